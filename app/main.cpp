@@ -1,62 +1,173 @@
 #include <iostream>
-#include <fstream>
 #include <vector>
 #include "Mesh.h"
-#include "Material.h"
+#include "MaterialTable.h"
 #include "Assembler.h"
+#include "LinearSolver.h"
+#include "SolverSession.h"
+#include "ModalSolver.h"
+#include "LoadCases.h"
+#include "BoundaryConditions.h"
+#include "AmgPreconditioner.h"
+#include "StressRecovery.h"
+#include "VtuWriter.h"
+#include "NodeOrdering.h"
+#include "MeshPartition.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <exception>
 #include <Eigen/Sparse>
-#include <Eigen/SparseCholesky>
-#include <Eigen/SparseLU>
-
-// A simple function to save the results to a VTK file for visualization
-void save_vtk(const std::string& filename, const Mesh& mesh, const Eigen::VectorXd& displacements) {
-    std::ofstream vtk_file(filename);
-    const auto& nodes = mesh.getNodes();
-    const auto& elements = mesh.getElements();
-
-    vtk_file << "# vtk DataFile Version 3.0\n";
-    vtk_file << "FEM Deformation\n";
-    vtk_file << "ASCII\n";
-    vtk_file << "DATASET UNSTRUCTURED_GRID\n";
-
-    // Write nodal positions
-    vtk_file << "POINTS " << nodes.size() << " double\n";
-    for (size_t i = 0; i < nodes.size(); ++i) {
-        vtk_file << (nodes[i].x + displacements(i * 3 + 0)) << " "
-                 << (nodes[i].y + displacements(i * 3 + 1)) << " "
-                 << (nodes[i].z + displacements(i * 3 + 2)) << "\n";
-    }
-
-    // Write element connectivity
-    vtk_file << "CELLS " << elements.size() << " " << elements.size() * 5 << "\n";
-    for (const auto& elem : elements) {
-        vtk_file << "4"; // 4 nodes per tetrahedron
-        for (int node_id : elem.connectivity) {
-            vtk_file << " " << (node_id - 1); // VTK uses 0-based indexing
-        }
-        vtk_file << "\n";
+#include <string>
+
+// Saves the results as a binary VTU file for visualization. Points are the
+// undeformed coordinates; warp by the Displacement field to see the deformation.
+bool save_vtu(const std::string& filename, const Mesh& mesh, const Eigen::VectorXd& displacements,
+              const StressResults& stresses, bool compress) {
+    VtuWriter writer(mesh);
+    writer.setCompression(compress ? VtuWriter::Compression::Zlib : VtuWriter::Compression::None);
+    writer.addPointData("Displacement", displacements, 3);
+    writer.addPointData("Stress", stresses.nodal_stress.data(), 6);
+    writer.addPointData("VonMises", stresses.nodal_von_mises, 1);
+    writer.addCellData("ElementStress", stresses.element_stress.data(), 6);
+    writer.addCellData("ElementVonMises", stresses.element_von_mises, 1);
+    if (!writer.write(filename)) {
+        return false;
     }
+    std::cout << "Successfully saved results to " << filename << std::endl;
+    return true;
+}
 
-    // Write element types (VTK_TETRA = 10)
-    vtk_file << "CELL_TYPES " << elements.size() << "\n";
-    for (size_t i = 0; i < elements.size(); ++i) {
-        vtk_file << "10\n";
+// Saves mode shapes (full-size, one column per mode) as point fields Mode1, Mode2, ...
+bool save_modes_vtu(const std::string& filename, const Mesh& mesh, const Eigen::MatrixXd& modes, bool compress) {
+    VtuWriter writer(mesh);
+    writer.setCompression(compress ? VtuWriter::Compression::Zlib : VtuWriter::Compression::None);
+    for (Eigen::Index m = 0; m < modes.cols(); ++m) {
+        writer.addPointData("Mode" + std::to_string(m + 1), modes.col(m).data(), 3);
     }
+    if (!writer.write(filename)) {
+        return false;
+    }
+    std::cout << "Successfully saved mode shapes to " << filename << std::endl;
+    return true;
+}
+
+void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " [--solver=lu|ldlt|llt|cg-jacobi|cg-ic|cg-amg|cg-schwarz]"
+              << " [--precision=double|mixed] [--tol=<relative residual>] [--max-iters=<n>] [--subdomains=<n>]"
+              << " [--reorder=natural|rcm|amd] [--loadcases=<file>] [--materials=<file>]"
+              << " [--modes=<n>] [--mass=consistent|lumped] [--output=<file.vtu>] [--compress]"
+              << " [--profile[=<file.json>]]" << std::endl;
+}
 
-    // Write displacement vectors for coloring
-    vtk_file << "POINT_DATA " << nodes.size() << "\n";
-    vtk_file << "VECTORS Displacements double\n";
-    for (size_t i = 0; i < nodes.size(); ++i) {
-        vtk_file << displacements(i * 3 + 0) << " "
-                 << displacements(i * 3 + 1) << " "
-                 << displacements(i * 3 + 2) << "\n";
+// Parses all of text as a number; false on junk, trailing characters or overflow
+bool parse_int(const std::string& text, int& value) {
+    try {
+        size_t used = 0;
+        value = std::stoi(text, &used);
+        return used == text.size();
+    } catch (const std::exception&) {
+        return false;
     }
+}
 
-    vtk_file.close();
-    std::cout << "Successfully saved results to " << filename << std::endl;
+bool parse_double(const std::string& text, double& value) {
+    try {
+        size_t used = 0;
+        value = std::stod(text, &used);
+        return used == text.size();
+    } catch (const std::exception&) {
+        return false;
+    }
 }
 
-int main() {
+int main(int argc, char** argv) {
+    // === 0. COMMAND LINE ===
+    SolverType solver_type = SolverType::SparseLU;
+    SolverPrecision precision = SolverPrecision::Double;
+    double tolerance = 1e-10;
+    int max_iterations = -1;
+    int num_subdomains = 0; // cg-schwarz: one per hardware thread
+    int num_modes = 0;      // Lowest natural modes to extract, none by default
+    MassMatrixType mass_type = MassMatrixType::Consistent;
+    NodeOrdering node_ordering = NodeOrdering::Natural;
+    std::string output_file = "result.vtu";
+    bool compress_output = false;
+    std::string loadcase_file;
+    std::string material_file;
+    std::string profile_file;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--solver=", 0) == 0) {
+            if (!parseSolverType(arg.substr(9), solver_type)) {
+                std::cerr << "Error: Unknown solver '" << arg.substr(9) << "'" << std::endl;
+                print_usage(argv[0]);
+                return -1;
+            }
+        } else if (arg.rfind("--precision=", 0) == 0) {
+            if (!parseSolverPrecision(arg.substr(12), precision)) {
+                std::cerr << "Error: Unknown precision '" << arg.substr(12) << "'" << std::endl;
+                print_usage(argv[0]);
+                return -1;
+            }
+        } else if (arg.rfind("--tol=", 0) == 0) {
+            if (!parse_double(arg.substr(6), tolerance) || !(tolerance > 0.0)) {
+                std::cerr << "Error: Invalid tolerance '" << arg.substr(6) << "'" << std::endl;
+                print_usage(argv[0]);
+                return -1;
+            }
+        } else if (arg.rfind("--max-iters=", 0) == 0) {
+            if (!parse_int(arg.substr(12), max_iterations) || max_iterations <= 0) {
+                std::cerr << "Error: Invalid iteration limit '" << arg.substr(12) << "'" << std::endl;
+                print_usage(argv[0]);
+                return -1;
+            }
+        } else if (arg.rfind("--subdomains=", 0) == 0) {
+            if (!parse_int(arg.substr(13), num_subdomains) || num_subdomains < 0) {
+                std::cerr << "Error: Invalid subdomain count '" << arg.substr(13) << "'" << std::endl;
+                print_usage(argv[0]);
+                return -1;
+            }
+        } else if (arg.rfind("--modes=", 0) == 0) {
+            if (!parse_int(arg.substr(8), num_modes) || num_modes < 0) {
+                std::cerr << "Error: Invalid mode count '" << arg.substr(8) << "'" << std::endl;
+                print_usage(argv[0]);
+                return -1;
+            }
+        } else if (arg == "--mass=consistent" || arg == "--mass=lumped") {
+            mass_type = arg == "--mass=lumped" ? MassMatrixType::Lumped : MassMatrixType::Consistent;
+        } else if (arg.rfind("--reorder=", 0) == 0) {
+            if (!parseNodeOrdering(arg.substr(10), node_ordering)) {
+                std::cerr << "Error: Unknown node ordering '" << arg.substr(10) << "'" << std::endl;
+                print_usage(argv[0]);
+                return -1;
+            }
+        } else if (arg.rfind("--loadcases=", 0) == 0) {
+            loadcase_file = arg.substr(12);
+        } else if (arg.rfind("--materials=", 0) == 0) {
+            material_file = arg.substr(12);
+        } else if (arg.rfind("--output=", 0) == 0) {
+            output_file = arg.substr(9);
+        } else if (arg == "--compress") {
+            compress_output = true;
+        } else if (arg == "--profile" || arg.rfind("--profile=", 0) == 0) {
+            profile_file = arg.size() > 10 ? arg.substr(10) : "profile.json";
+        } else {
+            print_usage(argv[0]);
+            return -1;
+        }
+    }
+
+    if (!profile_file.empty()) {
+#if !defined(FEM_ENABLE_PROFILING) || !FEM_ENABLE_PROFILING
+        std::cerr << "Warning: Built without FEM_ENABLE_PROFILING, " << profile_file
+                  << " will only hold process totals" << std::endl;
+#endif
+        Profiler::instance().setEnabled(true);
+        Profiler::instance().reset();
+    }
+
     // === 1. SETUP ===
     std::cout << "1. Setting up simulation..." << std::endl;
     Mesh mesh;
@@ -64,80 +175,227 @@ int main() {
     if (!mesh.loadFromFile("single_tet.mesh")) {
         return -1;
     }
+    // Steel for every element unless a material file maps the mesh's material IDs
     Material steel(210e9, 0.3);
+    steel.setDensity(7850.0);
+    MaterialTable materials(steel);
+    if (!material_file.empty() && !loadMaterialTable(material_file, materials)) {
+        return -1;
+    }
     Assembler assembler;
 
+    // Renumber nodes for the solver; results are mapped back after the solve
+    std::vector<int> node_permutation;
+    if (node_ordering != NodeOrdering::Natural) {
+        NodeAdjacency adjacency = buildNodeAdjacency(mesh, buildNodeElementIncidence(mesh));
+        node_permutation = computeNodeOrdering(adjacency, node_ordering);
+        OrderingQuality before = measureNodeOrdering(adjacency);
+        OrderingQuality after = measureNodeOrdering(adjacency, node_permutation);
+        std::cout << "   " << nodeOrderingName(node_ordering) << " renumbering: bandwidth " << before.bandwidth
+                  << " -> " << after.bandwidth << ", factor nnz " << before.factor_nonzeros << " -> "
+                  << after.factor_nonzeros << std::endl;
+        mesh.permuteNodes(node_permutation);
+    }
+
     // === 2. ASSEMBLE ===
     std::cout << "2. Assembling global stiffness matrix..." << std::endl;
-    Eigen::SparseMatrix<double> K = assembler.assembleGlobalStiffness(mesh, steel);
+    Eigen::SparseMatrix<double> K;
+    try {
+        K = assembler.assembleGlobalStiffness(mesh, materials);
+    } catch (const std::out_of_range& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return -1;
+    }
+    std::cout << "   " << materials.size() << " material(s)" << std::endl;
 
     // === 3. DEFINE BCs AND LOADS ===
     std::cout << "3. Defining boundary conditions and loads..." << std::endl;
-    size_t total_dofs = mesh.getNodes().size() * 3;
-    Eigen::VectorXd F = Eigen::VectorXd::Zero(total_dofs);
-    Eigen::VectorXd U = Eigen::VectorXd::Zero(total_dofs);
-
-    // Apply a downward force on the free node (ID=4, index=3)
-    int loaded_node_index = 3;
-    double force_magnitude = -1e7; // 10 MegaNewtons downwards
-    F(loaded_node_index * 3 + 2) = force_magnitude; // Apply in Z-direction
-
-    // Identify fixed nodes (nodes 1, 2, and 3 are on the z=0 plane)
-    std::vector<int> fixed_dofs;
-    fixed_dofs.push_back(0 * 3 + 0); fixed_dofs.push_back(0 * 3 + 1); fixed_dofs.push_back(0 * 3 + 2); // Node 1
-    fixed_dofs.push_back(1 * 3 + 0); fixed_dofs.push_back(1 * 3 + 1); fixed_dofs.push_back(1 * 3 + 2); // Node 2
-    fixed_dofs.push_back(2 * 3 + 0); fixed_dofs.push_back(2 * 3 + 1); fixed_dofs.push_back(2 * 3 + 2); // Node 3
-
-    // === 4. MODIFY SYSTEM FOR BCs ===
-    std::cout << "4. Applying boundary conditions..." << std::endl;
-    double penalty = 1e12 * K.diagonal().mean();
-    for (int dof : fixed_dofs) {
-        K.coeffRef(dof, dof) += penalty;
-        F(dof) = 0.0;
-    }
-
-    // === 5. SOLVE ===
-    std::cout << "5. Solving the linear system..." << std::endl;
-    Eigen::SparseLU<Eigen::SparseMatrix<double>> solver;
-    solver.compute(K);
-    if(solver.info() != Eigen::Success) {
-        std::cerr << "Error: Matrix decomposition failed." << std::endl;
+    std::vector<LoadCase> load_cases;
+    if (!loadcase_file.empty()) {
+        if (!loadLoadCases(loadcase_file, load_cases)) {
+            return -1;
+        }
+    } else {
+        // Apply a downward force of 10 MegaNewtons on the free node (ID=4)
+        load_cases.push_back({"default", {{4, 0.0, 0.0, -1e7}}});
+    }
+    Eigen::MatrixXd F;
+    try {
+        F = buildLoadMatrix(mesh, load_cases);
+    } catch (const std::out_of_range& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
         return -1;
     }
-    U = solver.solve(F);
-    if(solver.info() != Eigen::Success) {
-        std::cerr << "Error: Linear system solve failed." << std::endl;
+    std::cout << "   " << load_cases.size() << " load case(s)" << std::endl;
+
+    // Fix nodes 1, 2 and 3 (the z=0 plane)
+    BoundaryConditions bcs(mesh);
+    bcs.fixNodes({1, 2, 3});
+
+    // === 4. MODIFY SYSTEM FOR BCs AND FACTORIZE ONCE ===
+    std::cout << "4. Applying boundary conditions and factorizing (" << solverTypeName(solver_type) << ", "
+              << solverPrecisionName(precision) << " precision)..." << std::endl;
+    SolverSession session(bcs, solver_type);
+    session.solver().setNearNullspace(bcs.restrictRows(AmgPreconditioner::rigidBodyModes(mesh)));
+    session.solver().setTolerance(tolerance);
+    session.solver().setMaxIterations(max_iterations);
+    session.solver().setPrecision(precision);
+    if (solver_type == SolverType::CGSchwarz) {
+        int parts = num_subdomains > 0 ? num_subdomains : static_cast<int>(resolveThreadCount(0));
+        parts = std::min(parts, static_cast<int>(mesh.getNumNodes()));
+        MeshPartition partition = partitionMeshRCB(mesh, parts);
+        session.solver().setSubdomains(partitionFreeDofs(partition, bcs));
+        std::vector<size_t> sizes = partition.partSizes();
+        std::cout << "   " << parts << " subdomain(s) by coordinate bisection, "
+                  << *std::min_element(sizes.begin(), sizes.end()) << " to "
+                  << *std::max_element(sizes.begin(), sizes.end()) << " nodes each" << std::endl;
+    }
+    if (!session.setup(K)) {
         return -1;
     }
+    std::cout << "   " << bcs.getNumConstrainedDofs() << " constrained DOFs eliminated, "
+              << bcs.getNumFreeDofs() << " free DOFs remain" << std::endl;
+    SolverStats setup_stats = session.getStats();
+    std::cout << "   analyze:   " << setup_stats.analyze_seconds << " s" << std::endl;
+    std::cout << "   factorize: " << setup_stats.factorize_seconds << " s" << std::endl;
+
+    // === 5. SOLVE ALL LOAD CASES AS ONE BLOCK ===
+    std::cout << "5. Solving " << load_cases.size() << " load case(s)..." << std::endl;
+    Eigen::MatrixXd U;
+    if (!session.solve(F, U)) {
+        return -1;
+    }
+    const SolverStats& stats = session.getStats();
+    std::cout << "   solve:     " << stats.solve_seconds << " s ("
+              << stats.solve_seconds / stats.right_hand_sides << " s per case)" << std::endl;
+    std::cout << "   iterations: " << stats.iterations << ", worst relative residual: " << stats.residual
+              << std::endl;
+    if (precision == SolverPrecision::Mixed) {
+        std::cout << "   refinement steps: " << stats.refinements << std::endl;
+    }
+
+    // Modes of the same constrained model, one factorization of K for all Lanczos steps
+    Eigen::MatrixXd modes;
+    if (num_modes > 0) {
+        std::cout << "   Extracting the lowest " << num_modes << " mode(s), "
+                  << (mass_type == MassMatrixType::Lumped ? "lumped" : "consistent") << " mass..." << std::endl;
+        // A material file may leave the density out, which leaves M singular
+        for (int material_id : mesh.getElementMaterials()) {
+            if (!(materials[material_id].getDensity() > 0.0)) {
+                std::cerr << "Error: Material " << material_id << " has no density; --modes needs a positive density"
+                          << " for every material (the last value of its line in " << material_file << ")"
+                          << std::endl;
+                return -1;
+            }
+        }
+        Eigen::SparseMatrix<double> M, K_ff, M_ff;
+        try {
+            M = assembler.assembleGlobalMass(mesh, materials, mass_type);
+        } catch (const std::invalid_argument& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return -1;
+        }
+        bcs.reduce(K, K_ff);
+        bcs.reduce(M, M_ff);
+        num_modes = std::min(num_modes, static_cast<int>(K_ff.rows()));
+        // Lanczos needs exact solves: a direct --solver is used as is, CG falls back to LDLT
+        bool direct = solver_type == SolverType::SparseLU || solver_type == SolverType::LDLT ||
+                      solver_type == SolverType::LLT;
+        ModalSolver modal(direct ? solver_type : SolverType::LDLT);
+        ModalResults modal_results;
+        if (!modal.compute(K_ff, M_ff, num_modes, modal_results)) {
+            return -1;
+        }
+        const ModalStats& modal_stats = modal.getStats();
+        std::cout << "   " << modal_stats.lanczos_steps << " Lanczos steps, " << modal_stats.basis_size
+                  << " vectors, worst residual " << modal_stats.residual << std::endl;
+        for (int m = 0; m < num_modes; ++m) {
+            std::cout << "   mode " << m + 1 << ": " << modal_results.frequencies(m) << " Hz" << std::endl;
+        }
+        modes = bcs.expandHomogeneous(modal_results.modes);
+    }
+
+    if (!node_permutation.empty()) {
+        std::vector<int> restore = invertPermutation(node_permutation);
+        mesh.permuteNodes(restore);
+        for (Eigen::Index c = 0; c < U.cols(); ++c) {
+            U.col(c) = permuteNodeDofs(U.col(c), restore);
+        }
+        for (Eigen::Index m = 0; m < modes.cols(); ++m) {
+            modes.col(m) = permuteNodeDofs(modes.col(m), restore);
+        }
+    }
 
     // === VALIDATION STEP ===
-    std::cout << "\n--- Result Validation ---" << std::endl;
-    loaded_node_index = 3; // Node 4 is at index 3
-    double dx = U(loaded_node_index * 3 + 0);
-    double dy = U(loaded_node_index * 3 + 1);
-    double dz = U(loaded_node_index * 3 + 2);
-
-    std::cout << "Displacement of loaded node (Node 4):" << std::endl;
-    std::cout << "dx = " << dx << " m" << std::endl;
-    std::cout << "dy = " << dy << " m" << std::endl;
-    std::cout << "dz = " << dz << " m" << std::endl;
-
-    // Sanity checks
-    if (dz < 0) {
-        std::cout << "Check PASSED: Displacement in Z is negative (downward)." << std::endl;
-    } else {
-        std::cout << "Check FAILED: Displacement in Z should be negative." << std::endl;
+    if (loadcase_file.empty()) {
+        int loaded_node_index = mesh.getNodeIndex(4);
+        std::cout << "\n--- Result Validation ---" << std::endl;
+        double dx = U(loaded_node_index * 3 + 0, 0);
+        double dy = U(loaded_node_index * 3 + 1, 0);
+        double dz = U(loaded_node_index * 3 + 2, 0);
+
+        std::cout << "Displacement of loaded node (Node 4):" << std::endl;
+        std::cout << "dx = " << dx << " m" << std::endl;
+        std::cout << "dy = " << dy << " m" << std::endl;
+        std::cout << "dz = " << dz << " m" << std::endl;
+
+        // Sanity checks
+        if (dz < 0) {
+            std::cout << "Check PASSED: Displacement in Z is negative (downward)." << std::endl;
+        } else {
+            std::cout << "Check FAILED: Displacement in Z should be negative." << std::endl;
+        }
+        if (std::abs(dz) > std::abs(dx) && std::abs(dz) > std::abs(dy)) {
+            std::cout << "Check PASSED: Z-displacement is the largest component." << std::endl;
+        } else {
+            std::cout << "Check FAILED: Z-displacement should be the largest component." << std::endl;
+        }
     }
-    if (std::abs(dz) > std::abs(dx) && std::abs(dz) > std::abs(dy)) {
-        std::cout << "Check PASSED: Z-displacement is the largest component." << std::endl;
-    } else {
-        std::cout << "Check FAILED: Z-displacement should be the largest component." << std::endl;
+
+    // === 6. POST-PROCESS AND SAVE EACH LOAD CASE ===
+    std::cout << "6. Recovering stresses and saving results..." << std::endl;
+    StressRecovery recovery(mesh, 0);
+    StressResults stresses;
+    double solve_seconds = setup_stats.analyze_seconds + setup_stats.factorize_seconds + stats.solve_seconds;
+    double post_seconds = 0.0;
+    for (size_t c = 0; c < load_cases.size(); ++c) {
+        auto post_start = std::chrono::steady_clock::now();
+        Eigen::VectorXd U_case = U.col(c);
+        recovery.compute(materials, U_case, stresses);
+        post_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - post_start).count();
+        std::cout << "   " << load_cases[c].name << ": max element von Mises "
+                  << stresses.element_von_mises.maxCoeff() << " Pa" << std::endl;
+
+        // A single case keeps the output name; several get one file each
+        std::string filename = output_file;
+        if (load_cases.size() > 1) {
+            size_t dot = filename.rfind('.');
+            std::string stem = dot == std::string::npos ? filename : filename.substr(0, dot);
+            std::string extension = dot == std::string::npos ? ".vtu" : filename.substr(dot);
+            filename = stem + "_" + load_cases[c].name + extension;
+        }
+        if (!save_vtu(filename, mesh, U_case, stresses, compress_output)) {
+            return -1;
+        }
+    }
+    if (modes.cols() > 0) {
+        size_t dot = output_file.rfind('.');
+        std::string stem = dot == std::string::npos ? output_file : output_file.substr(0, dot);
+        if (!save_modes_vtu(stem + "_modes.vtu", mesh, modes, compress_output)) {
+            return -1;
+        }
     }
+    std::cout << "   post-processing: " << post_seconds << " s ("
+              << (solve_seconds > 0.0 ? 100.0 * post_seconds / solve_seconds : 0.0) << "% of solve time)" << std::endl;
 
-    // === 6. SAVE RESULTS ===
-    std::cout << "6. Saving results..." << std::endl;
-    save_vtk("result.vtk", mesh, U);
+    if (!profile_file.empty()) {
+        FEM_PROFILE_COUNTER("load_cases", load_cases.size());
+        if (!Profiler::instance().writeJson(profile_file)) {
+            return -1;
+        }
+        std::cout << "   profile written to " << profile_file << std::endl;
+    }
 
     std::cout << "\nSimulation finished successfully!" << std::endl;
     return 0;
-}
\ No newline at end of file
+}
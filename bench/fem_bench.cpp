@@ -0,0 +1,396 @@
+#include <benchmark/benchmark.h>
+#include "AmgPreconditioner.h"
+#include "Assembler.h"
+#include "BoundaryConditions.h"
+#include "ExplicitDynamics.h"
+#include "LinearSolver.h"
+#include "Material.h"
+#include "MeshGenerator.h"
+#include "MeshPartition.h"
+#include "StreamingAssembly.h"
+#include "StressRecovery.h"
+#include "Tet4Kernel.h"
+#include "VtuWriter.h"
+#include <Eigen/Core>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Every benchmark takes a target element count; the box is the cube of
+// cells closest to it (6 tets per cell). Each pipeline stage is timed on
+// its own, with its inputs prepared outside the timed loop.
+
+namespace {
+
+const Material kSteel(210e9, 0.3);
+
+int cellsPerSide(int64_t elements) {
+    return std::max(1, static_cast<int>(std::lround(std::cbrt(elements / 6.0))));
+}
+
+// The most recently used box mesh, kept across benchmarks of the same size
+const Mesh& boxMesh(int64_t elements) {
+    static int cached_n = 0;
+    static std::unique_ptr<Mesh> cached;
+    int n = cellsPerSide(elements);
+    if (n != cached_n) {
+        cached.reset();
+        cached.reset(new Mesh(generateBoxMesh(n, n, n)));
+        cached_n = n;
+    }
+    return *cached;
+}
+
+void setCounters(benchmark::State& state, const Mesh& mesh) {
+    state.counters["elements"] = static_cast<double>(mesh.getNumElements());
+    state.counters["nodes"] = static_cast<double>(mesh.getNumNodes());
+    state.counters["dofs"] = static_cast<double>(3 * mesh.getNumNodes());
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(mesh.getNumElements()));
+}
+
+// Clamps the z = 0 face and pulls the z = top face down
+void boxLoadCase(const Mesh& mesh, BoundaryConditions& bcs, Eigen::VectorXd& F) {
+    int n = cellsPerSide(static_cast<int64_t>(mesh.getNumElements()));
+    int per_layer = (n + 1) * (n + 1);
+    std::vector<int> bottom(per_layer);
+    for (int k = 0; k < per_layer; ++k) {
+        bottom[k] = 1 + k;
+    }
+    bcs.fixNodes(bottom);
+    F = Eigen::VectorXd::Zero(3 * mesh.getNumNodes());
+    for (int k = 0; k < per_layer; ++k) {
+        F(3 * (mesh.getNumNodes() - per_layer + k) + 2) = -1e3;
+    }
+}
+
+std::string tempPath(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+void BM_GenerateMesh(benchmark::State& state) {
+    int n = cellsPerSide(state.range(0));
+    for (auto _ : state) {
+        Mesh mesh = generateBoxMesh(n, n, n);
+        benchmark::DoNotOptimize(mesh.getConnectivity().data());
+    }
+    setCounters(state, boxMesh(state.range(0)));
+}
+
+void BM_LoadTextMesh(benchmark::State& state) {
+    const Mesh& source = boxMesh(state.range(0));
+    std::string filename = tempPath("fem_bench_box.mesh");
+    if (!source.saveText(filename)) {
+        state.SkipWithError("could not write the text mesh");
+        return;
+    }
+    for (auto _ : state) {
+        Mesh mesh;
+        if (!mesh.loadFromFile(filename)) {
+            state.SkipWithError("could not load the text mesh");
+            break;
+        }
+    }
+    std::remove(filename.c_str());
+    setCounters(state, source);
+}
+
+void BM_LoadBinaryMesh(benchmark::State& state) {
+    const Mesh& source = boxMesh(state.range(0));
+    std::string filename = tempPath("fem_bench_box.femb");
+    if (!source.saveBinary(filename)) {
+        state.SkipWithError("could not write the binary mesh");
+        return;
+    }
+    for (auto _ : state) {
+        Mesh mesh;
+        if (!mesh.loadFromFile(filename)) {
+            state.SkipWithError("could not load the binary mesh");
+            break;
+        }
+    }
+    std::remove(filename.c_str());
+    setCounters(state, source);
+}
+
+void BM_Assemble(benchmark::State& state) {
+    const Mesh& mesh = boxMesh(state.range(0));
+    Assembler assembler(0);
+    for (auto _ : state) {
+        Eigen::SparseMatrix<double> K = assembler.assembleGlobalStiffness(mesh, kSteel);
+        benchmark::DoNotOptimize(K.valuePtr());
+    }
+    setCounters(state, mesh);
+}
+
+// Out-of-core assembly from the binary mesh into a disk matrix, with a
+// budget of state.range(1) MiB for the chunk and merge buffers
+void BM_StreamingAssemble(benchmark::State& state) {
+    const Mesh& mesh = boxMesh(state.range(0));
+    std::string mesh_filename = tempPath("fem_bench_stream.femb");
+    std::string matrix_filename = tempPath("fem_bench_stream.femcsc");
+    if (!mesh.saveBinary(mesh_filename)) {
+        state.SkipWithError("could not write the binary mesh");
+        return;
+    }
+    StreamingAssembler streaming(static_cast<size_t>(state.range(1)) << 20, 0);
+    for (auto _ : state) {
+        if (!streaming.assembleToFile(mesh_filename, kSteel, matrix_filename)) {
+            state.SkipWithError("streaming assembly failed");
+            break;
+        }
+    }
+    const StreamingAssemblyStats& stats = streaming.getStats();
+    state.counters["chunks"] = static_cast<double>(stats.chunks);
+    state.counters["merge_passes"] = static_cast<double>(stats.merge_passes);
+    state.counters["spilled_bytes"] = static_cast<double>(stats.spilled_bytes);
+    std::remove(mesh_filename.c_str());
+    std::remove(matrix_filename.c_str());
+    setCounters(state, mesh);
+}
+
+// K * x with K in scalar CSC form (state.range(1) = 0) or as upper 3x3
+// blocks (1); the matrix_bytes counter is the storage each form needs
+void BM_SpMV(benchmark::State& state) {
+    const Mesh& mesh = boxMesh(state.range(0));
+    Assembler assembler(0);
+    AssemblyPattern pattern = assembler.buildPattern(mesh);
+    Eigen::VectorXd x = Eigen::VectorXd::Random(3 * mesh.getNumNodes());
+    Eigen::VectorXd y(x.size());
+    if (state.range(1)) {
+        SymmetricBlockMatrix K = assembler.assembleBlockStiffness(mesh, kSteel, pattern);
+        for (auto _ : state) {
+            y.noalias() = K * x;
+            benchmark::DoNotOptimize(y.data());
+        }
+        state.counters["matrix_bytes"] = static_cast<double>(K.memoryBytes());
+    } else {
+        Eigen::SparseMatrix<double> K = assembler.assembleGlobalStiffness(mesh, kSteel, pattern);
+        for (auto _ : state) {
+            y.noalias() = K * x;
+            benchmark::DoNotOptimize(y.data());
+        }
+        state.counters["matrix_bytes"] =
+            static_cast<double>(K.nonZeros() * (sizeof(double) + sizeof(int)) + (K.cols() + 1) * sizeof(int));
+    }
+    setCounters(state, mesh);
+}
+
+void BM_ApplyBoundaryConditions(benchmark::State& state) {
+    const Mesh& mesh = boxMesh(state.range(0));
+    Eigen::SparseMatrix<double> K = Assembler(0).assembleGlobalStiffness(mesh, kSteel);
+    for (auto _ : state) {
+        BoundaryConditions bcs(mesh);
+        Eigen::VectorXd F;
+        boxLoadCase(mesh, bcs, F);
+        Eigen::SparseMatrix<double> K_ff;
+        Eigen::VectorXd F_f;
+        bcs.reduce(K, F, K_ff, F_f);
+        benchmark::DoNotOptimize(K_ff.valuePtr());
+    }
+    setCounters(state, mesh);
+}
+
+// Factorization (state.range(1) = 0) or the solve with a computed factor (1)
+void BM_DirectSolver(benchmark::State& state) {
+    const Mesh& mesh = boxMesh(state.range(0));
+    Eigen::SparseMatrix<double> K = Assembler(0).assembleGlobalStiffness(mesh, kSteel);
+    BoundaryConditions bcs(mesh);
+    Eigen::VectorXd F;
+    boxLoadCase(mesh, bcs, F);
+    Eigen::SparseMatrix<double> K_ff;
+    Eigen::VectorXd F_f;
+    bcs.reduce(K, F, K_ff, F_f);
+
+    LinearSolver solver(SolverType::LDLT);
+    bool solve_only = state.range(1) != 0;
+    if (solve_only && !solver.compute(K_ff)) {
+        state.SkipWithError("factorization failed");
+        return;
+    }
+    Eigen::VectorXd U_f;
+    for (auto _ : state) {
+        if (!solve_only && !solver.compute(K_ff)) {
+            state.SkipWithError("factorization failed");
+            break;
+        }
+        if (solve_only && !solver.solve(F_f, U_f)) {
+            state.SkipWithError("solve failed");
+            break;
+        }
+    }
+    setCounters(state, mesh);
+    state.counters["nnz"] = static_cast<double>(K_ff.nonZeros());
+}
+
+void BM_IterativeSolver(benchmark::State& state) {
+    const Mesh& mesh = boxMesh(state.range(0));
+    Eigen::SparseMatrix<double> K = Assembler(0).assembleGlobalStiffness(mesh, kSteel);
+    BoundaryConditions bcs(mesh);
+    Eigen::VectorXd F;
+    boxLoadCase(mesh, bcs, F);
+    Eigen::SparseMatrix<double> K_ff;
+    Eigen::VectorXd F_f;
+    bcs.reduce(K, F, K_ff, F_f);
+
+    LinearSolver solver(SolverType::CGAMG);
+    solver.setTolerance(1e-8);
+    solver.setNearNullspace(bcs.restrictRows(AmgPreconditioner::rigidBodyModes(mesh)));
+    Eigen::VectorXd U_f;
+    for (auto _ : state) {
+        if (!solver.compute(K_ff) || !solver.solve(F_f, U_f)) {
+            state.SkipWithError("CG-AMG failed");
+            break;
+        }
+    }
+    setCounters(state, mesh);
+    state.counters["iterations"] = solver.getStats().iterations;
+}
+
+// CG with the two-level Schwarz preconditioner, one RCB subdomain per
+// thread; state.range(1) threads. Compare the thread counts for the speedup.
+void BM_SchwarzSolver(benchmark::State& state) {
+    const Mesh& mesh = boxMesh(state.range(0));
+    Eigen::SparseMatrix<double> K = Assembler(0).assembleGlobalStiffness(mesh, kSteel);
+    BoundaryConditions bcs(mesh);
+    Eigen::VectorXd F;
+    boxLoadCase(mesh, bcs, F);
+    Eigen::SparseMatrix<double> K_ff;
+    Eigen::VectorXd F_f;
+    bcs.reduce(K, F, K_ff, F_f);
+
+    unsigned threads = static_cast<unsigned>(state.range(1));
+    LinearSolver solver(SolverType::CGSchwarz);
+    solver.setTolerance(1e-8);
+    solver.setNumThreads(threads);
+    solver.setSubdomains(partitionFreeDofs(partitionMeshRCB(mesh, static_cast<int>(threads)), bcs));
+    solver.setNearNullspace(bcs.restrictRows(AmgPreconditioner::rigidBodyModes(mesh)));
+    Eigen::VectorXd U_f;
+    for (auto _ : state) {
+        if (!solver.compute(K_ff) || !solver.solve(F_f, U_f)) {
+            state.SkipWithError("CG-Schwarz failed");
+            break;
+        }
+    }
+    setCounters(state, mesh);
+    state.counters["iterations"] = solver.getStats().iterations;
+}
+
+void BM_RecoverStresses(benchmark::State& state) {
+    const Mesh& mesh = boxMesh(state.range(0));
+    Eigen::VectorXd U = Eigen::VectorXd::Random(3 * mesh.getNumNodes()) * 1e-3;
+    StressRecovery recovery(mesh, 0);
+    StressResults results;
+    for (auto _ : state) {
+        recovery.compute(kSteel, U, results);
+        benchmark::DoNotOptimize(results.nodal_von_mises.data());
+    }
+    setCounters(state, mesh);
+}
+
+// One explicit time step (internal forces of every element and the update),
+// all hardware threads; items are element updates
+void BM_ExplicitStep(benchmark::State& state) {
+    const Mesh& mesh = boxMesh(state.range(0));
+    BoundaryConditions bcs(mesh);
+    Eigen::VectorXd F;
+    boxLoadCase(mesh, bcs, F);
+    Material steel = kSteel;
+    steel.setDensity(7850.0);
+    ExplicitDynamics engine(mesh, steel, bcs, 0);
+    engine.setExternalForce(F);
+    engine.run(1);
+    for (auto _ : state) {
+        engine.run(1);
+    }
+    setCounters(state, mesh);
+}
+
+// Raw (state.range(1) = 0) or zlib-compressed (1) VTU output
+void BM_WriteVtu(benchmark::State& state) {
+    const Mesh& mesh = boxMesh(state.range(0));
+    Eigen::VectorXd U = Eigen::VectorXd::Random(3 * mesh.getNumNodes()) * 1e-3;
+    StressResults results;
+    StressRecovery(mesh, 0).compute(kSteel, U, results);
+
+    VtuWriter writer(mesh);
+    writer.setCompression(state.range(1) ? VtuWriter::Compression::Zlib : VtuWriter::Compression::None);
+    writer.addPointData("Displacement", U, 3);
+    writer.addPointData("VonMises", results.nodal_von_mises, 1);
+    writer.addCellData("ElementStress", results.element_stress.data(), 6);
+    std::string filename = tempPath("fem_bench_box.vtu");
+    for (auto _ : state) {
+        if (!writer.write(filename)) {
+            state.SkipWithError("could not write the VTU file");
+            break;
+        }
+    }
+    state.counters["file_bytes"] = static_cast<double>(std::filesystem::file_size(filename));
+    std::remove(filename.c_str());
+    setCounters(state, mesh);
+}
+
+} // namespace
+
+// Element counts 10^3 .. 10^7. Assembling 10^7 elements needs well over
+// 8 GB; pick sizes with --benchmark_filter on smaller machines. A direct
+// factorization of the largest boxes does not fit in memory at all, so the
+// solver benchmarks stop earlier.
+BENCHMARK(BM_GenerateMesh)->RangeMultiplier(10)->Range(1000, 10000000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LoadTextMesh)->RangeMultiplier(10)->Range(1000, 10000000)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_LoadBinaryMesh)->RangeMultiplier(10)->Range(1000, 10000000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Assemble)->RangeMultiplier(10)->Range(1000, 10000000)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_StreamingAssemble)
+    ->ArgsProduct({benchmark::CreateRange(1000, 1000000, 10), {1, 64}})
+    ->ArgNames({"elements", "budget_mib"})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK(BM_SpMV)
+    ->ArgsProduct({benchmark::CreateRange(1000, 1000000, 10), {0, 1}})
+    ->ArgNames({"elements", "blocks"})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ApplyBoundaryConditions)->RangeMultiplier(10)->Range(1000, 10000000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_DirectSolver)
+    ->ArgsProduct({benchmark::CreateRange(1000, 100000, 10), {0, 1}})
+    ->ArgNames({"elements", "solve_only"})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_IterativeSolver)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SchwarzSolver)
+    ->ArgsProduct({benchmark::CreateRange(1000, 10000000, 10), {1, 2, 4, 8, 16, 32, 64}})
+    ->ArgNames({"elements", "threads"})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK(BM_RecoverStresses)->RangeMultiplier(10)->Range(1000, 10000000)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_ExplicitStep)->RangeMultiplier(10)->Range(1000, 10000000)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_WriteVtu)
+    ->ArgsProduct({benchmark::CreateRange(1000, 10000000, 10), {0, 1}})
+    ->ArgNames({"elements", "zlib"})
+    ->Unit(benchmark::kMillisecond);
+
+// Like BENCHMARK_MAIN, but results also go to fem_bench.json unless
+// --benchmark_out says otherwise, so every run leaves a file to compare.
+int main(int argc, char** argv) {
+    std::vector<char*> args(argv, argv + argc);
+    std::string out = "--benchmark_out=fem_bench.json";
+    std::string format = "--benchmark_out_format=json";
+    bool has_out = false;
+    for (int i = 1; i < argc; ++i) {
+        has_out = has_out || std::string(argv[i]).rfind("--benchmark_out=", 0) == 0;
+    }
+    if (!has_out) {
+        args.push_back(&out[0]);
+        args.push_back(&format[0]);
+    }
+    int count = static_cast<int>(args.size());
+    benchmark::Initialize(&count, args.data());
+    if (benchmark::ReportUnrecognizedArguments(count, args.data())) {
+        return 1;
+    }
+    benchmark::AddCustomContext("tet4_batch_width", std::to_string(kTet4BatchWidth));
+    benchmark::AddCustomContext("zlib", VtuWriter::zlibAvailable() ? "yes" : "no");
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,256 @@
+#include "AmgPreconditioner.h"
+#include <Eigen/QR>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Node adjacency (CSR) implied by the nonzeros of A, where dof_node maps each
+// DOF to the node it belongs to.
+void buildNodeGraph(const Eigen::SparseMatrix<double>& A, const std::vector<int>& dof_node, int num_nodes,
+                    std::vector<int>& offsets, std::vector<int>& adjacency) {
+    std::vector<std::vector<int>> nbrs(num_nodes);
+    std::vector<int> mark(num_nodes, -1);
+
+    // DOFs of one node are contiguous, so walk the columns node by node
+    for (Eigen::Index col = 0; col < A.outerSize();) {
+        int node = dof_node[col];
+        for (; col < A.outerSize() && dof_node[col] == node; ++col) {
+            for (Eigen::SparseMatrix<double>::InnerIterator it(A, col); it; ++it) {
+                int other = dof_node[it.row()];
+                if (other != node && it.value() != 0.0 && mark[other] != node) {
+                    mark[other] = node;
+                    nbrs[node].push_back(other);
+                }
+            }
+        }
+    }
+
+    offsets.assign(num_nodes + 1, 0);
+    adjacency.clear();
+    for (int n = 0; n < num_nodes; ++n) {
+        adjacency.insert(adjacency.end(), nbrs[n].begin(), nbrs[n].end());
+        offsets[n + 1] = static_cast<int>(adjacency.size());
+    }
+}
+
+// Standard three-pass greedy aggregation; returns the aggregate of every node.
+int aggregateNodes(const std::vector<int>& offsets, const std::vector<int>& adjacency, std::vector<int>& aggregate) {
+    int num_nodes = static_cast<int>(offsets.size()) - 1;
+    aggregate.assign(num_nodes, -1);
+    int num_aggregates = 0;
+
+    // 1. Seed aggregates from nodes whose whole neighbourhood is still free
+    for (int n = 0; n < num_nodes; ++n) {
+        if (aggregate[n] >= 0) {
+            continue;
+        }
+        bool free = true;
+        for (int k = offsets[n]; k < offsets[n + 1] && free; ++k) {
+            free = aggregate[adjacency[k]] < 0;
+        }
+        if (!free) {
+            continue;
+        }
+        aggregate[n] = num_aggregates;
+        for (int k = offsets[n]; k < offsets[n + 1]; ++k) {
+            aggregate[adjacency[k]] = num_aggregates;
+        }
+        ++num_aggregates;
+    }
+
+    // 2. Attach leftovers to a neighbouring aggregate
+    std::vector<int> pass1 = aggregate;
+    for (int n = 0; n < num_nodes; ++n) {
+        if (aggregate[n] >= 0) {
+            continue;
+        }
+        for (int k = offsets[n]; k < offsets[n + 1]; ++k) {
+            if (pass1[adjacency[k]] >= 0) {
+                aggregate[n] = pass1[adjacency[k]];
+                break;
+            }
+        }
+    }
+
+    // 3. Anything still free (isolated nodes) becomes its own aggregate
+    for (int n = 0; n < num_nodes; ++n) {
+        if (aggregate[n] < 0) {
+            aggregate[n] = num_aggregates++;
+        }
+    }
+    return num_aggregates;
+}
+
+// Largest eigenvalue of D^-1 A by a few power iterations
+double estimateSpectralRadius(const Eigen::SparseMatrix<double>& A, const Eigen::VectorXd& inv_diag) {
+    Eigen::VectorXd v = Eigen::VectorXd::Ones(A.rows());
+    for (Eigen::Index i = 0; i < v.size(); i += 2) {
+        v(i) = -0.5; // Break the symmetry with the constant vector
+    }
+    double rho = 1.0;
+    for (int it = 0; it < 20; ++it) {
+        Eigen::VectorXd w = inv_diag.cwiseProduct(A * v);
+        double norm = w.norm();
+        if (norm == 0.0) {
+            break;
+        }
+        rho = norm / v.norm();
+        v = w / norm;
+    }
+    return rho;
+}
+
+} // namespace
+
+AmgPreconditioner::AmgPreconditioner()
+    : dofs_per_node_(3), max_coarse_size_(2000), info_(Eigen::Success) {}
+
+void AmgPreconditioner::setNearNullspace(const Eigen::MatrixXd& modes, int dofs_per_node) {
+    nullspace_ = modes;
+    dofs_per_node_ = dofs_per_node;
+}
+
+void AmgPreconditioner::setMaxCoarseSize(Eigen::Index max_coarse_size) {
+    max_coarse_size_ = max_coarse_size;
+}
+
+Eigen::MatrixXd AmgPreconditioner::rigidBodyModes(const Mesh& mesh) {
+    size_t num_nodes = mesh.getNumNodes();
+    Eigen::Map<const Eigen::VectorXd> xs(mesh.getX().data(), num_nodes);
+    Eigen::Map<const Eigen::VectorXd> ys(mesh.getY().data(), num_nodes);
+    Eigen::Map<const Eigen::VectorXd> zs(mesh.getZ().data(), num_nodes);
+    Eigen::Vector3d centroid = Eigen::Vector3d::Zero();
+    if (num_nodes > 0) {
+        centroid = Eigen::Vector3d(xs.mean(), ys.mean(), zs.mean());
+    }
+
+    Eigen::MatrixXd modes = Eigen::MatrixXd::Zero(num_nodes * 3, 6);
+    for (size_t i = 0; i < num_nodes; ++i) {
+        double x = xs(i) - centroid.x();
+        double y = ys(i) - centroid.y();
+        double z = zs(i) - centroid.z();
+        // Translations
+        modes(i * 3 + 0, 0) = 1.0;
+        modes(i * 3 + 1, 1) = 1.0;
+        modes(i * 3 + 2, 2) = 1.0;
+        // Rotations about x, y and z
+        modes(i * 3 + 1, 3) = -z; modes(i * 3 + 2, 3) = y;
+        modes(i * 3 + 0, 4) = z;  modes(i * 3 + 2, 4) = -x;
+        modes(i * 3 + 0, 5) = -y; modes(i * 3 + 1, 5) = x;
+    }
+    return modes;
+}
+
+void AmgPreconditioner::setup(Eigen::SparseMatrix<double> A) {
+    levels_.clear();
+    info_ = Eigen::Success;
+    A.makeCompressed();
+
+    // Fine-level near-nullspace and DOF -> node map
+    Eigen::MatrixXd B = nullspace_;
+    if (B.rows() != A.rows()) {
+        B = Eigen::MatrixXd::Zero(A.rows(), dofs_per_node_);
+        for (Eigen::Index dof = 0; dof < A.rows(); ++dof) {
+            B(dof, dof % dofs_per_node_) = 1.0;
+        }
+    }
+    std::vector<int> dof_node(A.rows());
+    for (Eigen::Index dof = 0; dof < A.rows(); ++dof) {
+        dof_node[dof] = static_cast<int>(dof / dofs_per_node_);
+    }
+    int num_nodes = A.rows() == 0 ? 0 : dof_node.back() + 1;
+
+    while (A.rows() > max_coarse_size_) {
+        Level level;
+        level.inv_diag = A.diagonal().cwiseInverse();
+
+        // 1. Aggregate the nodes of this level
+        std::vector<int> offsets, adjacency, aggregate;
+        buildNodeGraph(A, dof_node, num_nodes, offsets, adjacency);
+        int num_aggregates = aggregateNodes(offsets, adjacency, aggregate);
+
+        // 2. Tentative prolongator: orthonormalise the near-nullspace on each aggregate
+        std::vector<std::vector<Eigen::Index>> agg_dofs(num_aggregates);
+        for (Eigen::Index dof = 0; dof < A.rows(); ++dof) {
+            agg_dofs[aggregate[dof_node[dof]]].push_back(dof);
+        }
+        Eigen::Index num_modes = B.cols();
+        std::vector<Eigen::Triplet<double>> p_triplets;
+        std::vector<Eigen::Index> coarse_offset(num_aggregates + 1, 0);
+        std::vector<Eigen::MatrixXd> coarse_B(num_aggregates);
+        for (int a = 0; a < num_aggregates; ++a) {
+            const auto& dofs = agg_dofs[a];
+            Eigen::MatrixXd local(dofs.size(), num_modes);
+            for (size_t r = 0; r < dofs.size(); ++r) {
+                local.row(r) = B.row(dofs[r]);
+            }
+            Eigen::Index k = std::min<Eigen::Index>(local.rows(), num_modes);
+            Eigen::HouseholderQR<Eigen::MatrixXd> qr(local);
+            Eigen::MatrixXd Q = qr.householderQ() * Eigen::MatrixXd::Identity(local.rows(), k);
+            coarse_B[a] = qr.matrixQR().topRows(k).triangularView<Eigen::Upper>();
+            coarse_offset[a + 1] = coarse_offset[a] + k;
+            for (size_t r = 0; r < dofs.size(); ++r) {
+                for (Eigen::Index c = 0; c < k; ++c) {
+                    p_triplets.emplace_back(dofs[r], coarse_offset[a] + c, Q(r, c));
+                }
+            }
+        }
+        Eigen::Index coarse_size = coarse_offset.back();
+        if (coarse_size >= A.rows()) {
+            break; // Aggregation no longer coarsens, solve this level directly
+        }
+        Eigen::SparseMatrix<double> P_tent(A.rows(), coarse_size);
+        P_tent.setFromTriplets(p_triplets.begin(), p_triplets.end());
+
+        // 3. Smooth the prolongator: P = (I - omega D^-1 A) P_tent
+        level.omega = 4.0 / (3.0 * estimateSpectralRadius(A, level.inv_diag));
+        Eigen::SparseMatrix<double> AP = A * P_tent;
+        level.P = P_tent - (level.omega * level.inv_diag).asDiagonal() * AP;
+        level.P.makeCompressed();
+
+        // 4. Galerkin coarse operator and coarse near-nullspace
+        Eigen::SparseMatrix<double> A_coarse = level.P.transpose() * (A * level.P);
+        Eigen::MatrixXd B_coarse(coarse_size, num_modes);
+        std::vector<int> coarse_node(coarse_size);
+        for (int a = 0; a < num_aggregates; ++a) {
+            B_coarse.middleRows(coarse_offset[a], coarse_B[a].rows()) = coarse_B[a];
+            for (Eigen::Index c = coarse_offset[a]; c < coarse_offset[a + 1]; ++c) {
+                coarse_node[c] = a;
+            }
+        }
+
+        level.A = std::move(A);
+        levels_.push_back(std::move(level));
+        A = std::move(A_coarse);
+        A.makeCompressed();
+        B = std::move(B_coarse);
+        dof_node = std::move(coarse_node);
+        num_nodes = num_aggregates;
+    }
+
+    coarse_solver_.compute(A);
+    info_ = coarse_solver_.info();
+}
+
+void AmgPreconditioner::vcycle(size_t level, const Eigen::VectorXd& b, Eigen::VectorXd& x) const {
+    if (level == levels_.size()) {
+        x = coarse_solver_.solve(b);
+        return;
+    }
+    const Level& L = levels_[level];
+
+    // Pre-smooth from a zero initial guess
+    x = L.omega * L.inv_diag.cwiseProduct(b);
+
+    // Coarse-grid correction
+    Eigen::VectorXd r = b - L.A * x;
+    Eigen::VectorXd r_coarse = L.P.transpose() * r;
+    Eigen::VectorXd x_coarse;
+    vcycle(level + 1, r_coarse, x_coarse);
+    x += L.P * x_coarse;
+
+    // Post-smooth
+    r = b - L.A * x;
+    x += L.omega * L.inv_diag.cwiseProduct(r);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Mesh.h"
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+#include <vector>
+
+// Smoothed-aggregation algebraic multigrid preconditioner for elasticity,
+// usable as ConjugateGradient<SparseMatrix<double>, Lower|Upper, AmgPreconditioner>.
+//
+// Nodes are grouped into aggregates from the block sparsity of K. Each
+// aggregate's tentative prolongator is an orthonormal basis of the rigid-body
+// modes restricted to it, so translations and rotations are represented
+// exactly on the coarse level; the prolongator is then smoothed with one
+// damped Jacobi step. Levels are built until the coarse matrix is small
+// enough for a sparse LDLT, and apply() runs one symmetric V-cycle with
+// damped Jacobi pre- and post-smoothing.
+class AmgPreconditioner {
+public:
+    AmgPreconditioner();
+    template <typename MatType>
+    explicit AmgPreconditioner(const MatType& A) : AmgPreconditioner() { compute(A); }
+
+    // Near-nullspace (one column per mode, one row per DOF) and the number of
+    // DOFs per node. Without one, the 3 translations of a 3-DOF node are used.
+    void setNearNullspace(const Eigen::MatrixXd& modes, int dofs_per_node = 3);
+    void setMaxCoarseSize(Eigen::Index max_coarse_size);
+
+    template <typename MatType>
+    AmgPreconditioner& analyzePattern(const MatType&) { return *this; }
+    template <typename MatType>
+    AmgPreconditioner& factorize(const MatType& A) { return compute(A); }
+    template <typename MatType>
+    AmgPreconditioner& compute(const MatType& A) {
+        setup(Eigen::SparseMatrix<double>(A));
+        return *this;
+    }
+
+    template <typename Rhs>
+    Eigen::VectorXd solve(const Eigen::MatrixBase<Rhs>& b) const {
+        Eigen::VectorXd x;
+        vcycle(0, b.derived(), x);
+        return x;
+    }
+
+    Eigen::ComputationInfo info() const { return info_; }
+    size_t numLevels() const { return levels_.size() + 1; } // Including the direct coarse level
+    // Rows of the operator on a level, 0 the finest and numLevels() - 1 the coarse one
+    Eigen::Index levelSize(size_t level) const {
+        return level < levels_.size() ? levels_[level].A.rows() : coarse_solver_.rows();
+    }
+
+    // Translations and rotations about the centroid for every node of the mesh (3n x 6)
+    static Eigen::MatrixXd rigidBodyModes(const Mesh& mesh);
+
+private:
+    struct Level {
+        Eigen::SparseMatrix<double> A;
+        Eigen::SparseMatrix<double> P;
+        Eigen::VectorXd inv_diag;
+        double omega; // Jacobi damping, 4 / (3 * rho(D^-1 A))
+    };
+
+    void setup(Eigen::SparseMatrix<double> A);
+    void vcycle(size_t level, const Eigen::VectorXd& b, Eigen::VectorXd& x) const;
+
+    Eigen::MatrixXd nullspace_;
+    int dofs_per_node_;
+    Eigen::Index max_coarse_size_;
+    std::vector<Level> levels_;
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> coarse_solver_;
+    Eigen::ComputationInfo info_;
+};
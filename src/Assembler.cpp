@@ -1,53 +1,460 @@
 #include "Assembler.h"
+#include "ElementKernel.h"
+#include "MeshTopology.h"
 #include "Tet4Element.h"
+#include "Tet4Kernel.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
-Eigen::SparseMatrix<double> Assembler::assembleGlobalStiffness(const Mesh& mesh, const Material& mat) const {
-    const auto& nodes = mesh.getNodes();
-    const auto& elements = mesh.getElements();
+namespace {
 
-    if (nodes.empty()) {
+// Appends the nonzeros of one element's scale * [ke], taken from a kernel batch lane.
+void appendElementTriplets(const Mesh& mesh, size_t e, const Tet4Batch<kTet4BatchWidth>& batch, int lane,
+                           double scale, std::vector<Eigen::Triplet<double>>& triplet_list) {
+    // Connectivity holds 0-based node indices, DOF = 3 * index + component
+    const int* nodes = mesh.getElementNodes(e);
+    int global_dof_map[12];
+    for (int i = 0; i < 4; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            global_dof_map[i * 3 + c] = nodes[i] * 3 + c;
+        }
+    }
+
+    // Add [ke] into the triplet list
+    for (int i = 0; i < 12; ++i) {
+        for (int j = 0; j < 12; ++j) {
+            double value = scale * batch.stiffness(lane, i, j);
+            if (value != 0.0) {
+                triplet_list.emplace_back(global_dof_map[i], global_dof_map[j], value);
+            }
+        }
+    }
+}
+
+// Same for a fixed-size element matrix from the generic kernels
+template <int kDofs>
+void appendElementTriplets(const Mesh& mesh, size_t e, const Eigen::Matrix<double, kDofs, kDofs>& ke, double scale,
+                           std::vector<Eigen::Triplet<double>>& triplet_list) {
+    constexpr int kNodes = kDofs / 3;
+    const int* nodes = mesh.getElementNodes(e);
+    int global_dof_map[kDofs];
+    for (int i = 0; i < kNodes; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            global_dof_map[i * 3 + c] = nodes[i] * 3 + c;
+        }
+    }
+    for (int i = 0; i < kDofs; ++i) {
+        for (int j = 0; j < kDofs; ++j) {
+            double value = scale * ke(i, j);
+            if (value != 0.0) {
+                triplet_list.emplace_back(global_dof_map[i], global_dof_map[j], value);
+            }
+        }
+    }
+}
+
+// Runs the fixed-size kernel of a Tet10 or Hex8 run and hands each element
+// matrix to fn(e, ke). Tet4 runs go through the batched kernel instead, and
+// types without a kernel are skipped.
+template <typename ElementAt, typename Fn>
+void forEachGenericStiffness(const Mesh& mesh, ElementType type, const Eigen::Matrix<double, 6, 6>& D, size_t count,
+                             ElementAt&& element_at, Fn&& fn) {
+    dispatchElementType(type, [&](auto tag) {
+        constexpr ElementType Type = decltype(tag)::value;
+        ElementMatrix<Type> ke;
+        for (size_t k = 0; k < count; ++k) {
+            size_t e = element_at(k);
+            computeElementStiffness<Type>(gatherElementCoords<Type>(mesh, e), D, ke);
+            fn(e, ke);
+        }
+    });
+}
+
+// Runs the stiffness kernels over the pattern's coloring, calling
+// tet4_fn(e, batch, lane) or generic_fn(e, ke) for every element. Elements of
+// one color share no node, so concurrent callbacks never add to the same entry.
+template <typename Tet4Fn, typename GenericFn>
+void forEachColoredStiffness(const Mesh& mesh, const MaterialTable& materials, const ElementColoring& coloring,
+                             unsigned num_threads, const Tet4Geometry<kTet4BatchWidth>* cached, Tet4Fn&& tet4_fn,
+                             GenericFn&& generic_fn) {
+    std::vector<int> slots = materials.elementSlots(mesh);
+    for (size_t c = 0; c < coloring.numColors(); ++c) {
+        const size_t* color_begin = coloring.elements.data() + coloring.offsets[c];
+        size_t color_size = coloring.offsets[c + 1] - coloring.offsets[c];
+
+        parallelFor(color_size, num_threads, [&](size_t begin, size_t end, unsigned) {
+            const size_t* elements = color_begin + begin;
+            forEachElementRun(
+                mesh, materials, slots, end - begin, [&](size_t k) { return elements[k]; },
+                [&](ElementType type, const Eigen::Matrix<double, 6, 6>& D, size_t first, size_t count) {
+                    auto run_at = [&](size_t k) { return elements[first + k]; };
+                    if (type == ElementType::Tet4) {
+                        forEachTet4Stiffness(mesh, D, count, run_at, tet4_fn, cached);
+                        return;
+                    }
+                    forEachGenericStiffness(mesh, type, D, count, run_at, generic_fn);
+                });
+        });
+    }
+}
+
+// Adds scale * ke(i, j) of element e to the blocks of K on or above the
+// diagonal; the blocks below are their transposes and are skipped
+template <typename ElementMatrixAt>
+void addElementBlocks(const Mesh& mesh, size_t e, ElementMatrixAt&& ke, double scale, SymmetricBlockMatrix& K) {
+    const int* nodes = mesh.getElementNodes(e);
+    const int num_nodes = static_cast<int>(mesh.getElementNumNodes(e));
+    for (int p = 0; p < num_nodes; ++p) {
+        for (int q = 0; q < num_nodes; ++q) {
+            if (nodes[p] > nodes[q]) {
+                continue;
+            }
+            double* block = K.blockValues(K.findBlock(nodes[p], nodes[q]));
+            for (int a = 0; a < 3; ++a) {
+                for (int b = 0; b < 3; ++b) {
+                    block[3 * a + b] += scale * ke(3 * p + a, 3 * q + b);
+                }
+            }
+        }
+    }
+}
+
+// True if A is compressed with exactly the pattern's outer and inner indices,
+// so its value array can be refilled in place. Comparing the index arrays
+// costs far less than the assembly itself, and matching sizes alone would
+// let a matrix from another mesh of the same size through.
+bool hasStructure(const Eigen::SparseMatrix<double>& A, const Eigen::SparseMatrix<double>& structure) {
+    if (A.rows() != structure.rows() || A.cols() != structure.cols() || !A.isCompressed() ||
+        A.nonZeros() != structure.nonZeros()) {
+        return false;
+    }
+    return std::equal(A.outerIndexPtr(), A.outerIndexPtr() + A.outerSize() + 1, structure.outerIndexPtr()) &&
+           std::equal(A.innerIndexPtr(), A.innerIndexPtr() + A.nonZeros(), structure.innerIndexPtr());
+}
+
+} // namespace
+
+Assembler::Assembler(unsigned num_threads) : num_threads_(num_threads), geometry_(nullptr), scales_(nullptr) {}
+
+void Assembler::setNumThreads(unsigned num_threads) {
+    num_threads_ = num_threads;
+}
+
+unsigned Assembler::getNumThreads() const {
+    return num_threads_;
+}
+
+void Assembler::setGeometry(const ElementGeometry* geometry) {
+    geometry_ = geometry;
+}
+
+void Assembler::setElementScales(const std::vector<double>* scales) {
+    scales_ = scales;
+}
+
+const Tet4Geometry<kTet4BatchWidth>* Assembler::cachedGeometry(const Mesh& mesh) const {
+    return geometry_ && geometry_->matches(mesh) ? geometry_->blocks() : nullptr;
+}
+
+const double* Assembler::elementScales(const Mesh& mesh) const {
+    return scales_ && scales_->size() == mesh.getNumElements() ? scales_->data() : nullptr;
+}
+
+Eigen::SparseMatrix<double> Assembler::assembleGlobalStiffness(const Mesh& mesh, const MaterialTable& materials) const {
+    FEM_PROFILE_SCOPE("assembly");
+    if (mesh.getNumNodes() == 0) {
         return Eigen::SparseMatrix<double>(0, 0);
     }
 
-    size_t total_dofs = nodes.size() * 3; // 3 DOFs (x,y,z) per node
+    size_t total_dofs = mesh.getNumNodes() * 3; // 3 DOFs (x,y,z) per node
     Eigen::SparseMatrix<double> K(total_dofs, total_dofs);
-    
-    // Use a triplet list to efficiently build the sparse matrix
+
+    // Each thread fills its own triplet buffer for a contiguous range of the
+    // elements grouped by type and material, one kernel pass per run
+    std::vector<int> slots = materials.elementSlots(mesh);
+    std::vector<size_t> order = groupElementsByKernel(mesh, slots);
+    const Tet4Geometry<kTet4BatchWidth>* cached = cachedGeometry(mesh);
+    const double* scales = elementScales(mesh);
+    unsigned threads = resolveThreadCount(num_threads_);
+    std::vector<std::vector<Eigen::Triplet<double>>> buffers(threads);
+
+    parallelFor(order.size(), threads, [&](size_t begin, size_t end, unsigned t) {
+        auto& buffer = buffers[t];
+        buffer.reserve((end - begin) * 144); // 12x12 entries per Tet4
+        const size_t* elements = order.data() + begin;
+        forEachElementRun(
+            mesh, materials, slots, end - begin, [&](size_t k) { return elements[k]; },
+            [&](ElementType type, const Eigen::Matrix<double, 6, 6>& D, size_t first, size_t count) {
+                auto run_at = [&](size_t k) { return elements[first + k]; };
+                if (type == ElementType::Tet4) {
+                    forEachTet4Stiffness(
+                        mesh, D, count, run_at,
+                        [&](size_t e, const Tet4Batch<kTet4BatchWidth>& batch, int lane) {
+                            appendElementTriplets(mesh, e, batch, lane, scales ? scales[e] : 1.0, buffer);
+                        },
+                        cached);
+                    return;
+                }
+                forEachGenericStiffness(mesh, type, D, count, run_at, [&](size_t e, const auto& ke) {
+                    appendElementTriplets(mesh, e, ke, scales ? scales[e] : 1.0, buffer);
+                });
+            });
+    });
+
+    // Concatenate in thread order so the triplet list matches the serial one exactly
     std::vector<Eigen::Triplet<double>> triplet_list;
+    if (buffers.size() == 1) {
+        triplet_list.swap(buffers[0]);
+    } else {
+        size_t total = 0;
+        for (const auto& buffer : buffers) {
+            total += buffer.size();
+        }
+        triplet_list.reserve(total);
+        for (auto& buffer : buffers) {
+            triplet_list.insert(triplet_list.end(), buffer.begin(), buffer.end());
+            std::vector<Eigen::Triplet<double>>().swap(buffer);
+        }
+    }
+
+    // 4. Build the sparse matrix from the triplets
+    K.setFromTriplets(triplet_list.begin(), triplet_list.end());
+    FEM_PROFILE_COUNTER("assembly.triplets", triplet_list.size());
+    FEM_PROFILE_COUNTER("assembly.nonzeros", K.nonZeros());
+    return K;
+}
+
+AssemblyPattern Assembler::buildPattern(const Mesh& mesh) const {
+    FEM_PROFILE_SCOPE("assembly.pattern");
+    AssemblyPattern pattern;
 
-    for (const auto& elem_data : elements) {
-        // 1. Get the nodes for the current element
-        std::vector<Node> elem_nodes;
-        std::vector<size_t> global_dof_map;
-        elem_nodes.reserve(elem_data.connectivity.size());
-        global_dof_map.reserve(elem_data.connectivity.size() * 3);
+    size_t num_nodes = mesh.getNumNodes();
+    size_t num_elements = mesh.getNumElements();
+    size_t total_dofs = num_nodes * 3;
+    pattern.structure.resize(total_dofs, total_dofs);
 
-        for (int node_id : elem_data.connectivity) {
-            // Node IDs in file are 1-based, vector indices are 0-based
-            elem_nodes.push_back(nodes[node_id - 1]);
-            global_dof_map.push_back((node_id - 1) * 3 + 0); // Global X DOF
-            global_dof_map.push_back((node_id - 1) * 3 + 1); // Global Y DOF
-            global_dof_map.push_back((node_id - 1) * 3 + 2); // Global Z DOF
+    // 1. Node -> element incidence and sorted node neighbour lists
+    NodeAdjacency adjacency = buildNodeAdjacency(mesh, buildNodeElementIncidence(mesh));
+    const std::vector<size_t>& nbr_offsets = adjacency.offsets;
+    const std::vector<int>& nbrs = adjacency.neighbours;
+
+    // 2. Compressed structure: column 3n+a holds rows 3m+b for every neighbour m
+    Eigen::SparseMatrix<double>& K = pattern.structure;
+    K.resizeNonZeros(static_cast<Eigen::Index>(nbrs.size() * 9));
+    int* outer = K.outerIndexPtr();
+    int* inner = K.innerIndexPtr();
+    outer[0] = 0;
+    for (size_t n = 0; n < num_nodes; ++n) {
+        for (int a = 0; a < 3; ++a) {
+            int pos = outer[3 * n + a];
+            for (size_t k = nbr_offsets[n]; k < nbr_offsets[n + 1]; ++k) {
+                for (int b = 0; b < 3; ++b) {
+                    inner[pos++] = 3 * nbrs[k] + b;
+                }
+            }
+            outer[3 * n + a + 1] = pos;
+        }
+    }
+    std::fill(K.valuePtr(), K.valuePtr() + K.nonZeros(), 0.0);
+
+    // 3. Value positions of every element matrix entry
+    pattern.value_offsets.resize(num_elements + 1, 0);
+    for (size_t e = 0; e < num_elements; ++e) {
+        size_t ndof = mesh.getElementNumNodes(e) * 3;
+        pattern.value_offsets[e + 1] = pattern.value_offsets[e] + static_cast<Eigen::Index>(ndof * ndof);
+    }
+    pattern.value_map.resize(pattern.value_offsets.back());
+    for (size_t e = 0; e < num_elements; ++e) {
+        const int* conn = mesh.getElementNodes(e);
+        size_t num_elem_nodes = mesh.getElementNumNodes(e);
+        size_t ndof = num_elem_nodes * 3;
+        int* map = pattern.value_map.data() + pattern.value_offsets[e];
+        for (size_t q = 0; q < num_elem_nodes; ++q) {
+            size_t col_node = conn[q];
+            const int* nbr_begin = nbrs.data() + nbr_offsets[col_node];
+            const int* nbr_end = nbrs.data() + nbr_offsets[col_node + 1];
+            for (size_t p = 0; p < num_elem_nodes; ++p) {
+                int rank = static_cast<int>(std::lower_bound(nbr_begin, nbr_end, conn[p]) - nbr_begin);
+                for (int a = 0; a < 3; ++a) {
+                    int base = outer[3 * col_node + a] + 3 * rank;
+                    for (int b = 0; b < 3; ++b) {
+                        map[(p * 3 + b) * ndof + (q * 3 + a)] = base + b;
+                    }
+                }
+            }
         }
+    }
 
-        // 2. Calculate the element's stiffness matrix [ke]
-        if (elem_nodes.size() == 4) { // For now, only handle Tet4
-            Tet4Element tet(elem_nodes);
-            Eigen::Matrix<double, 12, 12> ke = tet.calculateStiffnessMatrix(mat);
+    // 4. Element coloring for race-free parallel scatter, each color ordered
+    //    by material and then element type so the kernel runs are long
+    pattern.coloring = colorElements(mesh);
+    std::vector<int> keys(num_elements);
+    for (size_t e = 0; e < num_elements; ++e) {
+        keys[e] = static_cast<int>(mesh.getElementTypes()[e]);
+    }
+    groupColorsByKey(pattern.coloring, keys);
+    keys.assign(mesh.getElementMaterials().begin(), mesh.getElementMaterials().end());
+    groupColorsByKey(pattern.coloring, keys);
+
+    return pattern;
+}
 
-            // 3. Add [ke] into the global triplet list
+void Assembler::assembleNumeric(const Mesh& mesh, const MaterialTable& materials, const AssemblyPattern& pattern,
+                                Eigen::SparseMatrix<double>& K) const {
+    FEM_PROFILE_SCOPE("assembly.numeric");
+    if (!hasStructure(K, pattern.structure)) {
+        K = pattern.structure;
+    }
+    double* values = K.valuePtr();
+    std::fill(values, values + K.nonZeros(), 0.0);
+    FEM_PROFILE_COUNTER("assembly.nonzeros", K.nonZeros());
+
+    const double* scales = elementScales(mesh);
+    forEachColoredStiffness(
+        mesh, materials, pattern.coloring, num_threads_, cachedGeometry(mesh),
+        [&](size_t e, const Tet4Batch<kTet4BatchWidth>& batch, int lane) {
+            const int* map = pattern.value_map.data() + pattern.value_offsets[e];
+            double scale = scales ? scales[e] : 1.0;
             for (int i = 0; i < 12; ++i) {
                 for (int j = 0; j < 12; ++j) {
-                    if (ke(i, j) != 0.0) {
-                        triplet_list.emplace_back(global_dof_map[i], global_dof_map[j], ke(i, j));
-                    }
+                    values[map[i * 12 + j]] += scale * batch.stiffness(lane, i, j);
                 }
             }
+        },
+        [&](size_t e, const auto& ke) {
+            const int* map = pattern.value_map.data() + pattern.value_offsets[e];
+            const Eigen::Index ndof = ke.rows();
+            double scale = scales ? scales[e] : 1.0;
+            for (Eigen::Index i = 0; i < ndof; ++i) {
+                for (Eigen::Index j = 0; j < ndof; ++j) {
+                    values[map[i * ndof + j]] += scale * ke(i, j);
+                }
+            }
+        });
+}
+
+Eigen::SparseMatrix<double> Assembler::assembleGlobalStiffness(const Mesh& mesh, const MaterialTable& materials,
+                                                               const AssemblyPattern& pattern) const {
+    Eigen::SparseMatrix<double> K = pattern.structure;
+    assembleNumeric(mesh, materials, pattern, K);
+    return K;
+}
+
+SymmetricBlockMatrix Assembler::buildBlockStructure(const AssemblyPattern& pattern) const {
+    // Column 3n of the scalar pattern lists rows 3m for every neighbour m of n
+    const Eigen::SparseMatrix<double>& S = pattern.structure;
+    const Eigen::Index num_nodes = S.cols() / 3;
+    std::vector<Eigen::Index> row_offsets(num_nodes + 1, 0);
+    std::vector<int> columns;
+    columns.reserve(S.nonZeros() / 18 + num_nodes);
+    for (Eigen::Index n = 0; n < num_nodes; ++n) {
+        columns.push_back(static_cast<int>(n));
+        for (int k = S.outerIndexPtr()[3 * n]; k < S.outerIndexPtr()[3 * n + 1]; k += 3) {
+            int m = S.innerIndexPtr()[k] / 3;
+            if (m > n) {
+                columns.push_back(m);
+            }
         }
+        row_offsets[n + 1] = static_cast<Eigen::Index>(columns.size());
     }
+    return SymmetricBlockMatrix(num_nodes, std::move(row_offsets), std::move(columns));
+}
 
-    // 4. Build the sparse matrix from the triplets
-    K.setFromTriplets(triplet_list.begin(), triplet_list.end());
+void Assembler::assembleNumeric(const Mesh& mesh, const MaterialTable& materials, const AssemblyPattern& pattern,
+                                SymmetricBlockMatrix& K) const {
+    FEM_PROFILE_SCOPE("assembly.numeric");
+    // Every connected node lists itself once and each neighbour pair twice
+    const Eigen::SparseMatrix<double>& S = pattern.structure;
+    const Eigen::Index num_nodes = S.cols() / 3;
+    Eigen::Index connected = 0;
+    for (Eigen::Index n = 0; n < num_nodes; ++n) {
+        connected += S.outerIndexPtr()[3 * n + 1] > S.outerIndexPtr()[3 * n];
+    }
+    const Eigen::Index blocks = num_nodes + (S.nonZeros() / 9 - connected) / 2;
+    if (K.blockRows() != num_nodes || K.nonZeroBlocks() != blocks) {
+        K = buildBlockStructure(pattern);
+    }
+    K.setZero();
+    FEM_PROFILE_COUNTER("assembly.blocks", K.nonZeroBlocks());
+
+    const double* scales = elementScales(mesh);
+    forEachColoredStiffness(
+        mesh, materials, pattern.coloring, num_threads_, cachedGeometry(mesh),
+        [&](size_t e, const Tet4Batch<kTet4BatchWidth>& batch, int lane) {
+            addElementBlocks(
+                mesh, e, [&](int i, int j) { return batch.stiffness(lane, i, j); }, scales ? scales[e] : 1.0, K);
+        },
+        [&](size_t e, const auto& ke) {
+            addElementBlocks(mesh, e, [&](int i, int j) { return ke(i, j); }, scales ? scales[e] : 1.0, K);
+        });
+}
+
+SymmetricBlockMatrix Assembler::assembleBlockStiffness(const Mesh& mesh, const MaterialTable& materials,
+                                                       const AssemblyPattern& pattern) const {
+    SymmetricBlockMatrix K = buildBlockStructure(pattern);
+    assembleNumeric(mesh, materials, pattern, K);
     return K;
-}
\ No newline at end of file
+}
+
+void Assembler::assembleMassNumeric(const Mesh& mesh, const MaterialTable& materials, const AssemblyPattern& pattern,
+                                    MassMatrixType type, Eigen::SparseMatrix<double>& M) const {
+    FEM_PROFILE_SCOPE("assembly.mass");
+    const MeshArray<ElementType>& types = mesh.getElementTypes();
+    auto other = std::find_if(types.begin(), types.end(), [](ElementType t) { return t != ElementType::Tet4; });
+    if (other != types.end()) {
+        throw std::invalid_argument("Assembler::assembleMassNumeric: element " +
+                                    std::to_string(mesh.getElementIds()[other - types.begin()]) +
+                                    " is not a Tet4; only Tet4 elements have a mass matrix");
+    }
+    if (!hasStructure(M, pattern.structure)) {
+        M = pattern.structure;
+    }
+    double* values = M.valuePtr();
+    std::fill(values, values + M.nonZeros(), 0.0);
+    std::vector<int> slots = materials.elementSlots(mesh);
+
+    // Same coloring as the stiffness, so threads never add to the same entry
+    const ElementColoring& coloring = pattern.coloring;
+    for (size_t c = 0; c < coloring.numColors(); ++c) {
+        const size_t* color_begin = coloring.elements.data() + coloring.offsets[c];
+        size_t color_size = coloring.offsets[c + 1] - coloring.offsets[c];
+
+        parallelFor(color_size, num_threads_, [&](size_t begin, size_t end, unsigned) {
+            for (size_t k = begin; k < end; ++k) {
+                size_t e = color_begin[k];
+                const int* map = pattern.value_map.data() + pattern.value_offsets[e];
+                double density = materials.getMaterial(slots[e]).getDensity();
+                Tet4Element element(gatherElementCoords<ElementType::Tet4>(mesh, e));
+                if (type == MassMatrixType::Lumped) {
+                    double m = element.calculateLumpedMassMatrix(density)(0, 0);
+                    for (int i = 0; i < 12; ++i) {
+                        values[map[i * 12 + i]] += m;
+                    }
+                    continue;
+                }
+                Eigen::Matrix<double, 12, 12> me = element.calculateMassMatrix(density);
+                for (int i = 0; i < 12; ++i) {
+                    for (int j = 0; j < 12; ++j) {
+                        values[map[i * 12 + j]] += me(i, j);
+                    }
+                }
+            }
+        });
+    }
+}
+
+Eigen::SparseMatrix<double> Assembler::assembleGlobalMass(const Mesh& mesh, const MaterialTable& materials,
+                                                          MassMatrixType type) const {
+    return assembleGlobalMass(mesh, materials, buildPattern(mesh), type);
+}
+
+Eigen::SparseMatrix<double> Assembler::assembleGlobalMass(const Mesh& mesh, const MaterialTable& materials,
+                                                          const AssemblyPattern& pattern, MassMatrixType type) const {
+    Eigen::SparseMatrix<double> M = pattern.structure;
+    assembleMassNumeric(mesh, materials, pattern, type, M);
+    return M;
+}
@@ -1,10 +1,104 @@
 #pragma once
 
 #include "Mesh.h"
-#include "Material.h"
+#include "MaterialTable.h"
+#include "ElementColoring.h"
+#include "ElementGeometry.h"
+#include "SymmetricBlockMatrix.h"
 #include <Eigen/Sparse>
+#include <vector>
+
+// Result of the symbolic assembly phase: the sparsity pattern of K derived from
+// mesh connectivity, and for every element the position in K.valuePtr() of each
+// entry of its element matrix. Reusable as long as the connectivity is unchanged.
+struct AssemblyPattern {
+    Eigen::SparseMatrix<double> structure; // Compressed, all values zero
+
+    // Entry k of element e's row-major (ndof x ndof) matrix lands at
+    // valuePtr()[value_map[value_offsets[e] + k]].
+    std::vector<Eigen::Index> value_offsets; // Size num_elements + 1
+    std::vector<int> value_map;
+
+    // Used by the numeric phase to scatter elements concurrently; within a
+    // color, elements are grouped by material ID and then element type
+    ElementColoring coloring;
+};
+
+enum class MassMatrixType {
+    Consistent, // rho * integral(N^T N)
+    Lumped      // Row sums on the diagonal
+};
 
 class Assembler {
 public:
-    Eigen::SparseMatrix<double> assembleGlobalStiffness(const Mesh& mesh, const Material& mat) const;
-};
\ No newline at end of file
+    // num_threads = 1 keeps the serial path; 0 uses every hardware thread.
+    explicit Assembler(unsigned num_threads = 1);
+
+    void setNumThreads(unsigned num_threads);
+    unsigned getNumThreads() const;
+
+    // Optional precomputed element geometry; used whenever it matches the mesh
+    // being assembled, so material sweeps skip the gradient computation. The
+    // store must outlive its use here; nullptr switches back to coordinates.
+    void setGeometry(const ElementGeometry* geometry);
+
+    // Optional stiffness multiplier per element (e.g. a density or damage
+    // factor), used whenever it has one entry per element of the mesh being
+    // assembled. Must outlive its use here; nullptr assembles unscaled.
+    void setElementScales(const std::vector<double>* scales);
+
+    // Every element takes its D from the table by its material ID (a single
+    // Material converts to a table used for all elements); std::out_of_range
+    // if an ID is missing. Elements are processed grouped by material.
+    //
+    // The result does not depend on the thread count: each thread assembles a
+    // contiguous range of the grouped elements and the per-thread triplet
+    // buffers are concatenated in that order before setFromTriplets.
+    Eigen::SparseMatrix<double> assembleGlobalStiffness(const Mesh& mesh, const MaterialTable& materials) const;
+
+    // Symbolic phase: computes the pattern of K once from the mesh connectivity.
+    AssemblyPattern buildPattern(const Mesh& mesh) const;
+
+    // Numeric phase: scatters every [ke] straight into K's compressed storage.
+    // K is reset to the pattern's structure if it does not already have it,
+    // otherwise its values are zeroed and reused in place. Elements are
+    // processed color by color, so the result is the same for any thread count.
+    void assembleNumeric(const Mesh& mesh, const MaterialTable& materials, const AssemblyPattern& pattern,
+                         Eigen::SparseMatrix<double>& K) const;
+    Eigen::SparseMatrix<double> assembleGlobalStiffness(const Mesh& mesh, const MaterialTable& materials,
+                                                        const AssemblyPattern& pattern) const;
+
+    // Block form of K (see SymmetricBlockMatrix): the upper 3x3 node blocks of
+    // the pattern, plus a zero diagonal block for any node no element touches
+    SymmetricBlockMatrix buildBlockStructure(const AssemblyPattern& pattern) const;
+
+    // Numeric phase into the block form: each element adds only its blocks on
+    // or above the diagonal, so half of [ke] is scattered. K is reset to
+    // buildBlockStructure(pattern) if it does not already have that shape.
+    // Colored like the scalar version, so it is deterministic too.
+    void assembleNumeric(const Mesh& mesh, const MaterialTable& materials, const AssemblyPattern& pattern,
+                         SymmetricBlockMatrix& K) const;
+    SymmetricBlockMatrix assembleBlockStiffness(const Mesh& mesh, const MaterialTable& materials,
+                                                const AssemblyPattern& pattern) const;
+
+    // Mass matrix from each element material's density, on the same pattern as
+    // K, so K and M share their structure (K - sigma M is a subtraction of the
+    // value arrays); the lumped matrix stores zeros off the diagonal. Only
+    // Tet4 elements have a mass kernel so far: std::invalid_argument for any
+    // other type. Element scales do not apply to the mass.
+    void assembleMassNumeric(const Mesh& mesh, const MaterialTable& materials, const AssemblyPattern& pattern,
+                             MassMatrixType type, Eigen::SparseMatrix<double>& M) const;
+    Eigen::SparseMatrix<double> assembleGlobalMass(const Mesh& mesh, const MaterialTable& materials,
+                                                   MassMatrixType type = MassMatrixType::Consistent) const;
+    Eigen::SparseMatrix<double> assembleGlobalMass(const Mesh& mesh, const MaterialTable& materials,
+                                                   const AssemblyPattern& pattern,
+                                                   MassMatrixType type = MassMatrixType::Consistent) const;
+
+private:
+    const Tet4Geometry<kTet4BatchWidth>* cachedGeometry(const Mesh& mesh) const;
+    const double* elementScales(const Mesh& mesh) const;
+
+    unsigned num_threads_;
+    const ElementGeometry* geometry_;
+    const std::vector<double>* scales_;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+class MappedFile;
+
+// Layout of the binary mesh format (.femb). All values are in the host's
+// native byte order; a file written on a machine of the other endianness is
+// rejected by the magic check. Every section starts on a 64-byte boundary and
+// mirrors one of Mesh's structure-of-arrays members:
+//
+//   node_ids       int32  [num_nodes]
+//   x, y, z        double [num_nodes] each
+//   element_ids    int32  [num_elements]
+//   element_types  uint8  [num_elements]      ElementType, agreeing with the node count
+//   element_materials int32 [num_elements]    Material IDs
+//   elem_offsets   int64  [num_elements + 1]  into connectivity
+//   connectivity   int32  [connectivity_size] 0-based node indices
+//
+// Version history: 1 stored interleaved xyz and node IDs in the connectivity;
+// 2 switched to the layout above; 3 added element_materials. Older sidecar
+// caches are simply refreshed.
+struct BinaryMeshHeader {
+    char magic[8];                // "FEMMESH" followed by '\0'
+    uint32_t version;
+    uint32_t header_size;         // sizeof(BinaryMeshHeader) of the writer
+    uint64_t num_nodes;
+    uint64_t num_elements;
+    uint64_t connectivity_size;
+    uint64_t source_size;         // Size of the text mesh it was converted from, 0 if none
+    int64_t source_mtime;         // Modification time of that file (file_time_type ticks)
+    uint64_t node_ids_offset;
+    uint64_t x_offset;
+    uint64_t y_offset;
+    uint64_t z_offset;
+    uint64_t element_ids_offset;
+    uint64_t element_types_offset;
+    uint64_t element_materials_offset;
+    uint64_t elem_offsets_offset;
+    uint64_t connectivity_offset;
+    uint64_t file_size;
+};
+
+const char kBinaryMeshMagic[8] = {'F', 'E', 'M', 'M', 'E', 'S', 'H', '\0'};
+const uint32_t kBinaryMeshVersion = 3;
+
+// Suffix appended to a text mesh path to name its binary sidecar cache
+const char kBinaryMeshSidecarSuffix[] = ".femb";
+
+// Checks the header of a mapped binary mesh and that every section lies
+// within the file; on failure explains why. The element sections themselves
+// (offsets, connectivity) are not checked here.
+bool validateBinaryMeshHeader(const MappedFile& file, BinaryMeshHeader& header, std::string& why);
@@ -0,0 +1,188 @@
+#include "BoundaryConditions.h"
+#include "Profiler.h"
+#include <stdexcept>
+
+BoundaryConditions::BoundaryConditions(const Mesh& mesh)
+    : mesh_(mesh),
+      constrained_(mesh.getNumNodes() * 3, 0),
+      values_(mesh.getNumNodes() * 3, 0.0),
+      reduced_index_(mesh.getNumNodes() * 3, 0),
+      num_constrained_(0),
+      numbering_valid_(false) {}
+
+void BoundaryConditions::fixNode(int node_id) {
+    for (int c = 0; c < 3; ++c) {
+        prescribe(node_id, c, 0.0);
+    }
+}
+
+void BoundaryConditions::fixNodes(const std::vector<int>& node_ids) {
+    for (int node_id : node_ids) {
+        fixNode(node_id);
+    }
+}
+
+void BoundaryConditions::prescribe(int node_id, int component, double value) {
+    int index = mesh_.getNodeIndex(node_id);
+    if (index < 0 || component < 0 || component > 2) {
+        throw std::out_of_range("BoundaryConditions: invalid node ID or component.");
+    }
+    // DOFs follow the mesh's node storage order
+    size_t dof = static_cast<size_t>(index) * 3 + component;
+    values_[dof] = value;
+    if (!constrained_[dof]) {
+        constrained_[dof] = 1;
+        ++num_constrained_;
+        numbering_valid_ = false;
+    }
+}
+
+void BoundaryConditions::prescribeNodes(const std::vector<int>& node_ids, int component, double value) {
+    for (int node_id : node_ids) {
+        prescribe(node_id, component, value);
+    }
+}
+
+size_t BoundaryConditions::getNumDofs() const {
+    return constrained_.size();
+}
+
+size_t BoundaryConditions::getNumConstrainedDofs() const {
+    return num_constrained_;
+}
+
+size_t BoundaryConditions::getNumFreeDofs() const {
+    return constrained_.size() - num_constrained_;
+}
+
+bool BoundaryConditions::isConstrained(size_t dof) const {
+    return constrained_[dof] != 0;
+}
+
+int BoundaryConditions::getReducedIndex(size_t dof) const {
+    renumber();
+    return reduced_index_[dof];
+}
+
+void BoundaryConditions::renumber() const {
+    if (numbering_valid_) {
+        return;
+    }
+    int next = 0;
+    for (size_t dof = 0; dof < constrained_.size(); ++dof) {
+        reduced_index_[dof] = constrained_[dof] ? -1 : next++;
+    }
+    numbering_valid_ = true;
+}
+
+void BoundaryConditions::reduce(const Eigen::SparseMatrix<double>& K, const Eigen::VectorXd& F,
+                                Eigen::SparseMatrix<double>& K_ff, Eigen::VectorXd& F_f) const {
+    if (static_cast<size_t>(K.rows()) != constrained_.size() || K.rows() != F.size()) {
+        throw std::invalid_argument("BoundaryConditions: system size does not match the mesh.");
+    }
+    FEM_PROFILE_SCOPE("boundary_conditions.reduce");
+    renumber();
+    Eigen::Index num_free = static_cast<Eigen::Index>(getNumFreeDofs());
+    FEM_PROFILE_COUNTER("dofs.free", num_free);
+    FEM_PROFILE_COUNTER("dofs.constrained", getNumConstrainedDofs());
+
+    F_f.resize(num_free);
+    for (size_t dof = 0; dof < constrained_.size(); ++dof) {
+        if (!constrained_[dof]) {
+            F_f(reduced_index_[dof]) = F(dof);
+        }
+    }
+
+    // 1. Count the free rows of every free column
+    K_ff.resize(num_free, num_free);
+    int* outer = K_ff.outerIndexPtr();
+    outer[0] = 0;
+    Eigen::Index nnz = 0;
+    for (Eigen::Index col = 0; col < K.outerSize(); ++col) {
+        if (constrained_[col]) {
+            continue;
+        }
+        for (Eigen::SparseMatrix<double>::InnerIterator it(K, col); it; ++it) {
+            if (!constrained_[it.row()]) {
+                ++nnz;
+            }
+        }
+        outer[reduced_index_[col] + 1] = static_cast<int>(nnz);
+    }
+
+    // 2. Copy K_ff and lift the prescribed values: F_f -= K_fc * U_c
+    K_ff.resizeNonZeros(nnz);
+    int* inner = K_ff.innerIndexPtr();
+    double* values = K_ff.valuePtr();
+    Eigen::Index pos = 0;
+    for (Eigen::Index col = 0; col < K.outerSize(); ++col) {
+        if (constrained_[col]) {
+            double u_c = values_[col];
+            if (u_c != 0.0) {
+                for (Eigen::SparseMatrix<double>::InnerIterator it(K, col); it; ++it) {
+                    if (!constrained_[it.row()]) {
+                        F_f(reduced_index_[it.row()]) -= it.value() * u_c;
+                    }
+                }
+            }
+            continue;
+        }
+        for (Eigen::SparseMatrix<double>::InnerIterator it(K, col); it; ++it) {
+            if (!constrained_[it.row()]) {
+                inner[pos] = reduced_index_[it.row()];
+                values[pos] = it.value();
+                ++pos;
+            }
+        }
+    }
+}
+
+void BoundaryConditions::reduce(const Eigen::SparseMatrix<double>& K, Eigen::SparseMatrix<double>& K_ff) const {
+    Eigen::VectorXd zero = Eigen::VectorXd::Zero(K.rows());
+    Eigen::VectorXd F_f;
+    reduce(K, zero, K_ff, F_f);
+}
+
+Eigen::MatrixXd BoundaryConditions::restrictRows(const Eigen::MatrixXd& full) const {
+    renumber();
+    Eigen::MatrixXd reduced(getNumFreeDofs(), full.cols());
+    for (size_t dof = 0; dof < constrained_.size(); ++dof) {
+        if (!constrained_[dof]) {
+            reduced.row(reduced_index_[dof]) = full.row(dof);
+        }
+    }
+    return reduced;
+}
+
+Eigen::VectorXd BoundaryConditions::expand(const Eigen::VectorXd& U_f) const {
+    renumber();
+    Eigen::VectorXd U(constrained_.size());
+    for (size_t dof = 0; dof < constrained_.size(); ++dof) {
+        U(dof) = constrained_[dof] ? values_[dof] : U_f(reduced_index_[dof]);
+    }
+    return U;
+}
+
+Eigen::MatrixXd BoundaryConditions::expandColumns(const Eigen::MatrixXd& U_f) const {
+    renumber();
+    Eigen::MatrixXd U(constrained_.size(), U_f.cols());
+    for (size_t dof = 0; dof < constrained_.size(); ++dof) {
+        if (constrained_[dof]) {
+            U.row(dof).setConstant(values_[dof]);
+        } else {
+            U.row(dof) = U_f.row(reduced_index_[dof]);
+        }
+    }
+    return U;
+}
+
+Eigen::MatrixXd BoundaryConditions::expandHomogeneous(const Eigen::MatrixXd& U_f) const {
+    renumber();
+    Eigen::MatrixXd U = Eigen::MatrixXd::Zero(constrained_.size(), U_f.cols());
+    for (size_t dof = 0; dof < constrained_.size(); ++dof) {
+        if (!constrained_[dof]) {
+            U.row(dof) = U_f.row(reduced_index_[dof]);
+        }
+    }
+    return U;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Mesh.h"
+#include <Eigen/Sparse>
+#include <vector>
+
+// Dirichlet constraints applied by elimination. Constrained DOFs are removed
+// from the system through a reduced DOF numbering, and their prescribed
+// values are lifted to the right-hand side:
+//
+//     K_ff * U_f = F_f - K_fc * U_c
+//
+// The reduced matrix keeps K's conditioning (no penalty terms) and is
+// symmetric positive definite for a sufficiently supported model.
+class BoundaryConditions {
+public:
+    // The mesh must outlive the boundary conditions.
+    explicit BoundaryConditions(const Mesh& mesh);
+
+    // Clamp every component of the given nodes (node set by ID)
+    void fixNode(int node_id);
+    void fixNodes(const std::vector<int>& node_ids);
+
+    // Prescribe one displacement component (0 = x, 1 = y, 2 = z); the last
+    // value given for a DOF wins.
+    void prescribe(int node_id, int component, double value);
+    void prescribeNodes(const std::vector<int>& node_ids, int component, double value);
+
+    size_t getNumDofs() const;            // All DOFs of the mesh
+    size_t getNumConstrainedDofs() const;
+    size_t getNumFreeDofs() const;
+    bool isConstrained(size_t dof) const;
+
+    // Reduced index of a DOF, or -1 if it is constrained
+    int getReducedIndex(size_t dof) const;
+
+    // Builds K_ff and the lifted F_f in one pass over K's compressed storage.
+    void reduce(const Eigen::SparseMatrix<double>& K, const Eigen::VectorXd& F,
+                Eigen::SparseMatrix<double>& K_ff, Eigen::VectorXd& F_f) const;
+    // K_ff alone, e.g. the mass matrix of a modal analysis
+    void reduce(const Eigen::SparseMatrix<double>& K, Eigen::SparseMatrix<double>& K_ff) const;
+
+    // Keeps only the free rows of a full-size vector or matrix
+    Eigen::MatrixXd restrictRows(const Eigen::MatrixXd& full) const;
+
+    // Scatters the reduced solution back and fills in the prescribed values
+    Eigen::VectorXd expand(const Eigen::VectorXd& U_f) const;
+    // The same for a block of solutions, one column per load case
+    Eigen::MatrixXd expandColumns(const Eigen::MatrixXd& U_f) const;
+    // The same with zeros at the constrained DOFs, for mode shapes
+    Eigen::MatrixXd expandHomogeneous(const Eigen::MatrixXd& U_f) const;
+
+private:
+    // Rebuilds the reduced numbering after constraints were added
+    void renumber() const;
+
+    const Mesh& mesh_;
+    std::vector<char> constrained_;
+    std::vector<double> values_;
+    mutable std::vector<int> reduced_index_;
+    size_t num_constrained_;
+    mutable bool numbering_valid_;
+};
@@ -1,9 +1,30 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
+// Element kinds, tagged per element in Mesh. The text format only records
+// the node count, so the type is inferred from it.
+enum class ElementType : uint8_t {
+    Unknown = 0,
+    Tet4,
+    Hex8,
+    Tet10
+};
+constexpr int kNumElementTypes = 4;
+
+inline ElementType elementTypeFromNodeCount(size_t num_nodes) {
+    switch (num_nodes) {
+    case 4: return ElementType::Tet4;
+    case 8: return ElementType::Hex8;
+    case 10: return ElementType::Tet10;
+    default: return ElementType::Unknown;
+    }
+}
+
 // A simple structure for a generic element.
 struct Element {
     int id;
     std::vector<int> connectivity; // List of node IDs that form the element
-};
\ No newline at end of file
+};
@@ -0,0 +1,62 @@
+#include "ElementColoring.h"
+#include "MeshTopology.h"
+#include <algorithm>
+
+ElementColoring colorElements(const Mesh& mesh) {
+    size_t num_elements = mesh.getNumElements();
+
+    // 1. Node -> element incidence
+    NodeElementIncidence incidence = buildNodeElementIncidence(mesh);
+
+    // 2. Smallest color not used by an already-colored neighbour
+    std::vector<int> color(num_elements, -1);
+    std::vector<size_t> color_mark; // color_mark[c] == e + 1 if color c is taken by a neighbour of e
+    int num_colors = 0;
+    for (size_t e = 0; e < num_elements; ++e) {
+        const int* nodes = mesh.getElementNodes(e);
+        for (size_t i = 0; i < mesh.getElementNumNodes(e); ++i) {
+            for (size_t k = incidence.offsets[nodes[i]]; k < incidence.offsets[nodes[i] + 1]; ++k) {
+                int c = color[incidence.elements[k]];
+                if (c >= 0) {
+                    color_mark[c] = e + 1;
+                }
+            }
+        }
+        int c = 0;
+        while (c < num_colors && color_mark[c] == e + 1) {
+            ++c;
+        }
+        if (c == num_colors) {
+            ++num_colors;
+            color_mark.push_back(0);
+        }
+        color[e] = c;
+    }
+
+    // 3. Bucket elements by color
+    ElementColoring coloring;
+    coloring.offsets.assign(num_colors + 1, 0);
+    for (int c : color) {
+        ++coloring.offsets[c + 1];
+    }
+    for (int c = 0; c < num_colors; ++c) {
+        coloring.offsets[c + 1] += coloring.offsets[c];
+    }
+    coloring.elements.resize(num_elements);
+    std::vector<size_t> fill(coloring.offsets.begin(), coloring.offsets.end() - 1);
+    for (size_t e = 0; e < num_elements; ++e) {
+        coloring.elements[fill[color[e]]++] = e;
+    }
+    return coloring;
+}
+
+void groupColorsByKey(ElementColoring& coloring, const std::vector<int>& keys) {
+    for (size_t c = 0; c < coloring.numColors(); ++c) {
+        auto begin = coloring.elements.begin() + coloring.offsets[c];
+        auto end = coloring.elements.begin() + coloring.offsets[c + 1];
+        auto by_key = [&](size_t a, size_t b) { return keys[a] < keys[b]; };
+        if (!std::is_sorted(begin, end, by_key)) {
+            std::stable_sort(begin, end, by_key);
+        }
+    }
+}
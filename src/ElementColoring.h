@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Mesh.h"
+#include <vector>
+
+// Groups elements so that no two elements of one color share a node. Elements
+// of a color can then scatter into global arrays concurrently without races.
+// Color c holds elements[offsets[c] .. offsets[c+1]), in ascending order
+// unless regrouped by groupColorsByKey.
+struct ElementColoring {
+    std::vector<size_t> offsets;
+    std::vector<size_t> elements;
+
+    size_t numColors() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+};
+
+// Greedy first-fit coloring in element order.
+ElementColoring colorElements(const Mesh& mesh);
+
+// Stably reorders every color so elements with equal keys[e] (e.g. material
+// IDs) are contiguous, in ascending key order.
+void groupColorsByKey(ElementColoring& coloring, const std::vector<int>& keys);
@@ -0,0 +1,78 @@
+#include "ElementGeometry.h"
+#include "Parallel.h"
+
+ElementGeometry::ElementGeometry(const Mesh& mesh, unsigned num_threads) {
+    build(mesh, num_threads);
+}
+
+void ElementGeometry::build(const Mesh& mesh, unsigned num_threads) {
+    const int W = kTet4BatchWidth;
+    num_elements_ = mesh.getNumElements();
+    mesh_revision_ = mesh.getRevision();
+    blocks_.assign((num_elements_ + W - 1) / W, Block());
+
+    const auto& x = mesh.getX();
+    const auto& y = mesh.getY();
+    const auto& z = mesh.getZ();
+    parallelFor(blocks_.size(), num_threads, [&](size_t begin, size_t end, unsigned) {
+        Tet4Batch<W> batch;
+        for (size_t b = begin; b < end; ++b) {
+            // Lanes past the end of the mesh or holding other element types stay
+            // at the origin, which the kernel treats as degenerate
+            for (int l = 0; l < W; ++l) {
+                size_t e = b * W + l;
+                bool tet4 = e < num_elements_ && mesh.getElementNumNodes(e) == 4;
+                const int* nodes = tet4 ? mesh.getElementNodes(e) : nullptr;
+                for (int i = 0; i < 4; ++i) {
+                    batch.x[i][l] = tet4 ? x[nodes[i]] : 0.0;
+                    batch.y[i][l] = tet4 ? y[nodes[i]] : 0.0;
+                    batch.z[i][l] = tet4 ? z[nodes[i]] : 0.0;
+                }
+            }
+            computeTet4Geometry(batch);
+            blocks_[b] = batch.geometry;
+        }
+    });
+}
+
+void ElementGeometry::clear() {
+    blocks_.clear();
+    blocks_.shrink_to_fit();
+    num_elements_ = 0;
+    mesh_revision_ = 0;
+}
+
+Eigen::Matrix<double, 4, 3> ElementGeometry::getGradients(size_t e) const {
+    Eigen::Matrix<double, 4, 3> grad;
+    for (int i = 0; i < 4; ++i) {
+        for (int d = 0; d < 3; ++d) {
+            grad(i, d) = getGradient(e, i, d);
+        }
+    }
+    return grad;
+}
+
+Eigen::Matrix<double, 6, 12> ElementGeometry::getBMatrix(size_t e) const {
+    Eigen::Matrix<double, 6, 12> B = Eigen::Matrix<double, 6, 12>::Zero();
+    for (int i = 0; i < 4; ++i) {
+        double dN_dx = getGradient(e, i, 0);
+        double dN_dy = getGradient(e, i, 1);
+        double dN_dz = getGradient(e, i, 2);
+
+        B(0, i * 3 + 0) = dN_dx;
+        B(1, i * 3 + 1) = dN_dy;
+        B(2, i * 3 + 2) = dN_dz;
+        B(3, i * 3 + 0) = dN_dy; B(3, i * 3 + 1) = dN_dx;
+        B(4, i * 3 + 1) = dN_dz; B(4, i * 3 + 2) = dN_dy;
+        B(5, i * 3 + 0) = dN_dz; B(5, i * 3 + 2) = dN_dx;
+    }
+    return B;
+}
+
+size_t ElementGeometry::memoryBytes() const {
+    return sizeof(*this) + blocks_.capacity() * sizeof(Block);
+}
+
+size_t ElementGeometry::estimateMemoryBytes(size_t num_elements) {
+    return sizeof(ElementGeometry) + (num_elements + kTet4BatchWidth - 1) / kTet4BatchWidth * sizeof(Block);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Mesh.h"
+#include "Tet4Kernel.h"
+#include <Eigen/Core>
+#include <vector>
+
+// Optional per-element geometry store: Tet4 shape-function gradients and
+// volumes, computed once from the mesh coordinates and reused by assembly,
+// stress recovery and matrix-free products across material changes.
+//
+// Elements are stored in blocks of kTet4BatchWidth in the kernel's lane-major
+// layout (element e is lane e % W of block e / W), 64-byte aligned, so a block
+// feeds the batched stiffness kernel directly. Elements that are not Tet4 get
+// zero gradients and volume. The store remembers the mesh revision it was
+// built from, and users fall back to the coordinates once the mesh has moved.
+class ElementGeometry {
+public:
+    ElementGeometry() = default;
+    // num_threads = 1 is serial; 0 uses every hardware thread.
+    explicit ElementGeometry(const Mesh& mesh, unsigned num_threads = 1);
+
+    void build(const Mesh& mesh, unsigned num_threads = 1);
+    void clear();
+
+    size_t getNumElements() const { return num_elements_; }
+    bool empty() const { return num_elements_ == 0; }
+    // True if the store was built from this mesh (or an unmodified copy) and
+    // no node has moved or been renumbered since
+    bool matches(const Mesh& mesh) const { return !empty() && mesh_revision_ == mesh.getRevision(); }
+
+    double getVolume(size_t e) const { return blocks_[e / kTet4BatchWidth].volume[e % kTet4BatchWidth]; }
+    // dN_node / dx_dim
+    double getGradient(size_t e, int node, int dim) const {
+        return blocks_[e / kTet4BatchWidth].grad[node][dim][e % kTet4BatchWidth];
+    }
+    Eigen::Matrix<double, 4, 3> getGradients(size_t e) const;
+    // Strain-displacement matrix, same layout as Tet4Element::calculateBMatrix
+    Eigen::Matrix<double, 6, 12> getBMatrix(size_t e) const;
+
+    const Tet4Geometry<kTet4BatchWidth>* blocks() const { return blocks_.data(); }
+
+    // Bytes held by the store, and what a store for num_elements would need
+    size_t memoryBytes() const;
+    static size_t estimateMemoryBytes(size_t num_elements);
+
+private:
+    typedef Tet4Geometry<kTet4BatchWidth> Block;
+    std::vector<Block> blocks_; // C++17 aligned new honours the blocks' alignas(64)
+    size_t num_elements_ = 0;
+    uint64_t mesh_revision_ = 0;
+};
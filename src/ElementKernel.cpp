@@ -0,0 +1,121 @@
+#include "ElementKernel.h"
+#include <algorithm>
+#include <cmath>
+
+template <ElementType Type>
+double computeShapeGradients(const ElementCoords<Type>& coords, double xi, double eta, double zeta,
+                             ElementGradients<Type>& grad) {
+    typedef ElementTraits<Type> Traits;
+    double dN[Traits::kNodes][3];
+    Traits::shapeDerivatives(xi, eta, zeta, dN);
+    Eigen::Matrix<double, Traits::kNodes, 3> dN_ref;
+    for (int i = 0; i < Traits::kNodes; ++i) {
+        dN_ref.row(i) << dN[i][0], dN[i][1], dN[i][2];
+    }
+
+    // J(k, d) = dx_d / dxi_k, and grad = dN_ref * J^-T
+    Eigen::Matrix3d J = dN_ref.transpose() * coords;
+    double det = J.determinant();
+    if (std::abs(det) < 1e-12) {
+        grad.setZero();
+        return 0.0;
+    }
+    grad.noalias() = dN_ref * J.inverse().transpose();
+    return det;
+}
+
+template <ElementType Type>
+void buildStrainOperator(const ElementGradients<Type>& grad, ElementStrainOperator<Type>& B) {
+    B.setZero();
+    for (int i = 0; i < ElementTraits<Type>::kNodes; ++i) {
+        double a = grad(i, 0), b = grad(i, 1), c = grad(i, 2);
+        int col = 3 * i;
+        B(0, col + 0) = a;
+        B(1, col + 1) = b;
+        B(2, col + 2) = c;
+        B(3, col + 0) = b;
+        B(3, col + 1) = a;
+        B(4, col + 1) = c;
+        B(4, col + 2) = b;
+        B(5, col + 0) = c;
+        B(5, col + 2) = a;
+    }
+}
+
+template <ElementType Type>
+bool computeElementStiffness(const ElementCoords<Type>& coords, const Eigen::Matrix<double, 6, 6>& D,
+                             ElementMatrix<Type>& ke) {
+    typedef ElementTraits<Type> Traits;
+    ke.setZero();
+    ElementGradients<Type> grad;
+    ElementStrainOperator<Type> B;
+    Eigen::Matrix<double, 6, Traits::kDofs> DB;
+    double orientation = 0.0;
+    for (const QuadraturePoint& p : Traits::quadrature()) {
+        double det = computeShapeGradients<Type>(coords, p.xi, p.eta, p.zeta, grad);
+        if (det == 0.0 || det * orientation < 0.0) {
+            ke.setZero();
+            return false;
+        }
+        orientation = det;
+        buildStrainOperator<Type>(grad, B);
+        DB.noalias() = (p.weight * std::abs(det)) * D * B;
+        ke.template triangularView<Eigen::Upper>() += B.transpose() * DB;
+    }
+    ke.template triangularView<Eigen::StrictlyLower>() = ke.transpose();
+    return true;
+}
+
+template <ElementType Type>
+double computeElementVolume(const ElementCoords<Type>& coords) {
+    ElementGradients<Type> grad;
+    double volume = 0.0;
+    for (const QuadraturePoint& p : ElementTraits<Type>::quadrature()) {
+        volume += p.weight * std::abs(computeShapeGradients<Type>(coords, p.xi, p.eta, p.zeta, grad));
+    }
+    return volume;
+}
+
+template <ElementType Type>
+bool computeCentroidStrainOperator(const ElementCoords<Type>& coords, ElementStrainOperator<Type>& B) {
+    constexpr QuadraturePoint c = ElementTraits<Type>::centroid();
+    ElementGradients<Type> grad;
+    bool ok = computeShapeGradients<Type>(coords, c.xi, c.eta, c.zeta, grad) != 0.0;
+    buildStrainOperator<Type>(grad, B);
+    return ok;
+}
+
+std::vector<size_t> groupElementsByKernel(const Mesh& mesh, const std::vector<int>& element_slots) {
+    // Counting sort on slot * kNumElementTypes + type
+    const MeshArray<ElementType>& types = mesh.getElementTypes();
+    int num_slots = 0;
+    for (int slot : element_slots) {
+        num_slots = std::max(num_slots, slot + 1);
+    }
+    std::vector<size_t> offsets(static_cast<size_t>(num_slots) * kNumElementTypes + 1, 0);
+    auto key = [&](size_t e) { return static_cast<size_t>(element_slots[e]) * kNumElementTypes + static_cast<size_t>(types[e]); };
+    for (size_t e = 0; e < types.size(); ++e) {
+        ++offsets[key(e) + 1];
+    }
+    for (size_t k = 1; k < offsets.size(); ++k) {
+        offsets[k] += offsets[k - 1];
+    }
+    std::vector<size_t> order(types.size());
+    for (size_t e = 0; e < types.size(); ++e) {
+        order[offsets[key(e)]++] = e;
+    }
+    return order;
+}
+
+#define FEM_INSTANTIATE_ELEMENT_KERNELS(Type)                                                                 \
+    template double computeShapeGradients<Type>(const ElementCoords<Type>&, double, double, double,           \
+                                                ElementGradients<Type>&);                                     \
+    template void buildStrainOperator<Type>(const ElementGradients<Type>&, ElementStrainOperator<Type>&);     \
+    template bool computeElementStiffness<Type>(const ElementCoords<Type>&, const Eigen::Matrix<double, 6, 6>&, \
+                                                ElementMatrix<Type>&);                                        \
+    template double computeElementVolume<Type>(const ElementCoords<Type>&);                                   \
+    template bool computeCentroidStrainOperator<Type>(const ElementCoords<Type>&, ElementStrainOperator<Type>&);
+
+FEM_INSTANTIATE_ELEMENT_KERNELS(ElementType::Tet4)
+FEM_INSTANTIATE_ELEMENT_KERNELS(ElementType::Tet10)
+FEM_INSTANTIATE_ELEMENT_KERNELS(ElementType::Hex8)
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "ElementTraits.h"
+#include "MaterialTable.h"
+#include "Mesh.h"
+#include <Eigen/Dense>
+#include <type_traits>
+#include <vector>
+
+// Fixed-size isoparametric kernels generated from ElementTraits. Every matrix
+// has compile-time dimensions, so Eigen unrolls the products per element
+// type. Tet4 also has the batched SIMD kernel in Tet4Kernel.h, which the
+// assembler prefers; the generic Tet4 instance serves as its reference.
+
+template <ElementType Type>
+using ElementCoords = Eigen::Matrix<double, ElementTraits<Type>::kNodes, 3>; // One row per node
+template <ElementType Type>
+using ElementGradients = Eigen::Matrix<double, ElementTraits<Type>::kNodes, 3>; // dN_i / dx_d
+template <ElementType Type>
+using ElementStrainOperator = Eigen::Matrix<double, 6, ElementTraits<Type>::kDofs>;
+template <ElementType Type>
+using ElementMatrix = Eigen::Matrix<double, ElementTraits<Type>::kDofs, ElementTraits<Type>::kDofs>;
+template <ElementType Type>
+using ElementVector = Eigen::Matrix<double, ElementTraits<Type>::kDofs, 1>;
+
+// Physical shape-function gradients at a reference point; returns det J,
+// which is negative for an element whose nodes are ordered inside out
+template <ElementType Type>
+double computeShapeGradients(const ElementCoords<Type>& coords, double xi, double eta, double zeta,
+                             ElementGradients<Type>& grad);
+
+// Strain-displacement matrix in Voigt order (xx, yy, zz, xy, yz, xz), DOF
+// 3 * node + component, as Tet4Element::calculateBMatrix
+template <ElementType Type>
+void buildStrainOperator(const ElementGradients<Type>& grad, ElementStrainOperator<Type>& B);
+
+// ke = sum over the quadrature points of w |det J| B^T D B. An element whose
+// det J vanishes or changes sign gets a zero ke and false, like a degenerate
+// Tet4 in the batched kernel.
+template <ElementType Type>
+bool computeElementStiffness(const ElementCoords<Type>& coords, const Eigen::Matrix<double, 6, 6>& D,
+                             ElementMatrix<Type>& ke);
+
+// Volume by the element's quadrature rule, and B at its centroid (for
+// stress recovery); zero for a degenerate element
+template <ElementType Type>
+double computeElementVolume(const ElementCoords<Type>& coords);
+template <ElementType Type>
+bool computeCentroidStrainOperator(const ElementCoords<Type>& coords, ElementStrainOperator<Type>& B);
+
+template <ElementType Type>
+ElementCoords<Type> gatherElementCoords(const Mesh& mesh, size_t e) {
+    const int* nodes = mesh.getElementNodes(e);
+    ElementCoords<Type> coords;
+    for (int i = 0; i < ElementTraits<Type>::kNodes; ++i) {
+        coords(i, 0) = mesh.getX()[nodes[i]];
+        coords(i, 1) = mesh.getY()[nodes[i]];
+        coords(i, 2) = mesh.getZ()[nodes[i]];
+    }
+    return coords;
+}
+
+inline bool hasElementKernel(ElementType type) {
+    return type == ElementType::Tet4 || type == ElementType::Tet10 || type == ElementType::Hex8;
+}
+
+// Calls fn(std::integral_constant<ElementType, T>()) with the compile-time
+// type, so fn's body is instantiated once per element type. Returns false,
+// without calling fn, for a type that has no kernel.
+template <typename Fn>
+bool dispatchElementType(ElementType type, Fn&& fn) {
+    switch (type) {
+    case ElementType::Tet4:
+        fn(std::integral_constant<ElementType, ElementType::Tet4>());
+        return true;
+    case ElementType::Tet10:
+        fn(std::integral_constant<ElementType, ElementType::Tet10>());
+        return true;
+    case ElementType::Hex8:
+        fn(std::integral_constant<ElementType, ElementType::Hex8>());
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Splits elements element_at(0 .. count-1) into maximal runs of one element
+// type and material slot (from MaterialTable::elementSlots) and calls
+// fn(type, D, first, run_count) for each run, where first is the position of
+// its first element. Kernels are then chosen once per run, not per element;
+// groupElementsByKernel orders elements so the runs are as long as possible.
+template <typename ElementAt, typename Fn>
+void forEachElementRun(const Mesh& mesh, const MaterialTable& materials, const std::vector<int>& element_slots,
+                       size_t count, ElementAt&& element_at, Fn&& fn) {
+    const MeshArray<ElementType>& types = mesh.getElementTypes();
+    size_t first = 0;
+    while (first < count) {
+        size_t e = element_at(first);
+        ElementType type = types[e];
+        int slot = element_slots[e];
+        size_t last = first + 1;
+        while (last < count && types[element_at(last)] == type && element_slots[element_at(last)] == slot) {
+            ++last;
+        }
+        fn(type, materials.getDMatrix(slot), first, last - first);
+        first = last;
+    }
+}
+
+// All element indices, stably reordered so each (type, material slot) pair is contiguous
+std::vector<size_t> groupElementsByKernel(const Mesh& mesh, const std::vector<int>& element_slots);
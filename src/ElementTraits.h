@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Element.h"
+#include <array>
+
+// Compile-time description of each element type: node and DOF counts, the
+// quadrature rule that integrates its stiffness exactly on an undistorted
+// element, and its shape functions in reference coordinates (xi, eta, zeta).
+// Node orders follow VTK, so meshes and VtuWriter output agree.
+
+struct QuadraturePoint {
+    double xi, eta, zeta;
+    double weight; // Includes the reference volume (1/6 for tets, 8 for hexes)
+};
+
+template <ElementType Type>
+struct ElementTraits;
+
+// Linear tetrahedron on the unit reference tet; B is constant, so one point
+template <>
+struct ElementTraits<ElementType::Tet4> {
+    static constexpr int kNodes = 4;
+    static constexpr int kDofs = 3 * kNodes;
+    static constexpr int kQuadraturePoints = 1;
+    static constexpr std::array<QuadraturePoint, kQuadraturePoints> quadrature() {
+        return {{{0.25, 0.25, 0.25, 1.0 / 6.0}}};
+    }
+    static constexpr QuadraturePoint centroid() { return {0.25, 0.25, 0.25, 1.0 / 6.0}; }
+
+    static void shapeFunctions(double xi, double eta, double zeta, double N[kNodes]) {
+        N[0] = 1.0 - xi - eta - zeta;
+        N[1] = xi;
+        N[2] = eta;
+        N[3] = zeta;
+    }
+    static void shapeDerivatives(double, double, double, double dN[kNodes][3]) {
+        const double d[kNodes][3] = {{-1, -1, -1}, {1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+        for (int i = 0; i < kNodes; ++i) {
+            for (int k = 0; k < 3; ++k) {
+                dN[i][k] = d[i][k];
+            }
+        }
+    }
+};
+
+// Quadratic tetrahedron: corners 0-3, then mid-edge nodes on the edges
+// 0-1, 1-2, 0-2, 0-3, 1-3, 2-3. B is linear, so the 4-point degree-2 rule.
+template <>
+struct ElementTraits<ElementType::Tet10> {
+    static constexpr int kNodes = 10;
+    static constexpr int kDofs = 3 * kNodes;
+    static constexpr int kQuadraturePoints = 4;
+    static constexpr std::array<QuadraturePoint, kQuadraturePoints> quadrature() {
+        constexpr double a = 0.5854101966249685; // (5 + 3 sqrt 5) / 20
+        constexpr double b = 0.1381966011250105; // (5 - sqrt 5) / 20
+        constexpr double w = 1.0 / 24.0;
+        return {{{b, b, b, w}, {a, b, b, w}, {b, a, b, w}, {b, b, a, w}}};
+    }
+    static constexpr QuadraturePoint centroid() { return {0.25, 0.25, 0.25, 1.0 / 6.0}; }
+    static constexpr int kEdges[6][2] = {{0, 1}, {1, 2}, {0, 2}, {0, 3}, {1, 3}, {2, 3}};
+
+    static void shapeFunctions(double xi, double eta, double zeta, double N[kNodes]) {
+        const double L[4] = {1.0 - xi - eta - zeta, xi, eta, zeta};
+        for (int i = 0; i < 4; ++i) {
+            N[i] = L[i] * (2.0 * L[i] - 1.0);
+        }
+        for (int k = 0; k < 6; ++k) {
+            N[4 + k] = 4.0 * L[kEdges[k][0]] * L[kEdges[k][1]];
+        }
+    }
+    static void shapeDerivatives(double xi, double eta, double zeta, double dN[kNodes][3]) {
+        const double L[4] = {1.0 - xi - eta - zeta, xi, eta, zeta};
+        const double dL[4][3] = {{-1, -1, -1}, {1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+        for (int d = 0; d < 3; ++d) {
+            for (int i = 0; i < 4; ++i) {
+                dN[i][d] = (4.0 * L[i] - 1.0) * dL[i][d];
+            }
+            for (int k = 0; k < 6; ++k) {
+                int p = kEdges[k][0], q = kEdges[k][1];
+                dN[4 + k][d] = 4.0 * (L[p] * dL[q][d] + L[q] * dL[p][d]);
+            }
+        }
+    }
+};
+
+// Trilinear hexahedron on [-1, 1]^3: nodes 0-3 counter-clockwise on the
+// zeta = -1 face, 4-7 above them. 2x2x2 Gauss points.
+template <>
+struct ElementTraits<ElementType::Hex8> {
+    static constexpr int kNodes = 8;
+    static constexpr int kDofs = 3 * kNodes;
+    static constexpr int kQuadraturePoints = 8;
+    static constexpr std::array<QuadraturePoint, kQuadraturePoints> quadrature() {
+        constexpr double g = 0.5773502691896258; // 1 / sqrt 3
+        return {{{-g, -g, -g, 1.0}, {g, -g, -g, 1.0}, {g, g, -g, 1.0}, {-g, g, -g, 1.0},
+                 {-g, -g, g, 1.0}, {g, -g, g, 1.0}, {g, g, g, 1.0}, {-g, g, g, 1.0}}};
+    }
+    static constexpr QuadraturePoint centroid() { return {0.0, 0.0, 0.0, 8.0}; }
+    static constexpr double kCorners[kNodes][3] = {{-1, -1, -1}, {1, -1, -1}, {1, 1, -1}, {-1, 1, -1},
+                                                   {-1, -1, 1},  {1, -1, 1},  {1, 1, 1},  {-1, 1, 1}};
+
+    static void shapeFunctions(double xi, double eta, double zeta, double N[kNodes]) {
+        for (int i = 0; i < kNodes; ++i) {
+            N[i] = 0.125 * (1.0 + xi * kCorners[i][0]) * (1.0 + eta * kCorners[i][1]) * (1.0 + zeta * kCorners[i][2]);
+        }
+    }
+    static void shapeDerivatives(double xi, double eta, double zeta, double dN[kNodes][3]) {
+        for (int i = 0; i < kNodes; ++i) {
+            double a = 1.0 + xi * kCorners[i][0], b = 1.0 + eta * kCorners[i][1], c = 1.0 + zeta * kCorners[i][2];
+            dN[i][0] = 0.125 * kCorners[i][0] * b * c;
+            dN[i][1] = 0.125 * a * kCorners[i][1] * c;
+            dN[i][2] = 0.125 * a * b * kCorners[i][2];
+        }
+    }
+};
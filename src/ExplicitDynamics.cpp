@@ -0,0 +1,369 @@
+#include "ExplicitDynamics.h"
+#include "ElementKernel.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include "Tet4Kernel.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+// Bounded queue drained by one writer thread. The writer must not throw.
+class ExplicitDynamics::OutputQueue {
+public:
+    OutputQueue(const std::function<void(const ExplicitSnapshot&)>& writer, size_t capacity)
+        : writer_(writer), capacity_(std::max<size_t>(capacity, 1)), done_(false), thread_([this]() { work(); }) {}
+    ~OutputQueue() { finish(); }
+
+    // Blocks only while the queue is full; returns the seconds spent waiting
+    double push(ExplicitSnapshot&& snapshot) {
+        auto start = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(mutex_);
+        space_.wait(lock, [&]() { return queue_.size() < capacity_; });
+        double waited = secondsSince(start);
+        queue_.push_back(std::move(snapshot));
+        lock.unlock();
+        ready_.notify_one();
+        return waited;
+    }
+
+    // Writes what is left and stops the thread
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_ = true;
+        }
+        ready_.notify_one();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+private:
+    void work() {
+        while (true) {
+            ExplicitSnapshot snapshot;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                ready_.wait(lock, [&]() { return done_ || !queue_.empty(); });
+                if (queue_.empty()) {
+                    return;
+                }
+                snapshot = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            space_.notify_one();
+            writer_(snapshot);
+        }
+    }
+
+    std::function<void(const ExplicitSnapshot&)> writer_;
+    size_t capacity_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::condition_variable space_;
+    std::deque<ExplicitSnapshot> queue_;
+    bool done_;
+    std::thread thread_; // Last, so it starts after everything it uses
+};
+
+ExplicitDynamics::ExplicitDynamics(const Mesh& mesh, const MaterialTable& materials, const BoundaryConditions& bcs,
+                                   unsigned num_threads)
+    : mesh_(mesh),
+      materials_(materials),
+      slots_(materials.elementSlots(mesh)),
+      num_threads_(num_threads),
+      geometry_(mesh, num_threads),
+      constrained_(3 * mesh.getNumNodes(), 0),
+      safety_factor_(0.9),
+      time_step_(0.0),
+      time_(0.0),
+      step_(0),
+      started_(false),
+      output_every_(0),
+      output_queue_length_(2) {
+    const MeshArray<ElementType>& types = mesh.getElementTypes();
+    auto other = std::find_if(types.begin(), types.end(), [](ElementType t) { return t != ElementType::Tet4; });
+    if (other != types.end()) {
+        throw std::invalid_argument("ExplicitDynamics: element " +
+                                    std::to_string(mesh.getElementIds()[other - types.begin()]) +
+                                    " is not a Tet4; only Tet4 elements are supported");
+    }
+    const Eigen::Index num_dofs = static_cast<Eigen::Index>(constrained_.size());
+    prescribed_ = bcs.expand(Eigen::VectorXd::Zero(bcs.getNumFreeDofs()));
+    for (Eigen::Index dof = 0; dof < num_dofs; ++dof) {
+        constrained_[dof] = bcs.isConstrained(dof);
+    }
+
+    // 1. Lumped mass, rho V / 4 to each node of a tet
+    mass_ = Eigen::VectorXd::Zero(num_dofs);
+    for (size_t e = 0; e < mesh.getNumElements(); ++e) {
+        double node_mass = materials_.getMaterial(slots_[e]).getDensity() * geometry_.getVolume(e) / 4.0;
+        const int* nodes = mesh.getElementNodes(e);
+        for (int i = 0; i < 4; ++i) {
+            for (int c = 0; c < 3; ++c) {
+                mass_(3 * nodes[i] + c) += node_mass;
+            }
+        }
+    }
+    inv_mass_ = Eigen::VectorXd::Zero(num_dofs);
+    for (Eigen::Index dof = 0; dof < num_dofs; ++dof) {
+        if (constrained_[dof]) {
+            continue;
+        }
+        if (!(mass_(dof) > 0.0)) {
+            throw std::invalid_argument("ExplicitDynamics: node " + std::to_string(mesh.getNodeIds()[dof / 3]) +
+                                        " has no mass; every material needs a positive density.");
+        }
+        inv_mass_(dof) = 1.0 / mass_(dof);
+    }
+
+    // 2. One element chunk per thread, in material order so the kernel runs
+    //    are long, each with a buffer spanning the DOFs it touches
+    order_ = groupElementsByKernel(mesh, slots_);
+    size_t num_chunks = std::max<size_t>(std::min<size_t>(resolveThreadCount(num_threads), order_.size()), 1);
+    chunk_offsets_.resize(num_chunks + 1);
+    chunk_dof_begin_.resize(num_chunks);
+    chunk_forces_.resize(num_chunks);
+    for (size_t c = 0; c <= num_chunks; ++c) {
+        chunk_offsets_[c] = order_.size() * c / num_chunks;
+    }
+    for (size_t c = 0; c < num_chunks; ++c) {
+        Eigen::Index lo = num_dofs, hi = 0;
+        for (size_t k = chunk_offsets_[c]; k < chunk_offsets_[c + 1]; ++k) {
+            const int* nodes = mesh.getElementNodes(order_[k]);
+            for (int i = 0; i < 4; ++i) {
+                lo = std::min<Eigen::Index>(lo, 3 * nodes[i]);
+                hi = std::max<Eigen::Index>(hi, 3 * nodes[i] + 3);
+            }
+        }
+        chunk_dof_begin_[c] = std::min(lo, hi);
+        chunk_forces_[c].resize(hi - chunk_dof_begin_[c]);
+    }
+
+    // 3. At rest at the prescribed displacements
+    u_ = prescribed_;
+    v_half_ = Eigen::VectorXd::Zero(num_dofs);
+    a_ = Eigen::VectorXd::Zero(num_dofs);
+    external_ = Eigen::VectorXd::Zero(num_dofs);
+}
+
+ExplicitDynamics::~ExplicitDynamics() = default;
+
+double ExplicitDynamics::criticalTimeStep() const {
+    double dt = std::numeric_limits<double>::infinity();
+    for (size_t e = 0; e < mesh_.getNumElements(); ++e) {
+        if (mesh_.getElementTypes()[e] != ElementType::Tet4 || geometry_.getVolume(e) <= 0.0) {
+            continue;
+        }
+        double gradients = 0.0;
+        for (int i = 0; i < 4; ++i) {
+            for (int d = 0; d < 3; ++d) {
+                gradients += geometry_.getGradient(e, i, d) * geometry_.getGradient(e, i, d);
+            }
+        }
+        const Eigen::Matrix<double, 6, 6>& D = materials_.getDMatrix(slots_[e]);
+        double modulus = std::max({D(0, 0), D(1, 1), D(2, 2)});
+        double wave_speed = std::sqrt(modulus / materials_.getMaterial(slots_[e]).getDensity());
+        dt = std::min(dt, 1.0 / (std::sqrt(gradients) * wave_speed));
+    }
+    return dt;
+}
+
+void ExplicitDynamics::setSafetyFactor(double factor) {
+    if (started_) {
+        v_half_ = getVelocity();
+        started_ = false;
+    }
+    safety_factor_ = factor;
+}
+
+void ExplicitDynamics::setTimeStep(double dt) {
+    if (started_) {
+        v_half_ = getVelocity();
+        started_ = false;
+    }
+    time_step_ = dt;
+}
+
+double ExplicitDynamics::getTimeStep() const {
+    return time_step_ > 0.0 ? time_step_ : safety_factor_ * criticalTimeStep();
+}
+
+void ExplicitDynamics::setInitialConditions(const Eigen::VectorXd& displacement, const Eigen::VectorXd& velocity) {
+    if (displacement.size() != u_.size() || velocity.size() != u_.size()) {
+        throw std::invalid_argument("ExplicitDynamics::setInitialConditions: vectors must have one entry per DOF.");
+    }
+    for (Eigen::Index dof = 0; dof < u_.size(); ++dof) {
+        u_(dof) = constrained_[dof] ? prescribed_(dof) : displacement(dof);
+        v_half_(dof) = constrained_[dof] ? 0.0 : velocity(dof);
+    }
+    time_ = 0.0;
+    step_ = 0;
+    started_ = false;
+}
+
+void ExplicitDynamics::setExternalForce(const Eigen::VectorXd& F, std::function<double(double)> amplitude) {
+    if (F.size() != u_.size()) {
+        throw std::invalid_argument("ExplicitDynamics::setExternalForce: F must have one entry per DOF.");
+    }
+    if (started_) {
+        v_half_ = getVelocity();
+        started_ = false;
+    }
+    external_ = F;
+    amplitude_ = std::move(amplitude);
+}
+
+void ExplicitDynamics::setOutput(int every, std::function<void(const ExplicitSnapshot&)> writer, int queue_length) {
+    output_every_ = writer ? every : 0;
+    writer_ = std::move(writer);
+    output_queue_length_ = queue_length;
+}
+
+Eigen::VectorXd ExplicitDynamics::getVelocity() const {
+    return started_ ? Eigen::VectorXd(v_half_ - 0.5 * stats_.time_step * a_) : v_half_;
+}
+
+void ExplicitDynamics::internalForces(const Eigen::VectorXd& u, Eigen::VectorXd& f) const {
+    const int W = kTet4BatchWidth;
+    const Tet4Geometry<W>* cached = geometry_.blocks();
+    const size_t num_chunks = chunk_forces_.size();
+
+    // 1. Every chunk into its own buffer, one chunk per thread
+    parallelFor(num_chunks, static_cast<unsigned>(num_chunks), [&](size_t chunk_begin, size_t chunk_end, unsigned) {
+        for (size_t c = chunk_begin; c < chunk_end; ++c) {
+            Eigen::VectorXd& buffer = chunk_forces_[c];
+            const Eigen::Index dof_begin = chunk_dof_begin_[c];
+            buffer.setZero();
+            const size_t* elements = order_.data() + chunk_offsets_[c];
+            forEachElementRun(
+                mesh_, materials_, slots_, chunk_offsets_[c + 1] - chunk_offsets_[c],
+                [&](size_t k) { return elements[k]; },
+                [&](ElementType, const Eigen::Matrix<double, 6, 6>& D, size_t first, size_t count) {
+                    alignas(64) double u_e[12][W] = {};
+                    alignas(64) double f_e[12][W];
+                    forEachTet4Batch(
+                        mesh_, count, [&](size_t k) { return elements[first + k]; },
+                        [&](const Tet4Batch<W>& batch, const size_t* batch_elements, int lanes) {
+                            // Gather the element displacements lane-major
+                            for (int l = 0; l < lanes; ++l) {
+                                const int* nodes = mesh_.getElementNodes(batch_elements[l]);
+                                for (int i = 0; i < 4; ++i) {
+                                    for (int d = 0; d < 3; ++d) {
+                                        u_e[3 * i + d][l] = u(3 * nodes[i] + d);
+                                    }
+                                }
+                            }
+                            for (int l = lanes; l < W; ++l) {
+                                for (int i = 0; i < 12; ++i) {
+                                    u_e[i][l] = 0.0;
+                                }
+                            }
+
+                            // All lanes at once, then scatter
+                            computeTet4InternalForces(batch.geometry, D, u_e, f_e);
+                            for (int l = 0; l < lanes; ++l) {
+                                const int* nodes = mesh_.getElementNodes(batch_elements[l]);
+                                for (int i = 0; i < 4; ++i) {
+                                    for (int d = 0; d < 3; ++d) {
+                                        buffer(3 * nodes[i] + d - dof_begin) += f_e[3 * i + d][l];
+                                    }
+                                }
+                            }
+                        },
+                        cached);
+                });
+        }
+    });
+
+    // 2. Sum the buffers in chunk order, split by DOF range
+    f.resize(u.size());
+    parallelFor(static_cast<size_t>(u.size()), static_cast<unsigned>(num_chunks),
+                [&](size_t begin, size_t end, unsigned) {
+                    const Eigen::Index lo = static_cast<Eigen::Index>(begin), hi = static_cast<Eigen::Index>(end);
+                    f.segment(lo, hi - lo).setZero();
+                    for (size_t c = 0; c < num_chunks; ++c) {
+                        const Eigen::Index first = std::max(lo, chunk_dof_begin_[c]);
+                        const Eigen::Index last = std::min(hi, chunk_dof_begin_[c] + chunk_forces_[c].size());
+                        if (first < last) {
+                            f.segment(first, last - first) += chunk_forces_[c].segment(first - chunk_dof_begin_[c],
+                                                                                       last - first);
+                        }
+                    }
+                });
+}
+
+void ExplicitDynamics::computeAcceleration() {
+    internalForces(u_, f_int_);
+    double scale = amplitude_ ? amplitude_(time_) : 1.0;
+    a_ = inv_mass_.cwiseProduct(scale * external_ - f_int_);
+}
+
+void ExplicitDynamics::run(long num_steps) {
+    FEM_PROFILE_SCOPE("explicit");
+    const double dt = getTimeStep();
+    if (!(dt > 0.0) || !std::isfinite(dt)) {
+        throw std::invalid_argument("ExplicitDynamics::run: no valid time step (" + std::to_string(dt) + ").");
+    }
+    stats_ = ExplicitStats();
+    stats_.time_step = dt;
+    std::unique_ptr<OutputQueue> output;
+    if (output_every_ > 0) {
+        output.reset(new OutputQueue(writer_, static_cast<size_t>(output_queue_length_)));
+    }
+
+    // 1. Stagger the velocity half a step ahead of the displacement
+    auto start = std::chrono::steady_clock::now();
+    if (!started_) {
+        computeAcceleration();
+        v_half_ += 0.5 * dt * a_;
+        started_ = true;
+    }
+
+    // 2. Central differences: u_{n+1} = u_n + dt v_{n+1/2}, v_{n+3/2} = v_{n+1/2} + dt a_{n+1}.
+    //    v_half_ and a_ vanish at the constrained DOFs, so those stay put.
+    for (long s = 0; s < num_steps; ++s) {
+        u_ += dt * v_half_;
+        time_ += dt;
+        ++step_;
+        computeAcceleration();
+        v_half_ += dt * a_;
+        ++stats_.steps;
+
+        if (output && (step_ % output_every_ == 0 || s + 1 == num_steps)) {
+            ExplicitSnapshot snapshot;
+            snapshot.step = step_;
+            snapshot.time = time_;
+            snapshot.displacement = u_;
+            snapshot.velocity = getVelocity();
+            stats_.output_wait_seconds += output->push(std::move(snapshot));
+            ++stats_.snapshots;
+        }
+    }
+    stats_.loop_seconds = secondsSince(start) - stats_.output_wait_seconds;
+    if (output) {
+        output->finish();
+    }
+
+    size_t tets = std::count(mesh_.getElementTypes().begin(), mesh_.getElementTypes().end(), ElementType::Tet4);
+    if (stats_.loop_seconds > 0.0) {
+        stats_.element_updates_per_second = static_cast<double>(stats_.steps) * tets / stats_.loop_seconds;
+    }
+    FEM_PROFILE_ADD("explicit.steps", stats_.steps);
+    FEM_PROFILE_ADD("explicit.element_updates", static_cast<size_t>(stats_.steps) * tets);
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "BoundaryConditions.h"
+#include "ElementGeometry.h"
+#include "MaterialTable.h"
+#include "Mesh.h"
+#include <Eigen/Core>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// State handed to the output callback: copies, so the time loop can move on
+struct ExplicitSnapshot {
+    long step = 0;
+    double time = 0.0;
+    Eigen::VectorXd displacement;
+    Eigen::VectorXd velocity;
+};
+
+struct ExplicitStats {
+    long steps = 0;                  // Steps taken by the last run()
+    double time_step = 0.0;          // dt used
+    double loop_seconds = 0.0;       // Time loop, output excluded
+    double element_updates_per_second = 0.0;
+    long snapshots = 0;              // Handed to the output callback
+    double output_wait_seconds = 0.0; // Time loop blocked on a full output queue
+};
+
+// Explicit central-difference time integration with a lumped mass, for
+// impact and other short transients: no global matrix is assembled or
+// factored. Every step computes the internal forces K u element by element
+// with the batched Tet4 kernel, then
+//
+//     a = M^-1 (F(t) - K u),  v += dt a,  u += dt v
+//
+// with v staggered half a step. The scheme is conditionally stable; the
+// default time step is a safety factor times criticalTimeStep().
+//
+// Snapshots go to a writer thread every N steps through a short queue, so
+// writing results overlaps the following steps. The loop waits only when the
+// writer falls more than the queue length behind (see ExplicitStats).
+//
+// Small strains, linear elastic, Tet4 elements only. Constrained DOFs stay at
+// their prescribed values.
+class ExplicitDynamics {
+public:
+    // The mesh and the boundary conditions must outlive the engine; the
+    // materials are copied and every material needs a positive density.
+    // std::invalid_argument if an element is not a Tet4 or a free DOF has no
+    // mass. num_threads = 1 is serial; 0 uses every hardware thread.
+    ExplicitDynamics(const Mesh& mesh, const MaterialTable& materials, const BoundaryConditions& bcs,
+                     unsigned num_threads = 1);
+    ~ExplicitDynamics();
+
+    ExplicitDynamics(const ExplicitDynamics&) = delete;
+    ExplicitDynamics& operator=(const ExplicitDynamics&) = delete;
+
+    // Stable step estimate: min over elements of h / c, with c the
+    // dilatational wave speed sqrt(max(D_11, D_22, D_33) / rho) of the
+    // material and h = 1 / sqrt(sum_i |grad N_i|^2) the element size. This h
+    // is at most the smallest altitude and keeps h / c below the element's
+    // own limit 2 / omega_max for any tet shape (the altitude alone
+    // overshoots by up to 2x on slender tets), so the bound is conservative.
+    double criticalTimeStep() const;
+    void setSafetyFactor(double factor); // Default 0.9
+    void setTimeStep(double dt);         // Overrides the estimate; 0 restores it
+    double getTimeStep() const;
+
+    // Full-size vectors; prescribed values win at the constrained DOFs
+    void setInitialConditions(const Eigen::VectorXd& displacement, const Eigen::VectorXd& velocity);
+    // F(t) = amplitude(t) * F; without an amplitude the load is constant
+    void setExternalForce(const Eigen::VectorXd& F, std::function<double(double)> amplitude = nullptr);
+
+    // Calls writer(snapshot) on a background thread every `every` steps and
+    // after the last step; queue_length snapshots may be pending at once.
+    // every = 0 turns output off.
+    void setOutput(int every, std::function<void(const ExplicitSnapshot&)> writer, int queue_length = 2);
+
+    // Advances num_steps steps; returns once the writer has caught up
+    void run(long num_steps);
+
+    double getTime() const { return time_; }
+    long getStep() const { return step_; }
+    const Eigen::VectorXd& getDisplacement() const { return u_; }
+    // Velocity at the current time (the staggered one shifted half a step)
+    Eigen::VectorXd getVelocity() const;
+    const Eigen::VectorXd& getLumpedMass() const { return mass_; } // Per DOF
+    const ExplicitStats& getStats() const { return stats_; }
+
+    // K u of the current displacements, the per-step kernel on its own.
+    // One parallel region per call: each thread scatters a fixed chunk of
+    // elements into its own force buffer, and the buffers are then summed in
+    // chunk order, so the result is the same from step to step. The buffers
+    // are reused, so concurrent calls on one engine are not allowed.
+    void internalForces(const Eigen::VectorXd& u, Eigen::VectorXd& f) const;
+
+private:
+    class OutputQueue;
+
+    // a = M^-1 (F(t) - K u) at the current state
+    void computeAcceleration();
+
+    const Mesh& mesh_;
+    MaterialTable materials_;
+    std::vector<int> slots_;
+    unsigned num_threads_;
+    ElementGeometry geometry_;
+    // Element chunk c is order_[chunk_offsets_[c] .. chunk_offsets_[c + 1]);
+    // its buffer covers the DOFs it touches, from chunk_dof_begin_[c] on
+    std::vector<size_t> order_;
+    std::vector<size_t> chunk_offsets_;
+    std::vector<Eigen::Index> chunk_dof_begin_;
+    mutable std::vector<Eigen::VectorXd> chunk_forces_;
+    std::vector<char> constrained_;
+    Eigen::VectorXd prescribed_;
+    Eigen::VectorXd mass_;
+    Eigen::VectorXd inv_mass_; // Zero at the constrained DOFs
+
+    double safety_factor_;
+    double time_step_; // 0 = safety factor times the estimate
+    Eigen::VectorXd external_;
+    std::function<double(double)> amplitude_;
+
+    double time_;
+    long step_;
+    Eigen::VectorXd u_, v_half_, a_, f_int_;
+    bool started_; // v_half_ holds the staggered velocity
+
+    int output_every_;
+    int output_queue_length_;
+    std::function<void(const ExplicitSnapshot&)> writer_;
+    ExplicitStats stats_;
+};
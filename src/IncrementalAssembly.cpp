@@ -0,0 +1,113 @@
+#include "IncrementalAssembly.h"
+#include "ElementKernel.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+IncrementalAssembler::IncrementalAssembler(Mesh& mesh, const MaterialTable& materials, unsigned num_threads)
+    : mesh_(mesh),
+      materials_(materials),
+      assembler_(num_threads),
+      pattern_(assembler_.buildPattern(mesh)),
+      incidence_(buildNodeElementIncidence(mesh)),
+      slots_(materials.elementSlots(mesh)),
+      scales_(mesh.getNumElements(), 1.0) {
+    const MeshArray<int>& ids = mesh.getElementIds();
+    element_index_.reserve(ids.size());
+    for (size_t e = 0; e < ids.size(); ++e) {
+        element_index_.emplace(ids[e], e);
+    }
+    assembler_.setElementScales(&scales_);
+    assemble();
+}
+
+void IncrementalAssembler::assemble() {
+    assembler_.assembleNumeric(mesh_, materials_, pattern_, K_);
+    changed_.clear();
+}
+
+int IncrementalAssembler::getElementIndex(int element_id) const {
+    auto it = element_index_.find(element_id);
+    return it == element_index_.end() ? -1 : static_cast<int>(it->second);
+}
+
+void IncrementalAssembler::addElementMatrix(size_t e, double factor) {
+    if (factor == 0.0) {
+        return;
+    }
+    const Eigen::Matrix<double, 6, 6>& D = materials_.getDMatrix(slots_[e]);
+    double* values = K_.valuePtr();
+    const int* map = pattern_.value_map.data() + pattern_.value_offsets[e];
+    dispatchElementType(mesh_.getElementTypes()[e], [&](auto tag) {
+        constexpr ElementType Type = decltype(tag)::value;
+        constexpr int kDofs = ElementTraits<Type>::kDofs;
+        ElementMatrix<Type> ke;
+        computeElementStiffness<Type>(gatherElementCoords<Type>(mesh_, e), D, ke);
+        for (int i = 0; i < kDofs; ++i) {
+            for (int j = 0; j < kDofs; ++j) {
+                values[map[i * kDofs + j]] += factor * ke(i, j);
+            }
+        }
+    });
+}
+
+void IncrementalAssembler::setScales(const std::vector<ScaleChange>& changes) {
+    FEM_PROFILE_SCOPE("assembly.incremental");
+    std::vector<size_t> elements(changes.size());
+    for (size_t k = 0; k < changes.size(); ++k) {
+        int e = getElementIndex(changes[k].element_id);
+        if (e < 0) {
+            throw std::out_of_range("IncrementalAssembler::setScales: no element with ID " +
+                                    std::to_string(changes[k].element_id));
+        }
+        elements[k] = static_cast<size_t>(e);
+    }
+
+    // K is linear in the scale, so one element matrix covers old and new
+    changed_.clear();
+    for (size_t k = 0; k < changes.size(); ++k) {
+        size_t e = elements[k];
+        addElementMatrix(e, changes[k].scale - scales_[e]);
+        scales_[e] = changes[k].scale;
+        changed_.push_back(e);
+    }
+    std::sort(changed_.begin(), changed_.end());
+    changed_.erase(std::unique(changed_.begin(), changed_.end()), changed_.end());
+    FEM_PROFILE_ADD("assembly.changed_elements", changed_.size());
+}
+
+void IncrementalAssembler::moveNodes(const std::vector<NodeMove>& moves) {
+    FEM_PROFILE_SCOPE("assembly.incremental");
+    std::vector<size_t> nodes(moves.size());
+    for (size_t k = 0; k < moves.size(); ++k) {
+        int n = mesh_.getNodeIndex(moves[k].node_id);
+        if (n < 0) {
+            throw std::out_of_range("IncrementalAssembler::moveNodes: no node with ID " +
+                                    std::to_string(moves[k].node_id));
+        }
+        nodes[k] = static_cast<size_t>(n);
+    }
+
+    // 1. Elements around the moved nodes
+    changed_.clear();
+    for (size_t n : nodes) {
+        for (size_t k = incidence_.offsets[n]; k < incidence_.offsets[n + 1]; ++k) {
+            changed_.push_back(incidence_.elements[k]);
+        }
+    }
+    std::sort(changed_.begin(), changed_.end());
+    changed_.erase(std::unique(changed_.begin(), changed_.end()), changed_.end());
+
+    // 2. Old contributions out, move, new contributions in
+    for (size_t e : changed_) {
+        addElementMatrix(e, -scales_[e]);
+    }
+    for (size_t k = 0; k < moves.size(); ++k) {
+        mesh_.setNodeCoordinates(nodes[k], moves[k].x, moves[k].y, moves[k].z);
+    }
+    for (size_t e : changed_) {
+        addElementMatrix(e, scales_[e]);
+    }
+    FEM_PROFILE_ADD("assembly.changed_elements", changed_.size());
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Assembler.h"
+#include "MaterialTable.h"
+#include "MeshTopology.h"
+#include <Eigen/Sparse>
+#include <unordered_map>
+#include <vector>
+
+// Keeps K assembled on a fixed sparsity pattern and applies localized changes
+// in place, for optimization and damage loops that touch a few elements per
+// iteration. A changed element's old contribution is subtracted from K's
+// compressed values and its new one added, so an update costs time in
+// proportion to the changed elements, not the mesh.
+//
+// Every element carries a stiffness scale factor (1 initially) multiplying
+// its D, e.g. a SIMP density^p or 1 - damage. Repeated updates accumulate
+// rounding in the touched entries; assemble() starts over from scratch.
+class IncrementalAssembler {
+public:
+    struct ScaleChange {
+        int element_id;
+        double scale;
+    };
+    struct NodeMove {
+        int node_id;
+        double x, y, z;
+    };
+
+    // The mesh must outlive the assembler, and its node coordinates should
+    // change only through moveNodes; the table is copied. Builds the pattern and assembles K.
+    // std::out_of_range if an element's material ID is not in the table.
+    IncrementalAssembler(Mesh& mesh, const MaterialTable& materials, unsigned num_threads = 1);
+
+    // Full reassembly with the current scale factors
+    void assemble();
+    const Eigen::SparseMatrix<double>& matrix() const { return K_; }
+
+    double getScale(size_t e) const { return scales_[e]; }
+    const std::vector<double>& getScales() const { return scales_; }
+
+    // Both throw std::out_of_range for an unknown ID, before changing anything
+    void setScales(const std::vector<ScaleChange>& changes);
+    // Moves nodes and updates every element around them
+    void moveNodes(const std::vector<NodeMove>& moves);
+
+    // Indices of the elements the last update touched
+    const std::vector<size_t>& getChangedElements() const { return changed_; }
+    // Index of an element ID, or -1 if there is no such element
+    int getElementIndex(int element_id) const;
+
+private:
+    // K += factor * ke(e), with ke for the element's current coordinates
+    void addElementMatrix(size_t e, double factor);
+
+    Mesh& mesh_;
+    MaterialTable materials_;
+    Assembler assembler_;
+    AssemblyPattern pattern_;
+    NodeElementIncidence incidence_;
+    std::vector<int> slots_;
+    std::vector<double> scales_;
+    std::unordered_map<int, size_t> element_index_;
+    std::vector<size_t> changed_;
+    Eigen::SparseMatrix<double> K_;
+};
@@ -0,0 +1,746 @@
+#include "LinearSolver.h"
+#include "AmgPreconditioner.h"
+#include "SchwarzPreconditioner.h"
+#include "Profiler.h"
+#include <Eigen/IterativeLinearSolvers>
+#include <Eigen/SparseCholesky>
+#include <Eigen/SparseLU>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+
+namespace {
+
+typedef Eigen::SparseMatrix<double> SpMat;
+typedef Eigen::SparseMatrix<float> SpMatF;
+
+// Relative residual each single-precision CG solve aims for inside the
+// refinement loop; tighter is not reachable in float on stiff systems
+const float kSingleTolerance = 1e-4f;
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+const struct {
+    SolverType type;
+    const char* name;
+} kSolverNames[] = {
+    {SolverType::SparseLU, "lu"},
+    {SolverType::LDLT, "ldlt"},
+    {SolverType::LLT, "llt"},
+    {SolverType::CGJacobi, "cg-jacobi"},
+    {SolverType::CGIncompleteCholesky, "cg-ic"},
+    {SolverType::CGAMG, "cg-amg"},
+    {SolverType::CGSchwarz, "cg-schwarz"},
+};
+
+const struct {
+    SolverPrecision precision;
+    const char* name;
+} kPrecisionNames[] = {
+    {SolverPrecision::Double, "double"},
+    {SolverPrecision::Mixed, "mixed"},
+};
+
+template <typename Solver, typename Matrix>
+bool factorizeTimed(Solver& solver, const Matrix& K, SolverStats& stats) {
+    FEM_PROFILE_SCOPE("solver.factorize");
+    auto t0 = std::chrono::steady_clock::now();
+    solver.factorize(K);
+    stats.factorize_seconds = secondsSince(t0);
+    return solver.info() == Eigen::Success;
+}
+
+// Runs analyzePattern/factorize on any Eigen sparse solver, timing both phases
+template <typename Solver, typename Matrix>
+bool computeTimed(Solver& solver, const Matrix& K, SolverStats& stats) {
+    {
+        FEM_PROFILE_SCOPE("solver.analyze");
+        auto t0 = std::chrono::steady_clock::now();
+        solver.analyzePattern(K);
+        stats.analyze_seconds = secondsSince(t0);
+    }
+    return factorizeTimed(solver, K, stats);
+}
+
+// Forward and back substitution with a simplicial LDL^T (given its D) or
+// LL^T factor (d == nullptr) for a block of right-hand sides, in the factor's
+// scalar type. The block is held row-major, so each factor entry updates
+// every column at once and the factor is streamed through once per block
+// instead of once per right-hand side.
+template <typename Cholesky, typename Scalar = typename Cholesky::Scalar>
+void substituteBlock(const Cholesky& cholesky, const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>* d,
+                const Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>& F,
+                Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>& U) {
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> Block;
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowBlock;
+    bool unit_diagonal = d != nullptr;
+    const Eigen::SparseMatrix<Scalar>& L = cholesky.matrixL().nestedExpression();
+    const int* outer = L.outerIndexPtr();
+    const int* inner = L.innerIndexPtr();
+    const Scalar* values = L.valuePtr();
+    Eigen::Index n = L.cols();
+
+    RowBlock X = cholesky.permutationP().size() > 0 ? RowBlock(cholesky.permutationP() * F) : RowBlock(F);
+    auto diagonal = [&](Eigen::Index j) {
+        for (int p = outer[j]; p < outer[j + 1]; ++p) {
+            if (inner[p] == j) {
+                return values[p];
+            }
+        }
+        return Scalar(1);
+    };
+
+    // 1. L y = b, column by column of L
+    for (Eigen::Index j = 0; j < n; ++j) {
+        if (!unit_diagonal) {
+            X.row(j) /= diagonal(j);
+        }
+        for (int p = outer[j]; p < outer[j + 1]; ++p) {
+            if (inner[p] > j) {
+                X.row(inner[p]) -= values[p] * X.row(j);
+            }
+        }
+    }
+    // 2. D z = y
+    if (unit_diagonal) {
+        for (Eigen::Index j = 0; j < n; ++j) {
+            X.row(j) /= (*d)(j);
+        }
+    }
+    // 3. L^T x = z, as dot products down each column of L
+    for (Eigen::Index j = n - 1; j >= 0; --j) {
+        for (int p = outer[j]; p < outer[j + 1]; ++p) {
+            if (inner[p] > j) {
+                X.row(j) -= values[p] * X.row(inner[p]);
+            }
+        }
+        if (!unit_diagonal) {
+            X.row(j) /= diagonal(j);
+        }
+    }
+    U = cholesky.permutationPinv().size() > 0 ? Block(cholesky.permutationPinv() * X) : Block(X);
+}
+
+// Iterative solvers take the block one column at a time, optionally
+// starting from the columns of a guess
+template <typename CG, typename Block>
+Eigen::ComputationInfo solveColumns(CG& cg, const Block& F, Block& U, int& iterations, const Block* guess = nullptr) {
+    U.resize(F.rows(), F.cols());
+    iterations = 0;
+    Eigen::ComputationInfo info = Eigen::Success;
+    for (Eigen::Index c = 0; c < F.cols(); ++c) {
+        if (guess) {
+            U.col(c) = cg.solveWithGuess(F.col(c), guess->col(c));
+        } else {
+            U.col(c) = cg.solve(F.col(c));
+        }
+        iterations = std::max(iterations, static_cast<int>(cg.iterations()));
+        if (cg.info() != Eigen::Success) {
+            info = cg.info();
+        }
+    }
+    return info;
+}
+
+template <typename CG>
+void configureCG(CG& cg, double tolerance, int max_iterations) {
+    cg.setTolerance(tolerance);
+    if (max_iterations > 0) {
+        cg.setMaxIterations(max_iterations);
+    }
+}
+
+// Largest ||R_c|| / ||F_c|| over the columns
+double worstRelativeResidual(const Eigen::MatrixXd& R, const Eigen::MatrixXd& F) {
+    double worst = 0.0;
+    for (Eigen::Index c = 0; c < F.cols(); ++c) {
+        double f_norm = F.col(c).norm();
+        worst = std::max(worst, R.col(c).norm() / (f_norm > 0.0 ? f_norm : 1.0));
+    }
+    return worst;
+}
+
+} // namespace
+
+bool parseSolverType(const std::string& name, SolverType& type) {
+    for (const auto& entry : kSolverNames) {
+        if (name == entry.name) {
+            type = entry.type;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* solverTypeName(SolverType type) {
+    for (const auto& entry : kSolverNames) {
+        if (entry.type == type) {
+            return entry.name;
+        }
+    }
+    return "unknown";
+}
+
+bool parseSolverPrecision(const std::string& name, SolverPrecision& precision) {
+    for (const auto& entry : kPrecisionNames) {
+        if (name == entry.name) {
+            precision = entry.precision;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* solverPrecisionName(SolverPrecision precision) {
+    for (const auto& entry : kPrecisionNames) {
+        if (entry.precision == precision) {
+            return entry.name;
+        }
+    }
+    return "unknown";
+}
+
+// Two matrices with the same size and nonzero count can still differ in
+// where the nonzeros are, which would invalidate the symbolic analysis
+uint64_t sparsityPatternHash(const Eigen::SparseMatrix<double>& K) {
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](uint64_t v) {
+        hash ^= v;
+        hash *= 1099511628211ull;
+    };
+    mix(static_cast<uint64_t>(K.rows()));
+    mix(static_cast<uint64_t>(K.cols()));
+    for (Eigen::Index c = 0; c < K.outerSize(); ++c) {
+        const int begin = K.outerIndexPtr()[c];
+        const int end = K.isCompressed() ? K.outerIndexPtr()[c + 1] : begin + K.innerNonZeroPtr()[c];
+        mix(static_cast<uint64_t>(end - begin));
+        for (int k = begin; k < end; ++k) {
+            mix(static_cast<uint64_t>(K.innerIndexPtr()[k]));
+        }
+    }
+    return hash;
+}
+
+// Only the backend matching the solver type is ever created
+struct LinearSolver::Backends {
+    std::unique_ptr<Eigen::SparseLU<SpMat>> lu;
+    std::unique_ptr<Eigen::SimplicialLDLT<SpMat>> ldlt;
+    std::unique_ptr<Eigen::SimplicialLLT<SpMat>> llt;
+    std::unique_ptr<Eigen::ConjugateGradient<SpMat, Eigen::Lower | Eigen::Upper, Eigen::DiagonalPreconditioner<double>>> cg_jacobi;
+    std::unique_ptr<Eigen::ConjugateGradient<SpMat, Eigen::Lower | Eigen::Upper, Eigen::IncompleteCholesky<double>>> cg_ic;
+    std::unique_ptr<Eigen::ConjugateGradient<SpMat, Eigen::Lower | Eigen::Upper, AmgPreconditioner>> cg_amg;
+    // Both the product and the preconditioner of cg-schwarz are threaded
+    std::unique_ptr<SymmetricSparseOperator> schwarz_operator;
+    std::unique_ptr<Eigen::ConjugateGradient<SymmetricSparseOperator, Eigen::Lower | Eigen::Upper, SchwarzPreconditioner>>
+        cg_schwarz;
+
+    // Mixed precision: the single-precision copy of K and its backend
+    bool single = false;
+    SpMatF K_single;
+    std::unique_ptr<Eigen::SparseLU<SpMatF>> lu_single;
+    std::unique_ptr<Eigen::SimplicialLDLT<SpMatF>> ldlt_single;
+    std::unique_ptr<Eigen::SimplicialLLT<SpMatF>> llt_single;
+    std::unique_ptr<Eigen::ConjugateGradient<SpMatF, Eigen::Lower | Eigen::Upper, Eigen::DiagonalPreconditioner<float>>> cg_jacobi_single;
+    std::unique_ptr<Eigen::ConjugateGradient<SpMatF, Eigen::Lower | Eigen::Upper, Eigen::IncompleteCholesky<float>>> cg_ic_single;
+};
+
+LinearSolver::LinearSolver(SolverType type)
+    : type_(type),
+      precision_(SolverPrecision::Double),
+      max_refinements_(20),
+      tolerance_(1e-10),
+      max_iterations_(-1),
+      mesh_(nullptr),
+      num_subdomains_(0),
+      num_threads_(0),
+      K_(nullptr),
+      analyzed_rows_(-1),
+      analyzed_pattern_(0),
+      backends_(new Backends()) {}
+
+LinearSolver::~LinearSolver() = default;
+
+SolverType LinearSolver::getType() const {
+    return type_;
+}
+
+void LinearSolver::setTolerance(double tolerance) {
+    tolerance_ = tolerance;
+}
+
+void LinearSolver::setMaxIterations(int max_iterations) {
+    max_iterations_ = max_iterations;
+}
+
+void LinearSolver::setPrecision(SolverPrecision precision) {
+    precision_ = precision;
+}
+
+SolverPrecision LinearSolver::getPrecision() const {
+    return precision_;
+}
+
+void LinearSolver::setMaxRefinements(int max_refinements) {
+    max_refinements_ = max_refinements;
+}
+
+void LinearSolver::setMesh(const Mesh& mesh) {
+    mesh_ = &mesh;
+}
+
+void LinearSolver::setNearNullspace(const Eigen::MatrixXd& modes) {
+    nullspace_ = modes;
+}
+
+void LinearSolver::setSubdomains(const std::vector<int>& row_subdomain) {
+    row_subdomain_ = row_subdomain;
+}
+
+void LinearSolver::setNumSubdomains(int num_subdomains) {
+    num_subdomains_ = num_subdomains;
+}
+
+void LinearSolver::setNumThreads(unsigned num_threads) {
+    num_threads_ = num_threads;
+}
+
+bool LinearSolver::compute(const Eigen::SparseMatrix<double>& K) {
+    K_ = nullptr;
+    analyzed_rows_ = K.rows();
+    analyzed_pattern_ = sparsityPatternHash(K);
+    stats_ = SolverStats();
+    backends_.reset(new Backends());
+    Backends& b = *backends_;
+    FEM_PROFILE_COUNTER("solver.nonzeros", K.nonZeros());
+    if (precision_ == SolverPrecision::Mixed) {
+        if (!computeSingle(K, false)) {
+            return false;
+        }
+        K_ = &K;
+        return true;
+    }
+
+    bool ok = false;
+    switch (type_) {
+    case SolverType::SparseLU:
+        b.lu.reset(new Eigen::SparseLU<SpMat>());
+        ok = computeTimed(*b.lu, K, stats_);
+        break;
+    case SolverType::LDLT:
+        b.ldlt.reset(new Eigen::SimplicialLDLT<SpMat>());
+        ok = computeTimed(*b.ldlt, K, stats_);
+        break;
+    case SolverType::LLT:
+        b.llt.reset(new Eigen::SimplicialLLT<SpMat>());
+        ok = computeTimed(*b.llt, K, stats_);
+        break;
+    case SolverType::CGJacobi:
+        b.cg_jacobi.reset(new Eigen::ConjugateGradient<SpMat, Eigen::Lower | Eigen::Upper, Eigen::DiagonalPreconditioner<double>>());
+        configureCG(*b.cg_jacobi, tolerance_, max_iterations_);
+        ok = computeTimed(*b.cg_jacobi, K, stats_);
+        break;
+    case SolverType::CGIncompleteCholesky:
+        b.cg_ic.reset(new Eigen::ConjugateGradient<SpMat, Eigen::Lower | Eigen::Upper, Eigen::IncompleteCholesky<double>>());
+        configureCG(*b.cg_ic, tolerance_, max_iterations_);
+        ok = computeTimed(*b.cg_ic, K, stats_);
+        break;
+    case SolverType::CGAMG:
+        b.cg_amg.reset(new Eigen::ConjugateGradient<SpMat, Eigen::Lower | Eigen::Upper, AmgPreconditioner>());
+        configureCG(*b.cg_amg, tolerance_, max_iterations_);
+        if (nullspace_.rows() == K.rows()) {
+            b.cg_amg->preconditioner().setNearNullspace(nullspace_);
+        } else if (mesh_ && mesh_->getNumNodes() * 3 == static_cast<size_t>(K.rows())) {
+            b.cg_amg->preconditioner().setNearNullspace(AmgPreconditioner::rigidBodyModes(*mesh_));
+        }
+        ok = computeTimed(*b.cg_amg, K, stats_);
+        break;
+    case SolverType::CGSchwarz: {
+        b.schwarz_operator.reset(new SymmetricSparseOperator(K, num_threads_));
+        b.cg_schwarz.reset(
+            new Eigen::ConjugateGradient<SymmetricSparseOperator, Eigen::Lower | Eigen::Upper, SchwarzPreconditioner>());
+        configureCG(*b.cg_schwarz, tolerance_, max_iterations_);
+        SchwarzPreconditioner& schwarz = b.cg_schwarz->preconditioner();
+        schwarz.setSubdomains(row_subdomain_);
+        schwarz.setNumSubdomains(num_subdomains_);
+        schwarz.setNumThreads(num_threads_);
+        if (nullspace_.rows() == K.rows()) {
+            schwarz.setNearNullspace(nullspace_);
+        } else if (mesh_ && mesh_->getNumNodes() * 3 == static_cast<size_t>(K.rows())) {
+            schwarz.setNearNullspace(AmgPreconditioner::rigidBodyModes(*mesh_));
+        }
+        ok = computeTimed(*b.cg_schwarz, *b.schwarz_operator, stats_);
+        break;
+    }
+    }
+
+    if (!ok) {
+        std::cerr << "Error: " << solverTypeName(type_) << " factorization/preconditioner setup failed." << std::endl;
+        return false;
+    }
+    if (b.ldlt) {
+        FEM_PROFILE_COUNTER("solver.factor_nonzeros", b.ldlt->matrixL().nestedExpression().nonZeros());
+    } else if (b.llt) {
+        FEM_PROFILE_COUNTER("solver.factor_nonzeros", b.llt->matrixL().nestedExpression().nonZeros());
+    }
+    K_ = &K;
+    return true;
+}
+
+bool LinearSolver::solve(const Eigen::VectorXd& F, Eigen::VectorXd& U) {
+    if (!K_) {
+        std::cerr << "Error: LinearSolver::solve called before compute." << std::endl;
+        return false;
+    }
+    Backends& b = *backends_;
+    if (b.single) {
+        // The refinement loop works on blocks
+        Eigen::MatrixXd U_block;
+        bool ok = solve(Eigen::MatrixXd(F), U_block);
+        U = U_block.col(0);
+        return ok;
+    }
+    Eigen::ComputationInfo info = Eigen::InvalidInput;
+    FEM_PROFILE_SCOPE("solver.solve");
+
+    auto t0 = std::chrono::steady_clock::now();
+    switch (type_) {
+    case SolverType::SparseLU:
+        U = b.lu->solve(F);
+        info = b.lu->info();
+        break;
+    case SolverType::LDLT:
+        U = b.ldlt->solve(F);
+        info = b.ldlt->info();
+        break;
+    case SolverType::LLT:
+        U = b.llt->solve(F);
+        info = b.llt->info();
+        break;
+    case SolverType::CGJacobi:
+        U = b.cg_jacobi->solve(F);
+        info = b.cg_jacobi->info();
+        stats_.iterations = static_cast<int>(b.cg_jacobi->iterations());
+        break;
+    case SolverType::CGIncompleteCholesky:
+        U = b.cg_ic->solve(F);
+        info = b.cg_ic->info();
+        stats_.iterations = static_cast<int>(b.cg_ic->iterations());
+        break;
+    case SolverType::CGAMG:
+        U = b.cg_amg->solve(F);
+        info = b.cg_amg->info();
+        stats_.iterations = static_cast<int>(b.cg_amg->iterations());
+        break;
+    case SolverType::CGSchwarz:
+        U = b.cg_schwarz->solve(F);
+        info = b.cg_schwarz->info();
+        stats_.iterations = static_cast<int>(b.cg_schwarz->iterations());
+        break;
+    }
+    stats_.solve_seconds = secondsSince(t0);
+    stats_.right_hand_sides = 1;
+    FEM_PROFILE_ADD("solver.iterations", stats_.iterations);
+    FEM_PROFILE_ADD("solver.right_hand_sides", 1);
+
+    double f_norm = F.norm();
+    stats_.residual = (*K_ * U - F).norm() / (f_norm > 0.0 ? f_norm : 1.0);
+
+    if (info != Eigen::Success) {
+        std::cerr << "Error: " << solverTypeName(type_) << " solve failed (relative residual " << stats_.residual
+                  << ")." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool LinearSolver::refactorize(const Eigen::SparseMatrix<double>& K) {
+    Backends& b = *backends_;
+    if (analyzed_rows_ < 0) {
+        std::cerr << "Error: LinearSolver::refactorize called before compute." << std::endl;
+        return false;
+    }
+    if (K.rows() != analyzed_rows_ || sparsityPatternHash(K) != analyzed_pattern_) {
+        std::cerr << "Error: LinearSolver::refactorize needs the sparsity pattern of the last compute." << std::endl;
+        return false;
+    }
+    K_ = nullptr;
+    double analyze_seconds = stats_.analyze_seconds;
+    stats_ = SolverStats();
+    stats_.analyze_seconds = analyze_seconds;
+    if (b.single) {
+        if (!computeSingle(K, true)) {
+            return false;
+        }
+        K_ = &K;
+        return true;
+    }
+
+    bool ok = false;
+    switch (type_) {
+    case SolverType::SparseLU:
+        ok = factorizeTimed(*b.lu, K, stats_);
+        break;
+    case SolverType::LDLT:
+        ok = factorizeTimed(*b.ldlt, K, stats_);
+        break;
+    case SolverType::LLT:
+        ok = factorizeTimed(*b.llt, K, stats_);
+        break;
+    case SolverType::CGJacobi:
+        ok = factorizeTimed(*b.cg_jacobi, K, stats_);
+        break;
+    case SolverType::CGIncompleteCholesky:
+        ok = factorizeTimed(*b.cg_ic, K, stats_);
+        break;
+    case SolverType::CGAMG:
+        ok = factorizeTimed(*b.cg_amg, K, stats_);
+        break;
+    case SolverType::CGSchwarz:
+        b.schwarz_operator.reset(new SymmetricSparseOperator(K, num_threads_));
+        ok = factorizeTimed(*b.cg_schwarz, *b.schwarz_operator, stats_);
+        break;
+    }
+    if (!ok) {
+        std::cerr << "Error: " << solverTypeName(type_) << " refactorization failed." << std::endl;
+        return false;
+    }
+    K_ = &K;
+    return true;
+}
+
+bool LinearSolver::updateValues(const Eigen::SparseMatrix<double>& K) {
+    Backends& b = *backends_;
+    bool keep = false;
+    if (b.single) {
+        keep = !b.cg_ic_single;
+    } else {
+        keep = type_ == SolverType::CGJacobi || type_ == SolverType::CGAMG || type_ == SolverType::CGSchwarz;
+    }
+    if (!keep || analyzed_rows_ < 0 || K.rows() != analyzed_rows_ || sparsityPatternHash(K) != analyzed_pattern_) {
+        return refactorize(K); // Also reports a missing compute or a changed pattern
+    }
+
+    // analyzePattern only rebinds CG to the new matrix; these preconditioners
+    // do no work there, so the numeric setup of the old values is kept
+    FEM_PROFILE_SCOPE("solver.update");
+    stats_.factorize_seconds = 0.0;
+    if (b.cg_jacobi_single) {
+        b.K_single = K.cast<float>();
+        b.cg_jacobi_single->analyzePattern(b.K_single);
+    } else if (b.cg_jacobi) {
+        b.cg_jacobi->analyzePattern(K);
+    } else if (b.cg_amg) {
+        b.cg_amg->analyzePattern(K);
+    } else if (b.cg_schwarz) {
+        b.schwarz_operator.reset(new SymmetricSparseOperator(K, num_threads_));
+        b.cg_schwarz->analyzePattern(*b.schwarz_operator);
+    }
+    K_ = &K;
+    return true;
+}
+
+bool LinearSolver::solve(const Eigen::MatrixXd& F, Eigen::MatrixXd& U) {
+    return solveBlock(F, nullptr, U);
+}
+
+bool LinearSolver::solveWithGuess(const Eigen::MatrixXd& F, const Eigen::MatrixXd& U0, Eigen::MatrixXd& U) {
+    if (U0.rows() != F.rows() || U0.cols() != F.cols()) {
+        std::cerr << "Error: LinearSolver::solveWithGuess: the guess is " << U0.rows() << " x " << U0.cols()
+                  << ", the loads " << F.rows() << " x " << F.cols() << std::endl;
+        return false;
+    }
+    return solveBlock(F, &U0, U);
+}
+
+bool LinearSolver::solveBlock(const Eigen::MatrixXd& F, const Eigen::MatrixXd* guess, Eigen::MatrixXd& U) {
+    if (!K_) {
+        std::cerr << "Error: LinearSolver::solve called before compute." << std::endl;
+        return false;
+    }
+    Backends& b = *backends_;
+    Eigen::ComputationInfo info = Eigen::Success;
+    stats_.iterations = 0;
+    stats_.refinements = 0;
+    FEM_PROFILE_SCOPE("solver.solve");
+
+    auto t0 = std::chrono::steady_clock::now();
+    if (b.single) {
+        info = solveRefined(F, guess, U);
+    } else {
+        switch (type_) {
+        case SolverType::SparseLU:
+            U = b.lu->solve(F); // Supernodal, already works on the whole block
+            info = b.lu->info();
+            break;
+        case SolverType::LDLT: {
+            Eigen::VectorXd d = b.ldlt->vectorD();
+            substituteBlock(*b.ldlt, &d, F, U);
+            break;
+        }
+        case SolverType::LLT:
+            substituteBlock(*b.llt, static_cast<const Eigen::VectorXd*>(nullptr), F, U);
+            break;
+        case SolverType::CGJacobi:
+            info = solveColumns(*b.cg_jacobi, F, U, stats_.iterations, guess);
+            break;
+        case SolverType::CGIncompleteCholesky:
+            info = solveColumns(*b.cg_ic, F, U, stats_.iterations, guess);
+            break;
+        case SolverType::CGAMG:
+            info = solveColumns(*b.cg_amg, F, U, stats_.iterations, guess);
+            break;
+        case SolverType::CGSchwarz:
+            info = solveColumns(*b.cg_schwarz, F, U, stats_.iterations, guess);
+            break;
+        }
+    }
+    stats_.solve_seconds = secondsSince(t0);
+    stats_.right_hand_sides = static_cast<int>(F.cols());
+    FEM_PROFILE_ADD("solver.iterations", stats_.iterations);
+    FEM_PROFILE_ADD("solver.right_hand_sides", F.cols());
+
+    stats_.residual = worstRelativeResidual(*K_ * U - F, F);
+
+    if (info != Eigen::Success) {
+        std::cerr << "Error: " << solverTypeName(type_) << " block solve failed (worst relative residual "
+                  << stats_.residual << ")." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool LinearSolver::computeSingle(const Eigen::SparseMatrix<double>& K, bool reuse_analysis) {
+    Backends& b = *backends_;
+    b.single = true;
+    b.K_single = K.cast<float>();
+
+    bool ok = false;
+    switch (type_) {
+    case SolverType::SparseLU:
+        if (!reuse_analysis) {
+            b.lu_single.reset(new Eigen::SparseLU<SpMatF>());
+            ok = computeTimed(*b.lu_single, b.K_single, stats_);
+        } else {
+            ok = factorizeTimed(*b.lu_single, b.K_single, stats_);
+        }
+        break;
+    case SolverType::LDLT:
+        if (!reuse_analysis) {
+            b.ldlt_single.reset(new Eigen::SimplicialLDLT<SpMatF>());
+            ok = computeTimed(*b.ldlt_single, b.K_single, stats_);
+        } else {
+            ok = factorizeTimed(*b.ldlt_single, b.K_single, stats_);
+        }
+        break;
+    case SolverType::LLT:
+        if (!reuse_analysis) {
+            b.llt_single.reset(new Eigen::SimplicialLLT<SpMatF>());
+            ok = computeTimed(*b.llt_single, b.K_single, stats_);
+        } else {
+            ok = factorizeTimed(*b.llt_single, b.K_single, stats_);
+        }
+        break;
+    case SolverType::CGJacobi:
+        if (!reuse_analysis) {
+            b.cg_jacobi_single.reset(
+                new Eigen::ConjugateGradient<SpMatF, Eigen::Lower | Eigen::Upper, Eigen::DiagonalPreconditioner<float>>());
+            configureCG(*b.cg_jacobi_single, kSingleTolerance, max_iterations_);
+            ok = computeTimed(*b.cg_jacobi_single, b.K_single, stats_);
+        } else {
+            ok = factorizeTimed(*b.cg_jacobi_single, b.K_single, stats_);
+        }
+        break;
+    case SolverType::CGIncompleteCholesky:
+        if (!reuse_analysis) {
+            b.cg_ic_single.reset(
+                new Eigen::ConjugateGradient<SpMatF, Eigen::Lower | Eigen::Upper, Eigen::IncompleteCholesky<float>>());
+            configureCG(*b.cg_ic_single, kSingleTolerance, max_iterations_);
+            ok = computeTimed(*b.cg_ic_single, b.K_single, stats_);
+        } else {
+            ok = factorizeTimed(*b.cg_ic_single, b.K_single, stats_);
+        }
+        break;
+    case SolverType::CGAMG:
+    case SolverType::CGSchwarz:
+        std::cerr << "Error: " << solverTypeName(type_) << " has no mixed-precision mode." << std::endl;
+        return false;
+    }
+    if (!ok) {
+        std::cerr << "Error: " << solverTypeName(type_) << " single-precision factorization/preconditioner setup failed."
+                  << std::endl;
+        return false;
+    }
+    if (b.ldlt_single) {
+        FEM_PROFILE_COUNTER("solver.factor_nonzeros", b.ldlt_single->matrixL().nestedExpression().nonZeros());
+    } else if (b.llt_single) {
+        FEM_PROFILE_COUNTER("solver.factor_nonzeros", b.llt_single->matrixL().nestedExpression().nonZeros());
+    }
+    return true;
+}
+
+// Classic iterative refinement: U += K_single^-1 (F - K U) until the residual
+// against the double-precision K meets the tolerance, or stops halving
+Eigen::ComputationInfo LinearSolver::solveRefined(const Eigen::MatrixXd& F, const Eigen::MatrixXd* guess,
+                                                  Eigen::MatrixXd& U) {
+    Backends& b = *backends_;
+    Eigen::MatrixXd R;
+    if (guess) {
+        U = *guess;
+        R = F - *K_ * U;
+    } else {
+        U = Eigen::MatrixXd::Zero(F.rows(), F.cols());
+        R = F;
+    }
+    Eigen::MatrixXf R_single, dU;
+    double previous = std::numeric_limits<double>::infinity();
+    while (true) {
+        double residual = worstRelativeResidual(R, F);
+        if (residual <= tolerance_) {
+            return Eigen::Success;
+        }
+        if (residual > 0.5 * previous || stats_.refinements >= max_refinements_) {
+            return Eigen::NoConvergence;
+        }
+        previous = residual;
+
+        // The inner CG solves only need to shrink the residual, so a
+        // correction that stops short of kSingleTolerance is still used
+        R_single = R.cast<float>();
+        int iterations = 0;
+        switch (type_) {
+        case SolverType::SparseLU:
+            dU = b.lu_single->solve(R_single);
+            break;
+        case SolverType::LDLT: {
+            Eigen::VectorXf d = b.ldlt_single->vectorD();
+            substituteBlock(*b.ldlt_single, &d, R_single, dU);
+            break;
+        }
+        case SolverType::LLT:
+            substituteBlock(*b.llt_single, static_cast<const Eigen::VectorXf*>(nullptr), R_single, dU);
+            break;
+        case SolverType::CGJacobi:
+            solveColumns(*b.cg_jacobi_single, R_single, dU, iterations);
+            break;
+        case SolverType::CGIncompleteCholesky:
+            solveColumns(*b.cg_ic_single, R_single, dU, iterations);
+            break;
+        case SolverType::CGAMG:
+        case SolverType::CGSchwarz:
+            return Eigen::InvalidInput;
+        }
+        stats_.iterations += iterations;
+        ++stats_.refinements;
+        FEM_PROFILE_ADD("solver.refinements", 1);
+
+        U += dU.cast<double>();
+        R = F - *K_ * U;
+    }
+}
+
+const SolverStats& LinearSolver::getStats() const {
+    return stats_;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "Mesh.h"
+#include <Eigen/Sparse>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+enum class SolverType {
+    SparseLU,             // General sparse LU (the original fem_app path)
+    LDLT,                 // Simplicial LDL^T, for symmetric K
+    LLT,                  // Simplicial Cholesky, for SPD K
+    CGJacobi,             // Conjugate gradient + diagonal preconditioner
+    CGIncompleteCholesky, // Conjugate gradient + IC(0) with AMD ordering
+    CGAMG,                // Conjugate gradient + smoothed-aggregation AMG
+    CGSchwarz             // Conjugate gradient + two-level additive Schwarz over subdomains
+};
+
+// Maps between solver types and their command-line names
+// ("lu", "ldlt", "llt", "cg-jacobi", "cg-ic", "cg-amg", "cg-schwarz").
+bool parseSolverType(const std::string& name, SolverType& type);
+const char* solverTypeName(SolverType type);
+
+enum class SolverPrecision {
+    Double, // Factor or preconditioner in double precision
+    Mixed   // Single-precision factor or preconditioner plus iterative refinement
+};
+
+// "double", "mixed"
+bool parseSolverPrecision(const std::string& name, SolverPrecision& precision);
+const char* solverPrecisionName(SolverPrecision precision);
+
+// 64-bit FNV-1a hash of the shape, every column's length and its row indices
+// (compressed or not). Equal hashes mean the same sparsity pattern in all
+// but pathological cases; it costs one pass over the indices.
+uint64_t sparsityPatternHash(const Eigen::SparseMatrix<double>& K);
+
+struct SolverStats {
+    int iterations = 0;             // Krylov iterations; 0 for direct solvers
+    double residual = 0.0;          // ||K*U - F|| / ||F|| of the last solve
+    double analyze_seconds = 0.0;   // Symbolic analysis / ordering
+    double factorize_seconds = 0.0; // Numeric factorization or preconditioner setup
+    double solve_seconds = 0.0;     // Last solve
+    int right_hand_sides = 0;       // Columns in the last solve
+    int refinements = 0;            // Iterative-refinement steps, mixed precision only
+};
+
+// Front end over Eigen's direct and preconditioned iterative solvers.
+// K must stay alive and unchanged between compute() and solve().
+//
+// In mixed precision the solver factorizes (or, for CG, solves with) a
+// single-precision copy of K, halving the memory traffic of the factor, and
+// recovers double-precision accuracy by iterative refinement: the residual
+// F - K U is formed with the double-precision K, the correction is solved in
+// single precision, and this repeats until the relative residual reaches the
+// tolerance. It converges as long as K is not too ill-conditioned for a
+// single-precision factor (condition number well below 1e7); a solve that
+// stops improving fails like a CG solve that does not converge. cg-amg and
+// cg-schwarz have no single-precision preconditioner.
+class LinearSolver {
+public:
+    explicit LinearSolver(SolverType type = SolverType::SparseLU);
+    ~LinearSolver();
+
+    SolverType getType() const;
+    // Relative residual for CG and for mixed-precision refinement (default 1e-10)
+    void setTolerance(double tolerance);
+    void setMaxIterations(int max_iterations);
+    // Takes effect at the next compute()
+    void setPrecision(SolverPrecision precision);
+    SolverPrecision getPrecision() const;
+    void setMaxRefinements(int max_refinements); // Default 20
+
+    // Supplies nodal coordinates so the AMG and Schwarz options can build rigid-body modes
+    void setMesh(const Mesh& mesh);
+    // Explicit AMG near-nullspace (and Schwarz coarse space), e.g. rigid-body
+    // modes restricted to the free DOFs of a reduced system; takes precedence
+    // over setMesh
+    void setNearNullspace(const Eigen::MatrixXd& modes);
+
+    // cg-schwarz: the subdomain of every row (see partitionFreeDofs), or
+    // just their number for contiguous row blocks (0 = one per thread), and
+    // the threads for the local factorizations and solves and for the CG
+    // matrix product (0 = all)
+    void setSubdomains(const std::vector<int>& row_subdomain);
+    void setNumSubdomains(int num_subdomains);
+    void setNumThreads(unsigned num_threads);
+
+    bool compute(const Eigen::SparseMatrix<double>& K);
+    // New values on the sparsity pattern of the last compute(): reuses the
+    // symbolic analysis (ordering, elimination tree) and only refactorizes
+    // or rebuilds the preconditioner
+    bool refactorize(const Eigen::SparseMatrix<double>& K);
+    // Like refactorize, but keeps the current preconditioner when that is
+    // cheaper than rebuilding it and the values changed only a little: CG
+    // with Jacobi, AMG or Schwarz preconditioning runs against the new K with
+    // the old preconditioner, and in mixed precision the old single-precision
+    // factor drives the refinement against the new K. cg-ic and the
+    // double-precision direct solvers refactorize.
+    bool updateValues(const Eigen::SparseMatrix<double>& K);
+
+    bool solve(const Eigen::VectorXd& F, Eigen::VectorXd& U);
+    // One column per load case. The direct solvers sweep the factor once for
+    // the whole block; CG solves the columns in turn with the shared
+    // preconditioner. iterations and residual report the worst column.
+    bool solve(const Eigen::MatrixXd& F, Eigen::MatrixXd& U);
+    // Starts CG and mixed-precision refinement from U0, e.g. the solution
+    // before a small change of K; the direct solvers ignore it
+    bool solveWithGuess(const Eigen::MatrixXd& F, const Eigen::MatrixXd& U0, Eigen::MatrixXd& U);
+
+    const SolverStats& getStats() const;
+
+private:
+    struct Backends;
+
+    bool computeSingle(const Eigen::SparseMatrix<double>& K, bool reuse_analysis);
+    bool solveBlock(const Eigen::MatrixXd& F, const Eigen::MatrixXd* guess, Eigen::MatrixXd& U);
+    Eigen::ComputationInfo solveRefined(const Eigen::MatrixXd& F, const Eigen::MatrixXd* guess, Eigen::MatrixXd& U);
+
+    SolverType type_;
+    SolverPrecision precision_;
+    int max_refinements_;
+    double tolerance_;
+    int max_iterations_;
+    const Mesh* mesh_;
+    Eigen::MatrixXd nullspace_;
+    std::vector<int> row_subdomain_;
+    int num_subdomains_;
+    unsigned num_threads_;
+    const Eigen::SparseMatrix<double>* K_;
+    Eigen::Index analyzed_rows_; // Pattern of the last compute(), -1 before
+    uint64_t analyzed_pattern_;  // sparsityPatternHash of it
+    std::unique_ptr<Backends> backends_;
+    SolverStats stats_;
+};
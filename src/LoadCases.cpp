@@ -0,0 +1,76 @@
+#include "LoadCases.h"
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+bool loadLoadCases(const std::string& filename, std::vector<LoadCase>& cases) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open load case file " << filename << std::endl;
+        return false;
+    }
+    cases.clear();
+    std::set<std::string> names;
+    std::string line;
+    size_t line_number = 0;
+    auto fail = [&](const std::string& why) {
+        std::cerr << "Error: " << filename << ":" << line_number << ": " << why << std::endl;
+        cases.clear();
+        return false;
+    };
+
+    while (std::getline(file, line)) {
+        ++line_number;
+        std::istringstream ss(line);
+        std::string first;
+        if (!(ss >> first) || first[0] == '#') {
+            continue;
+        }
+        if (first == "LOADCASE") {
+            LoadCase load_case;
+            std::string extra;
+            if (!(ss >> load_case.name) || (ss >> extra)) {
+                return fail("expected 'LOADCASE <name>'");
+            }
+            if (!names.insert(load_case.name).second) {
+                return fail("duplicate load case '" + load_case.name + "'");
+            }
+            cases.push_back(load_case);
+            continue;
+        }
+        if (cases.empty()) {
+            return fail("load before the first LOADCASE line");
+        }
+        NodalLoad load;
+        std::istringstream values(line);
+        std::string extra;
+        if (!(values >> load.node_id >> load.fx >> load.fy >> load.fz) || (values >> extra)) {
+            return fail("expected '<node_id> <fx> <fy> <fz>'");
+        }
+        cases.back().loads.push_back(load);
+    }
+    if (cases.empty()) {
+        std::cerr << "Error: No load cases in " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+Eigen::MatrixXd buildLoadMatrix(const Mesh& mesh, const std::vector<LoadCase>& cases) {
+    Eigen::MatrixXd F = Eigen::MatrixXd::Zero(mesh.getNumNodes() * 3, cases.size());
+    for (size_t c = 0; c < cases.size(); ++c) {
+        for (const NodalLoad& load : cases[c].loads) {
+            int index = mesh.getNodeIndex(load.node_id);
+            if (index < 0) {
+                throw std::out_of_range("Load case '" + cases[c].name + "': unknown node ID " +
+                                        std::to_string(load.node_id));
+            }
+            F(3 * index + 0, c) += load.fx;
+            F(3 * index + 1, c) += load.fy;
+            F(3 * index + 2, c) += load.fz;
+        }
+    }
+    return F;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Mesh.h"
+#include <Eigen/Dense>
+#include <string>
+#include <vector>
+
+struct NodalLoad {
+    int node_id;
+    double fx, fy, fz;
+};
+
+// A named set of nodal forces, solved as one right-hand side
+struct LoadCase {
+    std::string name;
+    std::vector<NodalLoad> loads;
+};
+
+// Reads load cases from a text file:
+//
+//     # Comment
+//     LOADCASE <name>
+//     <node_id> <fx> <fy> <fz>
+//     ...
+//
+// Each case runs until the next LOADCASE line; names must be unique. On
+// malformed input it prints the offending line and returns false.
+bool loadLoadCases(const std::string& filename, std::vector<LoadCase>& cases);
+
+// One column per case, 3 rows per node in mesh storage order; loads on the
+// same node add up. Throws std::out_of_range for an unknown node ID.
+Eigen::MatrixXd buildLoadMatrix(const Mesh& mesh, const std::vector<LoadCase>& cases);
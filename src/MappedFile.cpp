@@ -0,0 +1,69 @@
+#include "MappedFile.h"
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define FEM_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& filename) {
+    close();
+
+#ifdef FEM_HAVE_MMAP
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ > 0) {
+        void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            size_ = 0;
+            return false;
+        }
+        ::madvise(p, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(p);
+        mapped_ = true;
+    }
+    ::close(fd); // The mapping stays valid after the descriptor is closed
+#else
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+    size_ = static_cast<size_t>(file.tellg());
+    buffer_.resize(size_);
+    file.seekg(0);
+    file.read(buffer_.data(), static_cast<std::streamsize>(size_));
+    data_ = buffer_.data();
+#endif
+
+    is_open_ = true;
+    return true;
+}
+
+void MappedFile::close() {
+#ifdef FEM_HAVE_MMAP
+    if (mapped_) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+    buffer_.clear();
+    data_ = nullptr;
+    size_ = 0;
+    is_open_ = false;
+    mapped_ = false;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read-only view of a whole file. On POSIX systems the file is memory-mapped;
+// elsewhere it is read into an owned buffer. The mapping is released when the
+// object is destroyed.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& filename);
+    void close();
+
+    bool isOpen() const { return is_open_; }
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool is_open_ = false;
+    bool mapped_ = false;
+    std::vector<char> buffer_; // Fallback storage when mmap is unavailable
+};
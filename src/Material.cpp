@@ -1,7 +1,67 @@
 #include "Material.h"
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+void checkPositiveDefinite(const Eigen::Matrix<double, 6, 6>& D, const char* who) {
+    if (!D.allFinite() || !D.isApprox(D.transpose())) {
+        throw std::invalid_argument(std::string(who) + ": D must be finite and symmetric.");
+    }
+    if (D.llt().info() != Eigen::Success) {
+        throw std::invalid_argument(std::string(who) + ": D must be positive definite.");
+    }
+}
+
+} // namespace
 
 Material::Material(double youngsModulus, double poissonsRatio)
-    : E_(youngsModulus), nu_(poissonsRatio) {}
+    : kind_(Kind::Isotropic), E_(youngsModulus), nu_(poissonsRatio), density_(0.0) {
+    D_.setZero();
+
+    // Prefactor for 3D isotropic material
+    double prefactor = E_ / ((1.0 + nu_) * (1.0 - 2.0 * nu_));
+
+    D_(0, 0) = D_(1, 1) = D_(2, 2) = prefactor * (1.0 - nu_);
+    D_(0, 1) = D_(1, 0) = prefactor * nu_;
+    D_(0, 2) = D_(2, 0) = prefactor * nu_;
+    D_(1, 2) = D_(2, 1) = prefactor * nu_;
+    D_(3, 3) = D_(4, 4) = D_(5, 5) = prefactor * (1.0 - 2.0 * nu_) / 2.0;
+}
+
+Material::Material(Kind kind, const Eigen::Matrix<double, 6, 6>& D) : kind_(kind), D_(D), density_(0.0) {
+    // Uniaxial stress along x in the compliance S = D^-1: E = 1/S00, nu = -S01/S00
+    Eigen::Matrix<double, 6, 6> S = D.inverse();
+    E_ = 1.0 / S(0, 0);
+    nu_ = -S(0, 1) / S(0, 0);
+}
+
+Material Material::orthotropic(const OrthotropicConstants& c) {
+    // Compliance in the principal axes, inverted to D
+    Eigen::Matrix<double, 6, 6> S = Eigen::Matrix<double, 6, 6>::Zero();
+    S(0, 0) = 1.0 / c.Ex;
+    S(1, 1) = 1.0 / c.Ey;
+    S(2, 2) = 1.0 / c.Ez;
+    S(0, 1) = S(1, 0) = -c.nu_xy / c.Ex;
+    S(1, 2) = S(2, 1) = -c.nu_yz / c.Ey;
+    S(0, 2) = S(2, 0) = -c.nu_xz / c.Ex;
+    S(3, 3) = 1.0 / c.Gxy;
+    S(4, 4) = 1.0 / c.Gyz;
+    S(5, 5) = 1.0 / c.Gxz;
+    checkPositiveDefinite(S, "Material::orthotropic");
+    Eigen::Matrix<double, 6, 6> D = S.inverse();
+    D = 0.5 * (D + D.transpose()).eval();
+    return Material(Kind::Orthotropic, D);
+}
+
+Material Material::anisotropic(const Eigen::Matrix<double, 6, 6>& D) {
+    checkPositiveDefinite(D, "Material::anisotropic");
+    return Material(Kind::Anisotropic, D);
+}
+
+Material::Kind Material::getKind() const {
+    return kind_;
+}
 
 double Material::getE() const {
     return E_;
@@ -11,17 +71,17 @@ double Material::getNu() const {
     return nu_;
 }
 
-Eigen::Matrix<double, 6, 6> Material::getDMatrix() const {
-    Eigen::Matrix<double, 6, 6> D = Eigen::Matrix<double, 6, 6>::Zero();
-
-    // Prefactor for 3D isotropic material
-    double prefactor = E_ / ((1.0 + nu_) * (1.0 - 2.0 * nu_));
+const Eigen::Matrix<double, 6, 6>& Material::getDMatrix() const {
+    return D_;
+}
 
-    D(0, 0) = D(1, 1) = D(2, 2) = prefactor * (1.0 - nu_);
-    D(0, 1) = D(1, 0) = prefactor * nu_;
-    D(0, 2) = D(2, 0) = prefactor * nu_;
-    D(1, 2) = D(2, 1) = prefactor * nu_;
-    D(3, 3) = D(4, 4) = D(5, 5) = prefactor * (1.0 - 2.0 * nu_) / 2.0;
+void Material::setDensity(double density) {
+    if (!std::isfinite(density) || density < 0.0) {
+        throw std::invalid_argument("Material::setDensity: density must be finite and non-negative.");
+    }
+    density_ = density;
+}
 
-    return D;
-}
\ No newline at end of file
+double Material::getDensity() const {
+    return density_;
+}
@@ -1,19 +1,55 @@
 #pragma once
 #include <Eigen/Dense> // Include Eigen
 
+// Engineering constants of an orthotropic material in its principal axes,
+// which are taken to be the global x, y and z axes. nu_ij is the contraction
+// along j under a stress along i, so nu_ij / E_i = nu_ji / E_j.
+struct OrthotropicConstants {
+    double Ex, Ey, Ez;
+    double nu_xy, nu_yz, nu_xz;
+    double Gxy, Gyz, Gxz;
+};
+
+// Linear elastic material. The 6x6 constitutive matrix D is built once on
+// construction, in Voigt order (xx, yy, zz, xy, yz, xz) with engineering
+// shear strains.
 class Material {
 public:
+    enum class Kind {
+        Isotropic,
+        Orthotropic,
+        Anisotropic
+    };
+
     // Constructor to initialize properties
     Material(double youngsModulus, double poissonsRatio);
 
-    // Public getters
+    // Both throw std::invalid_argument unless the resulting D is symmetric
+    // positive definite
+    static Material orthotropic(const OrthotropicConstants& constants);
+    static Material anisotropic(const Eigen::Matrix<double, 6, 6>& D);
+
+    Kind getKind() const;
+
+    // Public getters. For orthotropic and anisotropic materials these are the
+    // modulus along x and the contraction ratio nu_xy implied by D.
     double getE() const;  // Young's Modulus
     double getNu() const; // Poisson's Ratio
 
     // --- NEW METHOD ---
-    Eigen::Matrix<double, 6, 6> getDMatrix() const;
+    const Eigen::Matrix<double, 6, 6>& getDMatrix() const;
+
+    // Mass per unit volume for the mass matrix, 0 unless set. Throws
+    // std::invalid_argument for a negative or non-finite density.
+    void setDensity(double density);
+    double getDensity() const;
 
 private:
+    Material(Kind kind, const Eigen::Matrix<double, 6, 6>& D);
+
+    Kind kind_;
     double E_;  // Young's Modulus
     double nu_; // Poisson's Ratio
-};
\ No newline at end of file
+    Eigen::Matrix<double, 6, 6> D_;
+    double density_;
+};
@@ -0,0 +1,165 @@
+#include "MaterialTable.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+// D from its upper triangle listed row by row
+Eigen::Matrix<double, 6, 6> symmetricFromUpper(const std::vector<double>& values) {
+    Eigen::Matrix<double, 6, 6> D;
+    size_t k = 0;
+    for (int i = 0; i < 6; ++i) {
+        for (int j = i; j < 6; ++j) {
+            D(i, j) = D(j, i) = values[k++];
+        }
+    }
+    return D;
+}
+
+} // namespace
+
+MaterialTable::MaterialTable() : default_slot_(-1) {}
+
+MaterialTable::MaterialTable(const Material& material) : default_slot_(-1) {
+    setDefault(material);
+}
+
+void MaterialTable::set(int material_id, const Material& material) {
+    auto it = slots_.find(material_id);
+    if (it != slots_.end()) {
+        materials_[it->second] = material;
+        return;
+    }
+    slots_.emplace(material_id, static_cast<int>(materials_.size()));
+    materials_.push_back(material);
+}
+
+void MaterialTable::setDefault(const Material& material) {
+    if (default_slot_ >= 0) {
+        materials_[default_slot_] = material;
+        return;
+    }
+    default_slot_ = static_cast<int>(materials_.size());
+    materials_.push_back(material);
+}
+
+bool MaterialTable::contains(int material_id) const {
+    return default_slot_ >= 0 || slots_.count(material_id) != 0;
+}
+
+size_t MaterialTable::size() const {
+    return materials_.size();
+}
+
+int MaterialTable::slotOf(int material_id) const {
+    auto it = slots_.find(material_id);
+    if (it != slots_.end()) {
+        return it->second;
+    }
+    if (default_slot_ < 0) {
+        throw std::out_of_range("MaterialTable: no material with ID " + std::to_string(material_id));
+    }
+    return default_slot_;
+}
+
+const Material& MaterialTable::operator[](int material_id) const {
+    return materials_[slotOf(material_id)];
+}
+
+std::vector<int> MaterialTable::elementSlots(const Mesh& mesh) const {
+    const MeshArray<int>& ids = mesh.getElementMaterials();
+    std::vector<int> slots(ids.size());
+    int last_id = 0;
+    int last_slot = -1;
+    for (size_t e = 0; e < ids.size(); ++e) {
+        if (last_slot < 0 || ids[e] != last_id) {
+            if (!contains(ids[e])) {
+                throw std::out_of_range("MaterialTable: element " + std::to_string(mesh.getElementIds()[e]) +
+                                        " has material ID " + std::to_string(ids[e]) + ", which is not in the table");
+            }
+            last_id = ids[e];
+            last_slot = slotOf(last_id);
+        }
+        slots[e] = last_slot;
+    }
+    return slots;
+}
+
+bool loadMaterialTable(const std::string& filename, MaterialTable& table) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open material file " << filename << std::endl;
+        return false;
+    }
+    table = MaterialTable();
+    std::string line;
+    size_t line_number = 0;
+    auto fail = [&](const std::string& why) {
+        std::cerr << "Error: " << filename << ":" << line_number << ": " << why << std::endl;
+        table = MaterialTable();
+        return false;
+    };
+
+    while (std::getline(file, line)) {
+        ++line_number;
+        std::istringstream ss(line);
+        std::string id_text, kind;
+        if (!(ss >> id_text) || id_text[0] == '#') {
+            continue;
+        }
+        int id = 0;
+        bool is_default = id_text == "default";
+        if (!is_default) {
+            std::istringstream id_stream(id_text);
+            std::string extra;
+            if (!(id_stream >> id) || (id_stream >> extra)) {
+                return fail("expected an integer material ID or 'default', got '" + id_text + "'");
+            }
+        }
+        ss >> kind;
+        std::vector<double> values;
+        double value;
+        while (ss >> value) {
+            values.push_back(value);
+        }
+        if (!ss.eof()) {
+            return fail("malformed number in material " + id_text);
+        }
+
+        size_t expected = kind == "isotropic" ? 2 : kind == "orthotropic" ? 9 : kind == "anisotropic" ? 21 : 0;
+        if (expected == 0) {
+            return fail("unknown material kind '" + kind + "', expected isotropic, orthotropic or anisotropic");
+        }
+        if (values.size() != expected && values.size() != expected + 1) {
+            return fail(kind + " material " + id_text + " needs " + std::to_string(expected) +
+                        " values and an optional density, got " + std::to_string(values.size()));
+        }
+        if (kind == "isotropic" && !(values[0] > 0.0 && values[1] > -1.0 && values[1] < 0.5)) {
+            return fail("isotropic material " + id_text + " needs E > 0 and -1 < nu < 0.5");
+        }
+        try {
+            Material material = kind == "isotropic"     ? Material(values[0], values[1])
+                                : kind == "orthotropic" ? Material::orthotropic({values[0], values[1], values[2],
+                                                                                 values[3], values[4], values[5],
+                                                                                 values[6], values[7], values[8]})
+                                                        : Material::anisotropic(symmetricFromUpper(values));
+            if (values.size() > expected) {
+                material.setDensity(values[expected]);
+            }
+            if (is_default) {
+                table.setDefault(material);
+            } else {
+                table.set(id, material);
+            }
+        } catch (const std::invalid_argument& e) {
+            return fail(e.what());
+        }
+    }
+    if (table.size() == 0) {
+        std::cerr << "Error: No materials in " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Material.h"
+#include "Mesh.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Materials by the material IDs stored per element in Mesh. Each Material
+// holds its D matrix, so a table lookup costs no constitutive setup; the
+// kernels fetch D once per run of elements sharing a material (see
+// forEachElementRun in ElementKernel.h).
+//
+// A table built from a single Material applies it to every element whatever
+// its ID; the conversion is implicit so single-material calls such as
+// assembleGlobalStiffness(mesh, steel) keep working.
+class MaterialTable {
+public:
+    MaterialTable();
+    MaterialTable(const Material& material);
+
+    // Adds or replaces the material of one ID
+    void set(int material_id, const Material& material);
+    // Used for IDs that were never set; without one such IDs are an error
+    void setDefault(const Material& material);
+
+    bool contains(int material_id) const; // Set explicitly or covered by the default
+    size_t size() const;                  // Distinct materials, the default included
+
+    // Dense slot of a material ID, valid for getMaterial/getDMatrix.
+    // Throws std::out_of_range for an ID the table does not cover.
+    int slotOf(int material_id) const;
+    const Material& getMaterial(int slot) const { return materials_[slot]; }
+    const Eigen::Matrix<double, 6, 6>& getDMatrix(int slot) const { return materials_[slot].getDMatrix(); }
+    // Shortcut for getMaterial(slotOf(material_id))
+    const Material& operator[](int material_id) const;
+
+    // Slot of every element. Throws std::out_of_range naming the first
+    // element whose material ID the table does not cover.
+    std::vector<int> elementSlots(const Mesh& mesh) const;
+
+private:
+    std::vector<Material> materials_;
+    std::unordered_map<int, int> slots_;
+    int default_slot_; // -1 without a default
+};
+
+// Reads materials from a text file, one per line:
+//
+//     # Comment
+//     <id> isotropic <E> <nu> [<density>]
+//     <id> orthotropic <Ex> <Ey> <Ez> <nu_xy> <nu_yz> <nu_xz> <Gxy> <Gyz> <Gxz> [<density>]
+//     <id> anisotropic <21 values: the upper triangle of D, row by row> [<density>]
+//
+// The id "default" sets the material for IDs not listed; the density is 0
+// when left out. On malformed input
+// or a material that is not positive definite it prints the offending line
+// and returns false.
+bool loadMaterialTable(const std::string& filename, MaterialTable& table);
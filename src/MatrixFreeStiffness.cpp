@@ -0,0 +1,188 @@
+#include "MatrixFreeStiffness.h"
+#include "ElementKernel.h"
+#include "Tet4Element.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// Gathers the coordinates of the Tet4 element with node indices nodes[0..3].
+Eigen::Matrix<double, 4, 3> gatherCoords(const Mesh& mesh, const int* nodes) {
+    Eigen::Matrix<double, 4, 3> coords;
+    for (int i = 0; i < 4; ++i) {
+        coords(i, 0) = mesh.getX()[nodes[i]];
+        coords(i, 1) = mesh.getY()[nodes[i]];
+        coords(i, 2) = mesh.getZ()[nodes[i]];
+    }
+    return coords;
+}
+
+} // namespace
+
+MatrixFreeStiffness::MatrixFreeStiffness(const Mesh& mesh, const MaterialTable& materials, unsigned num_threads)
+    : mesh_(mesh),
+      materials_(materials),
+      slots_(materials.elementSlots(mesh)),
+      num_threads_(num_threads),
+      total_dofs_(mesh.getNumNodes() * 3),
+      coloring_(colorElements(mesh)),
+      constrained_(total_dofs_, 0),
+      geometry_(nullptr) {
+    const MeshArray<ElementType>& types = mesh.getElementTypes();
+    auto other = std::find_if(types.begin(), types.end(), [](ElementType t) { return !hasElementKernel(t); });
+    if (other != types.end()) {
+        throw std::invalid_argument("MatrixFreeStiffness: element " +
+                                    std::to_string(mesh.getElementIds()[other - types.begin()]) +
+                                    " has no element kernel (" +
+                                    std::to_string(mesh.getElementNumNodes(other - types.begin())) + " nodes)");
+    }
+    groupColorsByKey(coloring_, slots_);
+}
+
+void MatrixFreeStiffness::setGeometry(const ElementGeometry* geometry) {
+    geometry_ = geometry;
+}
+
+const ElementGeometry* MatrixFreeStiffness::currentGeometry() const {
+    return geometry_ && geometry_->matches(mesh_) ? geometry_ : nullptr;
+}
+
+void MatrixFreeStiffness::setConstrainedDofs(const std::vector<int>& dofs) {
+    std::fill(constrained_.begin(), constrained_.end(), 0);
+    for (int dof : dofs) {
+        constrained_[dof] = 1;
+    }
+}
+
+void MatrixFreeStiffness::liftPrescribedValues(const Eigen::VectorXd& prescribed, Eigen::VectorXd& rhs) const {
+    if (prescribed.size() != rows() || rhs.size() != rows()) {
+        throw std::invalid_argument("MatrixFreeStiffness::liftPrescribedValues: vectors must have one entry per DOF");
+    }
+    addElementProducts(prescribed, rhs, -1.0, true);
+    for (size_t dof = 0; dof < total_dofs_; ++dof) {
+        if (constrained_[dof]) {
+            rhs(dof) = prescribed(dof);
+        }
+    }
+}
+
+void MatrixFreeStiffness::multiplyAdd(const Eigen::Ref<const Eigen::VectorXd>& x, Eigen::Ref<Eigen::VectorXd> y,
+                                      double alpha) const {
+    addElementProducts(x, y, alpha, false);
+
+    // Identity rows/columns for the constrained DOFs
+    for (size_t dof = 0; dof < total_dofs_; ++dof) {
+        if (constrained_[dof]) {
+            y(dof) += alpha * x(dof);
+        }
+    }
+}
+
+void MatrixFreeStiffness::addElementProducts(const Eigen::Ref<const Eigen::VectorXd>& x,
+                                             Eigen::Ref<Eigen::VectorXd> y, double alpha,
+                                             bool from_constrained) const {
+    // Elements of one color share no node, so their scatters never collide
+    const ElementGeometry* geometry = currentGeometry();
+    for (size_t c = 0; c < coloring_.numColors(); ++c) {
+        const size_t* color_begin = coloring_.elements.data() + coloring_.offsets[c];
+        size_t color_size = coloring_.offsets[c + 1] - coloring_.offsets[c];
+
+        parallelFor(color_size, num_threads_, [&](size_t begin, size_t end, unsigned) {
+            for (size_t k = begin; k < end; ++k) {
+                size_t e = color_begin[k];
+                const int* nodes = mesh_.getElementNodes(e);
+                const Eigen::Matrix<double, 6, 6>& D = materials_.getDMatrix(slots_[e]);
+                dispatchElementType(mesh_.getElementTypes()[e], [&](auto tag) {
+                    constexpr ElementType Type = decltype(tag)::value;
+                    constexpr int kDofs = ElementTraits<Type>::kDofs;
+                    int dofs[kDofs];
+                    ElementVector<Type> u_e;
+                    for (int i = 0; i < ElementTraits<Type>::kNodes; ++i) {
+                        for (int d = 0; d < 3; ++d) {
+                            int dof = nodes[i] * 3 + d;
+                            dofs[i * 3 + d] = dof;
+                            u_e(i * 3 + d) = (constrained_[dof] != 0) == from_constrained ? x(dof) : 0.0;
+                        }
+                    }
+
+                    // Tet4 from its constant B; the other types form ke on the fly
+                    ElementVector<Type> f_e;
+                    if constexpr (Type == ElementType::Tet4) {
+                        Eigen::Matrix<double, 6, 12> B;
+                        double volume;
+                        elementBAndVolume(geometry, e, nodes, B, volume);
+                        Eigen::Matrix<double, 6, 1> stress = D * (B * u_e);
+                        f_e = B.transpose() * stress * (alpha * volume);
+                    } else {
+                        ElementMatrix<Type> ke;
+                        computeElementStiffness<Type>(gatherElementCoords<Type>(mesh_, e), D, ke);
+                        f_e = alpha * (ke * u_e);
+                    }
+
+                    for (int i = 0; i < kDofs; ++i) {
+                        if (!constrained_[dofs[i]]) {
+                            y(dofs[i]) += f_e(i);
+                        }
+                    }
+                });
+            }
+        });
+    }
+}
+
+Eigen::VectorXd MatrixFreeStiffness::diagonal() const {
+    Eigen::VectorXd diag = Eigen::VectorXd::Zero(total_dofs_);
+    const ElementGeometry* geometry = currentGeometry();
+
+    for (size_t e = 0; e < mesh_.getNumElements(); ++e) {
+        const int* nodes = mesh_.getElementNodes(e);
+        const Eigen::Matrix<double, 6, 6>& D = materials_.getDMatrix(slots_[e]);
+        dispatchElementType(mesh_.getElementTypes()[e], [&](auto tag) {
+            constexpr ElementType Type = decltype(tag)::value;
+            ElementVector<Type> diag_e;
+            if constexpr (Type == ElementType::Tet4) {
+                Eigen::Matrix<double, 6, 12> B;
+                double volume;
+                elementBAndVolume(geometry, e, nodes, B, volume);
+                Eigen::Matrix<double, 6, 12> DB = D * B;
+                for (int local = 0; local < 12; ++local) {
+                    diag_e(local) = B.col(local).dot(DB.col(local)) * volume;
+                }
+            } else {
+                ElementMatrix<Type> ke;
+                computeElementStiffness<Type>(gatherElementCoords<Type>(mesh_, e), D, ke);
+                diag_e = ke.diagonal();
+            }
+            for (int i = 0; i < ElementTraits<Type>::kNodes; ++i) {
+                diag.segment<3>(nodes[i] * 3) += diag_e.template segment<3>(i * 3);
+            }
+        });
+    }
+
+    for (size_t dof = 0; dof < total_dofs_; ++dof) {
+        if (constrained_[dof]) {
+            diag(dof) = 1.0;
+        }
+    }
+    return diag;
+}
+
+void MatrixFreeStiffness::elementBAndVolume(const ElementGeometry* geometry, size_t e, const int* nodes,
+                                            Eigen::Matrix<double, 6, 12>& B, double& volume) const {
+    if (geometry) {
+        B = geometry->getBMatrix(e);
+        volume = geometry->getVolume(e);
+        return;
+    }
+    Tet4Element tet(gatherCoords(mesh_, nodes));
+    B = tet.calculateBMatrix();
+    volume = tet.getVolume();
+}
+
+size_t MatrixFreeStiffness::memoryBytes() const {
+    return sizeof(*this) + coloring_.offsets.capacity() * sizeof(size_t) +
+           coloring_.elements.capacity() * sizeof(size_t) + constrained_.capacity() * sizeof(char) +
+           slots_.capacity() * sizeof(int) + materials_.size() * sizeof(Material);
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "Mesh.h"
+#include "MaterialTable.h"
+#include "ElementColoring.h"
+#include "ElementGeometry.h"
+#include <Eigen/Sparse>
+#include <vector>
+
+class MatrixFreeStiffness;
+
+namespace Eigen {
+namespace internal {
+// Lets Eigen's iterative solvers treat the operator like a sparse matrix
+template <>
+struct traits<MatrixFreeStiffness> : public traits<Eigen::SparseMatrix<double>> {};
+} // namespace internal
+} // namespace Eigen
+
+// Applies K*u element by element without ever storing K: each product gathers
+// the element displacements, forms f_e = V * B^T * D * (B * u_e) and scatters
+// f_e back; Tet10 and Hex8 elements form their element matrix on the fly
+// instead. Only the element coloring and a constraint mask are kept, so the
+// memory cost is a small fraction of the assembled matrix.
+//
+// Constrained DOFs are eliminated: their rows and columns act as the identity,
+// which keeps the operator symmetric positive definite for CG. Right-hand sides
+// go through liftPrescribedValues first, which moves the coupling to nonzero
+// prescribed values (-K_fc * u_c) onto the free rows.
+class MatrixFreeStiffness : public Eigen::EigenBase<MatrixFreeStiffness> {
+public:
+    typedef double Scalar;
+    typedef double RealScalar;
+    typedef int StorageIndex;
+    enum {
+        ColsAtCompileTime = Eigen::Dynamic,
+        MaxColsAtCompileTime = Eigen::Dynamic,
+        IsRowMajor = false
+    };
+
+    // The mesh must outlive the operator; the materials are copied.
+    // num_threads = 1 is serial; 0 uses every hardware thread. Throws
+    // std::invalid_argument for an element type without a kernel.
+    MatrixFreeStiffness(const Mesh& mesh, const MaterialTable& materials, unsigned num_threads = 1);
+
+    Eigen::Index rows() const { return static_cast<Eigen::Index>(total_dofs_); }
+    Eigen::Index cols() const { return static_cast<Eigen::Index>(total_dofs_); }
+
+    // Optional precomputed element geometry, so products skip the per-element
+    // B matrix construction; must outlive the operator. Every product checks
+    // that it still matches the mesh and builds B from the nodes otherwise.
+    void setGeometry(const ElementGeometry* geometry);
+
+    void setConstrainedDofs(const std::vector<int>& dofs);
+    bool isConstrained(Eigen::Index dof) const { return constrained_[dof] != 0; }
+    // Prepares a full-size right-hand side for the constrained operator:
+    // rhs_f -= K_fc * u_c on the free rows and rhs_c = u_c on the constrained
+    // ones, with u_c read from the constrained entries of prescribed (the
+    // others are ignored). A zero prescribed vector only zeroes rhs_c.
+    void liftPrescribedValues(const Eigen::VectorXd& prescribed, Eigen::VectorXd& rhs) const;
+
+    // y += alpha * K * x
+    void multiplyAdd(const Eigen::Ref<const Eigen::VectorXd>& x, Eigen::Ref<Eigen::VectorXd> y, double alpha = 1.0) const;
+
+    // Diagonal of the (constrained) operator, for Jacobi preconditioning
+    Eigen::VectorXd diagonal() const;
+
+    // Bytes held by the operator itself (the mesh and any geometry store are shared)
+    size_t memoryBytes() const;
+
+    template <typename Rhs>
+    Eigen::Product<MatrixFreeStiffness, Rhs, Eigen::AliasFreeProduct> operator*(const Eigen::MatrixBase<Rhs>& x) const {
+        return Eigen::Product<MatrixFreeStiffness, Rhs, Eigen::AliasFreeProduct>(*this, x.derived());
+    }
+
+private:
+    // y_f += alpha * K_fs * x_s over the element kernels, where s is the free
+    // DOFs or, with from_constrained, the constrained ones
+    void addElementProducts(const Eigen::Ref<const Eigen::VectorXd>& x, Eigen::Ref<Eigen::VectorXd> y, double alpha,
+                            bool from_constrained) const;
+    // The geometry store if it matches the mesh as it is now, else null
+    const ElementGeometry* currentGeometry() const;
+    void elementBAndVolume(const ElementGeometry* geometry, size_t e, const int* nodes,
+                           Eigen::Matrix<double, 6, 12>& B, double& volume) const;
+
+    const Mesh& mesh_;
+    MaterialTable materials_;
+    std::vector<int> slots_; // Material slot of each element
+    unsigned num_threads_;
+    size_t total_dofs_;
+    ElementColoring coloring_;
+    std::vector<char> constrained_;
+    const ElementGeometry* geometry_;
+};
+
+// Jacobi preconditioner that reads the diagonal from the matrix-free operator,
+// for use as ConjugateGradient<MatrixFreeStiffness, Lower|Upper, MatrixFreeJacobi>.
+class MatrixFreeJacobi {
+public:
+    MatrixFreeJacobi() = default;
+    template <typename MatType>
+    explicit MatrixFreeJacobi(const MatType& op) { compute(op); }
+
+    MatrixFreeJacobi& analyzePattern(const MatrixFreeStiffness&) { return *this; }
+    MatrixFreeJacobi& factorize(const MatrixFreeStiffness& op) { return compute(op); }
+    MatrixFreeJacobi& compute(const MatrixFreeStiffness& op) {
+        inv_diag_ = op.diagonal().cwiseInverse();
+        return *this;
+    }
+
+    template <typename Rhs>
+    Eigen::VectorXd solve(const Eigen::MatrixBase<Rhs>& b) const {
+        return inv_diag_.cwiseProduct(b.derived());
+    }
+
+    Eigen::ComputationInfo info() const { return Eigen::Success; }
+
+private:
+    Eigen::VectorXd inv_diag_;
+};
+
+namespace Eigen {
+namespace internal {
+template <typename Rhs>
+struct generic_product_impl<MatrixFreeStiffness, Rhs, SparseShape, DenseShape, GemvProduct>
+    : generic_product_impl_base<MatrixFreeStiffness, Rhs, generic_product_impl<MatrixFreeStiffness, Rhs>> {
+    typedef typename Product<MatrixFreeStiffness, Rhs>::Scalar Scalar;
+
+    template <typename Dest>
+    static void scaleAndAddTo(Dest& dst, const MatrixFreeStiffness& lhs, const Rhs& rhs, const Scalar& alpha) {
+        lhs.multiplyAdd(rhs, dst, alpha);
+    }
+};
+} // namespace internal
+} // namespace Eigen
@@ -1,87 +1,614 @@
 #include "Mesh.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstring>
 #include <fstream>
-#include <sstream>
 #include <iostream>
+#include <stdexcept>
+#include <type_traits>
+
+namespace {
+
+struct ParseError {
+    size_t line = 0; // 1-based; 0 means no error
+    std::string message;
+
+    explicit operator bool() const { return line != 0; }
+    void set(size_t at_line, const std::string& what) {
+        if (!*this) {
+            line = at_line;
+            message = what;
+        }
+    }
+};
+
+// A run of consecutive records of one block, parsed by a single thread
+struct Chunk {
+    const char* begin;   // Start of the line holding the first record
+    size_t first_record; // Index of that record within the block
+    size_t num_records;
+    size_t first_line;   // 1-based line number of begin
+};
+
+// Upper bound on the node count field of an element record (27-node hex)
+const int kMaxNodesPerElement = 27;
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline const char* skipSpaces(const char* p, const char* end) {
+    while (p < end && isSpace(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+inline const char* findLineEnd(const char* p, const char* end) {
+    const void* nl = std::memchr(p, '\n', static_cast<size_t>(end - p));
+    return nl ? static_cast<const char*>(nl) : end;
+}
+
+inline const char* nextLine(const char* line_end, const char* end) {
+    return line_end < end ? line_end + 1 : end;
+}
+
+inline bool atLineEnd(const char* p, const char* line_end) {
+    return skipSpaces(p, line_end) == line_end;
+}
+
+// Parses one whitespace-delimited number and advances p past it. Like
+// operator>>, a leading '+' is accepted; unlike it, a number glued to other
+// characters ("1.5x") is rejected.
+template <typename T>
+bool parseNumber(const char*& p, const char* line_end, T& value) {
+    p = skipSpaces(p, line_end);
+    if (p < line_end && *p == '+') {
+        ++p;
+    }
+    auto result = std::from_chars(p, line_end, value);
+    if (result.ec != std::errc() || (result.ptr < line_end && !isSpace(*result.ptr))) {
+        return false;
+    }
+    p = result.ptr;
+    return true;
+}
+
+// Walks the `count` records following a block header, skipping blank and
+// comment lines, and cuts them into at most `threads` chunks. Returns the
+// position just past the block; line_number is advanced to its last line.
+const char* scanBlock(const char* p, const char* end, size_t count, unsigned threads, size_t& line_number,
+                      std::vector<Chunk>& chunks, ParseError& error) {
+    size_t per_chunk = std::max<size_t>(1, (count + threads - 1) / std::max(1u, threads));
+    size_t record = 0;
+    while (record < count) {
+        if (p >= end) {
+            error.set(line_number, "expected " + std::to_string(count) + " records, found " +
+                                       std::to_string(record) + " before end of file");
+            return end;
+        }
+        const char* line_end = findLineEnd(p, end);
+        ++line_number;
+        const char* q = skipSpaces(p, line_end);
+        if (q != line_end && *q != '#') {
+            if (record % per_chunk == 0) {
+                chunks.push_back({p, record, std::min(per_chunk, count - record), line_number});
+            }
+            ++record;
+        }
+        p = nextLine(line_end, end);
+    }
+    return p;
+}
+
+// Moves to the next record line of a chunk, skipping blanks and comments
+const char* nextRecord(const char*& p, const char* end, size_t& line_number) {
+    while (true) {
+        const char* line_end = findLineEnd(p, end);
+        const char* q = skipSpaces(p, line_end);
+        if (q != line_end && *q != '#') {
+            p = q;
+            return line_end;
+        }
+        p = nextLine(line_end, end);
+        ++line_number;
+    }
+}
+
+// Destination of a NODES block in the mesh's coordinate arrays
+struct NodeArrays {
+    int* ids;
+    double* x;
+    double* y;
+    double* z;
+};
+
+void parseNodeChunk(const Chunk& chunk, const char* end, const NodeArrays& out, ParseError& error) {
+    const char* p = chunk.begin;
+    size_t line_number = chunk.first_line;
+    for (size_t r = 0; r < chunk.num_records; ++r) {
+        const char* line_end = nextRecord(p, end, line_number);
+        size_t i = chunk.first_record + r;
+        if (!parseNumber(p, line_end, out.ids[i]) || !parseNumber(p, line_end, out.x[i]) ||
+            !parseNumber(p, line_end, out.y[i]) || !parseNumber(p, line_end, out.z[i])) {
+            error.set(line_number, "malformed node record, expected '<id> <x> <y> <z>'");
+            return;
+        }
+        if (!atLineEnd(p, line_end)) {
+            error.set(line_number, "unexpected trailing data after node record");
+            return;
+        }
+        p = nextLine(line_end, end);
+        ++line_number;
+    }
+}
+
+// Elements parsed by one thread; merged into the mesh in chunk order afterwards
+struct ElementChunkData {
+    std::vector<int> ids;
+    std::vector<ElementType> types;
+    std::vector<int> materials;
+    std::vector<size_t> num_nodes;
+    std::vector<int> connectivity; // Node indices
+};
+
+void parseElementChunk(const Chunk& chunk, const char* end, const Mesh& mesh, ElementChunkData& out,
+                       ParseError& error) {
+    const char* p = chunk.begin;
+    size_t line_number = chunk.first_line;
+    out.ids.resize(chunk.num_records);
+    out.types.resize(chunk.num_records);
+    out.materials.resize(chunk.num_records);
+    out.num_nodes.resize(chunk.num_records);
+    out.connectivity.reserve(chunk.num_records * 4);
+    for (size_t r = 0; r < chunk.num_records; ++r) {
+        const char* line_end = nextRecord(p, end, line_number);
+        int id = 0;
+        int type = 0; // Number of nodes that follow
+        if (!parseNumber(p, line_end, id) || !parseNumber(p, line_end, type) || type <= 0 ||
+            type > kMaxNodesPerElement) {
+            error.set(line_number, "malformed element record, expected '<id> <num_nodes> <node ids...>'");
+            return;
+        }
+        for (int j = 0; j < type; ++j) {
+            int node_id = 0;
+            if (!parseNumber(p, line_end, node_id)) {
+                error.set(line_number, "element " + std::to_string(id) + " lists fewer than " +
+                                           std::to_string(type) + " valid node IDs");
+                return;
+            }
+            int index = mesh.getNodeIndex(node_id);
+            if (index < 0) {
+                error.set(line_number, "element " + std::to_string(id) + " references unknown node ID " +
+                                           std::to_string(node_id));
+                return;
+            }
+            out.connectivity.push_back(index);
+        }
+        int material = 0;
+        if (!atLineEnd(p, line_end) && (!parseNumber(p, line_end, material) || !atLineEnd(p, line_end))) {
+            error.set(line_number, "unexpected trailing data after element record");
+            return;
+        }
+        out.ids[r] = id;
+        out.materials[r] = material;
+        out.types[r] = elementTypeFromNodeCount(type);
+        out.num_nodes[r] = static_cast<size_t>(type);
+        p = nextLine(line_end, end);
+        ++line_number;
+    }
+}
+
+uint64_t nextMeshRevision() {
+    static std::atomic<uint64_t> counter{0};
+    return ++counter;
+}
+
+} // namespace
 
 // Constructor implementation
-Mesh::Mesh() {
-    // The node and element vectors are created empty by default.
+Mesh::Mesh()
+    : revision_(nextMeshRevision()),
+      element_offsets_(1, 0),
+      contiguous_ids_(true),
+      first_node_id_(1),
+      nodes_view_valid_(false),
+      elements_view_valid_(false) {
+    // The node and element arrays are created empty by default.
 }
 
 // getNumNodes implementation
 size_t Mesh::getNumNodes() const {
-    return nodes_.size();
+    return node_ids_.size();
 }
 
 // getNumElements implementation
 size_t Mesh::getNumElements() const {
-    return elements_.size();
+    return element_ids_.size();
+}
+
+void Mesh::clear() {
+    node_ids_.clear();
+    x_.clear();
+    y_.clear();
+    z_.clear();
+    element_ids_.clear();
+    element_types_.clear();
+    element_materials_.clear();
+    element_offsets_ = MeshArray<size_t>(1, 0);
+    connectivity_.clear();
+    mapping_.reset();
+    contiguous_ids_ = true;
+    first_node_id_ = 1;
+    id_to_index_.clear();
+    invalidateViews();
 }
 
-bool Mesh::loadFromFile(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        std::cerr << "Error: Could not open mesh file " << filename << std::endl;
+bool Mesh::loadText(const std::string& filename, unsigned num_threads) {
+    FEM_PROFILE_SCOPE("mesh.load_text");
+    last_error_.clear();
+    MappedFile file;
+    if (!file.open(filename)) {
+        last_error_ = "Could not open mesh file " + filename;
+        std::cerr << "Error: " << last_error_ << std::endl;
         return false;
     }
 
     // Clear any existing data
-    nodes_.clear();
-    elements_.clear();
+    clear();
 
-    std::string line;
-    std::string keyword;
-    int count;
+    const char* p = file.data();
+    const char* end = p + file.size();
+    size_t line_number = 0;
+    ParseError error;
 
-    while (std::getline(file, line)) {
-        if (line.empty() || line[0] == '#') {
+    while (p < end && !error) {
+        const char* line_end = findLineEnd(p, end);
+        ++line_number;
+        const char* q = skipSpaces(p, line_end);
+        if (q == line_end || *q == '#') {
+            p = nextLine(line_end, end);
             continue; // Skip empty lines and comments
         }
 
-        std::stringstream ss(line);
-        ss >> keyword;
+        const char* keyword_end = q;
+        while (keyword_end < line_end && !isSpace(*keyword_end)) {
+            ++keyword_end;
+        }
+        std::string keyword(q, keyword_end);
+        long long count = 0;
+        const char* c = keyword_end;
+        size_t header_line = line_number;
+        if (keyword != "NODES" && keyword != "ELEMENTS") {
+            error.set(line_number, "unknown keyword '" + keyword + "'");
+            break;
+        }
+        if (!parseNumber(c, line_end, count) || count < 0 || !atLineEnd(c, line_end)) {
+            error.set(line_number, "expected a record count after " + keyword);
+            break;
+        }
+
+        // Locate the records of this block and split them into per-thread chunks
+        p = nextLine(line_end, end);
+        std::vector<Chunk> chunks;
+        unsigned threads = resolveThreadCount(num_threads);
+        p = scanBlock(p, end, static_cast<size_t>(count), threads, line_number, chunks, error);
+        if (error) {
+            error.message = keyword + " block: " + error.message;
+            break;
+        }
 
+        std::vector<ParseError> chunk_errors(chunks.size());
+        unsigned chunk_threads = static_cast<unsigned>(chunks.size());
         if (keyword == "NODES") {
-            ss >> count;
-            nodes_.reserve(count);
-            for (int i = 0; i < count; ++i) {
-                Node n;
-                file >> n.id >> n.x >> n.y >> n.z;
-                nodes_.push_back(n);
-            }
-        } else if (keyword == "ELEMENTS") {
-            ss >> count;
-            elements_.reserve(count);
-            for (int i = 0; i < count; ++i) {
-                Element e;
-                int type; // We read the type but don't use it yet
-                file >> e.id >> type;
-                e.connectivity.resize(type);
-                for (int j = 0; j < type; ++j) {
-                    file >> e.connectivity[j];
+            size_t first = node_ids_.size();
+            node_ids_.resize(first + count);
+            x_.resize(first + count);
+            y_.resize(first + count);
+            z_.resize(first + count);
+            NodeArrays out = {node_ids_.mutableData() + first, x_.mutableData() + first, y_.mutableData() + first,
+                              z_.mutableData() + first};
+            parallelFor(chunks.size(), chunk_threads, [&](size_t b, size_t e, unsigned) {
+                for (size_t k = b; k < e; ++k) {
+                    parseNodeChunk(chunks[k], end, out, chunk_errors[k]);
+                }
+            });
+        } else {
+            std::vector<ElementChunkData> parsed(chunks.size());
+            parallelFor(chunks.size(), chunk_threads, [&](size_t b, size_t e, unsigned) {
+                for (size_t k = b; k < e; ++k) {
+                    parseElementChunk(chunks[k], end, *this, parsed[k], chunk_errors[k]);
                 }
-                elements_.push_back(e);
+            });
+
+            // Append the chunks in file order
+            for (const auto& data : parsed) {
+                element_ids_.append(data.ids.begin(), data.ids.end());
+                element_types_.append(data.types.begin(), data.types.end());
+                element_materials_.append(data.materials.begin(), data.materials.end());
+                for (size_t n : data.num_nodes) {
+                    element_offsets_.push_back(element_offsets_.back() + n);
+                }
+                connectivity_.append(data.connectivity.begin(), data.connectivity.end());
+            }
+        }
+        // Chunks are in file order, so the first failing chunk holds the first error
+        for (const auto& chunk_error : chunk_errors) {
+            if (chunk_error) {
+                error = chunk_error;
+                break;
             }
         }
+        if (!error && keyword == "NODES" && !rebuildNodeIndex()) {
+            error.set(header_line, "NODES block: " + last_error_);
+        }
     }
 
+    if (error) {
+        last_error_ = filename + ":" + std::to_string(error.line) + ": " + error.message;
+        std::cerr << "Error: " << last_error_ << std::endl;
+        clear();
+        return false;
+    }
+    invalidateViews();
+    FEM_PROFILE_COUNTER("mesh.nodes", getNumNodes());
+    FEM_PROFILE_COUNTER("mesh.elements", getNumElements());
     return true;
 }
 
+bool Mesh::saveText(const std::string& filename) const {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open " << filename << " for writing" << std::endl;
+        return false;
+    }
+
+    // Lines are formatted with to_chars into a buffer flushed in large writes;
+    // shortest round-trip doubles, so loading gives back identical coordinates
+    std::string buffer;
+    const size_t flush_size = 1 << 20;
+    char field[32];
+    auto append = [&](auto value) {
+        auto result = std::to_chars(field, field + sizeof(field), value);
+        buffer.append(field, result.ptr);
+    };
+    auto flush = [&](bool force) {
+        if (force || buffer.size() >= flush_size) {
+            out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            buffer.clear();
+        }
+    };
+
+    buffer += "NODES ";
+    append(node_ids_.size());
+    buffer += '\n';
+    for (size_t i = 0; i < node_ids_.size(); ++i) {
+        append(node_ids_[i]);
+        for (double v : {x_[i], y_[i], z_[i]}) {
+            buffer += ' ';
+            append(v);
+        }
+        buffer += '\n';
+        flush(false);
+    }
+    buffer += "ELEMENTS ";
+    append(element_ids_.size());
+    buffer += '\n';
+    for (size_t e = 0; e < element_ids_.size(); ++e) {
+        append(element_ids_[e]);
+        buffer += ' ';
+        append(getElementNumNodes(e));
+        const int* nodes = getElementNodes(e);
+        for (size_t k = 0; k < getElementNumNodes(e); ++k) {
+            buffer += ' ';
+            append(node_ids_[nodes[k]]);
+        }
+        if (element_materials_[e] != 0) {
+            buffer += ' ';
+            append(element_materials_[e]);
+        }
+        buffer += '\n';
+        flush(false);
+    }
+    flush(true);
+    if (!out) {
+        std::cerr << "Error: Failed writing mesh " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+const std::string& Mesh::getLastError() const {
+    return last_error_;
+}
+
+int Mesh::getNodeIndex(int node_id) const {
+    if (contiguous_ids_) {
+        long long index = static_cast<long long>(node_id) - first_node_id_;
+        return index >= 0 && index < static_cast<long long>(node_ids_.size()) ? static_cast<int>(index) : -1;
+    }
+    auto it = id_to_index_.find(node_id);
+    return it == id_to_index_.end() ? -1 : it->second;
+}
+
+bool Mesh::rebuildNodeIndex() {
+    id_to_index_.clear();
+    first_node_id_ = node_ids_.empty() ? 1 : node_ids_[0];
+    contiguous_ids_ = true;
+    for (size_t i = 0; i < node_ids_.size(); ++i) {
+        if (static_cast<long long>(node_ids_[i]) != static_cast<long long>(first_node_id_) + static_cast<long long>(i)) {
+            contiguous_ids_ = false;
+            break;
+        }
+    }
+    if (contiguous_ids_) {
+        return true;
+    }
+
+    id_to_index_.reserve(node_ids_.size());
+    for (size_t i = 0; i < node_ids_.size(); ++i) {
+        if (!id_to_index_.emplace(node_ids_[i], static_cast<int>(i)).second) {
+            last_error_ = "duplicate node ID " + std::to_string(node_ids_[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Mesh::isMapped() const {
+    return node_ids_.isView() || x_.isView() || y_.isView() || z_.isView() || element_ids_.isView() ||
+           element_types_.isView() || element_materials_.isView() || element_offsets_.isView() ||
+           connectivity_.isView();
+}
+
+void Mesh::invalidateViews() {
+    revision_ = nextMeshRevision();
+    std::lock_guard<std::mutex> lock(view_mutex_.m);
+    nodes_view_valid_ = false;
+    elements_view_valid_ = false;
+    nodes_view_.clear();
+    elements_view_.clear();
+}
+
 const std::vector<Node>& Mesh::getNodes() const {
-    return nodes_;
+    std::lock_guard<std::mutex> lock(view_mutex_.m);
+    if (!nodes_view_valid_) {
+        nodes_view_.resize(node_ids_.size());
+        for (size_t i = 0; i < node_ids_.size(); ++i) {
+            nodes_view_[i] = {node_ids_[i], x_[i], y_[i], z_[i]};
+        }
+        nodes_view_valid_ = true;
+    }
+    return nodes_view_;
 }
 
 const std::vector<Element>& Mesh::getElements() const {
-    return elements_;
+    std::lock_guard<std::mutex> lock(view_mutex_.m);
+    if (!elements_view_valid_) {
+        elements_view_.resize(element_ids_.size());
+        for (size_t e = 0; e < element_ids_.size(); ++e) {
+            elements_view_[e].id = element_ids_[e];
+            elements_view_[e].connectivity.resize(getElementNumNodes(e));
+            const int* nodes = getElementNodes(e);
+            for (size_t j = 0; j < getElementNumNodes(e); ++j) {
+                elements_view_[e].connectivity[j] = node_ids_[nodes[j]];
+            }
+        }
+        elements_view_valid_ = true;
+    }
+    return elements_view_;
 }
 
 void Mesh::addNode(int id, double x, double y, double z) {
-    nodes_.push_back({id, x, y, z});
+    if (getNodeIndex(id) >= 0) {
+        throw std::invalid_argument("Mesh::addNode: duplicate node ID " + std::to_string(id));
+    }
+    int index = static_cast<int>(node_ids_.size());
+    if (node_ids_.empty()) {
+        first_node_id_ = id;
+    } else if (contiguous_ids_ && static_cast<long long>(id) != static_cast<long long>(first_node_id_) + index) {
+        // Switch to an explicit map for all nodes so far
+        contiguous_ids_ = false;
+        id_to_index_.reserve(node_ids_.size() + 1);
+        for (size_t i = 0; i < node_ids_.size(); ++i) {
+            id_to_index_.emplace(node_ids_[i], static_cast<int>(i));
+        }
+    }
+    if (!contiguous_ids_) {
+        id_to_index_.emplace(id, index);
+    }
+    node_ids_.push_back(id);
+    x_.push_back(x);
+    y_.push_back(y);
+    z_.push_back(z);
+    invalidateViews();
 }
 
-void Mesh::addElement(const std::vector<int>& connectivity) {
+void Mesh::reserve(size_t num_nodes, size_t num_elements, size_t connectivity_size) {
+    node_ids_.reserve(num_nodes);
+    x_.reserve(num_nodes);
+    y_.reserve(num_nodes);
+    z_.reserve(num_nodes);
+    element_ids_.reserve(num_elements);
+    element_types_.reserve(num_elements);
+    element_materials_.reserve(num_elements);
+    element_offsets_.reserve(num_elements + 1);
+    connectivity_.reserve(connectivity_size);
+}
+
+void Mesh::addElement(const std::vector<int>& connectivity, int material_id) {
+    // Resolve straight into the connectivity array, rolling back on a bad ID
+    // so the mesh is left untouched
+    size_t start = connectivity_.size();
+    for (int node_id : connectivity) {
+        int index = getNodeIndex(node_id);
+        if (index < 0) {
+            connectivity_.resize(start);
+            throw std::invalid_argument("Mesh::addElement: unknown node ID " + std::to_string(node_id));
+        }
+        connectivity_.push_back(index);
+    }
+
     // Automatically assign the next available element ID
-    int new_id = static_cast<int>(elements_.size()) + 1;
-    elements_.push_back({new_id, connectivity});
-}
\ No newline at end of file
+    int new_id = static_cast<int>(element_ids_.size()) + 1;
+    element_ids_.push_back(new_id);
+    element_types_.push_back(elementTypeFromNodeCount(connectivity.size()));
+    element_materials_.push_back(material_id);
+    element_offsets_.push_back(connectivity_.size());
+    invalidateViews();
+}
+
+void Mesh::setNodeCoordinates(size_t n, double x, double y, double z) {
+    if (n >= node_ids_.size()) {
+        throw std::out_of_range("Mesh::setNodeCoordinates: no node index " + std::to_string(n));
+    }
+    x_.mutableData()[n] = x;
+    y_.mutableData()[n] = y;
+    z_.mutableData()[n] = z;
+    invalidateViews();
+}
+
+void Mesh::setElementMaterial(size_t e, int material_id) {
+    if (e >= element_materials_.size()) {
+        throw std::out_of_range("Mesh::setElementMaterial: no element " + std::to_string(e));
+    }
+    element_materials_.mutableData()[e] = material_id;
+}
+
+void Mesh::permuteNodes(const std::vector<int>& old_to_new) {
+    size_t n = node_ids_.size();
+    if (old_to_new.size() != n) {
+        throw std::invalid_argument("Mesh::permuteNodes: permutation size does not match the node count");
+    }
+    std::vector<int> new_to_old(n, -1);
+    for (size_t i = 0; i < n; ++i) {
+        int k = old_to_new[i];
+        if (k < 0 || static_cast<size_t>(k) >= n || new_to_old[k] != -1) {
+            throw std::invalid_argument("Mesh::permuteNodes: not a permutation");
+        }
+        new_to_old[k] = static_cast<int>(i);
+    }
+
+    auto gather = [&](auto& array) {
+        typedef typename std::decay<decltype(array)>::type Array;
+        std::vector<typename Array::value_type> moved(n);
+        for (size_t k = 0; k < n; ++k) {
+            moved[k] = array[new_to_old[k]];
+        }
+        array = Array(std::move(moved));
+    };
+    gather(node_ids_);
+    gather(x_);
+    gather(y_);
+    gather(z_);
+    int* connectivity = connectivity_.mutableData();
+    for (size_t k = 0; k < connectivity_.size(); ++k) {
+        connectivity[k] = old_to_new[connectivity[k]];
+    }
+    rebuildNodeIndex(); // IDs were unique before, so this cannot fail
+    invalidateViews();
+}
@@ -1,22 +1,145 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 #include <string>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include "Node.h"     // <-- Include the new header
 #include "Element.h"  // <-- Include the new header
+#include "MeshArray.h"
 
+class MappedFile;
+
+// Nodes and elements are stored as structure-of-arrays: contiguous x/y/z
+// coordinate arrays, and element connectivity in CSR form (offsets plus a flat
+// array of 0-based node *indices*). Node IDs from the file are kept separately
+// and resolved through getNodeIndex, so IDs need not be contiguous or 1-based.
+// After loadBinary the arrays are views into the mapped file (see MeshArray).
 class Mesh {
 public:
     Mesh();
     size_t getNumNodes() const;
     size_t getNumElements() const;
-    bool loadFromFile(const std::string& filename);
+
+    // Loads a text .mesh file or a binary .femb file (detected by its magic).
+    // For a text file, a sidecar "<filename>.femb" is used instead when it
+    // matches the text file's size and modification time; a stale sidecar is
+    // rewritten after parsing. No sidecar is created if none exists.
+    //
+    // Text is parsed from a memory-mapped file with the NODES and ELEMENTS
+    // blocks split across num_threads threads (0 = all hardware threads) at
+    // line boundaries. On malformed input it returns false and
+    // getLastError() names the offending line. An element record is
+    // "<id> <num_nodes> <node ids...> [material_id]"; without the trailing
+    // field the element gets material 0.
+    bool loadFromFile(const std::string& filename, unsigned num_threads = 0);
+    const std::string& getLastError() const;
+    // Writes the text format read by loadFromFile
+    bool saveText(const std::string& filename) const;
+
+    // Binary format, see BinaryMeshFormat.h. source_filename records which
+    // text mesh the file caches (empty for a standalone binary mesh). Fails
+    // on elements of no supported type, which loadBinary would reject.
+    bool saveBinary(const std::string& filename, const std::string& source_filename = "") const;
+    // Zero-copy: the arrays below become views into the mapped file, which
+    // the mesh (and its copies) keep mapped until cleared or reloaded.
+    // Loading reads the element sections to validate them and the node IDs
+    // for the ID lookup, but copies nothing; an array is copied out of the
+    // mapping when it is first modified. saveBinary replaces files by renaming, so refreshing a
+    // sidecar does not disturb a mesh mapped from the old one.
+    bool loadBinary(const std::string& filename);
+    // True while some array still reads from a mapped binary file
+    bool isMapped() const;
+
+    // --- Structure-of-arrays access ---
+    const MeshArray<int>& getNodeIds() const { return node_ids_; }
+    const MeshArray<double>& getX() const { return x_; }
+    const MeshArray<double>& getY() const { return y_; }
+    const MeshArray<double>& getZ() const { return z_; }
+    // Index of a node ID in the arrays above, or -1 if there is no such node
+    int getNodeIndex(int node_id) const;
+    // Moves the node at index n; throws std::out_of_range if there is none
+    void setNodeCoordinates(size_t n, double x, double y, double z);
+
+    const MeshArray<int>& getElementIds() const { return element_ids_; }
+    const MeshArray<ElementType>& getElementTypes() const { return element_types_; }
+    const MeshArray<size_t>& getElementOffsets() const { return element_offsets_; }
+    const MeshArray<int>& getConnectivity() const { return connectivity_; } // Node indices
+    size_t getElementNumNodes(size_t e) const { return element_offsets_[e + 1] - element_offsets_[e]; }
+    const int* getElementNodes(size_t e) const { return connectivity_.data() + element_offsets_[e]; }
+    // Material (region) ID of each element, looked up in a MaterialTable
+    const MeshArray<int>& getElementMaterials() const { return element_materials_; }
+    int getElementMaterial(size_t e) const { return element_materials_[e]; }
+    // Throws std::out_of_range if there is no element e
+    void setElementMaterial(size_t e, int material_id);
+
+    // --- Compatibility views ---
+    // Array-of-structs copies (connectivity as node IDs) built on first use
+    // and dropped when the mesh changes. Prefer the accessors above in loops.
     const std::vector<Node>& getNodes() const;
     const std::vector<Element>& getElements() const;
+
+    // Node IDs must be unique; elements must reference existing node IDs.
+    // Both throw std::invalid_argument otherwise.
     void addNode(int id, double x, double y, double z);
-    void addElement(const std::vector<int>& connectivity);
+    void addElement(const std::vector<int>& connectivity, int material_id = 0);
+    // Preallocates storage before adding many nodes and elements
+    void reserve(size_t num_nodes, size_t num_elements, size_t connectivity_size);
+
+    // Moves node i to index old_to_new[i] and renumbers the connectivity to
+    // match. Node IDs move with their nodes, so getNodeIndex keeps resolving
+    // them. Throws std::invalid_argument if old_to_new is not a permutation.
+    void permuteNodes(const std::vector<int>& old_to_new);
+
+    // Stamp of the current coordinates and connectivity, drawn from a
+    // process-wide counter whenever a node moves or the connectivity changes
+    // (loads, addNode, addElement, setNodeCoordinates, permuteNodes). Two meshes
+    // share a revision only if one is an unmodified copy of the other, so
+    // caches derived from the geometry can check it to detect staleness.
+    // Material changes do not count.
+    uint64_t getRevision() const { return revision_; }
 
 private:
-    std::vector<Node> nodes_;
-    std::vector<Element> elements_;
-};
\ No newline at end of file
+    bool loadText(const std::string& filename, unsigned num_threads);
+    void clear();
+    // Re-derives the ID -> index lookup after node IDs were bulk-loaded;
+    // returns false (and names the ID in last_error_) on a duplicate
+    bool rebuildNodeIndex();
+    // Drops the compatibility views and takes a new revision
+    void invalidateViews();
+
+    uint64_t revision_;
+    MeshArray<int> node_ids_;
+    MeshArray<double> x_, y_, z_;
+
+    MeshArray<int> element_ids_;
+    MeshArray<ElementType> element_types_;
+    MeshArray<int> element_materials_;
+    MeshArray<size_t> element_offsets_; // Size num_elements + 1
+    MeshArray<int> connectivity_;
+    // Binary file the arrays may view; shared by copies of the mesh
+    std::shared_ptr<const MappedFile> mapping_;
+
+    // Node IDs first_node_id_, first_node_id_ + 1, ... in order need no map
+    bool contiguous_ids_;
+    int first_node_id_;
+    std::unordered_map<int, int> id_to_index_; // Only filled when not contiguous
+
+    std::string last_error_;
+
+    // The mutex only guards building the compatibility views; copies of a
+    // mesh get a fresh one
+    struct ViewMutex {
+        std::mutex m;
+        ViewMutex() = default;
+        ViewMutex(const ViewMutex&) {}
+        ViewMutex& operator=(const ViewMutex&) { return *this; }
+    };
+    mutable ViewMutex view_mutex_;
+    mutable bool nodes_view_valid_;
+    mutable bool elements_view_valid_;
+    mutable std::vector<Node> nodes_view_;
+    mutable std::vector<Element> elements_view_;
+};
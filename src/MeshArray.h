@@ -0,0 +1,87 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// One of Mesh's structure-of-arrays members. It either owns its elements or
+// is a read-only view into a memory-mapped binary mesh, which the owning Mesh
+// keeps alive. Reads look like those of a const std::vector. Every write
+// first copies a view into owned storage (copy on write), so the mapped file
+// is never written through.
+template <typename T>
+class MeshArray {
+public:
+    typedef T value_type;
+    typedef size_t size_type;
+    typedef const T* iterator;
+    typedef const T* const_iterator;
+
+    MeshArray() = default;
+    MeshArray(size_t count, const T& value) : owned_(count, value) {}
+    explicit MeshArray(std::vector<T>&& owned) : owned_(std::move(owned)) {}
+
+    const T* data() const { return view_ ? view_ : owned_.data(); }
+    size_t size() const { return view_ ? view_size_ : owned_.size(); }
+    bool empty() const { return size() == 0; }
+    const T& operator[](size_t i) const { return data()[i]; }
+    const T& front() const { return data()[0]; }
+    const T& back() const { return data()[size() - 1]; }
+    const T* begin() const { return data(); }
+    const T* end() const { return data() + size(); }
+
+    // True while the elements live in a mapped file
+    bool isView() const { return view_ != nullptr; }
+    // Points the array at count elements owned by someone else
+    void setView(const T* elements, size_t count) {
+        std::vector<T>().swap(owned_);
+        view_ = count > 0 ? elements : nullptr;
+        view_size_ = count > 0 ? count : 0;
+    }
+
+    // --- Writes; each detaches a view first ---
+    T* mutableData() { return detach().data(); }
+    void clear() {
+        view_ = nullptr;
+        view_size_ = 0;
+        owned_.clear();
+    }
+    void reserve(size_t count) { detach().reserve(count); }
+    void resize(size_t count) { detach().resize(count); }
+    void push_back(const T& value) { detach().push_back(value); }
+    template <typename It>
+    void assign(It first, It last) {
+        view_ = nullptr;
+        view_size_ = 0;
+        owned_.assign(first, last);
+    }
+    template <typename It>
+    void append(It first, It last) { detach().insert(owned_.end(), first, last); }
+
+    // Bytes of owned storage; a view costs nothing
+    size_t ownedBytes() const { return owned_.capacity() * sizeof(T); }
+
+    friend bool operator==(const MeshArray& a, const MeshArray& b) {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+    }
+    friend bool operator==(const MeshArray& a, const std::vector<T>& b) {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+    }
+    friend bool operator==(const std::vector<T>& a, const MeshArray& b) { return b == a; }
+    friend bool operator!=(const MeshArray& a, const MeshArray& b) { return !(a == b); }
+
+private:
+    std::vector<T>& detach() {
+        if (view_) {
+            owned_.assign(view_, view_ + view_size_);
+            view_ = nullptr;
+            view_size_ = 0;
+        }
+        return owned_;
+    }
+
+    std::vector<T> owned_;
+    const T* view_ = nullptr;
+    size_t view_size_ = 0;
+};
@@ -0,0 +1,263 @@
+#include "Mesh.h"
+#include "BinaryMeshFormat.h"
+#include "MappedFile.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <system_error>
+
+namespace {
+
+const uint64_t kSectionAlignment = 64;
+
+uint64_t alignUp(uint64_t offset) {
+    return (offset + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment;
+}
+
+// Size and modification time identifying the version of a text mesh
+bool sourceStamp(const std::string& filename, uint64_t& size, int64_t& mtime) {
+    std::error_code ec;
+    auto file_size = std::filesystem::file_size(filename, ec);
+    if (ec) {
+        return false;
+    }
+    auto file_time = std::filesystem::last_write_time(filename, ec);
+    if (ec) {
+        return false;
+    }
+    size = static_cast<uint64_t>(file_size);
+    mtime = static_cast<int64_t>(file_time.time_since_epoch().count());
+    return true;
+}
+
+bool hasBinaryMagic(const MappedFile& file) {
+    return file.size() >= sizeof(kBinaryMeshMagic) &&
+           std::memcmp(file.data(), kBinaryMeshMagic, sizeof(kBinaryMeshMagic)) == 0;
+}
+
+} // namespace
+
+bool validateBinaryMeshHeader(const MappedFile& file, BinaryMeshHeader& header, std::string& why) {
+    if (!hasBinaryMagic(file) || file.size() < sizeof(BinaryMeshHeader)) {
+        why = "not a binary mesh file";
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.version != kBinaryMeshVersion) {
+        why = "unsupported binary mesh version " + std::to_string(header.version);
+        return false;
+    }
+    if (header.header_size != sizeof(BinaryMeshHeader) || header.file_size != file.size()) {
+        why = "corrupt or truncated binary mesh header";
+        return false;
+    }
+    if (header.num_nodes > file.size() || header.num_elements > file.size() ||
+        header.connectivity_size > file.size()) {
+        why = "corrupt binary mesh counts";
+        return false;
+    }
+    auto fits = [&](uint64_t offset, uint64_t bytes) {
+        return offset % kSectionAlignment == 0 && offset <= file.size() && bytes <= file.size() - offset;
+    };
+    if (!fits(header.node_ids_offset, header.num_nodes * sizeof(int32_t)) ||
+        !fits(header.x_offset, header.num_nodes * sizeof(double)) ||
+        !fits(header.y_offset, header.num_nodes * sizeof(double)) ||
+        !fits(header.z_offset, header.num_nodes * sizeof(double)) ||
+        !fits(header.element_ids_offset, header.num_elements * sizeof(int32_t)) ||
+        !fits(header.element_types_offset, header.num_elements * sizeof(uint8_t)) ||
+        !fits(header.element_materials_offset, header.num_elements * sizeof(int32_t)) ||
+        !fits(header.elem_offsets_offset, (header.num_elements + 1) * sizeof(int64_t)) ||
+        !fits(header.connectivity_offset, header.connectivity_size * sizeof(int32_t))) {
+        why = "binary mesh section out of bounds";
+        return false;
+    }
+    return true;
+}
+
+bool Mesh::loadFromFile(const std::string& filename, unsigned num_threads) {
+    FEM_PROFILE_SCOPE("mesh.load");
+    {
+        MappedFile probe;
+        if (probe.open(filename) && hasBinaryMagic(probe)) {
+            probe.close();
+            return loadBinary(filename);
+        }
+    }
+
+    // Use the sidecar cache when it was written from this exact text file
+    std::string sidecar = filename + kBinaryMeshSidecarSuffix;
+    uint64_t source_size = 0;
+    int64_t source_mtime = 0;
+    bool have_stamp = sourceStamp(filename, source_size, source_mtime);
+    bool have_sidecar = have_stamp && std::filesystem::exists(sidecar);
+    if (have_sidecar) {
+        MappedFile cache;
+        BinaryMeshHeader header;
+        std::string why;
+        if (cache.open(sidecar) && validateBinaryMeshHeader(cache, header, why) && header.source_size == source_size &&
+            header.source_mtime == source_mtime) {
+            cache.close();
+            if (loadBinary(sidecar)) {
+                return true;
+            }
+        }
+    }
+
+    if (!loadText(filename, num_threads)) {
+        return false;
+    }
+    if (have_sidecar && !saveBinary(sidecar, filename)) {
+        std::cerr << "Warning: Could not refresh mesh cache " << sidecar << std::endl;
+    }
+    return true;
+}
+
+bool Mesh::saveBinary(const std::string& filename, const std::string& source_filename) const {
+    FEM_PROFILE_SCOPE("mesh.save_binary");
+    static_assert(sizeof(int) == sizeof(int32_t) && sizeof(ElementType) == sizeof(uint8_t),
+                  "binary mesh sections are written straight from the mesh arrays");
+    BinaryMeshHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kBinaryMeshMagic, sizeof(kBinaryMeshMagic));
+    header.version = kBinaryMeshVersion;
+    header.header_size = sizeof(BinaryMeshHeader);
+    header.num_nodes = node_ids_.size();
+    header.num_elements = element_ids_.size();
+    header.connectivity_size = connectivity_.size();
+    if (!source_filename.empty() && !sourceStamp(source_filename, header.source_size, header.source_mtime)) {
+        std::cerr << "Error: Could not stat mesh source " << source_filename << std::endl;
+        return false;
+    }
+    uint64_t n = header.num_nodes;
+    uint64_t ne = header.num_elements;
+    size_t unknown = std::find(element_types_.begin(), element_types_.end(), ElementType::Unknown) -
+                     element_types_.begin();
+    if (unknown < ne) {
+        std::cerr << "Error: Element " << element_ids_[unknown] << " has "
+                  << element_offsets_[unknown + 1] - element_offsets_[unknown]
+                  << " nodes, which is no supported element type; it cannot be saved as a binary mesh" << std::endl;
+        return false;
+    }
+    header.node_ids_offset = alignUp(sizeof(BinaryMeshHeader));
+    header.x_offset = alignUp(header.node_ids_offset + n * sizeof(int32_t));
+    header.y_offset = alignUp(header.x_offset + n * sizeof(double));
+    header.z_offset = alignUp(header.y_offset + n * sizeof(double));
+    header.element_ids_offset = alignUp(header.z_offset + n * sizeof(double));
+    header.element_types_offset = alignUp(header.element_ids_offset + ne * sizeof(int32_t));
+    header.element_materials_offset = alignUp(header.element_types_offset + ne * sizeof(uint8_t));
+    header.elem_offsets_offset = alignUp(header.element_materials_offset + ne * sizeof(int32_t));
+    header.connectivity_offset = alignUp(header.elem_offsets_offset + (ne + 1) * sizeof(int64_t));
+    header.file_size = header.connectivity_offset + header.connectivity_size * sizeof(int32_t);
+
+    std::vector<int64_t> elem_offsets(element_offsets_.begin(), element_offsets_.end());
+
+    // Write to a temporary file and rename, so readers never see a partial cache
+    std::string tmp_filename = filename + ".tmp";
+    {
+        std::ofstream out(tmp_filename, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            std::cerr << "Error: Could not open " << tmp_filename << " for writing" << std::endl;
+            return false;
+        }
+        auto writeSection = [&](uint64_t offset, const void* data, size_t bytes) {
+            static const char zeros[kSectionAlignment] = {};
+            uint64_t pos = static_cast<uint64_t>(out.tellp());
+            out.write(zeros, static_cast<std::streamsize>(offset - pos));
+            out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        };
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        writeSection(header.node_ids_offset, node_ids_.data(), n * sizeof(int32_t));
+        writeSection(header.x_offset, x_.data(), n * sizeof(double));
+        writeSection(header.y_offset, y_.data(), n * sizeof(double));
+        writeSection(header.z_offset, z_.data(), n * sizeof(double));
+        writeSection(header.element_ids_offset, element_ids_.data(), ne * sizeof(int32_t));
+        writeSection(header.element_types_offset, element_types_.data(), ne * sizeof(uint8_t));
+        writeSection(header.element_materials_offset, element_materials_.data(), ne * sizeof(int32_t));
+        writeSection(header.elem_offsets_offset, elem_offsets.data(), (ne + 1) * sizeof(int64_t));
+        writeSection(header.connectivity_offset, connectivity_.data(), connectivity_.size() * sizeof(int32_t));
+        if (!out) {
+            std::cerr << "Error: Failed writing binary mesh " << tmp_filename << std::endl;
+            std::remove(tmp_filename.c_str());
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp_filename, filename, ec);
+    if (ec) {
+        std::cerr << "Error: Could not move " << tmp_filename << " to " << filename << std::endl;
+        std::remove(tmp_filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool Mesh::loadBinary(const std::string& filename) {
+    FEM_PROFILE_SCOPE("mesh.load_binary");
+    last_error_.clear();
+    auto mapping = std::make_shared<MappedFile>();
+    MappedFile& file = *mapping;
+    BinaryMeshHeader header;
+    std::string why = "could not open file";
+    if (!file.open(filename) || !validateBinaryMeshHeader(file, header, why)) {
+        last_error_ = filename + ": " + why;
+        std::cerr << "Error: " << last_error_ << std::endl;
+        return false;
+    }
+
+    const char* base = file.data();
+    uint64_t n = header.num_nodes;
+    uint64_t ne = header.num_elements;
+    const int64_t* elem_offsets = reinterpret_cast<const int64_t*>(base + header.elem_offsets_offset);
+    const int32_t* connectivity = reinterpret_cast<const int32_t*>(base + header.connectivity_offset);
+    const uint8_t* element_types = reinterpret_cast<const uint8_t*>(base + header.element_types_offset);
+
+    // Validate the indirections before trusting them
+    bool ok = elem_offsets[0] == 0 && static_cast<uint64_t>(elem_offsets[ne]) == header.connectivity_size;
+    for (uint64_t e = 0; ok && e < ne; ++e) {
+        // The kernels read as many nodes as the type says, so it must match the record
+        ok = elem_offsets[e] <= elem_offsets[e + 1] &&
+             elementTypeFromNodeCount(static_cast<size_t>(elem_offsets[e + 1] - elem_offsets[e])) ==
+                 static_cast<ElementType>(element_types[e]) &&
+             element_types[e] != static_cast<uint8_t>(ElementType::Unknown);
+    }
+    for (uint64_t k = 0; ok && k < header.connectivity_size; ++k) {
+        ok = connectivity[k] >= 0 && static_cast<uint64_t>(connectivity[k]) < n;
+    }
+    if (!ok) {
+        last_error_ = filename + ": corrupt element connectivity";
+        std::cerr << "Error: " << last_error_ << std::endl;
+        return false;
+    }
+
+    // Every section becomes a view of the mapped bytes. The offsets are
+    // int64 on disk and the types uint8, the same sizes as in memory; both
+    // were range-checked above.
+    static_assert(sizeof(size_t) == sizeof(int64_t), "element offsets are viewed in place");
+    clear();
+    node_ids_.setView(reinterpret_cast<const int*>(base + header.node_ids_offset), n);
+    x_.setView(reinterpret_cast<const double*>(base + header.x_offset), n);
+    y_.setView(reinterpret_cast<const double*>(base + header.y_offset), n);
+    z_.setView(reinterpret_cast<const double*>(base + header.z_offset), n);
+    element_ids_.setView(reinterpret_cast<const int*>(base + header.element_ids_offset), ne);
+    element_types_.setView(reinterpret_cast<const ElementType*>(base + header.element_types_offset), ne);
+    element_materials_.setView(reinterpret_cast<const int*>(base + header.element_materials_offset), ne);
+    element_offsets_.setView(reinterpret_cast<const size_t*>(base + header.elem_offsets_offset), ne + 1);
+    connectivity_.setView(reinterpret_cast<const int*>(base + header.connectivity_offset), header.connectivity_size);
+    mapping_ = std::move(mapping);
+
+    if (!rebuildNodeIndex()) {
+        last_error_ = filename + ": " + last_error_;
+        std::cerr << "Error: " << last_error_ << std::endl;
+        clear();
+        return false;
+    }
+    invalidateViews();
+    FEM_PROFILE_COUNTER("mesh.nodes", n);
+    FEM_PROFILE_COUNTER("mesh.elements", ne);
+    return true;
+}
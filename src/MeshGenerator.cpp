@@ -0,0 +1,46 @@
+#include "MeshGenerator.h"
+#include <limits>
+#include <stdexcept>
+
+Mesh generateBoxMesh(int nx, int ny, int nz, double spacing) {
+    if (nx < 1 || ny < 1 || nz < 1) {
+        throw std::invalid_argument("generateBoxMesh: cell counts must be positive");
+    }
+    size_t num_nodes = static_cast<size_t>(nx + 1) * (ny + 1) * (nz + 1);
+    size_t num_elements = 6 * static_cast<size_t>(nx) * ny * nz;
+    if (num_nodes > static_cast<size_t>(std::numeric_limits<int>::max())) {
+        throw std::invalid_argument("generateBoxMesh: too many nodes for int node IDs");
+    }
+
+    Mesh mesh;
+    mesh.reserve(num_nodes, num_elements, 4 * num_elements);
+    auto id = [&](int i, int j, int k) { return 1 + i + (nx + 1) * (j + (ny + 1) * k); };
+    for (int k = 0; k <= nz; ++k)
+        for (int j = 0; j <= ny; ++j)
+            for (int i = 0; i <= nx; ++i)
+                mesh.addNode(id(i, j, k), i * spacing, j * spacing, k * spacing);
+
+    std::vector<int> tet(4);
+    auto add = [&](int a, int b, int c, int d) {
+        tet[0] = a;
+        tet[1] = b;
+        tet[2] = c;
+        tet[3] = d;
+        mesh.addElement(tet);
+    };
+    for (int k = 0; k < nz; ++k) {
+        for (int j = 0; j < ny; ++j) {
+            for (int i = 0; i < nx; ++i) {
+                int c[8] = {id(i, j, k),     id(i + 1, j, k),     id(i + 1, j + 1, k),     id(i, j + 1, k),
+                            id(i, j, k + 1), id(i + 1, j, k + 1), id(i + 1, j + 1, k + 1), id(i, j + 1, k + 1)};
+                add(c[0], c[1], c[2], c[6]);
+                add(c[0], c[2], c[3], c[6]);
+                add(c[0], c[3], c[7], c[6]);
+                add(c[0], c[7], c[4], c[6]);
+                add(c[0], c[4], c[5], c[6]);
+                add(c[0], c[5], c[1], c[6]);
+            }
+        }
+    }
+    return mesh;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "Mesh.h"
+
+// Structured box of nx x ny x nz cubic cells with edge length `spacing`,
+// corner at the origin. Each cell is split into 6 tetrahedra around its
+// (0,0,0)-(1,1,1) diagonal, so neighbouring cells share faces conformingly.
+//
+// Node (i, j, k) has ID 1 + i + (nx+1) * (j + (ny+1) * k) and sits at that
+// storage index; the mesh has 6 * nx * ny * nz Tet4 elements.
+Mesh generateBoxMesh(int nx, int ny, int nz, double spacing = 1.0);
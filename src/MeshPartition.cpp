@@ -0,0 +1,101 @@
+#include "MeshPartition.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+
+// Assigns parts first_part .. first_part + num_parts - 1 to nodes[begin, end)
+void bisect(const Mesh& mesh, std::vector<int>& nodes, size_t begin, size_t end, int first_part, int num_parts,
+            std::vector<int>& node_part) {
+    if (num_parts == 1 || end - begin <= 1) {
+        for (size_t k = begin; k < end; ++k) {
+            node_part[nodes[k]] = first_part;
+        }
+        return;
+    }
+
+    // 1. Longest side of the bounding box
+    const MeshArray<double>* coords[3] = {&mesh.getX(), &mesh.getY(), &mesh.getZ()};
+    int axis = 0;
+    double longest = -1.0;
+    for (int d = 0; d < 3; ++d) {
+        const MeshArray<double>& c = *coords[d];
+        auto range = std::minmax_element(nodes.begin() + begin, nodes.begin() + end,
+                                         [&](int a, int b) { return c[a] < c[b]; });
+        double extent = c[*range.second] - c[*range.first];
+        if (extent > longest) {
+            longest = extent;
+            axis = d;
+        }
+    }
+
+    // 2. Split at the node count proportional to the parts on each side;
+    //    ties on the coordinate are broken by index, so the result is deterministic
+    int left_parts = num_parts / 2;
+    size_t split = begin + (end - begin) * left_parts / num_parts;
+    const MeshArray<double>& c = *coords[axis];
+    std::nth_element(nodes.begin() + begin, nodes.begin() + split, nodes.begin() + end,
+                     [&](int a, int b) { return c[a] < c[b] || (c[a] == c[b] && a < b); });
+
+    bisect(mesh, nodes, begin, split, first_part, left_parts, node_part);
+    bisect(mesh, nodes, split, end, first_part + left_parts, num_parts - left_parts, node_part);
+}
+
+} // namespace
+
+std::vector<size_t> MeshPartition::partSizes() const {
+    std::vector<size_t> sizes(num_parts, 0);
+    for (int part : node_part) {
+        ++sizes[part];
+    }
+    return sizes;
+}
+
+MeshPartition partitionMeshRCB(const Mesh& mesh, int num_parts) {
+    FEM_PROFILE_SCOPE("partition");
+    if (num_parts < 1) {
+        throw std::invalid_argument("partitionMeshRCB: need at least one part");
+    }
+    MeshPartition partition;
+    partition.num_parts = num_parts;
+    partition.node_part.assign(mesh.getNumNodes(), 0);
+    std::vector<int> nodes(mesh.getNumNodes());
+    std::iota(nodes.begin(), nodes.end(), 0);
+    bisect(mesh, nodes, 0, nodes.size(), 0, num_parts, partition.node_part);
+
+    partition.element_part.resize(mesh.getNumElements());
+    std::vector<int> votes(num_parts, 0);
+    for (size_t e = 0; e < mesh.getNumElements(); ++e) {
+        const int* element_nodes = mesh.getElementNodes(e);
+        size_t count = mesh.getElementNumNodes(e);
+        int best = 0;
+        for (size_t i = 0; i < count; ++i) {
+            ++votes[partition.node_part[element_nodes[i]]];
+        }
+        for (size_t i = 0; i < count; ++i) {
+            int part = partition.node_part[element_nodes[i]];
+            if (votes[part] > votes[best] || (votes[part] == votes[best] && part < best)) {
+                best = part;
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            votes[partition.node_part[element_nodes[i]]] = 0;
+        }
+        partition.element_part[e] = best;
+    }
+    FEM_PROFILE_COUNTER("partition.parts", num_parts);
+    return partition;
+}
+
+std::vector<int> partitionFreeDofs(const MeshPartition& partition, const BoundaryConditions& bcs) {
+    std::vector<int> dof_part(bcs.getNumFreeDofs());
+    for (size_t dof = 0; dof < bcs.getNumDofs(); ++dof) {
+        int reduced = bcs.getReducedIndex(dof);
+        if (reduced >= 0) {
+            dof_part[reduced] = partition.node_part[dof / 3];
+        }
+    }
+    return dof_part;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "BoundaryConditions.h"
+#include "Mesh.h"
+#include <vector>
+
+// Split of a mesh into subdomains for domain decomposition. Every node and
+// every element belongs to exactly one part.
+struct MeshPartition {
+    int num_parts = 0;
+    std::vector<int> node_part;    // Part of each node, by node index
+    std::vector<int> element_part; // Part owning most of an element's nodes (lowest part on a tie)
+
+    // Nodes per part
+    std::vector<size_t> partSizes() const;
+};
+
+// Recursive coordinate bisection: the nodes are split at the median of the
+// longest side of their bounding box, then each half again, until there are
+// num_parts parts. Parts differ in size by at most one node, and a part count
+// that is not a power of two is split in proportion. Throws
+// std::invalid_argument if num_parts < 1.
+MeshPartition partitionMeshRCB(const Mesh& mesh, int num_parts);
+
+// Part of every free DOF of bcs (3 per node, in reduced numbering), for
+// SchwarzPreconditioner::setSubdomains on the reduced system
+std::vector<int> partitionFreeDofs(const MeshPartition& partition, const BoundaryConditions& bcs);
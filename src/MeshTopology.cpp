@@ -0,0 +1,47 @@
+#include "MeshTopology.h"
+#include <algorithm>
+
+NodeElementIncidence buildNodeElementIncidence(const Mesh& mesh) {
+    size_t num_nodes = mesh.getNumNodes();
+    size_t num_elements = mesh.getNumElements();
+    const auto& offsets = mesh.getElementOffsets();
+    const auto& connectivity = mesh.getConnectivity();
+
+    NodeElementIncidence incidence;
+    incidence.offsets.assign(num_nodes + 1, 0);
+    for (int node : connectivity) {
+        ++incidence.offsets[node + 1];
+    }
+    for (size_t n = 0; n < num_nodes; ++n) {
+        incidence.offsets[n + 1] += incidence.offsets[n];
+    }
+    incidence.elements.resize(incidence.offsets.back());
+    std::vector<size_t> fill(incidence.offsets.begin(), incidence.offsets.end() - 1);
+    for (size_t e = 0; e < num_elements; ++e) {
+        for (size_t k = offsets[e]; k < offsets[e + 1]; ++k) {
+            incidence.elements[fill[connectivity[k]]++] = e;
+        }
+    }
+    return incidence;
+}
+
+NodeAdjacency buildNodeAdjacency(const Mesh& mesh, const NodeElementIncidence& incidence) {
+    size_t num_nodes = mesh.getNumNodes();
+    NodeAdjacency adjacency;
+    adjacency.offsets.assign(num_nodes + 1, 0);
+
+    std::vector<int> scratch;
+    for (size_t n = 0; n < num_nodes; ++n) {
+        scratch.clear();
+        for (size_t k = incidence.offsets[n]; k < incidence.offsets[n + 1]; ++k) {
+            size_t e = incidence.elements[k];
+            const int* nodes = mesh.getElementNodes(e);
+            scratch.insert(scratch.end(), nodes, nodes + mesh.getElementNumNodes(e));
+        }
+        std::sort(scratch.begin(), scratch.end());
+        scratch.erase(std::unique(scratch.begin(), scratch.end()), scratch.end());
+        adjacency.neighbours.insert(adjacency.neighbours.end(), scratch.begin(), scratch.end());
+        adjacency.offsets[n + 1] = adjacency.neighbours.size();
+    }
+    return adjacency;
+}
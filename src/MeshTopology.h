@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Mesh.h"
+#include <vector>
+
+// Elements touching each node, in CSR form: node n is used by elements
+// elements[offsets[n] .. offsets[n+1]), in ascending element order.
+struct NodeElementIncidence {
+    std::vector<size_t> offsets;
+    std::vector<size_t> elements;
+};
+
+// Nodes sharing an element with each node (including the node itself), in
+// CSR form with every list sorted ascending. Nodes used by no element have
+// an empty list.
+struct NodeAdjacency {
+    std::vector<size_t> offsets;
+    std::vector<int> neighbours;
+};
+
+NodeElementIncidence buildNodeElementIncidence(const Mesh& mesh);
+NodeAdjacency buildNodeAdjacency(const Mesh& mesh, const NodeElementIncidence& incidence);
@@ -0,0 +1,257 @@
+#include "ModalSolver.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr double kTwoPi = 6.283185307179586;
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Makes room for at least `cols` basis vectors, growing geometrically; only
+// the leading columns in use are ever read
+void growBasis(Eigen::MatrixXd& basis, Eigen::Index cols) {
+    if (basis.cols() < cols) {
+        basis.conservativeResize(Eigen::NoChange, std::max(cols, 2 * basis.cols()));
+    }
+}
+
+// Grows the projected operator to size x size with zeros in the new entries
+void growProjection(Eigen::MatrixXd& H, Eigen::Index size) {
+    Eigen::Index old = H.rows();
+    H.conservativeResize(size, size);
+    H.bottomRows(size - old).setZero();
+    H.rightCols(size - old).setZero();
+}
+
+// W -= V (MV^T W) over the first k basis vectors, in two passes so the result
+// is M-orthogonal to working precision; returns the summed coefficients
+Eigen::MatrixXd orthogonalize(const Eigen::MatrixXd& V, const Eigen::MatrixXd& MV, Eigen::Index k,
+                              Eigen::MatrixXd& W) {
+    Eigen::MatrixXd C = Eigen::MatrixXd::Zero(k, W.cols());
+    for (int pass = 0; pass < 2 && k > 0; ++pass) {
+        Eigen::MatrixXd c = MV.leftCols(k).transpose() * W;
+        W.noalias() -= V.leftCols(k) * c;
+        C += c;
+    }
+    return C;
+}
+
+// M-orthonormalizes the columns of W by Cholesky QR, repeated once for
+// accuracy: W_in = W_out R with R upper triangular, and MW = M W_out. False
+// if the block is rank deficient, i.e. a column's new direction is at most
+// `floor` in the M-norm.
+bool orthonormalize(const Eigen::SparseMatrix<double>& M, Eigen::MatrixXd& W, Eigen::MatrixXd& MW,
+                    Eigen::MatrixXd& R, double floor) {
+    MW = M * W;
+    R = Eigen::MatrixXd::Identity(W.cols(), W.cols());
+    for (int pass = 0; pass < 2; ++pass) {
+        Eigen::MatrixXd G = W.transpose() * MW;
+        Eigen::LLT<Eigen::MatrixXd> llt(0.5 * (G + G.transpose()));
+        if (llt.info() != Eigen::Success) {
+            return false;
+        }
+        Eigen::MatrixXd U = llt.matrixU();
+        if (pass == 0 && U.diagonal().minCoeff() <= floor) {
+            return false;
+        }
+        U.triangularView<Eigen::Upper>().solveInPlace<Eigen::OnTheRight>(W);
+        U.triangularView<Eigen::Upper>().solveInPlace<Eigen::OnTheRight>(MW);
+        R = U * R;
+    }
+    return true;
+}
+
+} // namespace
+
+ModalSolver::ModalSolver(SolverType type)
+    : solver_(type), shift_(0.0), tolerance_(1e-8), block_size_(3), max_basis_(0) {}
+
+void ModalSolver::setShift(double shift) {
+    shift_ = shift;
+}
+
+void ModalSolver::setTolerance(double tolerance) {
+    tolerance_ = tolerance;
+}
+
+void ModalSolver::setBlockSize(int block_size) {
+    if (block_size < 1) {
+        throw std::invalid_argument("ModalSolver::setBlockSize: the block size must be at least 1.");
+    }
+    block_size_ = block_size;
+}
+
+void ModalSolver::setMaxBasisSize(int max_basis) {
+    max_basis_ = max_basis;
+}
+
+bool ModalSolver::compute(const Eigen::SparseMatrix<double>& K, const Eigen::SparseMatrix<double>& M,
+                          int num_modes, ModalResults& results) {
+    FEM_PROFILE_SCOPE("modal");
+    const Eigen::Index n = K.rows();
+    if (K.cols() != n || M.rows() != n || M.cols() != n) {
+        throw std::invalid_argument("ModalSolver::compute: K and M must be square and of the same size.");
+    }
+    if (num_modes < 1 || num_modes > n) {
+        throw std::invalid_argument("ModalSolver::compute: asked for " + std::to_string(num_modes) +
+                                    " modes of a system with " + std::to_string(n) + " rows.");
+    }
+    stats_ = ModalStats();
+    const Eigen::Index b = std::min<Eigen::Index>(block_size_, n);
+    const Eigen::Index limit = max_basis_ > 0 ? std::min<Eigen::Index>(max_basis_, n) : n;
+
+    // 1. One factorization of K - sigma M for every step
+    auto start = std::chrono::steady_clock::now();
+    shifted_ = K - shift_ * M;
+    if (!solver_.compute(shifted_)) {
+        std::cerr << "Error: ModalSolver: K - sigma M could not be factorized (sigma = " << shift_
+                  << "); a singular K needs a negative shift." << std::endl;
+        return false;
+    }
+    stats_.factorize_seconds = secondsSince(start);
+    start = std::chrono::steady_clock::now();
+
+    // 2. Random start block; a fixed seed keeps runs reproducible
+    std::mt19937 rng(5489u);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    Eigen::MatrixXd V(n, 0), MV(n, 0), H(0, 0);
+    auto random_block = [&](Eigen::Index k, Eigen::Index width) {
+        Eigen::MatrixXd W = Eigen::MatrixXd::NullaryExpr(n, width, [&]() { return uniform(rng); });
+        orthogonalize(V, MV, k, W);
+        return W;
+    };
+    Eigen::Index width = std::min(b, limit); // Of the newest block; the last one may be narrower
+    Eigen::MatrixXd W = random_block(0, width), MW, R;
+    if (!orthonormalize(M, W, MW, R, 0.0)) {
+        std::cerr << "Error: ModalSolver: the mass matrix is not positive definite; check that every material"
+                  << " has a positive density." << std::endl;
+        return false;
+    }
+    growBasis(V, width);
+    growBasis(MV, width);
+    V.leftCols(width) = W;
+    MV.leftCols(width) = MW;
+    growProjection(H, width);
+    Eigen::Index k = width;
+    Eigen::Index block = 0; // First column of the newest block
+
+    // 3. Block Lanczos on (K - sigma M)^-1 M in the M inner product. H is the
+    //    projection of the operator on the basis, block tridiagonal up to
+    //    rounding; its eigenpairs (theta, s) give lambda = sigma + 1 / theta.
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> ritz;
+    std::vector<Eigen::Index> wanted;
+    double scale = 0.0;
+    while (true) {
+        FEM_PROFILE_SCOPE("modal.lanczos");
+        if (!solver_.solve(Eigen::MatrixXd(MV.middleCols(block, width)), W)) {
+            std::cerr << "Error: ModalSolver: solve with K - sigma M failed." << std::endl;
+            return false;
+        }
+        ++stats_.lanczos_steps;
+        Eigen::MatrixXd C = orthogonalize(V, MV, k, W);
+        H.block(0, block, k, width) = C;
+        scale = std::max(scale, C.cwiseAbs().maxCoeff());
+
+        Eigen::MatrixXd T = H.topLeftCorner(k, k);
+        ritz.compute(0.5 * (T + T.transpose()));
+        const Eigen::VectorXd& theta = ritz.eigenvalues();
+        wanted.resize(k);
+        std::iota(wanted.begin(), wanted.end(), 0);
+        std::sort(wanted.begin(), wanted.end(),
+                  [&](Eigen::Index a, Eigen::Index c) { return std::abs(theta(a)) > std::abs(theta(c)); });
+
+        // The residual of a Ritz pair is || R s_last || with s_last the rows
+        // of s in the newest block; zero once the basis is invariant. Near the
+        // basis limit only the first `next` columns of W fit, so the residual
+        // comes from the Gram matrix G = R^T R of all of W instead, and the
+        // coupling to the kept columns is R for them plus their overlap with
+        // the rest.
+        Eigen::Index next = std::min(b, limit - k);
+        Eigen::MatrixXd G;
+        bool breakdown = false;
+        if (next < width) {
+            Eigen::MatrixXd W_rest = W.rightCols(width - next);
+            G = W.transpose() * (M * W);
+            W.conservativeResize(Eigen::NoChange, next);
+            breakdown = next > 0 && !orthonormalize(M, W, MW, R, 1e-10 * scale);
+            if (next > 0 && !breakdown) {
+                R.conservativeResize(Eigen::NoChange, width);
+                R.rightCols(width - next) = MW.transpose() * W_rest;
+            }
+        } else {
+            breakdown = !orthonormalize(M, W, MW, R, 1e-10 * scale);
+        }
+        int converged = 0;
+        for (int i = 0; i < num_modes && i < k; ++i) {
+            Eigen::Index j = wanted[i];
+            auto s_last = ritz.eigenvectors().block(k - width, j, width, 1);
+            double residual = breakdown      ? 0.0
+                              : next < width ? std::sqrt(std::max((s_last.transpose() * G * s_last)(0, 0), 0.0))
+                                             : (R * s_last).norm();
+            converged += residual <= tolerance_ * std::abs(theta(j));
+        }
+        if (k >= num_modes && ((!breakdown && converged == num_modes) || k == n)) {
+            break;
+        }
+        if (k >= limit) {
+            std::cerr << "Error: ModalSolver: only " << converged << " of " << num_modes << " modes converged in "
+                      << k << " Lanczos vectors." << std::endl;
+            return false;
+        }
+
+        // 4. Append the next block; after a breakdown restart from a fresh
+        //    random block, uncoupled from the invariant subspace found so far
+        if (breakdown) {
+            W = random_block(k, next);
+            if (!orthonormalize(M, W, MW, R, 0.0)) {
+                std::cerr << "Error: ModalSolver: Lanczos restart failed after " << k << " vectors." << std::endl;
+                return false;
+            }
+            R = Eigen::MatrixXd::Zero(next, width);
+        }
+        growBasis(V, k + next);
+        growBasis(MV, k + next);
+        V.middleCols(k, next) = W;
+        MV.middleCols(k, next) = MW;
+        growProjection(H, k + next);
+        H.block(k, block, next, width) = R;
+        block = k;
+        width = next;
+        k += next;
+    }
+    stats_.basis_size = static_cast<int>(k);
+
+    // 5. Ritz vectors of the wanted values, by ascending eigenvalue
+    const Eigen::VectorXd& theta = ritz.eigenvalues();
+    std::sort(wanted.begin(), wanted.begin() + num_modes,
+              [&](Eigen::Index a, Eigen::Index c) { return 1.0 / theta(a) < 1.0 / theta(c); });
+    results.eigenvalues.resize(num_modes);
+    results.frequencies.resize(num_modes);
+    results.modes.resize(n, num_modes);
+    for (int i = 0; i < num_modes; ++i) {
+        Eigen::Index j = wanted[i];
+        double lambda = shift_ + 1.0 / theta(j);
+        results.eigenvalues(i) = lambda;
+        results.frequencies(i) = std::sqrt(std::max(lambda, 0.0)) / kTwoPi;
+        results.modes.col(i) = V.leftCols(k) * ritz.eigenvectors().col(j);
+
+        Eigen::VectorXd K_phi = K * results.modes.col(i);
+        Eigen::VectorXd residual = K_phi - lambda * (M * results.modes.col(i));
+        double norm = K_phi.norm();
+        stats_.residual = std::max(stats_.residual, norm > 0.0 ? residual.norm() / norm : residual.norm());
+    }
+    stats_.iterate_seconds = secondsSince(start);
+    FEM_PROFILE_COUNTER("modal.lanczos_steps", stats_.lanczos_steps);
+    return true;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "LinearSolver.h"
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+
+struct ModalResults {
+    Eigen::VectorXd eigenvalues; // omega^2, ascending
+    Eigen::VectorXd frequencies; // omega / 2 pi, in Hz
+    Eigen::MatrixXd modes;       // One column per eigenvalue, mass-normalized: phi^T M phi = 1
+};
+
+struct ModalStats {
+    int lanczos_steps = 0;          // Block steps, one block solve each
+    int basis_size = 0;             // Lanczos vectors at the end
+    double residual = 0.0;          // Worst ||K phi - omega^2 M phi|| / ||K phi|| of the returned modes
+    double factorize_seconds = 0.0; // K - sigma M, analysis included
+    double iterate_seconds = 0.0;   // Lanczos steps and Ritz extraction
+};
+
+// Lowest natural modes of K phi = omega^2 M phi by shift-invert block
+// Lanczos. K - sigma M is factorized once; every Lanczos step is one block
+// solve with that factor and one product with M, and the basis is kept
+// M-orthonormal by full reorthogonalization. The block size bounds the
+// multiplicity of eigenvalues that are reliably resolved (symmetric parts
+// have pairs of equal bending frequencies; a single vector would find only
+// one of them). Eigenvalues near the shift converge first, so with a
+// shift at or below the lowest eigenvalue the first modes found are the
+// lowest ones. An unconstrained model (six rigid-body modes at zero) needs a
+// negative shift so that K - sigma M is nonsingular.
+//
+// K and M must be symmetric with the same dimensions (e.g. both reduced by
+// BoundaryConditions) and M positive definite.
+class ModalSolver {
+public:
+    explicit ModalSolver(SolverType type = SolverType::LDLT);
+
+    // Solver for K - sigma M; a CG type needs a tight tolerance
+    LinearSolver& solver() { return solver_; }
+
+    void setShift(double shift);         // sigma, default 0
+    void setTolerance(double tolerance); // Ritz residual relative to the Ritz value, default 1e-8
+    void setBlockSize(int block_size);   // Default 3
+    void setMaxBasisSize(int max_basis); // Lanczos vectors, default 0 = the matrix size
+
+    // Returns false and prints the reason if the factorization fails, M is
+    // not positive definite or fewer than num_modes converge within the
+    // basis limit. Throws std::invalid_argument for num_modes < 1 or more
+    // modes than rows.
+    bool compute(const Eigen::SparseMatrix<double>& K, const Eigen::SparseMatrix<double>& M, int num_modes,
+                 ModalResults& results);
+
+    const ModalStats& getStats() const { return stats_; }
+
+private:
+    LinearSolver solver_;
+    double shift_;
+    double tolerance_;
+    int block_size_;
+    int max_basis_;
+    Eigen::SparseMatrix<double> shifted_; // K - sigma M, kept alive for solver_
+    ModalStats stats_;
+};
@@ -0,0 +1,252 @@
+#include "NodeOrdering.h"
+#include <Eigen/OrderingMethods>
+#include <Eigen/SparseCore>
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+const struct {
+    NodeOrdering ordering;
+    const char* name;
+} kOrderingNames[] = {
+    {NodeOrdering::Natural, "natural"},
+    {NodeOrdering::RCM, "rcm"},
+    {NodeOrdering::AMD, "amd"},
+};
+
+size_t degree(const NodeAdjacency& adjacency, int node) {
+    return adjacency.offsets[node + 1] - adjacency.offsets[node];
+}
+
+// Breadth-first search from root over nodes not yet numbered, appending the
+// visited nodes to order; each level's nodes are taken in ascending degree.
+// Returns the number of levels, with the last level starting at *last_level.
+int breadthFirst(const NodeAdjacency& adjacency, int root, std::vector<int>& stamp, int tag, std::vector<int>& order,
+                 size_t* last_level) {
+    size_t begin = order.size();
+    order.push_back(root);
+    stamp[root] = tag;
+    int levels = 0;
+    size_t level_begin = begin;
+    std::vector<int> next;
+    while (level_begin < order.size()) {
+        size_t level_end = order.size();
+        *last_level = level_begin;
+        ++levels;
+        for (size_t k = level_begin; k < level_end; ++k) {
+            int node = order[k];
+            next.clear();
+            for (size_t a = adjacency.offsets[node]; a < adjacency.offsets[node + 1]; ++a) {
+                int neighbour = adjacency.neighbours[a];
+                if (stamp[neighbour] != tag && stamp[neighbour] != -2) {
+                    stamp[neighbour] = tag;
+                    next.push_back(neighbour);
+                }
+            }
+            std::stable_sort(next.begin(), next.end(), [&](int a, int b) {
+                return degree(adjacency, a) < degree(adjacency, b);
+            });
+            order.insert(order.end(), next.begin(), next.end());
+        }
+        level_begin = level_end;
+    }
+    return levels;
+}
+
+// Reverse Cuthill-McKee, one connected component at a time, each started
+// from a pseudo-peripheral node (George & Liu)
+std::vector<int> reverseCuthillMcKee(const NodeAdjacency& adjacency) {
+    int n = static_cast<int>(adjacency.offsets.size()) - 1;
+    std::vector<int> new_to_old;
+    new_to_old.reserve(n);
+    std::vector<int> stamp(n, -1); // -2 marks numbered nodes
+    std::vector<int> trial;
+    int tag = 0;
+
+    for (int seed = 0; seed < n; ++seed) {
+        if (stamp[seed] == -2 || degree(adjacency, seed) == 0) {
+            continue;
+        }
+        // 1. Walk to a pseudo-peripheral node: restart from a minimum-degree
+        //    node of the deepest level while the depth keeps growing
+        int root = seed;
+        size_t last_level = 0;
+        trial.clear();
+        int depth = breadthFirst(adjacency, root, stamp, tag++, trial, &last_level);
+        for (;;) {
+            int candidate = trial[last_level];
+            for (size_t k = last_level; k < trial.size(); ++k) {
+                if (degree(adjacency, trial[k]) < degree(adjacency, candidate)) {
+                    candidate = trial[k];
+                }
+            }
+            std::vector<int> attempt;
+            size_t attempt_last = 0;
+            int attempt_depth = breadthFirst(adjacency, candidate, stamp, tag++, attempt, &attempt_last);
+            if (attempt_depth <= depth) {
+                break;
+            }
+            root = candidate;
+            depth = attempt_depth;
+            trial.swap(attempt);
+            last_level = attempt_last;
+        }
+
+        // 2. The last search from root is the Cuthill-McKee order of the component
+        trial.clear();
+        breadthFirst(adjacency, root, stamp, tag++, trial, &last_level);
+        for (int node : trial) {
+            stamp[node] = -2;
+        }
+        new_to_old.insert(new_to_old.end(), trial.begin(), trial.end());
+    }
+    std::reverse(new_to_old.begin(), new_to_old.end());
+    return new_to_old;
+}
+
+std::vector<int> approximateMinimumDegree(const NodeAdjacency& adjacency) {
+    int n = static_cast<int>(adjacency.offsets.size()) - 1;
+    Eigen::SparseMatrix<double, Eigen::ColMajor, int> pattern(n, n);
+    std::vector<Eigen::Triplet<double, int>> entries;
+    entries.reserve(adjacency.neighbours.size());
+    for (int node = 0; node < n; ++node) {
+        for (size_t a = adjacency.offsets[node]; a < adjacency.offsets[node + 1]; ++a) {
+            entries.emplace_back(adjacency.neighbours[a], node, 1.0);
+        }
+    }
+    pattern.setFromTriplets(entries.begin(), entries.end());
+
+    Eigen::AMDOrdering<int>::PermutationType perm;
+    Eigen::AMDOrdering<int>()(pattern, perm); // indices()[k] is the node eliminated k-th
+    std::vector<int> new_to_old;
+    new_to_old.reserve(n);
+    for (int k = 0; k < n; ++k) {
+        int node = perm.indices()[k];
+        if (degree(adjacency, node) > 0) {
+            new_to_old.push_back(node);
+        }
+    }
+    return new_to_old;
+}
+
+} // namespace
+
+bool parseNodeOrdering(const std::string& name, NodeOrdering& ordering) {
+    for (const auto& entry : kOrderingNames) {
+        if (name == entry.name) {
+            ordering = entry.ordering;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* nodeOrderingName(NodeOrdering ordering) {
+    for (const auto& entry : kOrderingNames) {
+        if (entry.ordering == ordering) {
+            return entry.name;
+        }
+    }
+    return "unknown";
+}
+
+std::vector<int> computeNodeOrdering(const NodeAdjacency& adjacency, NodeOrdering ordering) {
+    int n = static_cast<int>(adjacency.offsets.size()) - 1;
+    std::vector<int> new_to_old;
+    switch (ordering) {
+    case NodeOrdering::Natural:
+        break;
+    case NodeOrdering::RCM:
+        new_to_old = reverseCuthillMcKee(adjacency);
+        break;
+    case NodeOrdering::AMD:
+        new_to_old = approximateMinimumDegree(adjacency);
+        break;
+    }
+    // Connected nodes are numbered by now; unconnected ones follow in order
+    for (int node = 0; node < n; ++node) {
+        if (ordering == NodeOrdering::Natural || degree(adjacency, node) == 0) {
+            new_to_old.push_back(node);
+        }
+    }
+    return invertPermutation(new_to_old);
+}
+
+std::vector<int> invertPermutation(const std::vector<int>& permutation) {
+    std::vector<int> inverse(permutation.size(), -1);
+    for (size_t i = 0; i < permutation.size(); ++i) {
+        int k = permutation[i];
+        if (k < 0 || static_cast<size_t>(k) >= permutation.size() || inverse[k] != -1) {
+            throw std::invalid_argument("invertPermutation: not a permutation");
+        }
+        inverse[k] = static_cast<int>(i);
+    }
+    return inverse;
+}
+
+Eigen::VectorXd permuteNodeDofs(const Eigen::VectorXd& values, const std::vector<int>& old_to_new) {
+    if (values.size() != static_cast<Eigen::Index>(old_to_new.size() * 3)) {
+        throw std::invalid_argument("permuteNodeDofs: vector size does not match the permutation");
+    }
+    Eigen::VectorXd permuted(values.size());
+    for (size_t i = 0; i < old_to_new.size(); ++i) {
+        permuted.segment<3>(3 * old_to_new[i]) = values.segment<3>(3 * i);
+    }
+    return permuted;
+}
+
+OrderingQuality measureNodeOrdering(const NodeAdjacency& adjacency, const std::vector<int>& old_to_new) {
+    int n = static_cast<int>(adjacency.offsets.size()) - 1;
+    auto position = [&](int node) { return old_to_new.empty() ? node : old_to_new[node]; };
+    std::vector<int> new_to_old = old_to_new.empty() ? std::vector<int>() : invertPermutation(old_to_new);
+    auto original = [&](int k) { return new_to_old.empty() ? k : new_to_old[k]; };
+
+    OrderingQuality quality;
+    if (n == 0) {
+        return quality;
+    }
+
+    // 1. Elimination tree of the permuted node graph (Liu), with path
+    //    compression through ancestor; also the node bandwidth
+    std::vector<int> parent(n, -1), ancestor(n, -1);
+    size_t node_bandwidth = 0;
+    for (int k = 0; k < n; ++k) {
+        int node = original(k);
+        for (size_t a = adjacency.offsets[node]; a < adjacency.offsets[node + 1]; ++a) {
+            int j = position(adjacency.neighbours[a]);
+            if (j >= k) {
+                continue;
+            }
+            node_bandwidth = std::max(node_bandwidth, static_cast<size_t>(k - j));
+            while (ancestor[j] != -1 && ancestor[j] != k) {
+                int next = ancestor[j];
+                ancestor[j] = k;
+                j = next;
+            }
+            if (ancestor[j] == -1) {
+                ancestor[j] = k;
+                parent[j] = k;
+            }
+        }
+    }
+
+    // 2. Row k of L is the union of the etree paths from each lower neighbour
+    //    up to k; count each node on them once
+    std::vector<int> mark(n, -1);
+    size_t off_diagonal_blocks = 0;
+    for (int k = 0; k < n; ++k) {
+        mark[k] = k;
+        int node = original(k);
+        for (size_t a = adjacency.offsets[node]; a < adjacency.offsets[node + 1]; ++a) {
+            for (int j = position(adjacency.neighbours[a]); j < k && mark[j] != k; j = parent[j]) {
+                mark[j] = k;
+                ++off_diagonal_blocks;
+            }
+        }
+    }
+
+    quality.bandwidth = 3 * node_bandwidth + 2;
+    quality.factor_nonzeros = 6 * static_cast<size_t>(n) + 9 * off_diagonal_blocks;
+    return quality;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "MeshTopology.h"
+#include <Eigen/Core>
+#include <string>
+#include <vector>
+
+// Node renumbering run between loading a mesh and assembling it. The DOFs of
+// node i are 3i..3i+2, so ordering the node graph orders the stiffness matrix
+// in 3x3 blocks.
+enum class NodeOrdering {
+    Natural, // Keep the order the mesher emitted
+    RCM,     // Reverse Cuthill-McKee: small bandwidth/profile, good SpMV locality
+    AMD,     // Approximate minimum degree: small Cholesky fill
+};
+
+// Maps a command-line name (natural, rcm, amd) to an ordering
+bool parseNodeOrdering(const std::string& name, NodeOrdering& ordering);
+const char* nodeOrderingName(NodeOrdering ordering);
+
+// Permutation old_to_new (node i moves to index old_to_new[i]) for Mesh::permuteNodes.
+// Nodes used by no element keep their relative order and go last.
+std::vector<int> computeNodeOrdering(const NodeAdjacency& adjacency, NodeOrdering ordering);
+
+std::vector<int> invertPermutation(const std::vector<int>& permutation);
+
+// Moves the 3 DOFs of node i to node old_to_new[i]. Use the inverse
+// permutation to map results back to the original order.
+Eigen::VectorXd permuteNodeDofs(const Eigen::VectorXd& values, const std::vector<int>& old_to_new);
+
+// Structure of the 3-DOF stiffness matrix under a node order, assuming dense
+// 3x3 blocks: the half bandwidth, and the nonzeros of the Cholesky factor L
+// (lower triangle, diagonal included) without any further fill reduction.
+// The factor count walks the elimination tree of the node graph, so it costs
+// O(nnz(L) / 9), not a factorization.
+struct OrderingQuality {
+    size_t bandwidth = 0;
+    size_t factor_nonzeros = 0;
+};
+
+// Quality of the current node order, or of old_to_new when one is given
+OrderingQuality measureNodeOrdering(const NodeAdjacency& adjacency, const std::vector<int>& old_to_new = {});
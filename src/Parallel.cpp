@@ -0,0 +1,104 @@
+#include "Parallel.h"
+#include <exception>
+
+namespace {
+
+// Set on pool workers, so a parallel loop inside a task runs serially
+thread_local bool tls_pool_worker = false;
+
+} // namespace
+
+ThreadPool& ThreadPool::instance() {
+    static ThreadPool pool;
+    return pool;
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::run(size_t count, const std::function<void(size_t)>& task) {
+    std::unique_lock<std::mutex> busy(run_mutex_, std::try_to_lock);
+    if (count <= 1 || tls_pool_worker || !busy.owns_lock()) {
+        for (size_t t = 0; t < count; ++t) {
+            task(t);
+        }
+        return;
+    }
+
+    // 1. Publish the job; tasks are handed out through next_
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        while (workers_.size() + 1 < count) {
+            workers_.emplace_back([this]() { workerLoop(); });
+        }
+        task_ = &task;
+        count_ = count;
+        next_.store(1);
+        remaining_ = count - 1;
+        ++generation_;
+    }
+    wake_.notify_all();
+
+    // 2. Task 0 here, then help with whatever is left
+    std::exception_ptr error;
+    try {
+        task(0);
+    } catch (...) {
+        error = std::current_exception();
+    }
+    drain(task, count);
+
+    // 3. Wait until every task is done and every worker has left the job, so
+    //    none can pick up a task index of the next one
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this]() { return remaining_ == 0 && active_ == 0; });
+        task_ = nullptr;
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::drain(const std::function<void(size_t)>& task, size_t count) {
+    for (size_t t = next_.fetch_add(1); t < count; t = next_.fetch_add(1)) {
+        task(t);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--remaining_ == 0) {
+            done_.notify_all();
+        }
+    }
+}
+
+void ThreadPool::workerLoop() {
+    tls_pool_worker = true;
+    unsigned long long seen = 0;
+    while (true) {
+        const std::function<void(size_t)>* task = nullptr;
+        size_t count = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&]() { return stop_ || (generation_ != seen && task_ != nullptr); });
+            if (stop_) {
+                return;
+            }
+            seen = generation_;
+            task = task_;
+            count = count_;
+            ++active_;
+        }
+        drain(*task, count);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--active_ == 0) {
+            done_.notify_all();
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Turns a requested thread count into an actual one: 0 means "use every
+// hardware thread", anything else is taken as-is.
+inline unsigned resolveThreadCount(unsigned requested) {
+    if (requested != 0) {
+        return requested;
+    }
+    unsigned hw = std::thread::hardware_concurrency();
+    return hw == 0 ? 1 : hw;
+}
+
+// Process-wide set of worker threads, started on first use and kept until
+// exit, so parallel loops inside solver iterations or time steps cost a
+// wake-up rather than a thread creation per call.
+class ThreadPool {
+public:
+    static ThreadPool& instance();
+
+    // Calls task(0 .. count-1), task 0 on the calling thread and the others on
+    // the workers (grown to count - 1 as needed), and returns when all are
+    // done. A call made while the pool is busy, e.g. from inside a task, runs
+    // its tasks serially on the calling thread instead of waiting.
+    void run(size_t count, const std::function<void(size_t)>& task);
+
+    ~ThreadPool();
+
+private:
+    ThreadPool() = default;
+    void workerLoop();
+    void drain(const std::function<void(size_t)>& task, size_t count);
+
+    std::mutex run_mutex_; // Held for the whole of run()
+    std::mutex mutex_;     // Guards the job fields and the counters below
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    std::vector<std::thread> workers_;
+    const std::function<void(size_t)>* task_ = nullptr;
+    size_t count_ = 0;
+    std::atomic<size_t> next_{0};
+    size_t remaining_ = 0; // Tasks not finished yet
+    size_t active_ = 0;    // Workers still inside the current job
+    unsigned long long generation_ = 0;
+    bool stop_ = false;
+};
+
+// Splits [0, count) into contiguous chunks, one per thread, and calls
+// fn(begin, end, thread_index) on each. Chunk t always covers lower indices
+// than chunk t+1, so per-thread results merged in thread order come out in
+// the same order as a serial loop would produce them. The chunks run on the
+// ThreadPool, the calling thread taking chunk 0.
+template <typename Fn>
+void parallelFor(size_t count, unsigned num_threads, Fn&& fn) {
+    size_t threads = std::min<size_t>(resolveThreadCount(num_threads), count);
+    if (threads <= 1) {
+        fn(size_t(0), count, 0u);
+        return;
+    }
+
+    size_t chunk = count / threads;
+    size_t remainder = count % threads;
+    auto chunkBegin = [&](size_t t) { return t * chunk + std::min(t, remainder); };
+    ThreadPool::instance().run(threads, [&](size_t t) {
+        fn(chunkBegin(t), chunkBegin(t + 1), static_cast<unsigned>(t));
+    });
+}
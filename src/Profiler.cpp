@@ -0,0 +1,210 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Path of the scopes currently open on this thread
+thread_local std::string t_scope_path;
+
+std::string jsonString(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+// Counters are mostly integral (bytes, element updates) and soon pass 1e9,
+// so those print every digit; the rest round-trip at 17 digits. NaN and
+// infinity have no JSON form and become null.
+std::string jsonNumber(double value) {
+    if (!std::isfinite(value)) {
+        return "null";
+    }
+    if (value == std::trunc(value) && std::abs(value) < 9007199254740992.0) { // 2^53
+        return std::to_string(static_cast<int64_t>(value));
+    }
+    std::ostringstream text;
+    text << std::setprecision(17) << value;
+    return text.str();
+}
+
+// The kernel's high-water mark; it folds fresh pages in lazily, so callers
+// take the max with a current sample
+size_t reportedPeakBytes() {
+    size_t peak = 0;
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#if defined(__APPLE__)
+        peak = static_cast<size_t>(usage.ru_maxrss); // Bytes on macOS
+#else
+        peak = static_cast<size_t>(usage.ru_maxrss) * 1024; // Kilobytes on Linux
+#endif
+    }
+#endif
+    return peak;
+}
+
+} // namespace
+
+Profiler::Profiler() : enabled_(false), started_(std::chrono::steady_clock::now()) {}
+
+Profiler& Profiler::instance() {
+    static Profiler profiler;
+    return profiler;
+}
+
+void Profiler::setEnabled(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+void Profiler::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    phases_.clear();
+    counters_.clear();
+    started_ = std::chrono::steady_clock::now();
+}
+
+void Profiler::setCounter(const std::string& name, double value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    counters_[name] = value;
+}
+
+void Profiler::addCounter(const std::string& name, double value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    counters_[name] += value;
+}
+
+std::vector<Profiler::Phase> Profiler::getPhases() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return phases_;
+}
+
+std::map<std::string, double> Profiler::getCounters() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return counters_;
+}
+
+void Profiler::record(const std::string& path, double seconds, size_t rss_start, size_t rss_end, size_t peak) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Phase* phase = nullptr;
+    for (Phase& p : phases_) {
+        if (p.path == path) {
+            phase = &p;
+            break;
+        }
+    }
+    if (!phase) {
+        phases_.emplace_back();
+        phase = &phases_.back();
+        phase->path = path;
+        phase->rss_start_bytes = rss_start;
+    }
+    ++phase->calls;
+    phase->seconds += seconds;
+    phase->rss_end_bytes = rss_end;
+    phase->peak_rss_bytes = peak;
+}
+
+size_t Profiler::currentRssBytes() {
+#if defined(__linux__)
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    if (statm >> pages >> resident) {
+        return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    }
+#endif
+    return 0;
+}
+
+size_t Profiler::peakRssBytes() {
+    return std::max(reportedPeakBytes(), currentRssBytes());
+}
+
+void Profiler::writeJson(std::ostream& out) const {
+    std::vector<Phase> phases = getPhases();
+    std::map<std::string, double> counters = getCounters();
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - started_).count();
+
+    std::ostringstream json;
+    json << std::setprecision(9);
+    json << "{\n";
+    json << "  \"format\": \"fem-profile\",\n";
+    json << "  \"version\": 1,\n";
+    json << "  \"wall_seconds\": " << wall << ",\n";
+    json << "  \"peak_rss_bytes\": " << peakRssBytes() << ",\n";
+    json << "  \"phases\": [";
+    for (size_t i = 0; i < phases.size(); ++i) {
+        const Phase& p = phases[i];
+        json << (i ? ",\n" : "\n") << "    {\"path\": " << jsonString(p.path) << ", \"calls\": " << p.calls
+             << ", \"seconds\": " << p.seconds << ", \"rss_start_bytes\": " << p.rss_start_bytes
+             << ", \"rss_end_bytes\": " << p.rss_end_bytes << ", \"peak_rss_bytes\": " << p.peak_rss_bytes << "}";
+    }
+    json << (phases.empty() ? "],\n" : "\n  ],\n");
+    json << "  \"counters\": {";
+    size_t i = 0;
+    for (const auto& counter : counters) {
+        json << (i++ ? ",\n" : "\n") << "    " << jsonString(counter.first) << ": " << jsonNumber(counter.second);
+    }
+    json << (counters.empty() ? "}\n" : "\n  }\n");
+    json << "}\n";
+    out << json.str();
+}
+
+bool Profiler::writeJson(const std::string& filename) const {
+    std::ofstream out(filename);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open " << filename << " for writing" << std::endl;
+        return false;
+    }
+    writeJson(out);
+    if (!out) {
+        std::cerr << "Error: Failed writing profile " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+Profiler::Scope::Scope(const char* name)
+    : active_(Profiler::instance().isEnabled()), top_level_(t_scope_path.empty()), rss_start_(0) {
+    if (!active_) {
+        return;
+    }
+    if (!top_level_) {
+        t_scope_path += '/';
+    }
+    t_scope_path += name;
+    if (top_level_) {
+        rss_start_ = currentRssBytes();
+    }
+    start_ = std::chrono::steady_clock::now();
+}
+
+Profiler::Scope::~Scope() {
+    if (!active_) {
+        return;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    size_t rss_end = 0, peak = 0;
+    if (top_level_) {
+        rss_end = currentRssBytes();
+        peak = std::max(reportedPeakBytes(), rss_end);
+    }
+    Profiler::instance().record(t_scope_path, seconds, rss_start_, rss_end, peak);
+    size_t slash = t_scope_path.rfind('/');
+    t_scope_path.erase(slash == std::string::npos ? 0 : slash);
+}
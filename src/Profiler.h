@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Lightweight instrumentation: scoped phase timers, named counters and
+// resident-memory sampling, reported as JSON.
+//
+// Library code uses only the FEM_PROFILE_* macros. They compile to nothing
+// unless the build defines FEM_ENABLE_PROFILING=1 (CMake option of the same
+// name), and even then record only after Profiler::instance().setEnabled(true).
+//
+// Scopes nest per thread: a scope opened inside another is reported under
+// the path "outer/inner". Only a thread's top-level scopes sample memory, so
+// fine-grained nested scopes cost two clock reads. Counters are process-wide.
+class Profiler {
+public:
+    struct Phase {
+        std::string path;
+        size_t calls = 0;
+        double seconds = 0.0;
+        // Memory of top-level phases; 0 for nested ones
+        size_t rss_start_bytes = 0; // At the first entry
+        size_t rss_end_bytes = 0;   // At the last exit
+        size_t peak_rss_bytes = 0;  // Process peak at the last exit
+    };
+
+    static Profiler& instance();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+    // Drops everything recorded so far and restarts the wall clock
+    void reset();
+
+    void setCounter(const std::string& name, double value);
+    void addCounter(const std::string& name, double value);
+
+    std::vector<Phase> getPhases() const;
+    std::map<std::string, double> getCounters() const;
+
+    void writeJson(std::ostream& out) const;
+    // Returns false and prints the reason if the file cannot be written
+    bool writeJson(const std::string& filename) const;
+
+    // Memory of this process; 0 where the platform does not report it
+    static size_t currentRssBytes();
+    static size_t peakRssBytes();
+
+    // Times one phase from construction to destruction; see FEM_PROFILE_SCOPE
+    class Scope {
+    public:
+        explicit Scope(const char* name);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        bool active_;
+        bool top_level_; // Samples memory
+        size_t rss_start_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+private:
+    Profiler();
+    void record(const std::string& path, double seconds, size_t rss_start, size_t rss_end, size_t peak);
+
+    // Read by every scope on every thread, so the switch itself must not race
+    std::atomic<bool> enabled_;
+    std::chrono::steady_clock::time_point started_;
+    mutable std::mutex mutex_;
+    std::vector<Phase> phases_; // In order of first entry
+    std::map<std::string, double> counters_;
+};
+
+#if defined(FEM_ENABLE_PROFILING) && FEM_ENABLE_PROFILING
+#define FEM_PROFILE_CONCAT_(a, b) a##b
+#define FEM_PROFILE_CONCAT(a, b) FEM_PROFILE_CONCAT_(a, b)
+#define FEM_PROFILE_SCOPE(name) Profiler::Scope FEM_PROFILE_CONCAT(fem_profile_scope_, __LINE__)(name)
+#define FEM_PROFILE_COUNTER(name, value)                                                                      \
+    do {                                                                                                      \
+        if (Profiler::instance().isEnabled())                                                                 \
+            Profiler::instance().setCounter(name, static_cast<double>(value));                                \
+    } while (0)
+#define FEM_PROFILE_ADD(name, value)                                                                          \
+    do {                                                                                                      \
+        if (Profiler::instance().isEnabled())                                                                 \
+            Profiler::instance().addCounter(name, static_cast<double>(value));                                \
+    } while (0)
+#else
+#define FEM_PROFILE_SCOPE(name) ((void)0)
+#define FEM_PROFILE_COUNTER(name, value) ((void)0)
+#define FEM_PROFILE_ADD(name, value) ((void)0)
+#endif
@@ -0,0 +1,225 @@
+#include "SchwarzPreconditioner.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <algorithm>
+
+SchwarzPreconditioner::SchwarzPreconditioner()
+    : num_subdomains_(0), overlap_(1), num_threads_(0), info_(Eigen::Success) {}
+
+SchwarzPreconditioner::~SchwarzPreconditioner() = default;
+
+void SchwarzPreconditioner::setSubdomains(const std::vector<int>& row_subdomain) {
+    row_subdomain_ = row_subdomain;
+}
+
+void SchwarzPreconditioner::setNumSubdomains(int num_subdomains) {
+    num_subdomains_ = num_subdomains;
+}
+
+void SchwarzPreconditioner::setOverlap(int layers) {
+    overlap_ = std::max(layers, 0);
+}
+
+void SchwarzPreconditioner::setNumThreads(unsigned num_threads) {
+    num_threads_ = num_threads;
+}
+
+void SchwarzPreconditioner::setNearNullspace(const Eigen::MatrixXd& modes) {
+    nullspace_ = modes;
+}
+
+Eigen::Index SchwarzPreconditioner::maxSubdomainSize() const {
+    size_t largest = 0;
+    for (const auto& s : subdomains_) {
+        largest = std::max(largest, s->rows.size());
+    }
+    return static_cast<Eigen::Index>(largest);
+}
+
+void SchwarzPreconditioner::setup(const Eigen::SparseMatrix<double>& A) {
+    info_ = Eigen::Success;
+    int n = static_cast<int>(A.rows());
+    subdomains_.clear();
+    Z_.resize(0, 0);
+    if (n == 0) {
+        return;
+    }
+
+    // 1. Owner of every row: the given labels, else contiguous blocks
+    std::vector<int> owner;
+    int num_parts = 0;
+    if (row_subdomain_.size() == static_cast<size_t>(n)) {
+        owner = row_subdomain_;
+        num_parts = *std::max_element(owner.begin(), owner.end()) + 1;
+    } else {
+        num_parts = num_subdomains_ > 0 ? num_subdomains_ : static_cast<int>(resolveThreadCount(num_threads_));
+        num_parts = std::min(num_parts, n);
+        owner.resize(n);
+        for (int r = 0; r < n; ++r) {
+            owner[r] = static_cast<int>(static_cast<long long>(r) * num_parts / n);
+        }
+    }
+    std::vector<std::vector<int>> owned(num_parts);
+    for (int r = 0; r < n; ++r) {
+        owned[owner[r]].push_back(r);
+    }
+    owned.erase(std::remove_if(owned.begin(), owned.end(), [](const std::vector<int>& rows) { return rows.empty(); }),
+                owned.end());
+    num_parts = static_cast<int>(owned.size());
+    subdomains_.resize(num_parts);
+
+    // 2. Grow each subdomain by overlap_ graph layers, extract its block of
+    //    A and factorize it; every thread reuses one row -> local map
+    unsigned threads = resolveThreadCount(num_threads_);
+    std::vector<std::vector<int>> local_maps(threads);
+    std::vector<char> failed(num_parts, 0);
+    {
+        FEM_PROFILE_SCOPE("schwarz.local_factorize");
+        parallelFor(num_parts, threads, [&](size_t begin, size_t end, unsigned t) {
+            std::vector<int>& local = local_maps[t];
+            local.assign(n, -1);
+            for (size_t i = begin; i < end; ++i) {
+                std::unique_ptr<Subdomain> s(new Subdomain());
+                std::vector<int>& rows = s->rows;
+                rows = owned[i];
+                for (int r : rows) {
+                    local[r] = 0;
+                }
+                size_t frontier = 0;
+                for (int layer = 0; layer < overlap_; ++layer) {
+                    size_t layer_end = rows.size();
+                    for (size_t k = frontier; k < layer_end; ++k) {
+                        for (Eigen::SparseMatrix<double>::InnerIterator it(A, rows[k]); it; ++it) {
+                            int r = static_cast<int>(it.row());
+                            if (local[r] < 0) {
+                                local[r] = 0;
+                                rows.push_back(r);
+                            }
+                        }
+                    }
+                    frontier = layer_end;
+                }
+                std::sort(rows.begin(), rows.end());
+                for (size_t k = 0; k < rows.size(); ++k) {
+                    local[rows[k]] = static_cast<int>(k);
+                }
+
+                // Columns of A are in row order, so the local block comes out sorted too
+                Eigen::Index size = static_cast<Eigen::Index>(rows.size());
+                Eigen::SparseMatrix<double> A_local(size, size);
+                std::vector<Eigen::Triplet<double>> triplets;
+                for (Eigen::Index c = 0; c < size; ++c) {
+                    for (Eigen::SparseMatrix<double>::InnerIterator it(A, rows[c]); it; ++it) {
+                        int r = local[it.row()];
+                        if (r >= 0) {
+                            triplets.emplace_back(r, c, it.value());
+                        }
+                    }
+                }
+                A_local.setFromTriplets(triplets.begin(), triplets.end());
+                s->solver.compute(A_local);
+                failed[i] = s->solver.info() != Eigen::Success;
+
+                for (int r : rows) {
+                    local[r] = -1;
+                }
+                subdomains_[i] = std::move(s);
+            }
+        });
+    }
+    if (std::find(failed.begin(), failed.end(), 1) != failed.end()) {
+        info_ = Eigen::NumericalIssue;
+        return;
+    }
+
+    // 3. Copies of every row across the subdomains, so apply() can gather
+    //    the local solutions row by row without two threads sharing an entry
+    copy_offsets_.assign(n + 1, 0);
+    for (const auto& s : subdomains_) {
+        for (int r : s->rows) {
+            ++copy_offsets_[r + 1];
+        }
+    }
+    for (int r = 0; r < n; ++r) {
+        copy_offsets_[r + 1] += copy_offsets_[r];
+    }
+    copy_subdomain_.resize(copy_offsets_[n]);
+    copy_local_.resize(copy_offsets_[n]);
+    std::vector<int> fill(copy_offsets_.begin(), copy_offsets_.end() - 1);
+    for (int i = 0; i < num_parts; ++i) {
+        const std::vector<int>& rows = subdomains_[i]->rows;
+        for (size_t k = 0; k < rows.size(); ++k) {
+            int pos = fill[rows[k]]++;
+            copy_subdomain_[pos] = i;
+            copy_local_[pos] = static_cast<int>(k);
+        }
+    }
+
+    // 4. Coarse space: the near-nullspace modes cut to each subdomain's own
+    //    rows. The owned rows do not overlap, so the pieces sum to the modes.
+    if (nullspace_.rows() == n && nullspace_.cols() > 0) {
+        FEM_PROFILE_SCOPE("schwarz.coarse");
+        Eigen::Index m = nullspace_.cols();
+        std::vector<Eigen::Triplet<double>> triplets;
+        triplets.reserve(static_cast<size_t>(n) * m);
+        for (int i = 0; i < num_parts; ++i) {
+            for (int r : owned[i]) {
+                for (Eigen::Index k = 0; k < m; ++k) {
+                    if (nullspace_(r, k) != 0.0) {
+                        triplets.emplace_back(r, i * m + k, nullspace_(r, k));
+                    }
+                }
+            }
+        }
+        Z_.resize(n, num_parts * m);
+        Z_.setFromTriplets(triplets.begin(), triplets.end());
+        Eigen::SparseMatrix<double> AZ = A * Z_;
+        Eigen::MatrixXd A_coarse = Eigen::MatrixXd(Z_.transpose() * AZ);
+        coarse_solver_.compute(A_coarse);
+        if (coarse_solver_.info() != Eigen::Success) {
+            info_ = Eigen::NumericalIssue;
+            return;
+        }
+    }
+    FEM_PROFILE_COUNTER("solver.subdomains", num_parts);
+    FEM_PROFILE_COUNTER("solver.coarse_size", Z_.cols());
+}
+
+void SchwarzPreconditioner::apply(const Eigen::VectorXd& b, Eigen::VectorXd& x) const {
+    Eigen::Index n = b.size();
+    if (subdomains_.empty()) {
+        x = b;
+        return;
+    }
+
+    // 1. Local solves, each subdomain on its own
+    std::vector<Eigen::VectorXd> local(subdomains_.size());
+    parallelFor(subdomains_.size(), num_threads_, [&](size_t begin, size_t end, unsigned) {
+        for (size_t i = begin; i < end; ++i) {
+            const Subdomain& s = *subdomains_[i];
+            Eigen::VectorXd b_local(s.rows.size());
+            for (size_t k = 0; k < s.rows.size(); ++k) {
+                b_local(k) = b(s.rows[k]);
+            }
+            local[i] = s.solver.solve(b_local);
+        }
+    });
+
+    // 2. Sum the copies of every row
+    x.resize(n);
+    parallelFor(static_cast<size_t>(n), num_threads_, [&](size_t begin, size_t end, unsigned) {
+        for (size_t r = begin; r < end; ++r) {
+            double sum = 0.0;
+            for (int p = copy_offsets_[r]; p < copy_offsets_[r + 1]; ++p) {
+                sum += local[copy_subdomain_[p]](copy_local_[p]);
+            }
+            x(r) = sum;
+        }
+    });
+
+    // 3. Coarse correction
+    if (Z_.cols() > 0) {
+        Eigen::VectorXd coarse = Z_.transpose() * b;
+        x += Z_ * coarse_solver_.solve(coarse);
+    }
+}
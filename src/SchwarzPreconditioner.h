@@ -0,0 +1,102 @@
+#pragma once
+
+#include "SymmetricSparseOperator.h"
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+#include <memory>
+#include <vector>
+
+// Two-level overlapping additive Schwarz preconditioner, usable as
+// ConjugateGradient<SymmetricSparseOperator, Lower|Upper, SchwarzPreconditioner>
+// (or over a plain SparseMatrix<double>, at the cost of a serial product and
+// a copy of the matrix).
+//
+// The rows of A are split into subdomains, each grown by a few layers of
+// matrix-graph neighbours. Every subdomain's block of A is factorized with a
+// sparse LDLT, and apply() sums the local solutions:
+//
+//     M^-1 r = sum_i R_i^T A_i^-1 R_i r  +  Z (Z^T A Z)^-1 Z^T r
+//
+// The second term is a coarse correction over the near-nullspace modes cut
+// to each subdomain's own rows; it keeps the iteration count from growing
+// with the number of subdomains. Both the local factorizations and the local
+// solves of apply() run on num_threads threads, one subdomain at a time per
+// thread, so the work scales with the cores as long as there are at least
+// as many subdomains as threads.
+class SchwarzPreconditioner {
+public:
+    SchwarzPreconditioner();
+    ~SchwarzPreconditioner();
+    template <typename MatType>
+    explicit SchwarzPreconditioner(const MatType& A) : SchwarzPreconditioner() { compute(A); }
+
+    // Subdomain of every row, e.g. from partitionFreeDofs. Without one the
+    // rows are cut into num_subdomains contiguous blocks.
+    void setSubdomains(const std::vector<int>& row_subdomain);
+    // 0 = one subdomain per thread (the default)
+    void setNumSubdomains(int num_subdomains);
+    void setOverlap(int layers); // Graph layers added around each subdomain (default 1)
+    // 1 is serial; 0 (the default) uses every hardware thread
+    void setNumThreads(unsigned num_threads);
+    // Coarse space; without one (or with the wrong number of rows) the
+    // preconditioner is one-level
+    void setNearNullspace(const Eigen::MatrixXd& modes);
+
+    template <typename MatType>
+    SchwarzPreconditioner& analyzePattern(const MatType&) { return *this; }
+    template <typename MatType>
+    SchwarzPreconditioner& factorize(const MatType& A) { return compute(A); }
+    // The matrix itself and the threaded operator over it are read in place;
+    // other expressions are evaluated into a SparseMatrix first
+    SchwarzPreconditioner& compute(const Eigen::SparseMatrix<double>& A) {
+        setup(A);
+        return *this;
+    }
+    SchwarzPreconditioner& compute(const SymmetricSparseOperator& A) {
+        setup(A.matrix());
+        return *this;
+    }
+    template <typename MatType>
+    SchwarzPreconditioner& compute(const MatType& A) {
+        setup(Eigen::SparseMatrix<double>(A));
+        return *this;
+    }
+
+    template <typename Rhs>
+    Eigen::VectorXd solve(const Eigen::MatrixBase<Rhs>& b) const {
+        Eigen::VectorXd x;
+        apply(b.derived(), x);
+        return x;
+    }
+
+    Eigen::ComputationInfo info() const { return info_; }
+    int numSubdomains() const { return static_cast<int>(subdomains_.size()); }
+    // Rows of the largest subdomain, overlap included
+    Eigen::Index maxSubdomainSize() const;
+    Eigen::Index coarseSize() const { return Z_.cols(); }
+
+private:
+    struct Subdomain {
+        std::vector<int> rows; // Sorted global rows, overlap included
+        Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> solver;
+    };
+
+    void setup(const Eigen::SparseMatrix<double>& A);
+    void apply(const Eigen::VectorXd& b, Eigen::VectorXd& x) const;
+
+    std::vector<int> row_subdomain_;
+    int num_subdomains_;
+    int overlap_;
+    unsigned num_threads_;
+    Eigen::MatrixXd nullspace_;
+
+    std::vector<std::unique_ptr<Subdomain>> subdomains_;
+    // Rows in CSR form: the (subdomain, local row) copies of every global row
+    std::vector<int> copy_offsets_;
+    std::vector<int> copy_subdomain_;
+    std::vector<int> copy_local_;
+    Eigen::SparseMatrix<double> Z_; // Coarse basis, empty when one-level
+    Eigen::LDLT<Eigen::MatrixXd> coarse_solver_;
+    Eigen::ComputationInfo info_;
+};
@@ -0,0 +1,107 @@
+#include "SolverSession.h"
+#include <iostream>
+
+SolverSession::SolverSession(const BoundaryConditions& bcs, SolverType type)
+    : bcs_(bcs), solver_(type), pattern_hash_(0), ready_(false) {}
+
+void SolverSession::reduce(const Eigen::SparseMatrix<double>& K) {
+    // Reducing a zero load leaves exactly the lift of the prescribed values
+    Eigen::VectorXd zero = Eigen::VectorXd::Zero(K.rows());
+    bcs_.reduce(K, zero, K_ff_, lift_);
+
+    // Walk K in the order BoundaryConditions::reduce copies it, so the free
+    // entries land at consecutive positions of K_ff
+    Eigen::SparseMatrix<double> compressed;
+    const Eigen::SparseMatrix<double>* A = &K;
+    if (!K.isCompressed()) {
+        compressed = K;
+        compressed.makeCompressed();
+        A = &compressed;
+    }
+    Eigen::VectorXd prescribed = bcs_.expand(Eigen::VectorXd::Zero(bcs_.getNumFreeDofs()));
+    value_map_.assign(A->nonZeros(), -1);
+    lift_entries_.clear();
+    int pos = 0;
+    for (Eigen::Index col = 0; col < A->outerSize(); ++col) {
+        int reduced_col = bcs_.getReducedIndex(col);
+        for (int k = A->outerIndexPtr()[col]; k < A->outerIndexPtr()[col + 1]; ++k) {
+            int reduced_row = bcs_.getReducedIndex(A->innerIndexPtr()[k]);
+            if (reduced_row < 0) {
+                continue;
+            }
+            if (reduced_col >= 0) {
+                value_map_[k] = pos++;
+            } else if (prescribed(col) != 0.0) {
+                lift_entries_.push_back({k, reduced_row, prescribed(col)});
+            }
+        }
+    }
+    pattern_hash_ = sparsityPatternHash(*A);
+}
+
+void SolverSession::gatherValues(const Eigen::SparseMatrix<double>& K) {
+    const double* values = K.valuePtr();
+    double* reduced = K_ff_.valuePtr();
+    for (size_t k = 0; k < value_map_.size(); ++k) {
+        if (value_map_[k] >= 0) {
+            reduced[value_map_[k]] = values[k];
+        }
+    }
+    lift_.setZero();
+    for (const LiftEntry& entry : lift_entries_) {
+        lift_(entry.row) -= values[entry.k] * entry.u_c;
+    }
+}
+
+bool SolverSession::setup(const Eigen::SparseMatrix<double>& K) {
+    reduce(K);
+    ready_ = solver_.compute(K_ff_);
+    return ready_;
+}
+
+bool SolverSession::update(const Eigen::SparseMatrix<double>& K, bool keep_preconditioner) {
+    if (!ready_) {
+        return setup(K);
+    }
+    if (K.isCompressed() && sparsityPatternHash(K) == pattern_hash_) {
+        gatherValues(K);
+    } else {
+        reduce(K);
+    }
+    ready_ = keep_preconditioner ? solver_.updateValues(K_ff_) : solver_.refactorize(K_ff_);
+    return ready_;
+}
+
+bool SolverSession::solve(const Eigen::MatrixXd& F, Eigen::MatrixXd& U) {
+    return solveReduced(F, nullptr, U);
+}
+
+bool SolverSession::solveWithGuess(const Eigen::MatrixXd& F, const Eigen::MatrixXd& U0, Eigen::MatrixXd& U) {
+    if (U0.rows() != F.rows() || U0.cols() != F.cols()) {
+        std::cerr << "Error: SolverSession::solveWithGuess: the guess is " << U0.rows() << " x " << U0.cols()
+                  << ", the loads " << F.rows() << " x " << F.cols() << std::endl;
+        return false;
+    }
+    return solveReduced(F, &U0, U);
+}
+
+bool SolverSession::solveReduced(const Eigen::MatrixXd& F, const Eigen::MatrixXd* U0, Eigen::MatrixXd& U) {
+    if (!ready_) {
+        std::cerr << "Error: SolverSession::solve called before a successful setup." << std::endl;
+        return false;
+    }
+    if (static_cast<size_t>(F.rows()) != bcs_.getNumDofs()) {
+        std::cerr << "Error: SolverSession::solve: load block has " << F.rows() << " rows, expected "
+                  << bcs_.getNumDofs() << std::endl;
+        return false;
+    }
+    Eigen::MatrixXd F_f = bcs_.restrictRows(F);
+    F_f.colwise() += lift_;
+    Eigen::MatrixXd U_f;
+    bool ok = U0 ? solver_.solveWithGuess(F_f, bcs_.restrictRows(*U0), U_f) : solver_.solve(F_f, U_f);
+    if (!ok) {
+        return false;
+    }
+    U = bcs_.expandColumns(U_f);
+    return true;
+}
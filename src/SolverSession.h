@@ -0,0 +1,73 @@
+#pragma once
+
+#include "BoundaryConditions.h"
+#include "LinearSolver.h"
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <cstdint>
+#include <vector>
+
+// Factor once, solve many: one model and one set of constraints, any number
+// of load cases. setup() reduces K and factorizes it (or builds the CG
+// preconditioner) once; every solve() then reuses it, and update() swaps in
+// new stiffness values while keeping the symbolic analysis. setup() also
+// records where every value of K lands in K_ff, so update() gathers the new
+// values into K_ff in place instead of reducing K again.
+//
+// The prescribed displacements are lifted into a single right-hand-side
+// correction at setup, so every load case sees the same constraints.
+class SolverSession {
+public:
+    // The boundary conditions must outlive the session and stay unchanged.
+    explicit SolverSession(const BoundaryConditions& bcs, SolverType type = SolverType::LDLT);
+
+    SolverSession(const SolverSession&) = delete;
+    SolverSession& operator=(const SolverSession&) = delete;
+
+    // Tolerance, iteration limit and AMG near-nullspace are set here, before setup()
+    LinearSolver& solver() { return solver_; }
+
+    // K is only read during the call
+    bool setup(const Eigen::SparseMatrix<double>& K);
+    // Same sparsity pattern as the K given to setup(), checked by hash; a
+    // different pattern falls back to a full reduction, and the solver then
+    // reports that it cannot reuse its analysis. With
+    // keep_preconditioner, a small change of K (see IncrementalAssembler)
+    // reuses the current preconditioner where LinearSolver::updateValues can.
+    bool update(const Eigen::SparseMatrix<double>& K, bool keep_preconditioner = false);
+
+    // Full-size loads in, full-size displacements out (prescribed values
+    // filled in), one column per load case
+    bool solve(const Eigen::MatrixXd& F, Eigen::MatrixXd& U);
+    // Warm start from full-size displacements U0, e.g. the previous solution
+    bool solveWithGuess(const Eigen::MatrixXd& F, const Eigen::MatrixXd& U0, Eigen::MatrixXd& U);
+
+    bool isReady() const { return ready_; }
+    const Eigen::SparseMatrix<double>& getReducedMatrix() const { return K_ff_; }
+    const SolverStats& getStats() const { return solver_.getStats(); }
+
+private:
+    // Full reduction, which also rebuilds the value map
+    void reduce(const Eigen::SparseMatrix<double>& K);
+    // New values of K on the setup pattern, gathered through the value map
+    void gatherValues(const Eigen::SparseMatrix<double>& K);
+    bool solveReduced(const Eigen::MatrixXd& F, const Eigen::MatrixXd* U0, Eigen::MatrixXd& U);
+
+    const BoundaryConditions& bcs_;
+    LinearSolver solver_;
+    Eigen::SparseMatrix<double> K_ff_;
+    Eigen::VectorXd lift_; // -K_fc * U_c, added to every reduced load
+
+    // Position in K_ff's values of every value of K, -1 if its row or column
+    // is constrained
+    std::vector<int> value_map_;
+    // Values of K in the free rows of prescribed, nonzero columns
+    struct LiftEntry {
+        int k;          // Position in K's values
+        int row;        // Reduced row
+        double u_c;     // Prescribed value of the column
+    };
+    std::vector<LiftEntry> lift_entries_;
+    uint64_t pattern_hash_; // sparsityPatternHash of the setup K
+    bool ready_;
+};
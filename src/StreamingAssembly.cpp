@@ -0,0 +1,614 @@
+#include "StreamingAssembly.h"
+#include "Assembler.h"
+#include "BinaryMeshFormat.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <stdexcept>
+#include <system_error>
+
+namespace {
+
+const uint64_t kSectionAlignment = 64;
+
+// Smallest read buffer per run in a merge; more runs than the budget holds
+// buffers of this size are merged in several passes
+const size_t kMinMergeBuffer = size_t(16) << 10;
+// Larger buffers no longer speed up sequential I/O, they only cost setup
+const size_t kMaxIoBuffer = size_t(4) << 20;
+
+// Working set of a chunk, per entry of its element matrices: the triplet,
+// its copy inside setFromTriplets, and the chunk's compressed matrix
+const size_t kChunkBytesPerEntry = 2 * sizeof(Eigen::Triplet<double>) + sizeof(double) + sizeof(int);
+// Per chunk node: coordinates, ID and the sorted global index
+const size_t kChunkBytesPerNode = 3 * sizeof(double) + 2 * sizeof(int);
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+uint64_t alignUp(uint64_t offset) {
+    return (offset + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment;
+}
+
+// One matrix entry of a spilled run; runs are sorted by (col, row)
+struct RunEntry {
+    int32_t col;
+    int32_t row;
+    double value;
+};
+static_assert(sizeof(RunEntry) == 16, "run files are written straight from RunEntry arrays");
+
+bool operator<(const RunEntry& a, const RunEntry& b) {
+    return a.col < b.col || (a.col == b.col && a.row < b.row);
+}
+
+// Buffered binary writer of a flat array of T
+template <typename T>
+class ArrayWriter {
+public:
+    bool open(const std::string& filename, size_t buffer_bytes) {
+        filename_ = filename;
+        out_.open(filename, std::ios::binary | std::ios::trunc);
+        buffer_.clear();
+        buffer_.reserve(std::max<size_t>(std::min(buffer_bytes, kMaxIoBuffer) / sizeof(T), 1));
+        written_ = 0;
+        if (!out_.is_open()) {
+            std::cerr << "Error: Could not open " << filename << " for writing" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    void push(const T& value) {
+        buffer_.push_back(value);
+        if (buffer_.size() == buffer_.capacity()) {
+            flush();
+        }
+    }
+
+    // Flushes and closes; false if any write failed
+    bool close() {
+        flush();
+        out_.close();
+        if (!out_) {
+            std::cerr << "Error: Failed writing " << filename_ << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    uint64_t bytesWritten() const { return written_; }
+
+private:
+    void flush() {
+        out_.write(reinterpret_cast<const char*>(buffer_.data()),
+                   static_cast<std::streamsize>(buffer_.size() * sizeof(T)));
+        written_ += buffer_.size() * sizeof(T);
+        buffer_.clear();
+    }
+
+    std::string filename_;
+    std::ofstream out_;
+    std::vector<T> buffer_;
+    uint64_t written_ = 0;
+};
+
+// Buffered sequential reader of a run file
+class RunReader {
+public:
+    bool open(const std::string& filename, size_t buffer_bytes) {
+        in_.open(filename, std::ios::binary);
+        buffer_.resize(std::max<size_t>(std::min(buffer_bytes, kMaxIoBuffer) / sizeof(RunEntry), 1));
+        pos_ = count_ = 0;
+        if (!in_.is_open()) {
+            std::cerr << "Error: Could not open scratch run " << filename << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // False at the end of the run
+    bool next(RunEntry& entry) {
+        if (pos_ == count_) {
+            in_.read(reinterpret_cast<char*>(buffer_.data()),
+                     static_cast<std::streamsize>(buffer_.size() * sizeof(RunEntry)));
+            count_ = static_cast<size_t>(in_.gcount()) / sizeof(RunEntry);
+            pos_ = 0;
+            if (count_ == 0) {
+                return false;
+            }
+        }
+        entry = buffer_[pos_++];
+        return true;
+    }
+
+private:
+    std::ifstream in_;
+    std::vector<RunEntry> buffer_;
+    size_t pos_ = 0;
+    size_t count_ = 0;
+};
+
+// k-way merge of sorted runs: emit(col, row, value) once per distinct
+// position, in (col, row) order, with the values of all runs summed
+template <typename Emit>
+bool mergeGroup(const std::vector<std::string>& paths, size_t buffer_bytes, Emit&& emit) {
+    std::vector<RunReader> readers(paths.size());
+    typedef std::pair<RunEntry, size_t> HeapItem;
+    auto later = [](const HeapItem& a, const HeapItem& b) { return b.first < a.first; };
+    std::priority_queue<HeapItem, std::vector<HeapItem>, decltype(later)> heap(later);
+    for (size_t r = 0; r < paths.size(); ++r) {
+        RunEntry entry;
+        if (!readers[r].open(paths[r], buffer_bytes)) {
+            return false;
+        }
+        if (readers[r].next(entry)) {
+            heap.emplace(entry, r);
+        }
+    }
+
+    while (!heap.empty()) {
+        RunEntry current = heap.top().first;
+        current.value = 0.0;
+        while (!heap.empty() && heap.top().first.col == current.col && heap.top().first.row == current.row) {
+            HeapItem item = heap.top();
+            heap.pop();
+            current.value += item.first.value;
+            RunEntry entry;
+            if (readers[item.second].next(entry)) {
+                heap.emplace(entry, item.second);
+            }
+        }
+        emit(current);
+    }
+    return true;
+}
+
+// Appends a whole file to out in buffer-sized pieces
+bool appendFile(std::ofstream& out, const std::string& filename, std::vector<char>& buffer) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in.is_open()) {
+        std::cerr << "Error: Could not open " << filename << std::endl;
+        return false;
+    }
+    while (in) {
+        in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        out.write(buffer.data(), in.gcount());
+    }
+    return static_cast<bool>(out);
+}
+
+} // namespace
+
+// Scratch files of one assembly, removed however it ends; removing one that
+// a merge pass already deleted is harmless
+class StreamingAssembler::ScratchFiles {
+public:
+    ~ScratchFiles() {
+        for (const std::string& path : paths_) {
+            std::remove(path.c_str());
+        }
+    }
+    std::string add(const std::string& path) {
+        paths_.push_back(path);
+        return path;
+    }
+
+private:
+    std::vector<std::string> paths_;
+};
+
+// Consumer of the merged entries, in (col, row) order
+class StreamingAssembler::EntrySink {
+public:
+    virtual ~EntrySink() = default;
+    virtual bool begin(Eigen::Index size) = 0;
+    virtual void add(int col, int row, double value) = 0;
+    virtual bool finish() = 0;
+};
+
+// Fills a SparseMatrix column by column through Eigen's sorted-insertion API
+class StreamingAssembler::MemorySink : public EntrySink {
+public:
+    explicit MemorySink(Eigen::SparseMatrix<double>& K) : K_(K) {}
+
+    bool begin(Eigen::Index size) override {
+        K_.resize(size, size);
+        K_.data().squeeze();
+        started_ = 0;
+        return true;
+    }
+
+    void add(int col, int row, double value) override {
+        while (started_ <= col) {
+            K_.startVec(started_++);
+        }
+        K_.insertBack(row, col) = value;
+    }
+
+    bool finish() override {
+        K_.finalize();
+        return true;
+    }
+
+private:
+    Eigen::SparseMatrix<double>& K_;
+    Eigen::Index started_ = 0;
+};
+
+// Streams outer, inner and values to three scratch files, then writes the
+// disk matrix file from them; the matrix is never in memory
+class StreamingAssembler::FileSink : public EntrySink {
+public:
+    FileSink(const std::string& filename, const std::string& outer, const std::string& inner,
+             const std::string& values, size_t buffer_bytes)
+        : filename_(filename), outer_path_(outer), inner_path_(inner), values_path_(values),
+          buffer_bytes_(buffer_bytes) {}
+
+    bool begin(Eigen::Index size) override {
+        size_ = size;
+        closed_ = 0;
+        nnz_ = 0;
+        if (!outer_.open(outer_path_, buffer_bytes_ / 3) || !inner_.open(inner_path_, buffer_bytes_ / 3) ||
+            !values_.open(values_path_, buffer_bytes_ / 3)) {
+            return false;
+        }
+        outer_.push(0);
+        return true;
+    }
+
+    void add(int col, int row, double value) override {
+        while (closed_ < col) {
+            outer_.push(static_cast<int32_t>(nnz_));
+            ++closed_;
+        }
+        inner_.push(row);
+        values_.push(value);
+        ++nnz_;
+    }
+
+    bool finish() override {
+        while (closed_ < size_) {
+            outer_.push(static_cast<int32_t>(nnz_));
+            ++closed_;
+        }
+        if (!outer_.close() || !inner_.close() || !values_.close()) {
+            return false;
+        }
+        if (nnz_ > INT_MAX) {
+            std::cerr << "Error: " << filename_ << ": " << nnz_ << " nonzeros exceed 32-bit indices" << std::endl;
+            return false;
+        }
+
+        DiskMatrixHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, kDiskMatrixMagic, sizeof(kDiskMatrixMagic));
+        header.version = kDiskMatrixVersion;
+        header.header_size = sizeof(DiskMatrixHeader);
+        header.rows = header.cols = size_;
+        header.nnz = nnz_;
+        header.outer_offset = alignUp(sizeof(DiskMatrixHeader));
+        header.inner_offset = alignUp(header.outer_offset + (size_ + 1) * sizeof(int32_t));
+        header.values_offset = alignUp(header.inner_offset + nnz_ * sizeof(int32_t));
+        header.file_size = header.values_offset + nnz_ * sizeof(double);
+
+        // Write to a temporary file and rename, like Mesh::saveBinary
+        std::string tmp_filename = filename_ + ".tmp";
+        {
+            std::ofstream out(tmp_filename, std::ios::binary | std::ios::trunc);
+            if (!out.is_open()) {
+                std::cerr << "Error: Could not open " << tmp_filename << " for writing" << std::endl;
+                return false;
+            }
+            std::vector<char> buffer(std::clamp<size_t>(buffer_bytes_, 4096, kMaxIoBuffer));
+            auto section = [&](uint64_t offset, const std::string& path) {
+                static const char zeros[kSectionAlignment] = {};
+                uint64_t pos = static_cast<uint64_t>(out.tellp());
+                out.write(zeros, static_cast<std::streamsize>(offset - pos));
+                return appendFile(out, path, buffer);
+            };
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            bool ok = section(header.outer_offset, outer_path_) && section(header.inner_offset, inner_path_) &&
+                      section(header.values_offset, values_path_);
+            if (!ok || !out) {
+                std::cerr << "Error: Failed writing disk matrix " << tmp_filename << std::endl;
+                out.close();
+                std::remove(tmp_filename.c_str());
+                return false;
+            }
+        }
+        std::error_code ec;
+        std::filesystem::rename(tmp_filename, filename_, ec);
+        if (ec) {
+            std::cerr << "Error: Could not move " << tmp_filename << " to " << filename_ << std::endl;
+            std::remove(tmp_filename.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    std::string filename_, outer_path_, inner_path_, values_path_;
+    size_t buffer_bytes_;
+    Eigen::Index size_ = 0;
+    Eigen::Index closed_ = 0;
+    int64_t nnz_ = 0;
+    ArrayWriter<int32_t> outer_;
+    ArrayWriter<int32_t> inner_;
+    ArrayWriter<double> values_;
+};
+
+bool MappedSparseMatrix::open(const std::string& filename) {
+    close();
+    if (!file_.open(filename)) {
+        std::cerr << "Error: Could not open disk matrix " << filename << std::endl;
+        return false;
+    }
+    std::string why;
+    DiskMatrixHeader header;
+    if (file_.size() < sizeof(DiskMatrixHeader) ||
+        std::memcmp(file_.data(), kDiskMatrixMagic, sizeof(kDiskMatrixMagic)) != 0) {
+        why = "not a disk matrix file";
+    } else {
+        std::memcpy(&header, file_.data(), sizeof(header));
+        auto fits = [&](uint64_t offset, uint64_t bytes) {
+            return offset % kSectionAlignment == 0 && offset <= file_.size() && bytes <= file_.size() - offset;
+        };
+        if (header.version != kDiskMatrixVersion) {
+            why = "unsupported disk matrix version " + std::to_string(header.version);
+        } else if (header.header_size != sizeof(DiskMatrixHeader) || header.file_size != file_.size() ||
+                   header.rows < 0 || header.cols < 0 || header.nnz < 0 || header.nnz > INT_MAX ||
+                   header.cols >= INT_MAX || header.rows > INT_MAX) {
+            why = "corrupt or truncated disk matrix header";
+        } else if (!fits(header.outer_offset, (header.cols + 1) * sizeof(int32_t)) ||
+                   !fits(header.inner_offset, header.nnz * sizeof(int32_t)) ||
+                   !fits(header.values_offset, header.nnz * sizeof(double))) {
+            why = "disk matrix section out of bounds";
+        }
+    }
+    if (why.empty()) {
+        // The outer indices bound every column's slice of inner and values
+        const int32_t* outer = reinterpret_cast<const int32_t*>(file_.data() + header.outer_offset);
+        bool ok = outer[0] == 0 && outer[header.cols] == header.nnz;
+        for (int64_t c = 0; ok && c < header.cols; ++c) {
+            ok = outer[c] <= outer[c + 1];
+        }
+        if (!ok) {
+            why = "corrupt column offsets";
+        }
+    }
+    if (!why.empty()) {
+        std::cerr << "Error: " << filename << ": " << why << std::endl;
+        close();
+        return false;
+    }
+    header_ = header;
+    return true;
+}
+
+void MappedSparseMatrix::close() {
+    file_.close();
+    header_ = DiskMatrixHeader();
+}
+
+Eigen::Map<const Eigen::SparseMatrix<double>> MappedSparseMatrix::matrix() const {
+    const char* base = file_.data();
+    return Eigen::Map<const Eigen::SparseMatrix<double>>(
+        header_.rows, header_.cols, header_.nnz, reinterpret_cast<const int*>(base + header_.outer_offset),
+        reinterpret_cast<const int*>(base + header_.inner_offset),
+        reinterpret_cast<const double*>(base + header_.values_offset));
+}
+
+StreamingAssembler::StreamingAssembler(size_t memory_budget, unsigned num_threads)
+    : memory_budget_(0), num_threads_(num_threads) {
+    setMemoryBudget(memory_budget);
+}
+
+void StreamingAssembler::setMemoryBudget(size_t bytes) {
+    if (bytes < kMinMemoryBudget) {
+        throw std::invalid_argument("StreamingAssembler: a memory budget of " + std::to_string(bytes) +
+                                    " bytes is below the minimum of " + std::to_string(kMinMemoryBudget));
+    }
+    memory_budget_ = bytes;
+}
+
+void StreamingAssembler::setScratchDirectory(const std::string& directory) {
+    scratch_directory_ = directory;
+}
+
+std::string StreamingAssembler::scratchPath() {
+    std::error_code ec;
+    std::filesystem::path directory =
+        scratch_directory_.empty() ? std::filesystem::temp_directory_path(ec) : std::filesystem::path(scratch_directory_);
+    // Unique per process (clock) and per assembler (address and counter)
+    std::string name = "fem_stream_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) +
+                       "_" + std::to_string(reinterpret_cast<uintptr_t>(this)) + "_" +
+                       std::to_string(scratch_counter_++) + ".run";
+    return (directory / name).string();
+}
+
+bool StreamingAssembler::assemble(const std::string& mesh_filename, const MaterialTable& materials,
+                                  Eigen::SparseMatrix<double>& K) {
+    ScratchFiles scratch;
+    MemorySink sink(K);
+    return run(mesh_filename, materials, sink, scratch);
+}
+
+bool StreamingAssembler::assembleToFile(const std::string& mesh_filename, const MaterialTable& materials,
+                                        const std::string& matrix_filename) {
+    ScratchFiles scratch;
+    FileSink sink(matrix_filename, scratch.add(scratchPath()), scratch.add(scratchPath()), scratch.add(scratchPath()),
+                  memory_budget_ / 4);
+    return run(mesh_filename, materials, sink, scratch);
+}
+
+bool StreamingAssembler::run(const std::string& mesh_filename, const MaterialTable& materials, EntrySink& sink,
+                             ScratchFiles& scratch) {
+    FEM_PROFILE_SCOPE("assembly.streaming");
+    stats_ = StreamingAssemblyStats();
+    std::vector<std::string> runs;
+    Eigen::Index size = 0;
+    bool ok = spillChunks(mesh_filename, materials, scratch, runs, size) && sink.begin(size) &&
+              mergeRuns(scratch, runs, sink) && sink.finish();
+    FEM_PROFILE_COUNTER("assembly.streaming.runs", stats_.runs);
+    FEM_PROFILE_COUNTER("assembly.streaming.spilled_bytes", stats_.spilled_bytes);
+    return ok;
+}
+
+bool StreamingAssembler::spillChunks(const std::string& mesh_filename, const MaterialTable& materials,
+                                     ScratchFiles& scratch, std::vector<std::string>& runs, Eigen::Index& size) {
+    auto start = std::chrono::steady_clock::now();
+    MappedFile file;
+    BinaryMeshHeader header;
+    std::string why = "could not open file";
+    if (!file.open(mesh_filename) || !validateBinaryMeshHeader(file, header, why)) {
+        std::cerr << "Error: " << mesh_filename << ": " << why << std::endl;
+        return false;
+    }
+    const char* base = file.data();
+    const uint64_t num_nodes = header.num_nodes;
+    const uint64_t num_elements = header.num_elements;
+    const double* x = reinterpret_cast<const double*>(base + header.x_offset);
+    const double* y = reinterpret_cast<const double*>(base + header.y_offset);
+    const double* z = reinterpret_cast<const double*>(base + header.z_offset);
+    const uint8_t* types = reinterpret_cast<const uint8_t*>(base + header.element_types_offset);
+    const int32_t* element_materials = reinterpret_cast<const int32_t*>(base + header.element_materials_offset);
+    const int64_t* offsets = reinterpret_cast<const int64_t*>(base + header.elem_offsets_offset);
+    const int32_t* connectivity = reinterpret_cast<const int32_t*>(base + header.connectivity_offset);
+    if (3 * num_nodes > static_cast<uint64_t>(INT_MAX)) {
+        std::cerr << "Error: " << mesh_filename << ": " << num_nodes << " nodes exceed 32-bit DOF indices"
+                  << std::endl;
+        return false;
+    }
+    size = static_cast<Eigen::Index>(3 * num_nodes);
+    if (offsets[0] != 0 || static_cast<uint64_t>(offsets[num_elements]) != header.connectivity_size) {
+        std::cerr << "Error: " << mesh_filename << ": corrupt element connectivity" << std::endl;
+        return false;
+    }
+
+    Assembler assembler(num_threads_);
+    std::vector<int> chunk_nodes;
+    std::vector<int> element_nodes;
+    uint64_t begin = 0;
+    while (begin < num_elements) {
+        // 1. Extend the chunk while its estimated working set fits the budget
+        //    (at least one element), checking the element records on the way
+        FEM_PROFILE_SCOPE("assembly.streaming.chunk");
+        size_t estimate = 0;
+        uint64_t end = begin;
+        chunk_nodes.clear();
+        while (end < num_elements) {
+            int64_t count = offsets[end + 1] - offsets[end];
+            if (count < 0 || static_cast<uint64_t>(offsets[end + 1]) > header.connectivity_size ||
+                types[end] == static_cast<uint8_t>(ElementType::Unknown) ||
+                static_cast<ElementType>(types[end]) != elementTypeFromNodeCount(static_cast<size_t>(count))) {
+                std::cerr << "Error: " << mesh_filename << ": corrupt element " << end << std::endl;
+                return false;
+            }
+            size_t cost = static_cast<size_t>(9 * count * count) * kChunkBytesPerEntry + count * kChunkBytesPerNode;
+            if (end > begin && estimate + cost > memory_budget_) {
+                break;
+            }
+            for (int64_t k = offsets[end]; k < offsets[end + 1]; ++k) {
+                if (connectivity[k] < 0 || static_cast<uint64_t>(connectivity[k]) >= num_nodes) {
+                    std::cerr << "Error: " << mesh_filename << ": element " << end << " references node index "
+                              << connectivity[k] << " of " << num_nodes << std::endl;
+                    return false;
+                }
+                chunk_nodes.push_back(connectivity[k]);
+            }
+            estimate += cost;
+            ++end;
+        }
+        stats_.peak_working_bytes = std::max(stats_.peak_working_bytes, estimate);
+
+        // 2. The chunk as a mesh of its own, nodes in ascending global order
+        std::sort(chunk_nodes.begin(), chunk_nodes.end());
+        chunk_nodes.erase(std::unique(chunk_nodes.begin(), chunk_nodes.end()), chunk_nodes.end());
+        Mesh chunk;
+        chunk.reserve(chunk_nodes.size(), end - begin, offsets[end] - offsets[begin]);
+        for (size_t i = 0; i < chunk_nodes.size(); ++i) {
+            int g = chunk_nodes[i];
+            chunk.addNode(static_cast<int>(i) + 1, x[g], y[g], z[g]);
+        }
+        for (uint64_t e = begin; e < end; ++e) {
+            element_nodes.clear();
+            for (int64_t k = offsets[e]; k < offsets[e + 1]; ++k) {
+                auto it = std::lower_bound(chunk_nodes.begin(), chunk_nodes.end(), connectivity[k]);
+                element_nodes.push_back(static_cast<int>(it - chunk_nodes.begin()) + 1);
+            }
+            chunk.addElement(element_nodes, element_materials[e]);
+        }
+
+        // 3. Its matrix, spilled in global (col, row) order: the renumbering
+        //    is monotone, so the compressed order carries over
+        Eigen::SparseMatrix<double> K_chunk = assembler.assembleGlobalStiffness(chunk, materials);
+        const std::string& path = runs.emplace_back(scratch.add(scratchPath()));
+        ArrayWriter<RunEntry> writer;
+        if (!writer.open(path, kMinMergeBuffer)) {
+            return false;
+        }
+        for (Eigen::Index c = 0; c < K_chunk.outerSize(); ++c) {
+            int col = 3 * chunk_nodes[c / 3] + static_cast<int>(c % 3);
+            for (Eigen::SparseMatrix<double>::InnerIterator it(K_chunk, c); it; ++it) {
+                writer.push({col, 3 * chunk_nodes[it.index() / 3] + static_cast<int>(it.index() % 3), it.value()});
+            }
+        }
+        if (!writer.close()) {
+            return false;
+        }
+        stats_.spilled_bytes += writer.bytesWritten();
+        ++stats_.chunks;
+        ++stats_.runs;
+        begin = end;
+    }
+    stats_.assemble_seconds = secondsSince(start);
+    return true;
+}
+
+bool StreamingAssembler::mergeRuns(ScratchFiles& scratch, std::vector<std::string>& runs, EntrySink& sink) {
+    FEM_PROFILE_SCOPE("assembly.streaming.merge");
+    auto start = std::chrono::steady_clock::now();
+    // One buffer per input run plus one for the output
+    const size_t fan_in = std::max<size_t>(2, memory_budget_ / kMinMergeBuffer - 1);
+
+    // 1. Merge groups of runs into longer runs until one pass can take them all
+    while (runs.size() > fan_in) {
+        std::vector<std::string> merged;
+        for (size_t first = 0; first < runs.size(); first += fan_in) {
+            std::vector<std::string> group(runs.begin() + first, runs.begin() + std::min(first + fan_in, runs.size()));
+            size_t buffer_bytes = memory_budget_ / (group.size() + 1);
+            stats_.peak_working_bytes = std::max(stats_.peak_working_bytes, buffer_bytes * (group.size() + 1));
+            const std::string& path = merged.emplace_back(scratch.add(scratchPath()));
+            ArrayWriter<RunEntry> writer;
+            if (!writer.open(path, buffer_bytes) ||
+                !mergeGroup(group, buffer_bytes, [&](const RunEntry& entry) { writer.push(entry); }) ||
+                !writer.close()) {
+                return false;
+            }
+            stats_.spilled_bytes += writer.bytesWritten();
+            for (const std::string& done : group) {
+                std::remove(done.c_str());
+            }
+        }
+        runs.swap(merged);
+        ++stats_.merge_passes;
+    }
+
+    // 2. The final pass feeds the sink
+    size_t buffer_bytes = memory_budget_ / (runs.size() + 1);
+    stats_.peak_working_bytes = std::max(stats_.peak_working_bytes, buffer_bytes * runs.size());
+    bool ok = mergeGroup(runs, buffer_bytes,
+                         [&](const RunEntry& entry) { sink.add(entry.col, entry.row, entry.value); });
+    ++stats_.merge_passes;
+    stats_.merge_seconds = secondsSince(start);
+    return ok;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "MaterialTable.h"
+#include <Eigen/Sparse>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Layout of a disk matrix file (.femcsc): one compressed-column matrix in
+// Eigen's default storage, so a mapping of the file is usable as-is. Native
+// byte order, every section on a 64-byte boundary:
+//
+//   outer   int32  [cols + 1]
+//   inner   int32  [nnz]      Row indices, ascending within each column
+//   values  double [nnz]
+struct DiskMatrixHeader {
+    char magic[8]; // "FEMCSC" followed by two '\0'
+    uint32_t version;
+    uint32_t header_size; // sizeof(DiskMatrixHeader) of the writer
+    int64_t rows;
+    int64_t cols;
+    int64_t nnz;
+    uint64_t outer_offset;
+    uint64_t inner_offset;
+    uint64_t values_offset;
+    uint64_t file_size;
+};
+
+const char kDiskMatrixMagic[8] = {'F', 'E', 'M', 'C', 'S', 'C', '\0', '\0'};
+const uint32_t kDiskMatrixVersion = 1;
+
+// Read-only, memory-mapped view of a disk matrix file. matrix() is an
+// ordinary Eigen sparse expression (products, CG, conversion to a
+// SparseMatrix), with the operating system paging the arrays in and out, so
+// a solver can run on a matrix larger than RAM.
+class MappedSparseMatrix {
+public:
+    // Returns false and prints the reason if the file is missing or malformed
+    bool open(const std::string& filename);
+    void close();
+    bool isOpen() const { return file_.isOpen(); }
+
+    Eigen::Index rows() const { return header_.rows; }
+    Eigen::Index cols() const { return header_.cols; }
+    Eigen::Index nonZeros() const { return header_.nnz; }
+    Eigen::Map<const Eigen::SparseMatrix<double>> matrix() const;
+
+private:
+    MappedFile file_;
+    DiskMatrixHeader header_ = {};
+};
+
+struct StreamingAssemblyStats {
+    size_t chunks = 0;             // Element chunks read and assembled
+    size_t runs = 0;               // Sorted runs the chunks spilled
+    size_t merge_passes = 0;       // Passes over the runs; the last one writes K
+    uint64_t spilled_bytes = 0;    // Written to scratch files over all passes
+    size_t peak_working_bytes = 0; // Largest chunk or merge working set (estimate)
+    double assemble_seconds = 0.0; // Reading chunks, element kernels and spilling
+    double merge_seconds = 0.0;
+};
+
+// Stiffness assembly for meshes larger than memory, from a binary mesh
+// (.femb, see BinaryMeshFormat.h). The file is mapped, never loaded: its
+// elements are read in chunks sized to the memory budget, and each chunk is
+// assembled like an in-memory mesh of just those elements, with its nodes
+// renumbered in ascending order so that the chunk's compressed matrix maps
+// to a run already sorted by global (column, row). The run is spilled to a
+// scratch file as (column, row, value) records.
+//
+// A k-way merge then streams the runs in column order, summing the entries
+// the chunks share. Each run is read through its own buffer and the budget
+// bounds their total, so with more runs than buffers fit, groups of runs are
+// first merged into longer ones (another pass over the data). The final pass
+// either builds K in memory (which then must fit, on top of the budget) or
+// writes it to a disk matrix file for MappedSparseMatrix.
+//
+// The budget covers the chunk and merge buffers; the mapped mesh and the
+// page cache come on top and are reclaimed by the operating system as
+// needed. Results match Assembler::assembleGlobalStiffness up to the order
+// in which the element contributions to an entry are summed.
+class StreamingAssembler {
+public:
+    static constexpr size_t kMinMemoryBudget = size_t(64) << 10;
+
+    // std::invalid_argument for a budget below kMinMemoryBudget.
+    // num_threads is passed on to the chunk assembly (0 = all).
+    explicit StreamingAssembler(size_t memory_budget = size_t(256) << 20, unsigned num_threads = 1);
+
+    void setMemoryBudget(size_t bytes);
+    size_t getMemoryBudget() const { return memory_budget_; }
+    // Where runs are spilled; the system temporary directory by default.
+    // Scratch files are removed when assembly finishes, successful or not.
+    void setScratchDirectory(const std::string& directory);
+    void setNumThreads(unsigned num_threads) { num_threads_ = num_threads; }
+
+    // Return false and print the reason on an unreadable or malformed mesh or
+    // a failed scratch or output write. Materials are looked up by element
+    // material ID; std::out_of_range if one is missing.
+    bool assemble(const std::string& mesh_filename, const MaterialTable& materials, Eigen::SparseMatrix<double>& K);
+    bool assembleToFile(const std::string& mesh_filename, const MaterialTable& materials,
+                        const std::string& matrix_filename);
+
+    const StreamingAssemblyStats& getStats() const { return stats_; }
+
+private:
+    class EntrySink;
+    class MemorySink;
+    class FileSink;
+    class ScratchFiles;
+
+    // Every scratch file is registered in scratch, which removes them all
+    // however the assembly ends (including exceptions from the materials)
+    bool run(const std::string& mesh_filename, const MaterialTable& materials, EntrySink& sink,
+             ScratchFiles& scratch);
+    bool spillChunks(const std::string& mesh_filename, const MaterialTable& materials, ScratchFiles& scratch,
+                     std::vector<std::string>& runs, Eigen::Index& size);
+    bool mergeRuns(ScratchFiles& scratch, std::vector<std::string>& runs, EntrySink& sink);
+    std::string scratchPath();
+
+    size_t memory_budget_;
+    unsigned num_threads_;
+    std::string scratch_directory_;
+    uint64_t scratch_counter_ = 0;
+    StreamingAssemblyStats stats_;
+};
@@ -0,0 +1,141 @@
+#include "StressRecovery.h"
+#include "ElementKernel.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include "Tet4Kernel.h"
+#include <cmath>
+
+namespace {
+
+template <typename Derived>
+void resizeColumns(Eigen::PlainObjectBase<Derived>& m, Eigen::Index cols) {
+    if (m.cols() != cols) {
+        m.resize(6, cols);
+    }
+}
+
+} // namespace
+
+StressRecovery::StressRecovery(const Mesh& mesh, unsigned num_threads)
+    : mesh_(mesh),
+      num_threads_(num_threads),
+      geometry_(nullptr),
+      incidence_(buildNodeElementIncidence(mesh)),
+      incidence_revision_(mesh.getRevision()) {}
+
+void StressRecovery::setGeometry(const ElementGeometry* geometry) {
+    geometry_ = geometry;
+}
+
+double StressRecovery::vonMises(const Eigen::Matrix<double, 6, 1>& s) {
+    double normal = (s(0) - s(1)) * (s(0) - s(1)) + (s(1) - s(2)) * (s(1) - s(2)) + (s(2) - s(0)) * (s(2) - s(0));
+    double shear = s(3) * s(3) + s(4) * s(4) + s(5) * s(5);
+    return std::sqrt(0.5 * normal + 3.0 * shear);
+}
+
+void StressRecovery::compute(const MaterialTable& materials, const Eigen::VectorXd& U, StressResults& results) const {
+    FEM_PROFILE_SCOPE("stress_recovery");
+    const int W = kTet4BatchWidth;
+    Eigen::Index num_elements = static_cast<Eigen::Index>(mesh_.getNumElements());
+    Eigen::Index num_nodes = static_cast<Eigen::Index>(mesh_.getNumNodes());
+    resizeColumns(results.element_strain, num_elements);
+    resizeColumns(results.element_stress, num_elements);
+    resizeColumns(results.nodal_stress, num_nodes);
+    results.element_von_mises.resize(num_elements);
+    results.element_volume.resize(num_elements);
+    results.nodal_von_mises.resize(num_nodes);
+
+    std::vector<int> slots = materials.elementSlots(mesh_);
+    const Tet4Geometry<W>* cached = geometry_ && geometry_->matches(mesh_) ? geometry_->blocks() : nullptr;
+    NodeElementIncidence rebuilt;
+    if (incidence_revision_ != mesh_.getRevision()) {
+        rebuilt = buildNodeElementIncidence(mesh_);
+    }
+    const NodeElementIncidence& incidence = incidence_revision_ == mesh_.getRevision() ? incidence_ : rebuilt;
+
+    // 1. Element strain and stress: eps = B u_e, built from the gradients
+    //    without forming B (see the nodal block layout in Tet4Kernel.cpp)
+    parallelFor(mesh_.getNumElements(), num_threads_, [&](size_t begin, size_t end, unsigned) {
+        for (size_t e = begin; e < end; ++e) {
+            if (!hasElementKernel(mesh_.getElementTypes()[e])) {
+                results.element_strain.col(e).setZero();
+                results.element_stress.col(e).setZero();
+                results.element_von_mises(e) = 0.0;
+                results.element_volume(e) = 0.0;
+            }
+        }
+        forEachElementRun(
+            mesh_, materials, slots, end - begin, [&](size_t k) { return begin + k; },
+            [&](ElementType type, const Eigen::Matrix<double, 6, 6>& D, size_t first, size_t count) {
+                if (type != ElementType::Tet4) {
+                    // Fixed-size kernels for the other types, evaluated at the centroid
+                    dispatchElementType(type, [&](auto tag) {
+                        constexpr ElementType Type = decltype(tag)::value;
+                        ElementStrainOperator<Type> B;
+                        ElementVector<Type> u_e;
+                        for (size_t k = 0; k < count; ++k) {
+                            size_t e = begin + first + k;
+                            const int* nodes = mesh_.getElementNodes(e);
+                            for (int i = 0; i < ElementTraits<Type>::kNodes; ++i) {
+                                u_e.template segment<3>(3 * i) = U.segment<3>(3 * nodes[i]);
+                            }
+                            ElementCoords<Type> coords = gatherElementCoords<Type>(mesh_, e);
+                            computeCentroidStrainOperator<Type>(coords, B);
+                            Eigen::Matrix<double, 6, 1> eps = B * u_e;
+                            Eigen::Matrix<double, 6, 1> sigma = D * eps;
+                            results.element_strain.col(e) = eps;
+                            results.element_stress.col(e) = sigma;
+                            results.element_von_mises(e) = vonMises(sigma);
+                            results.element_volume(e) = computeElementVolume<Type>(coords);
+                        }
+                    });
+                    return;
+                }
+                forEachTet4Batch(
+                    mesh_, count, [&](size_t k) { return begin + first + k; },
+                    [&](const Tet4Batch<W>& batch, const size_t* elements, int lanes) {
+                        for (int l = 0; l < lanes; ++l) {
+                            size_t e = elements[l];
+                            const int* nodes = mesh_.getElementNodes(e);
+                            Eigen::Matrix<double, 6, 1> eps = Eigen::Matrix<double, 6, 1>::Zero();
+                            for (int i = 0; i < 4; ++i) {
+                                double a = batch.geometry.grad[i][0][l];
+                                double b = batch.geometry.grad[i][1][l];
+                                double c = batch.geometry.grad[i][2][l];
+                                double ux = U(3 * nodes[i] + 0), uy = U(3 * nodes[i] + 1), uz = U(3 * nodes[i] + 2);
+                                eps(0) += a * ux;
+                                eps(1) += b * uy;
+                                eps(2) += c * uz;
+                                eps(3) += b * ux + a * uy;
+                                eps(4) += c * uy + b * uz;
+                                eps(5) += c * ux + a * uz;
+                            }
+                            Eigen::Matrix<double, 6, 1> sigma = D * eps;
+                            results.element_strain.col(e) = eps;
+                            results.element_stress.col(e) = sigma;
+                            results.element_von_mises(e) = vonMises(sigma);
+                            results.element_volume(e) = batch.geometry.volume[l];
+                        }
+                    },
+                    cached);
+            });
+    });
+
+    // 2. Nodal averages, gathered per node so threads never share an output
+    parallelFor(mesh_.getNumNodes(), num_threads_, [&](size_t begin, size_t end, unsigned) {
+        for (size_t n = begin; n < end; ++n) {
+            Eigen::Matrix<double, 6, 1> sum = Eigen::Matrix<double, 6, 1>::Zero();
+            double weight = 0.0;
+            for (size_t k = incidence.offsets[n]; k < incidence.offsets[n + 1]; ++k) {
+                size_t e = incidence.elements[k];
+                sum += results.element_volume(e) * results.element_stress.col(e);
+                weight += results.element_volume(e);
+            }
+            if (weight > 0.0) {
+                sum /= weight;
+            }
+            results.nodal_stress.col(n) = sum;
+            results.nodal_von_mises(n) = vonMises(sum);
+        }
+    });
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Mesh.h"
+#include "MaterialTable.h"
+#include "ElementGeometry.h"
+#include "MeshTopology.h"
+#include <Eigen/Dense>
+
+// Whole-mesh post-processing results. Tensors use Voigt order
+// (xx, yy, zz, xy, yz, xz) with engineering shear strains, one column per
+// element or node, so each column is contiguous.
+struct StressResults {
+    Eigen::Matrix<double, 6, Eigen::Dynamic> element_strain;
+    Eigen::Matrix<double, 6, Eigen::Dynamic> element_stress;
+    Eigen::VectorXd element_von_mises;
+    Eigen::VectorXd element_volume; // Weights of the nodal averages
+
+    // Volume-weighted average of the stresses of the elements around each node;
+    // nodal von Mises is taken from the averaged tensor
+    Eigen::Matrix<double, 6, Eigen::Dynamic> nodal_stress;
+    Eigen::VectorXd nodal_von_mises;
+};
+
+// Recovers strain, stress and von Mises stress for every element from the
+// global displacement vector, then averages stresses to the nodes. Elements
+// are processed in parallel through the batched Tet4 geometry kernel and write
+// straight into the result arrays; nodal averaging gathers over each node's
+// elements, so no two threads write the same entry. Tet10 and Hex8 elements
+// report their values at the element centroid. Elements of other types report
+// zeros and do not contribute to the nodal averages.
+class StressRecovery {
+public:
+    // The mesh must outlive the recovery object. num_threads = 1 is serial;
+    // 0 uses every hardware thread. The node-to-element incidence is built
+    // here; if the mesh changes later, compute() rebuilds it on every call.
+    explicit StressRecovery(const Mesh& mesh, unsigned num_threads = 1);
+
+    // Optional precomputed element geometry; must outlive the recovery object.
+    // Each compute() uses it only while it matches the mesh, so a geometry
+    // left behind by moved or renumbered nodes is ignored.
+    void setGeometry(const ElementGeometry* geometry);
+
+    // U holds 3 DOFs per node in mesh storage order. Each element takes its D
+    // from the table by material ID, as in Assembler. The arrays of results are
+    // resized only if their shape is wrong, so passing the same results object
+    // again performs no allocation.
+    void compute(const MaterialTable& materials, const Eigen::VectorXd& U, StressResults& results) const;
+
+    static double vonMises(const Eigen::Matrix<double, 6, 1>& stress);
+
+private:
+    const Mesh& mesh_;
+    unsigned num_threads_;
+    const ElementGeometry* geometry_;
+    NodeElementIncidence incidence_;
+    uint64_t incidence_revision_; // Mesh revision incidence_ was built from
+};
@@ -0,0 +1,234 @@
+#include "SymmetricBlockMatrix.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+SymmetricBlockMatrix::SymmetricBlockMatrix(Eigen::Index block_rows, std::vector<Eigen::Index> row_offsets,
+                                           std::vector<int> columns)
+    : block_rows_(block_rows), row_offsets_(std::move(row_offsets)), columns_(std::move(columns)) {
+    if (static_cast<Eigen::Index>(row_offsets_.size()) != block_rows_ + 1 || row_offsets_.front() != 0 ||
+        row_offsets_.back() != static_cast<Eigen::Index>(columns_.size())) {
+        throw std::invalid_argument("SymmetricBlockMatrix: row offsets do not match the block rows and columns.");
+    }
+    for (Eigen::Index i = 0; i < block_rows_; ++i) {
+        Eigen::Index begin = row_offsets_[i], end = row_offsets_[i + 1];
+        bool valid = begin < end && columns_[begin] == i;
+        for (Eigen::Index k = begin + 1; valid && k < end; ++k) {
+            valid = columns_[k] > columns_[k - 1] && columns_[k] < block_rows_;
+        }
+        if (!valid) {
+            throw std::invalid_argument("SymmetricBlockMatrix: block row " + std::to_string(i) +
+                                        " must start with its diagonal, then ascending columns above it.");
+        }
+    }
+    values_.assign(9 * columns_.size(), 0.0);
+}
+
+Eigen::Index SymmetricBlockMatrix::findBlock(int i, int j) const {
+    const int* begin = columns_.data() + row_offsets_[i];
+    const int* end = columns_.data() + row_offsets_[i + 1];
+    if (i == j) {
+        return row_offsets_[i];
+    }
+    const int* it = std::lower_bound(begin + 1, end, j);
+    return it != end && *it == j ? static_cast<Eigen::Index>(it - columns_.data()) : -1;
+}
+
+void SymmetricBlockMatrix::setZero() {
+    std::fill(values_.begin(), values_.end(), 0.0);
+}
+
+void SymmetricBlockMatrix::multiplyAdd(const Eigen::Ref<const Eigen::VectorXd>& x, Eigen::Ref<Eigen::VectorXd> y,
+                                       double alpha) const {
+    const double* xp = x.data();
+    double* yp = y.data();
+    unsigned threads = static_cast<unsigned>(std::min<Eigen::Index>(resolveThreadCount(num_threads_),
+                                                                    std::max<Eigen::Index>(block_rows_, 1)));
+    std::vector<Eigen::Index> spill_begin(threads, block_rows_);
+    std::vector<std::vector<double>> spills(threads);
+
+    parallelFor(static_cast<size_t>(block_rows_), threads, [&](size_t row_begin, size_t row_end, unsigned t) {
+        // 1. Transposed blocks may reach rows past this range; those go to a
+        //    private buffer starting at row_end
+        const Eigen::Index end = static_cast<Eigen::Index>(row_end);
+        Eigen::Index reach = end;
+        for (Eigen::Index i = row_begin; i < end; ++i) {
+            reach = std::max<Eigen::Index>(reach, columns_[row_offsets_[i + 1] - 1] + 1);
+        }
+        spill_begin[t] = end;
+        spills[t].assign(3 * (reach - end), 0.0);
+
+        // 2. Row i of the upper blocks forwards, their transposes into rows j > i
+        for (Eigen::Index i = row_begin; i < end; ++i) {
+            const double xi0 = xp[3 * i], xi1 = xp[3 * i + 1], xi2 = xp[3 * i + 2];
+            const double ai0 = alpha * xi0, ai1 = alpha * xi1, ai2 = alpha * xi2;
+            Eigen::Index k = row_offsets_[i];
+            const double* v = values_.data() + 9 * k;
+            double s0 = v[0] * xi0 + v[1] * xi1 + v[2] * xi2;
+            double s1 = v[3] * xi0 + v[4] * xi1 + v[5] * xi2;
+            double s2 = v[6] * xi0 + v[7] * xi1 + v[8] * xi2;
+
+            for (++k; k < row_offsets_[i + 1]; ++k) {
+                const Eigen::Index j = columns_[k];
+                v = values_.data() + 9 * k;
+                const double xj0 = xp[3 * j], xj1 = xp[3 * j + 1], xj2 = xp[3 * j + 2];
+                s0 += v[0] * xj0 + v[1] * xj1 + v[2] * xj2;
+                s1 += v[3] * xj0 + v[4] * xj1 + v[5] * xj2;
+                s2 += v[6] * xj0 + v[7] * xj1 + v[8] * xj2;
+
+                double* yj = j < end ? yp + 3 * j : spills[t].data() + 3 * (j - end);
+                yj[0] += v[0] * ai0 + v[3] * ai1 + v[6] * ai2;
+                yj[1] += v[1] * ai0 + v[4] * ai1 + v[7] * ai2;
+                yj[2] += v[2] * ai0 + v[5] * ai1 + v[8] * ai2;
+            }
+            yp[3 * i] += alpha * s0;
+            yp[3 * i + 1] += alpha * s1;
+            yp[3 * i + 2] += alpha * s2;
+        }
+    });
+
+    // 3. Buffers in thread order, so the result does not depend on timing
+    for (unsigned t = 0; t < threads; ++t) {
+        double* target = yp + 3 * spill_begin[t];
+        for (size_t k = 0; k < spills[t].size(); ++k) {
+            target[k] += spills[t][k];
+        }
+    }
+}
+
+void SymmetricBlockMatrix::eliminateDofs(const std::vector<int>& dofs) {
+    std::vector<char> constrained(3 * block_rows_, 0);
+    for (int dof : dofs) {
+        constrained[dof] = 1;
+    }
+    for (Eigen::Index i = 0; i < block_rows_; ++i) {
+        for (Eigen::Index k = row_offsets_[i]; k < row_offsets_[i + 1]; ++k) {
+            const Eigen::Index j = columns_[k];
+            double* v = values_.data() + 9 * k;
+            for (int a = 0; a < 3; ++a) {
+                for (int b = 0; b < 3; ++b) {
+                    if (constrained[3 * i + a] || constrained[3 * j + b]) {
+                        v[3 * a + b] = (i == j && a == b) ? 1.0 : 0.0;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void SymmetricBlockMatrix::eliminateDofs(const std::vector<int>& dofs, const Eigen::VectorXd& prescribed,
+                                         Eigen::VectorXd& rhs) {
+    if (prescribed.size() != rows() || rhs.size() != rows()) {
+        throw std::invalid_argument("SymmetricBlockMatrix::eliminateDofs: vectors must have one entry per DOF");
+    }
+    std::vector<char> constrained(3 * block_rows_, 0);
+    for (int dof : dofs) {
+        constrained[dof] = 1;
+    }
+
+    // 1. Lift the constrained columns, each stored block for itself and
+    //    (off the diagonal) for its transpose
+    for (Eigen::Index i = 0; i < block_rows_; ++i) {
+        for (Eigen::Index k = row_offsets_[i]; k < row_offsets_[i + 1]; ++k) {
+            const Eigen::Index j = columns_[k];
+            const double* v = values_.data() + 9 * k;
+            for (int a = 0; a < 3; ++a) {
+                for (int b = 0; b < 3; ++b) {
+                    const Eigen::Index row = 3 * i + a, col = 3 * j + b;
+                    if (!constrained[row] && constrained[col]) {
+                        rhs(row) -= v[3 * a + b] * prescribed(col);
+                    }
+                    if (i != j && !constrained[col] && constrained[row]) {
+                        rhs(col) -= v[3 * a + b] * prescribed(row);
+                    }
+                }
+            }
+        }
+    }
+    for (int dof : dofs) {
+        rhs(dof) = prescribed(dof);
+    }
+
+    // 2. Identity rows and columns
+    eliminateDofs(dofs);
+}
+
+Eigen::VectorXd SymmetricBlockMatrix::diagonal() const {
+    Eigen::VectorXd diag(rows());
+    for (Eigen::Index i = 0; i < block_rows_; ++i) {
+        const double* v = values_.data() + 9 * row_offsets_[i];
+        diag.segment<3>(3 * i) << v[0], v[4], v[8];
+    }
+    return diag;
+}
+
+Eigen::SparseMatrix<double> SymmetricBlockMatrix::toEigen() const {
+    // 1. Upper blocks by block column: column m gets the rows above its diagonal
+    std::vector<Eigen::Index> upper_offsets(block_rows_ + 1, 0);
+    for (Eigen::Index k = 0; k < nonZeroBlocks(); ++k) {
+        ++upper_offsets[columns_[k] + 1];
+    }
+    for (Eigen::Index i = 0; i < block_rows_; ++i) {
+        upper_offsets[i + 1] += upper_offsets[i] - 1; // Less the diagonal block
+    }
+    std::vector<Eigen::Index> upper_blocks(upper_offsets.back());
+    std::vector<int> upper_rows(upper_offsets.back());
+    std::vector<Eigen::Index> fill(upper_offsets.begin(), upper_offsets.end() - 1);
+    for (Eigen::Index i = 0; i < block_rows_; ++i) {
+        for (Eigen::Index k = row_offsets_[i] + 1; k < row_offsets_[i + 1]; ++k) {
+            Eigen::Index pos = fill[columns_[k]]++;
+            upper_blocks[pos] = k;
+            upper_rows[pos] = static_cast<int>(i);
+        }
+    }
+
+    // 2. Column 3m+b: rows above from the upper blocks, then the diagonal
+    //    and the blocks of row m transposed, all in ascending row order
+    Eigen::SparseMatrix<double> A(rows(), cols());
+    A.resizeNonZeros(nonZeros());
+    int* outer = A.outerIndexPtr();
+    int* inner = A.innerIndexPtr();
+    double* values = A.valuePtr();
+    int pos = 0;
+    outer[0] = 0;
+    for (Eigen::Index m = 0; m < block_rows_; ++m) {
+        for (int b = 0; b < 3; ++b) {
+            for (Eigen::Index u = upper_offsets[m]; u < upper_offsets[m + 1]; ++u) {
+                const double* v = values_.data() + 9 * upper_blocks[u];
+                for (int a = 0; a < 3; ++a) {
+                    inner[pos] = 3 * upper_rows[u] + a;
+                    values[pos++] = v[3 * a + b];
+                }
+            }
+            for (Eigen::Index k = row_offsets_[m]; k < row_offsets_[m + 1]; ++k) {
+                const double* v = values_.data() + 9 * k;
+                for (int a = 0; a < 3; ++a) {
+                    inner[pos] = 3 * columns_[k] + a;
+                    values[pos++] = v[3 * b + a];
+                }
+            }
+            outer[3 * m + b + 1] = pos;
+        }
+    }
+    return A;
+}
+
+size_t SymmetricBlockMatrix::memoryBytes() const {
+    return sizeof(*this) + row_offsets_.capacity() * sizeof(Eigen::Index) + columns_.capacity() * sizeof(int) +
+           values_.capacity() * sizeof(double);
+}
+
+BlockJacobiPreconditioner& BlockJacobiPreconditioner::compute(const SymmetricBlockMatrix& A) {
+    inverses_.resize(A.blockRows());
+    for (Eigen::Index i = 0; i < A.blockRows(); ++i) {
+        Eigen::Matrix3d block = Eigen::Map<const Eigen::Matrix<double, 3, 3, Eigen::RowMajor>>(
+            A.blockValues(A.rowOffsets()[i]));
+        bool invertible = false;
+        block.computeInverseWithCheck(inverses_[i], invertible);
+        if (!invertible) {
+            inverses_[i].setIdentity();
+        }
+    }
+    return *this;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <vector>
+
+class SymmetricBlockMatrix;
+
+namespace Eigen {
+namespace internal {
+// Lets Eigen's iterative solvers treat the matrix like a sparse matrix
+template <>
+struct traits<SymmetricBlockMatrix> : public traits<Eigen::SparseMatrix<double>> {};
+} // namespace internal
+} // namespace Eigen
+
+// Symmetric matrix in block compressed sparse row (BSR) form with dense 3x3
+// blocks, one per pair of coupled nodes: block (i, j) holds rows 3i..3i+2
+// and columns 3j..3j+2. Only the upper triangle of blocks (j >= i) is
+// stored, with one column index per block, so K takes 76 bytes per stored
+// block instead of 108 for each of its two halves in scalar CSC form.
+//
+// Every block row starts with its diagonal block, followed by its other
+// columns in ascending order. Block values are row-major. The diagonal
+// block is stored in full and must itself be symmetric.
+//
+// Products run the upper blocks forwards and their transposes backwards in
+// the same pass, so each block is read once. Assembler::assembleNumeric
+// fills the matrix straight from the element kernels; toEigen() expands it
+// for the direct solvers.
+class SymmetricBlockMatrix : public Eigen::EigenBase<SymmetricBlockMatrix> {
+public:
+    typedef double Scalar;
+    typedef double RealScalar;
+    typedef int StorageIndex;
+    enum {
+        ColsAtCompileTime = Eigen::Dynamic,
+        MaxColsAtCompileTime = Eigen::Dynamic,
+        IsRowMajor = false
+    };
+
+    SymmetricBlockMatrix() = default;
+    // Block row i holds columns[row_offsets[i] .. row_offsets[i + 1]), its
+    // diagonal first and the rest ascending; all values start at zero.
+    // std::invalid_argument if the structure breaks that layout.
+    SymmetricBlockMatrix(Eigen::Index block_rows, std::vector<Eigen::Index> row_offsets, std::vector<int> columns);
+
+    Eigen::Index rows() const { return 3 * block_rows_; }
+    Eigen::Index cols() const { return 3 * block_rows_; }
+    Eigen::Index blockRows() const { return block_rows_; }
+    Eigen::Index nonZeroBlocks() const { return static_cast<Eigen::Index>(columns_.size()); }
+    // Scalar nonzeros of the full symmetric matrix
+    Eigen::Index nonZeros() const { return 9 * (2 * nonZeroBlocks() - block_rows_); }
+
+    const std::vector<Eigen::Index>& rowOffsets() const { return row_offsets_; }
+    const std::vector<int>& columns() const { return columns_; }
+
+    // Position k of block (i, j) with i <= j in columns(), or -1 if not stored
+    Eigen::Index findBlock(int i, int j) const;
+    double* blockValues(Eigen::Index k) { return values_.data() + 9 * k; }
+    const double* blockValues(Eigen::Index k) const { return values_.data() + 9 * k; }
+    void setZero();
+
+    // Threads for the products: 1 (the default) is serial, 0 uses every
+    // hardware thread. Threads work on contiguous block rows; transposed
+    // contributions past a thread's rows go to a private buffer that is added
+    // in thread order afterwards, so the buffers stay about the size of the
+    // bandwidth for a well-ordered matrix (see NodeOrdering).
+    void setNumThreads(unsigned num_threads) { num_threads_ = num_threads; }
+
+    // y += alpha * A * x
+    void multiplyAdd(const Eigen::Ref<const Eigen::VectorXd>& x, Eigen::Ref<Eigen::VectorXd> y, double alpha = 1.0) const;
+
+    // Replaces the rows and columns of the given DOFs by those of the
+    // identity, like MatrixFreeStiffness::setConstrainedDofs, so CG can run
+    // on the full-size system. Changes the stored values; reassembling
+    // restores them. This form is for homogeneous constraints: right-hand
+    // sides need zeros at those DOFs.
+    void eliminateDofs(const std::vector<int>& dofs);
+    // The same for nonzero prescribed values, read from the constrained
+    // entries of prescribed: before the columns are dropped, rhs_f -= K_fc * u_c
+    // on the free rows, and rhs_c = u_c. std::invalid_argument if either
+    // vector does not have rows() entries.
+    void eliminateDofs(const std::vector<int>& dofs, const Eigen::VectorXd& prescribed, Eigen::VectorXd& rhs);
+
+    Eigen::VectorXd diagonal() const;
+
+    // Both halves as a compressed column-major matrix, with the same pattern
+    // the scalar assembly produces (all nine entries of every block)
+    Eigen::SparseMatrix<double> toEigen() const;
+
+    // Bytes held by the structure and the values
+    size_t memoryBytes() const;
+
+    template <typename Rhs>
+    Eigen::Product<SymmetricBlockMatrix, Rhs, Eigen::AliasFreeProduct> operator*(const Eigen::MatrixBase<Rhs>& x) const {
+        return Eigen::Product<SymmetricBlockMatrix, Rhs, Eigen::AliasFreeProduct>(*this, x.derived());
+    }
+
+private:
+    Eigen::Index block_rows_ = 0;
+    std::vector<Eigen::Index> row_offsets_{0};
+    std::vector<int> columns_;
+    std::vector<double> values_; // 9 per block, row-major
+    unsigned num_threads_ = 1;
+};
+
+// Block Jacobi preconditioner: the inverse of every 3x3 diagonal block, which
+// couples the three displacement components of a node (plain Jacobi ignores
+// that coupling). For ConjugateGradient<SymmetricBlockMatrix, Lower|Upper,
+// BlockJacobiPreconditioner>. A singular diagonal block (a node no element
+// touches) falls back to the identity.
+class BlockJacobiPreconditioner {
+public:
+    BlockJacobiPreconditioner() = default;
+    explicit BlockJacobiPreconditioner(const SymmetricBlockMatrix& A) { compute(A); }
+
+    BlockJacobiPreconditioner& analyzePattern(const SymmetricBlockMatrix&) { return *this; }
+    BlockJacobiPreconditioner& factorize(const SymmetricBlockMatrix& A) { return compute(A); }
+    BlockJacobiPreconditioner& compute(const SymmetricBlockMatrix& A);
+
+    template <typename Rhs>
+    Eigen::VectorXd solve(const Eigen::MatrixBase<Rhs>& b) const {
+        Eigen::VectorXd x(b.size());
+        for (Eigen::Index i = 0; i < static_cast<Eigen::Index>(inverses_.size()); ++i) {
+            x.segment<3>(3 * i) = inverses_[i] * b.template segment<3>(3 * i);
+        }
+        return x;
+    }
+
+    Eigen::ComputationInfo info() const { return Eigen::Success; }
+
+private:
+    std::vector<Eigen::Matrix3d> inverses_;
+};
+
+namespace Eigen {
+namespace internal {
+template <typename Rhs>
+struct generic_product_impl<SymmetricBlockMatrix, Rhs, SparseShape, DenseShape, GemvProduct>
+    : generic_product_impl_base<SymmetricBlockMatrix, Rhs, generic_product_impl<SymmetricBlockMatrix, Rhs>> {
+    typedef typename Product<SymmetricBlockMatrix, Rhs>::Scalar Scalar;
+
+    template <typename Dest>
+    static void scaleAndAddTo(Dest& dst, const SymmetricBlockMatrix& lhs, const Rhs& rhs, const Scalar& alpha) {
+        lhs.multiplyAdd(rhs, dst, alpha);
+    }
+};
+} // namespace internal
+} // namespace Eigen
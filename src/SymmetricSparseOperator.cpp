@@ -0,0 +1,23 @@
+#include "SymmetricSparseOperator.h"
+#include "Parallel.h"
+
+void SymmetricSparseOperator::multiplyAdd(const Eigen::Ref<const Eigen::VectorXd>& x, Eigen::Ref<Eigen::VectorXd> y,
+                                          double alpha) const {
+    const int* outer = A_->outerIndexPtr();
+    const int* inner = A_->innerIndexPtr();
+    const double* values = A_->valuePtr();
+    const int* nnz = A_->innerNonZeroPtr(); // Null when compressed
+    const double* xp = x.data();
+    double* yp = y.data();
+    parallelFor(static_cast<size_t>(A_->outerSize()), num_threads_, [&](size_t begin, size_t end, unsigned) {
+        for (size_t j = begin; j < end; ++j) {
+            const int first = outer[j];
+            const int last = nnz ? first + nnz[j] : outer[j + 1];
+            double sum = 0.0;
+            for (int p = first; p < last; ++p) {
+                sum += values[p] * xp[inner[p]];
+            }
+            yp[j] += alpha * sum;
+        }
+    });
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <Eigen/Sparse>
+
+class SymmetricSparseOperator;
+
+namespace Eigen {
+namespace internal {
+// Lets Eigen's iterative solvers treat the operator like a sparse matrix
+template <>
+struct traits<SymmetricSparseOperator> : public traits<Eigen::SparseMatrix<double>> {};
+} // namespace internal
+} // namespace Eigen
+
+// Threaded product with a symmetric matrix held in full compressed-column
+// storage, for ConjugateGradient<SymmetricSparseOperator, Lower|Upper, ...>.
+// Since A = A^T, row i of A x is the dot product of column i with x, so the
+// columns are split among the threads and every entry of y has one writer:
+// no atomics or per-thread buffers, and the same result for any thread count.
+// Eigen's own product scatters column by column and runs serially.
+class SymmetricSparseOperator : public Eigen::EigenBase<SymmetricSparseOperator> {
+public:
+    typedef double Scalar;
+    typedef double RealScalar;
+    typedef int StorageIndex;
+    enum {
+        ColsAtCompileTime = Eigen::Dynamic,
+        MaxColsAtCompileTime = Eigen::Dynamic,
+        IsRowMajor = false
+    };
+
+    // A must be symmetric and outlive the operator. num_threads = 1 is
+    // serial; 0 uses every hardware thread.
+    explicit SymmetricSparseOperator(const Eigen::SparseMatrix<double>& A, unsigned num_threads = 1)
+        : A_(&A), num_threads_(num_threads) {}
+
+    Eigen::Index rows() const { return A_->rows(); }
+    Eigen::Index cols() const { return A_->cols(); }
+    const Eigen::SparseMatrix<double>& matrix() const { return *A_; }
+    void setNumThreads(unsigned num_threads) { num_threads_ = num_threads; }
+
+    // y += alpha * A * x
+    void multiplyAdd(const Eigen::Ref<const Eigen::VectorXd>& x, Eigen::Ref<Eigen::VectorXd> y, double alpha = 1.0) const;
+
+    template <typename Rhs>
+    Eigen::Product<SymmetricSparseOperator, Rhs, Eigen::AliasFreeProduct> operator*(
+        const Eigen::MatrixBase<Rhs>& x) const {
+        return Eigen::Product<SymmetricSparseOperator, Rhs, Eigen::AliasFreeProduct>(*this, x.derived());
+    }
+
+private:
+    const Eigen::SparseMatrix<double>* A_;
+    unsigned num_threads_;
+};
+
+namespace Eigen {
+namespace internal {
+template <typename Rhs>
+struct generic_product_impl<SymmetricSparseOperator, Rhs, SparseShape, DenseShape, GemvProduct>
+    : generic_product_impl_base<SymmetricSparseOperator, Rhs, generic_product_impl<SymmetricSparseOperator, Rhs>> {
+    typedef typename Product<SymmetricSparseOperator, Rhs>::Scalar Scalar;
+
+    template <typename Dest>
+    static void scaleAndAddTo(Dest& dst, const SymmetricSparseOperator& lhs, const Rhs& rhs, const Scalar& alpha) {
+        lhs.multiplyAdd(rhs, dst, alpha);
+    }
+};
+} // namespace internal
+} // namespace Eigen
@@ -13,6 +13,8 @@ Tet4Element::Tet4Element(const std::vector<Node>& nodes) {
     }
 }
 
+Tet4Element::Tet4Element(const Eigen::Matrix<double, 4, 3>& node_coords) : node_coords_(node_coords) {}
+
 double Tet4Element::getVolume() const {
     Eigen::Matrix4d m;
     m.block<4, 3>(0, 0) = node_coords_;
@@ -58,6 +60,24 @@ Eigen::Matrix<double, 12, 12> Tet4Element::calculateStiffnessMatrix(const Materi
     return B.transpose() * D * B * volume;
 }
 
+Eigen::Matrix<double, 12, 12> Tet4Element::calculateMassMatrix(double density) const {
+    double m = density * getVolume() / 20.0;
+    Eigen::Matrix<double, 12, 12> me = Eigen::Matrix<double, 12, 12>::Zero();
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            double mij = i == j ? 2.0 * m : m;
+            for (int c = 0; c < 3; ++c) {
+                me(3 * i + c, 3 * j + c) = mij;
+            }
+        }
+    }
+    return me;
+}
+
+Eigen::Matrix<double, 12, 12> Tet4Element::calculateLumpedMassMatrix(double density) const {
+    return Eigen::Matrix<double, 12, 12>::Identity() * (density * getVolume() / 4.0);
+}
+
 Eigen::Matrix<double, 6, 1> Tet4Element::calculateStrain(const Eigen::Matrix<double, 12, 1>& element_displacements) const {
     Eigen::Matrix<double, 6, 12> B = this->calculateBMatrix();
     return B * element_displacements;
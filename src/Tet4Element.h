@@ -8,16 +8,21 @@
 class Tet4Element {
 public:
     Tet4Element(const std::vector<Node>& nodes);
+    explicit Tet4Element(const Eigen::Matrix<double, 4, 3>& node_coords); // One row per node
     double getVolume() const;
     Eigen::Matrix<double, 12, 12> calculateStiffnessMatrix(const Material& mat) const;
+    // Consistent mass rho * integral(N^T N): rho V / 20 * (1 + delta_ij) per
+    // direction. The lumped matrix is its row sum, rho V / 4 on the diagonal.
+    Eigen::Matrix<double, 12, 12> calculateMassMatrix(double density) const;
+    Eigen::Matrix<double, 12, 12> calculateLumpedMassMatrix(double density) const;
     
     // --- NEW METHODS ---
     Eigen::Matrix<double, 6, 1> calculateStrain(const Eigen::Matrix<double, 12, 1>& element_displacements) const;
     Eigen::Matrix<double, 6, 1> calculateStress(const Eigen::Matrix<double, 12, 1>& element_displacements, const Material& mat) const;
 
+    // Strain-displacement matrix; zero for a degenerate element
+    Eigen::Matrix<double, 6, 12> calculateBMatrix() const;
+
 private:
     Eigen::Matrix<double, 4, 3> node_coords_;
-
-    // --- NEW PRIVATE HELPER ---
-    Eigen::Matrix<double, 6, 12> calculateBMatrix() const;
 };
\ No newline at end of file
@@ -0,0 +1,282 @@
+#include "Tet4Kernel.h"
+#include <cstring>
+
+namespace {
+
+// GCC/Clang vector extension holding W doubles; the compiler maps it onto
+// AVX-512, AVX2 or SSE registers. W = 1 is the plain scalar fallback.
+template <int W>
+struct LaneVector {
+    typedef double type __attribute__((vector_size(W * sizeof(double))));
+};
+
+template <>
+struct LaneVector<1> {
+    typedef double type;
+};
+
+// Wider than the baseline registers; the vectors never leave this file, so
+// GCC's note on their by-value ABI is moot
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+// Kernel bodies are inlined into one entry point per instruction set (see
+// the dispatch below), so each copy is compiled for that set's registers
+#define TET4_INLINE inline __attribute__((always_inline))
+
+template <typename Vec>
+TET4_INLINE Vec load(const double* src) {
+    Vec v;
+    std::memcpy(&v, src, sizeof(Vec));
+    return v;
+}
+
+template <typename Vec>
+TET4_INLINE void store(double* dst, const Vec& v) {
+    std::memcpy(dst, &v, sizeof(Vec));
+}
+
+template <int W>
+TET4_INLINE void geometryKernel(Tet4Batch<W>& batch) {
+    typedef typename LaneVector<W>::type Vec; // One lane per element of the batch
+    const Vec zero = {};
+    const Vec one = zero + 1.0;
+
+    // Gradients grad N_k = (e_m x e_n) / det for the edges e_k = p_k - p_0,
+    // and grad N_0 = -(grad N_1 + grad N_2 + grad N_3)
+    Vec x0 = load<Vec>(batch.x[0]), y0 = load<Vec>(batch.y[0]), z0 = load<Vec>(batch.z[0]);
+    Vec e1x = load<Vec>(batch.x[1]) - x0, e1y = load<Vec>(batch.y[1]) - y0, e1z = load<Vec>(batch.z[1]) - z0;
+    Vec e2x = load<Vec>(batch.x[2]) - x0, e2y = load<Vec>(batch.y[2]) - y0, e2z = load<Vec>(batch.z[2]) - z0;
+    Vec e3x = load<Vec>(batch.x[3]) - x0, e3y = load<Vec>(batch.y[3]) - y0, e3z = load<Vec>(batch.z[3]) - z0;
+
+    Vec grad[4][3];
+    grad[1][0] = e2y * e3z - e2z * e3y; grad[1][1] = e2z * e3x - e2x * e3z; grad[1][2] = e2x * e3y - e2y * e3x;
+    grad[2][0] = e3y * e1z - e3z * e1y; grad[2][1] = e3z * e1x - e3x * e1z; grad[2][2] = e3x * e1y - e3y * e1x;
+    grad[3][0] = e1y * e2z - e1z * e2y; grad[3][1] = e1z * e2x - e1x * e2z; grad[3][2] = e1x * e2y - e1y * e2x;
+
+    Vec det = e1x * grad[1][0] + e1y * grad[1][1] + e1z * grad[1][2]; // 6 * signed volume
+    Vec abs_det = det < zero ? -det : det;
+    Vec inv_det = abs_det < 1e-12 ? zero : one / det;
+    store(batch.geometry.volume, abs_det < 1e-12 ? zero : abs_det * (1.0 / 6.0));
+    for (int d = 0; d < 3; ++d) {
+        for (int k = 1; k < 4; ++k) {
+            grad[k][d] *= inv_det;
+            store(batch.geometry.grad[k][d], grad[k][d]);
+        }
+        store(batch.geometry.grad[0][d], -(grad[1][d] + grad[2][d] + grad[3][d]));
+    }
+}
+
+template <int W>
+TET4_INLINE void stiffnessKernel(Tet4Batch<W>& batch, const Eigen::Matrix<double, 6, 6>& D) {
+    typedef typename LaneVector<W>::type Vec;
+    Vec grad[4][3];
+    for (int k = 0; k < 4; ++k) {
+        for (int d = 0; d < 3; ++d) {
+            grad[k][d] = load<Vec>(batch.geometry.grad[k][d]);
+        }
+    }
+    Vec volume = load<Vec>(batch.geometry.volume);
+
+    // 1. V * D * B_j, using the three nonzeros in each column of the nodal block
+    //    B_j = [a 0 0; 0 b 0; 0 0 c; b a 0; 0 c b; c 0 a] with (a, b, c) = grad N_j
+    Vec vdb[4][3][6];
+    for (int j = 0; j < 4; ++j) {
+        Vec a = grad[j][0] * volume, b = grad[j][1] * volume, c = grad[j][2] * volume;
+        for (int r = 0; r < 6; ++r) {
+            vdb[j][0][r] = D(r, 0) * a + D(r, 3) * b + D(r, 5) * c;
+            vdb[j][1][r] = D(r, 1) * b + D(r, 3) * a + D(r, 4) * c;
+            vdb[j][2][r] = D(r, 2) * c + D(r, 4) * b + D(r, 5) * a;
+        }
+    }
+
+    // 2. Upper triangle of ke: block (i, j) = B_i^T (V D B_j), again skipping B's zeros
+    for (int i = 0; i < 4; ++i) {
+        Vec a = grad[i][0], b = grad[i][1], c = grad[i][2];
+        for (int j = i; j < 4; ++j) {
+            for (int s = 0; s < 3; ++s) {
+                const Vec* v = vdb[j][s];
+                int col = 3 * j + s;
+                store(batch.ke[tet4PackedIndex(3 * i + 0, col)], a * v[0] + b * v[3] + c * v[5]);
+                if (i != j || s >= 1) { // Diagonal blocks stop at the diagonal
+                    store(batch.ke[tet4PackedIndex(3 * i + 1, col)], b * v[1] + a * v[3] + c * v[4]);
+                }
+                if (i != j || s >= 2) {
+                    store(batch.ke[tet4PackedIndex(3 * i + 2, col)], c * v[2] + b * v[4] + a * v[5]);
+                }
+            }
+        }
+    }
+}
+
+template <int W>
+TET4_INLINE void internalForcesKernel(const Tet4Geometry<W>& geometry, const Eigen::Matrix<double, 6, 6>& D,
+                                      const double (&u)[12][W], double (&f)[12][W]) {
+    typedef typename LaneVector<W>::type Vec;
+    Vec grad[4][3];
+    for (int k = 0; k < 4; ++k) {
+        for (int d = 0; d < 3; ++d) {
+            grad[k][d] = load<Vec>(geometry.grad[k][d]);
+        }
+    }
+
+    // 1. Engineering strain B u, from the nodal blocks of B (see above)
+    Vec eps[6] = {};
+    for (int k = 0; k < 4; ++k) {
+        Vec a = grad[k][0], b = grad[k][1], c = grad[k][2];
+        Vec ux = load<Vec>(u[3 * k + 0]), uy = load<Vec>(u[3 * k + 1]), uz = load<Vec>(u[3 * k + 2]);
+        eps[0] += a * ux;
+        eps[1] += b * uy;
+        eps[2] += c * uz;
+        eps[3] += b * ux + a * uy;
+        eps[4] += c * uy + b * uz;
+        eps[5] += c * ux + a * uz;
+    }
+
+    // 2. Volume-weighted stress V D eps
+    Vec volume = load<Vec>(geometry.volume);
+    Vec sigma[6];
+    for (int r = 0; r < 6; ++r) {
+        Vec s = D(r, 0) * eps[0];
+        for (int c = 1; c < 6; ++c) {
+            s += D(r, c) * eps[c];
+        }
+        sigma[r] = s * volume;
+    }
+
+    // 3. f_k = B_k^T sigma
+    for (int k = 0; k < 4; ++k) {
+        Vec a = grad[k][0], b = grad[k][1], c = grad[k][2];
+        store(f[3 * k + 0], a * sigma[0] + b * sigma[3] + c * sigma[5]);
+        store(f[3 * k + 1], b * sigma[1] + a * sigma[3] + c * sigma[4]);
+        store(f[3 * k + 2], c * sigma[2] + b * sigma[4] + a * sigma[5]);
+    }
+}
+
+// One set of entry points per instruction set, for kTet4BatchWidth lanes
+struct Tet4Kernels {
+    typedef Tet4Batch<kTet4BatchWidth> Batch;
+    typedef Tet4Geometry<kTet4BatchWidth> Geometry;
+    typedef double Lanes[12][kTet4BatchWidth];
+
+    void (*geometry)(Batch&);
+    void (*stiffness)(Batch&, const Eigen::Matrix<double, 6, 6>&);
+    void (*internal_forces)(const Geometry&, const Eigen::Matrix<double, 6, 6>&, const Lanes&, Lanes&);
+    const char* isa;
+};
+
+#define TET4_KERNEL_SET(name, ...)                                                                            \
+    __VA_ARGS__ void name##Geometry(Tet4Kernels::Batch& batch) { geometryKernel(batch); }                    \
+    __VA_ARGS__ void name##Stiffness(Tet4Kernels::Batch& batch, const Eigen::Matrix<double, 6, 6>& D) {       \
+        stiffnessKernel(batch, D);                                                                           \
+    }                                                                                                        \
+    __VA_ARGS__ void name##InternalForces(const Tet4Kernels::Geometry& geometry,                             \
+                                          const Eigen::Matrix<double, 6, 6>& D, const Tet4Kernels::Lanes& u, \
+                                          Tet4Kernels::Lanes& f) {                                           \
+        internalForcesKernel(geometry, D, u, f);                                                             \
+    }
+
+TET4_KERNEL_SET(baseline)
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TET4_KERNEL_DISPATCH 1
+TET4_KERNEL_SET(avx2, __attribute__((target("avx2,fma"))))
+TET4_KERNEL_SET(avx512, __attribute__((target("avx512f,avx2,fma"))))
+#endif
+
+// Picked once from the CPU the process runs on, so the library itself can be
+// compiled for a generic target
+Tet4Kernels selectKernels() {
+#ifdef TET4_KERNEL_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return {avx512Geometry, avx512Stiffness, avx512InternalForces, "avx512"};
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return {avx2Geometry, avx2Stiffness, avx2InternalForces, "avx2"};
+    }
+#endif
+    return {baselineGeometry, baselineStiffness, baselineInternalForces, "baseline"};
+}
+
+const Tet4Kernels& kernels() {
+    static const Tet4Kernels selected = selectKernels();
+    return selected;
+}
+
+} // namespace
+
+template <int W>
+Eigen::Matrix<double, 12, 12> Tet4Batch<W>::stiffness(int lane) const {
+    Eigen::Matrix<double, 12, 12> out;
+    for (int i = 0; i < 12; ++i) {
+        for (int j = 0; j < 12; ++j) {
+            out(i, j) = stiffness(lane, i, j);
+        }
+    }
+    return out;
+}
+
+template <int W>
+void computeTet4Geometry(Tet4Batch<W>& batch) {
+    if constexpr (W == kTet4BatchWidth) {
+        kernels().geometry(batch);
+    } else {
+        geometryKernel(batch);
+    }
+}
+
+template <int W>
+void computeTet4StiffnessFromGeometry(Tet4Batch<W>& batch, const Eigen::Matrix<double, 6, 6>& D) {
+    if constexpr (W == kTet4BatchWidth) {
+        kernels().stiffness(batch, D);
+    } else {
+        stiffnessKernel(batch, D);
+    }
+}
+
+template <int W>
+void computeTet4InternalForces(const Tet4Geometry<W>& geometry, const Eigen::Matrix<double, 6, 6>& D,
+                               const double (&u)[12][W], double (&f)[12][W]) {
+    if constexpr (W == kTet4BatchWidth) {
+        kernels().internal_forces(geometry, D, u, f);
+    } else {
+        internalForcesKernel(geometry, D, u, f);
+    }
+}
+
+const char* tet4KernelInstructionSet() {
+    return kernels().isa;
+}
+
+template <int W>
+void computeTet4Stiffness(Tet4Batch<W>& batch, const Eigen::Matrix<double, 6, 6>& D) {
+    computeTet4Geometry(batch);
+    computeTet4StiffnessFromGeometry(batch, D);
+}
+
+Eigen::Matrix<double, 12, 12> computeTet4Stiffness(const Eigen::Matrix<double, 4, 3>& coords,
+                                                   const Eigen::Matrix<double, 6, 6>& D) {
+    Tet4Batch<1> batch;
+    for (int i = 0; i < 4; ++i) {
+        batch.x[i][0] = coords(i, 0);
+        batch.y[i][0] = coords(i, 1);
+        batch.z[i][0] = coords(i, 2);
+    }
+    computeTet4Stiffness(batch, D);
+    return batch.stiffness(0);
+}
+
+template struct Tet4Batch<1>;
+template void computeTet4Geometry<1>(Tet4Batch<1>&);
+template void computeTet4StiffnessFromGeometry<1>(Tet4Batch<1>&, const Eigen::Matrix<double, 6, 6>&);
+template void computeTet4Stiffness<1>(Tet4Batch<1>&, const Eigen::Matrix<double, 6, 6>&);
+template void computeTet4InternalForces<1>(const Tet4Geometry<1>&, const Eigen::Matrix<double, 6, 6>&,
+                                           const double (&)[12][1], double (&)[12][1]);
+template struct Tet4Batch<kTet4BatchWidth>;
+template void computeTet4Geometry<kTet4BatchWidth>(Tet4Batch<kTet4BatchWidth>&);
+template void computeTet4StiffnessFromGeometry<kTet4BatchWidth>(Tet4Batch<kTet4BatchWidth>&,
+                                                                const Eigen::Matrix<double, 6, 6>&);
+template void computeTet4Stiffness<kTet4BatchWidth>(Tet4Batch<kTet4BatchWidth>&, const Eigen::Matrix<double, 6, 6>&);
+template void computeTet4InternalForces<kTet4BatchWidth>(const Tet4Geometry<kTet4BatchWidth>&,
+                                                         const Eigen::Matrix<double, 6, 6>&,
+                                                         const double (&)[12][kTet4BatchWidth],
+                                                         double (&)[12][kTet4BatchWidth]);
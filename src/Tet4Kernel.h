@@ -0,0 +1,149 @@
+#pragma once
+
+#include "Mesh.h"
+#include <Eigen/Dense>
+
+// Elements per batched kernel call: one AVX-512 register of doubles, two AVX2
+// or four SSE registers. The instruction set is picked at run time (see
+// tet4KernelInstructionSet), so the width and the batch layout are fixed.
+constexpr int kTet4BatchWidth = 8;
+
+// Number of entries in the upper triangle of a 12x12 element matrix
+constexpr int kTet4PackedSize = 78;
+
+// Position of ke(i, j) in the packed row-major upper triangle
+constexpr int tet4PackedIndex(int i, int j) {
+    return i <= j ? i * 12 - i * (i - 1) / 2 + (j - i) : j * 12 - j * (j - 1) / 2 + (i - j);
+}
+
+// Shape-function gradients and volumes of W tets, lane-major. This is also
+// the block layout of ElementGeometry, so cached blocks copy straight in.
+template <int W>
+struct Tet4Geometry {
+    alignas(64) double grad[4][3][W]; // dN_i/dx, dN_i/dy, dN_i/dz
+    alignas(64) double volume[W];     // Zero for a degenerate element
+};
+
+// Coordinates, geometry and stiffness matrices of W tets, stored lane-major so
+// the kernel's inner loops run across elements and compile to SIMD arithmetic.
+template <int W>
+struct Tet4Batch {
+    alignas(64) double x[4][W];
+    alignas(64) double y[4][W];
+    alignas(64) double z[4][W];
+    Tet4Geometry<W> geometry;
+    alignas(64) double ke[kTet4PackedSize][W]; // Upper triangle only, ke is symmetric
+
+    double stiffness(int lane, int i, int j) const { return ke[tet4PackedIndex(i, j)][lane]; }
+    Eigen::Matrix<double, 12, 12> stiffness(int lane) const;
+};
+
+// Closed-form shape-function gradients and volumes from the coordinates, via
+// edge cross products. Degenerate lanes (|6V| < 1e-12) get all zeros.
+template <int W>
+void computeTet4Geometry(Tet4Batch<W>& batch);
+
+// ke from batch.geometry, forming only the nonzeros of B^T D B.
+template <int W>
+void computeTet4StiffnessFromGeometry(Tet4Batch<W>& batch, const Eigen::Matrix<double, 6, 6>& D);
+
+// Both steps: coordinates to ke. Degenerate lanes get a zero matrix, like Tet4Element.
+template <int W>
+void computeTet4Stiffness(Tet4Batch<W>& batch, const Eigen::Matrix<double, 6, 6>& D);
+
+// Internal forces f = V B^T D B u of W tets straight from their geometry,
+// without forming ke: u and f hold the 12 element DOFs lane-major,
+// u[3 * node + dim][lane]. Zero-volume lanes get zero forces.
+template <int W>
+void computeTet4InternalForces(const Tet4Geometry<W>& geometry, const Eigen::Matrix<double, 6, 6>& D,
+                               const double (&u)[12][W], double (&f)[12][W]);
+
+// Instruction set the kTet4BatchWidth kernels were dispatched to on this CPU:
+// "avx512", "avx2" or "baseline" (whatever the compiler targets by default)
+const char* tet4KernelInstructionSet();
+
+// Single-element scalar path of the same kernel.
+Eigen::Matrix<double, 12, 12> computeTet4Stiffness(const Eigen::Matrix<double, 4, 3>& coords,
+                                                   const Eigen::Matrix<double, 6, 6>& D);
+
+// Feeds the Tet4 elements element_at(0 .. count-1) through the kernel in
+// batches of kTet4BatchWidth: gathers each batch, fills batch.geometry and
+// calls batch_fn(batch, elements, lanes) with the element of every used lane.
+// Elements of other types are skipped. With cached geometry blocks (see
+// ElementGeometry) the gradients are copied rather than recomputed.
+template <typename ElementAt, typename BatchFn>
+void forEachTet4Batch(const Mesh& mesh, size_t count, ElementAt&& element_at, BatchFn&& batch_fn,
+                      const Tet4Geometry<kTet4BatchWidth>* cached = nullptr) {
+    const int W = kTet4BatchWidth;
+    const auto& x = mesh.getX();
+    const auto& y = mesh.getY();
+    const auto& z = mesh.getZ();
+    Tet4Batch<W> batch;
+    size_t batch_elements[W];
+
+    size_t k = 0;
+    while (k < count) {
+        // 1. Gather up to a full batch of Tet4 elements
+        int lanes = 0;
+        for (; k < count && lanes < W; ++k) {
+            size_t e = element_at(k);
+            if (mesh.getElementNumNodes(e) != 4) {
+                continue;
+            }
+            if (cached) {
+                const Tet4Geometry<W>& block = cached[e / W];
+                for (int i = 0; i < 4; ++i) {
+                    for (int d = 0; d < 3; ++d) {
+                        batch.geometry.grad[i][d][lanes] = block.grad[i][d][e % W];
+                    }
+                }
+                batch.geometry.volume[lanes] = block.volume[e % W];
+            } else {
+                const int* nodes = mesh.getElementNodes(e);
+                for (int i = 0; i < 4; ++i) {
+                    batch.x[i][lanes] = x[nodes[i]];
+                    batch.y[i][lanes] = y[nodes[i]];
+                    batch.z[i][lanes] = z[nodes[i]];
+                }
+            }
+            batch_elements[lanes++] = e;
+        }
+        if (lanes == 0) {
+            break;
+        }
+
+        // 2. Pad a partial batch with zero-volume lanes
+        for (int l = lanes; l < W; ++l) {
+            for (int i = 0; i < 4; ++i) {
+                batch.x[i][l] = batch.y[i][l] = batch.z[i][l] = 0.0;
+                for (int d = 0; d < 3; ++d) {
+                    batch.geometry.grad[i][d][l] = 0.0;
+                }
+            }
+            batch.geometry.volume[l] = 0.0;
+        }
+
+        // 3. Geometry, then hand the batch out
+        if (!cached) {
+            computeTet4Geometry(batch);
+        }
+        batch_fn(batch, static_cast<const size_t*>(batch_elements), lanes);
+    }
+}
+
+// As forEachTet4Batch, additionally computing ke and calling fn(e, batch, lane)
+// for each element in order.
+template <typename ElementAt, typename Fn>
+void forEachTet4Stiffness(const Mesh& mesh, const Eigen::Matrix<double, 6, 6>& D, size_t count,
+                          ElementAt&& element_at, Fn&& fn,
+                          const Tet4Geometry<kTet4BatchWidth>* cached = nullptr) {
+    forEachTet4Batch(
+        mesh, count, element_at,
+        [&](Tet4Batch<kTet4BatchWidth>& batch, const size_t* elements, int lanes) {
+            computeTet4StiffnessFromGeometry(batch, D);
+            for (int l = 0; l < lanes; ++l) {
+                fn(elements[l], batch, l);
+            }
+        },
+        cached);
+}
@@ -0,0 +1,297 @@
+#include "VtuWriter.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#ifdef FEM_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+// Bytes per compressed block and per staging buffer for converted arrays
+const size_t kBlockBytes = 1 << 20;
+// Offsets in the XML header are zero-padded to this width and patched once the
+// appended data has been written, so the header can precede the data
+const int kOffsetWidth = 20;
+
+uint8_t vtkCellType(ElementType type) {
+    switch (type) {
+    case ElementType::Tet4: return 10;  // VTK_TETRA
+    case ElementType::Hex8: return 12;  // VTK_HEXAHEDRON
+    case ElementType::Tet10: return 24; // VTK_QUADRATIC_TETRA
+    default: return 2;                  // VTK_POLY_VERTEX
+    }
+}
+
+// One DataArray in the appended block: an 8-byte size header followed by the
+// raw bytes, or for zlib the vtkZLibDataCompressor block table followed by the
+// compressed blocks.
+class AppendedArrayWriter {
+public:
+    AppendedArrayWriter(std::ofstream& out, bool compress) : out_(out), compress_(compress) {}
+
+    void begin(uint64_t total_bytes) {
+        if (!compress_) {
+            out_.write(reinterpret_cast<const char*>(&total_bytes), sizeof(total_bytes));
+            return;
+        }
+        // Reserve the block table: count, block size, last block size, compressed sizes
+        uint64_t num_blocks = (total_bytes + kBlockBytes - 1) / kBlockBytes;
+        table_.assign(3 + num_blocks, 0);
+        table_[0] = num_blocks;
+        table_[1] = kBlockBytes;
+        table_[2] = num_blocks == 0 ? 0 : total_bytes - (num_blocks - 1) * kBlockBytes;
+        table_pos_ = out_.tellp();
+        out_.write(reinterpret_cast<const char*>(table_.data()), table_.size() * sizeof(uint64_t));
+        block_.clear();
+        block_.reserve(kBlockBytes);
+        next_block_ = 0;
+    }
+
+    void write(const void* data, size_t bytes) {
+        if (!compress_) {
+            out_.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+            return;
+        }
+        const char* p = static_cast<const char*>(data);
+        while (bytes > 0) {
+            size_t take = std::min(bytes, kBlockBytes - block_.size());
+            block_.insert(block_.end(), p, p + take);
+            p += take;
+            bytes -= take;
+            if (block_.size() == kBlockBytes) {
+                flushBlock();
+            }
+        }
+    }
+
+    void end() {
+        if (!compress_) {
+            return;
+        }
+        if (!block_.empty()) {
+            flushBlock();
+        }
+        std::streampos end_pos = out_.tellp();
+        out_.seekp(table_pos_);
+        out_.write(reinterpret_cast<const char*>(table_.data()), table_.size() * sizeof(uint64_t));
+        out_.seekp(end_pos);
+    }
+
+    // True once zlib has rejected a block; the arrays written since are incomplete
+    bool failed() const { return failed_; }
+
+private:
+    void flushBlock() {
+#ifdef FEM_HAVE_ZLIB
+        uLongf size = compressBound(static_cast<uLong>(block_.size()));
+        compressed_.resize(size);
+        if (failed_ ||
+            compress2(reinterpret_cast<Bytef*>(compressed_.data()), &size,
+                      reinterpret_cast<const Bytef*>(block_.data()), static_cast<uLong>(block_.size()),
+                      Z_BEST_SPEED) != Z_OK) {
+            failed_ = true;
+            block_.clear();
+            return;
+        }
+        out_.write(compressed_.data(), static_cast<std::streamsize>(size));
+        table_[3 + next_block_++] = size;
+#endif
+        block_.clear();
+    }
+
+    std::ofstream& out_;
+    bool compress_;
+    std::vector<uint64_t> table_;
+    std::streampos table_pos_;
+    std::vector<char> block_;
+    std::vector<char> compressed_;
+    size_t next_block_ = 0;
+    bool failed_ = false;
+};
+
+// Streams count items produced by fill(first, n, buffer) through a staging buffer
+template <typename T, typename Fill>
+void writeConverted(AppendedArrayWriter& array, size_t count, Fill&& fill) {
+    size_t chunk = kBlockBytes / sizeof(T);
+    std::vector<T> buffer(std::min(chunk, std::max<size_t>(count, 1)));
+    array.begin(count * sizeof(T));
+    for (size_t first = 0; first < count; first += chunk) {
+        size_t n = std::min(chunk, count - first);
+        fill(first, n, buffer.data());
+        array.write(buffer.data(), n * sizeof(T));
+    }
+    array.end();
+}
+
+} // namespace
+
+VtuWriter::VtuWriter(const Mesh& mesh) : mesh_(mesh), compression_(Compression::None) {}
+
+void VtuWriter::setCompression(Compression compression) {
+    compression_ = compression;
+}
+
+bool VtuWriter::zlibAvailable() {
+#ifdef FEM_HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+void VtuWriter::addPointData(const std::string& name, const double* values, int components) {
+    point_fields_.push_back({name, values, components});
+}
+
+void VtuWriter::addCellData(const std::string& name, const double* values, int components) {
+    cell_fields_.push_back({name, values, components});
+}
+
+void VtuWriter::addPointData(const std::string& name, const Eigen::VectorXd& values, int components) {
+    addPointData(name, values.data(), components);
+}
+
+void VtuWriter::addCellData(const std::string& name, const Eigen::VectorXd& values, int components) {
+    addCellData(name, values.data(), components);
+}
+
+bool VtuWriter::write(const std::string& filename) const {
+    FEM_PROFILE_SCOPE("output.vtu");
+    bool compress = compression_ == Compression::Zlib;
+    if (compress && !zlibAvailable()) {
+        std::cerr << "Warning: Built without zlib, writing " << filename << " uncompressed" << std::endl;
+        compress = false;
+    }
+
+    // The buffer must outlive the stream, which flushes into it on close
+    std::unique_ptr<char[]> stream_buffer(new char[kBlockBytes]);
+    std::ofstream out;
+    out.rdbuf()->pubsetbuf(stream_buffer.get(), kBlockBytes);
+    out.open(filename, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open " << filename << " for writing" << std::endl;
+        return false;
+    }
+
+    size_t num_nodes = mesh_.getNumNodes();
+    size_t num_elements = mesh_.getNumElements();
+
+    // 1. XML header with placeholder offsets, one per DataArray in write order
+    std::vector<std::streampos> offset_slots;
+    std::ostringstream xml;
+    auto dataArray = [&](const char* type, const std::string& name, int components) {
+        xml << "        <DataArray type=\"" << type << "\"";
+        if (!name.empty()) {
+            xml << " Name=\"" << name << "\"";
+        }
+        if (components > 1) {
+            xml << " NumberOfComponents=\"" << components << "\"";
+        }
+        xml << " format=\"appended\" offset=\"";
+        offset_slots.push_back(static_cast<std::streamoff>(xml.tellp()));
+        xml << std::string(kOffsetWidth, '0') << "\"/>\n";
+    };
+    xml << "<?xml version=\"1.0\"?>\n"
+        << "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\"LittleEndian\" header_type=\"UInt64\"";
+    if (compress) {
+        xml << " compressor=\"vtkZLibDataCompressor\"";
+    }
+    xml << ">\n  <UnstructuredGrid>\n"
+        << "    <Piece NumberOfPoints=\"" << num_nodes << "\" NumberOfCells=\"" << num_elements << "\">\n";
+    xml << "      <Points>\n";
+    dataArray("Float64", "Points", 3);
+    xml << "      </Points>\n      <Cells>\n";
+    dataArray("Int32", "connectivity", 1);
+    dataArray("Int64", "offsets", 1);
+    dataArray("UInt8", "types", 1);
+    xml << "      </Cells>\n      <PointData>\n";
+    for (const Field& f : point_fields_) {
+        dataArray("Float64", f.name, f.components);
+    }
+    xml << "      </PointData>\n      <CellData>\n";
+    for (const Field& f : cell_fields_) {
+        dataArray("Float64", f.name, f.components);
+    }
+    xml << "      </CellData>\n    </Piece>\n  </UnstructuredGrid>\n  <AppendedData encoding=\"raw\">\n   _";
+    std::string header = xml.str();
+    out.write(header.data(), static_cast<std::streamsize>(header.size()));
+    std::streampos data_start = out.tellp();
+
+    // 2. Appended arrays, recording where each one starts
+    AppendedArrayWriter array(out, compress);
+    std::vector<uint64_t> offsets;
+    auto next = [&]() { offsets.push_back(static_cast<uint64_t>(out.tellp() - data_start)); };
+
+    const auto& x = mesh_.getX();
+    const auto& y = mesh_.getY();
+    const auto& z = mesh_.getZ();
+    next();
+    writeConverted<double>(array, num_nodes * 3, [&](size_t first, size_t n, double* buf) {
+        for (size_t k = 0; k < n; ++k) {
+            size_t i = (first + k) / 3;
+            int c = static_cast<int>((first + k) % 3);
+            buf[k] = c == 0 ? x[i] : (c == 1 ? y[i] : z[i]);
+        }
+    });
+
+    static_assert(sizeof(int) == sizeof(int32_t), "connectivity is written as Int32");
+    next();
+    array.begin(mesh_.getConnectivity().size() * sizeof(int32_t));
+    array.write(mesh_.getConnectivity().data(), mesh_.getConnectivity().size() * sizeof(int32_t));
+    array.end();
+
+    const auto& elem_offsets = mesh_.getElementOffsets();
+    next();
+    writeConverted<int64_t>(array, num_elements, [&](size_t first, size_t n, int64_t* buf) {
+        for (size_t k = 0; k < n; ++k) {
+            buf[k] = static_cast<int64_t>(elem_offsets[first + k + 1]); // VTK stores end offsets
+        }
+    });
+
+    const auto& types = mesh_.getElementTypes();
+    next();
+    writeConverted<uint8_t>(array, num_elements, [&](size_t first, size_t n, uint8_t* buf) {
+        for (size_t k = 0; k < n; ++k) {
+            buf[k] = vtkCellType(types[first + k]);
+        }
+    });
+
+    auto writeField = [&](const Field& f, size_t count) {
+        next();
+        size_t bytes = count * f.components * sizeof(double);
+        array.begin(bytes);
+        array.write(f.values, bytes);
+        array.end();
+    };
+    for (const Field& f : point_fields_) {
+        writeField(f, num_nodes);
+    }
+    for (const Field& f : cell_fields_) {
+        writeField(f, num_elements);
+    }
+    out << "\n  </AppendedData>\n</VTKFile>\n";
+    FEM_PROFILE_ADD("output.vtu_bytes", static_cast<std::streamoff>(out.tellp()));
+
+    // 3. Patch the real offsets into the header
+    for (size_t k = 0; k < offsets.size(); ++k) {
+        std::string digits = std::to_string(offsets[k]);
+        digits.insert(0, kOffsetWidth - digits.size(), '0');
+        out.seekp(offset_slots[k]);
+        out.write(digits.data(), kOffsetWidth);
+    }
+    out.flush();
+    if (array.failed()) {
+        std::cerr << "Error: zlib failed to compress the data of " << filename << std::endl;
+        return false;
+    }
+    if (!out) {
+        std::cerr << "Error: Failed writing " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Mesh.h"
+#include <Eigen/Core>
+#include <string>
+#include <vector>
+
+// Writes a mesh and its result fields as a VTK XML unstructured grid (.vtu)
+// with all arrays in a raw appended block, optionally zlib-compressed. Arrays
+// are streamed to the file in large blocks straight from the mesh and field
+// storage; nothing is formatted as text and no full copy is made.
+//
+// Cell types follow each element's ElementType (Tet4, Hex8, Tet10); elements
+// of unknown type are written as poly-vertex cells.
+class VtuWriter {
+public:
+    enum class Compression { None, Zlib };
+
+    // The mesh and every added field must stay alive until write() returns.
+    explicit VtuWriter(const Mesh& mesh);
+
+    // Zlib falls back to uncompressed output (with a warning) when the
+    // library was built without zlib, see zlibAvailable().
+    void setCompression(Compression compression);
+    static bool zlibAvailable();
+
+    // values holds `components` doubles per node (or per element), contiguous
+    // per entity: a 3-DOF displacement vector, or a column-major 6 x N matrix.
+    void addPointData(const std::string& name, const double* values, int components);
+    void addCellData(const std::string& name, const double* values, int components);
+    void addPointData(const std::string& name, const Eigen::VectorXd& values, int components);
+    void addCellData(const std::string& name, const Eigen::VectorXd& values, int components);
+
+    // Returns false and prints the reason if the file cannot be written or
+    // zlib fails to compress a block
+    bool write(const std::string& filename) const;
+
+private:
+    struct Field {
+        std::string name;
+        const double* values;
+        int components;
+    };
+
+    const Mesh& mesh_;
+    Compression compression_;
+    std::vector<Field> point_fields_;
+    std::vector<Field> cell_fields_;
+};
@@ -0,0 +1,8 @@
+#pragma once
+
+#include "MeshGenerator.h"
+
+// An n x n x n box of unit cubes, each split into 6 tetrahedra.
+inline Mesh makeBoxMesh(int n) {
+    return generateBoxMesh(n, n, n);
+}
@@ -3,7 +3,14 @@
 #include "Mesh.h"
 #include "Material.h"
 #include "Tet4Element.h"
+#include "Parallel.h"
+#include "TestMeshes.h"
+#include <algorithm>
+#include <numeric>
+#include <random>
 #include <vector>
+#include <chrono>
+#include <iostream>
 
 TEST(AssemblerTest, TwoElementAssemblyCheck) {
     // 1. Create a mesh in memory: 5 nodes, 2 tet elements sharing a face
@@ -52,4 +59,215 @@ TEST(AssemblerTest, TwoElementAssemblyCheck) {
     // Check a zero entry. Nodes 1 and 3 are not in the same element.
     // The block connecting them in K should be zero.
     ASSERT_NEAR(K.coeff(0, 6), 0.0, 1e-9);
-}
\ No newline at end of file
+}
+
+TEST(AssemblerTest, ParallelAssemblyIsBitIdentical) {
+    Mesh mesh = makeBoxMesh(12);
+    Material material(210e9, 0.3);
+
+    Assembler serial(1);
+    Assembler parallel(0); // All hardware threads
+
+    auto t0 = std::chrono::steady_clock::now();
+    Eigen::SparseMatrix<double> K_serial = serial.assembleGlobalStiffness(mesh, material);
+    auto t1 = std::chrono::steady_clock::now();
+    Eigen::SparseMatrix<double> K_parallel = parallel.assembleGlobalStiffness(mesh, material);
+    auto t2 = std::chrono::steady_clock::now();
+
+    double serial_s = std::chrono::duration<double>(t1 - t0).count();
+    double parallel_s = std::chrono::duration<double>(t2 - t1).count();
+    std::cout << "[ INFO     ] " << mesh.getNumElements() << " elements, " << resolveThreadCount(0)
+              << " threads: serial " << serial_s << " s, parallel " << parallel_s << " s, speedup "
+              << serial_s / parallel_s << "x" << std::endl;
+
+    // Same sparsity structure and exactly the same values
+    ASSERT_EQ(K_serial.nonZeros(), K_parallel.nonZeros());
+    for (Eigen::Index i = 0; i < K_serial.nonZeros(); ++i) {
+        ASSERT_EQ(K_serial.innerIndexPtr()[i], K_parallel.innerIndexPtr()[i]);
+        ASSERT_EQ(K_serial.valuePtr()[i], K_parallel.valuePtr()[i]);
+    }
+    for (Eigen::Index j = 0; j <= K_serial.outerSize(); ++j) {
+        ASSERT_EQ(K_serial.outerIndexPtr()[j], K_parallel.outerIndexPtr()[j]);
+    }
+}
+
+TEST(AssemblerTest, ParallelAssemblyWithMoreThreadsThanElements) {
+    Mesh mesh = makeBoxMesh(1); // 6 elements
+    Material material(210e9, 0.3);
+
+    Eigen::SparseMatrix<double> K_serial = Assembler(1).assembleGlobalStiffness(mesh, material);
+    Eigen::SparseMatrix<double> K_parallel = Assembler(16).assembleGlobalStiffness(mesh, material);
+
+    ASSERT_EQ((K_serial - K_parallel).norm(), 0.0);
+}
+
+TEST(AssemblerTest, PatternAssemblyMatchesTripletAssembly) {
+    Mesh mesh = makeBoxMesh(4);
+    Material material(210e9, 0.3);
+    Assembler assembler;
+
+    AssemblyPattern pattern = assembler.buildPattern(mesh);
+    Eigen::SparseMatrix<double> K_pattern = assembler.assembleGlobalStiffness(mesh, material, pattern);
+    Eigen::SparseMatrix<double> K_triplet = assembler.assembleGlobalStiffness(mesh, material);
+
+    ASSERT_EQ(K_pattern.rows(), K_triplet.rows());
+    ASSERT_LE((K_pattern - K_triplet).norm(), 1e-12 * K_triplet.norm());
+
+    // Neighbouring elements must never share a color
+    std::vector<int> last_color(mesh.getNumNodes(), -1);
+    const ElementColoring& coloring = pattern.coloring;
+    for (size_t c = 0; c < coloring.numColors(); ++c) {
+        for (size_t k = coloring.offsets[c]; k < coloring.offsets[c + 1]; ++k) {
+            size_t e = coloring.elements[k];
+            for (size_t i = 0; i < mesh.getElementNumNodes(e); ++i) {
+                int node = mesh.getElementNodes(e)[i];
+                ASSERT_NE(last_color[node], static_cast<int>(c));
+                last_color[node] = static_cast<int>(c);
+            }
+        }
+    }
+}
+
+TEST(AssemblerTest, NumericReassemblyReusesStorage) {
+    Mesh mesh = makeBoxMesh(3);
+    Assembler assembler(0);
+    AssemblyPattern pattern = assembler.buildPattern(mesh);
+
+    Eigen::SparseMatrix<double> K;
+    assembler.assembleNumeric(mesh, Material(210e9, 0.3), pattern, K);
+    const double* storage = K.valuePtr();
+
+    // A material change only needs the numeric pass, into the same buffer
+    Material aluminium(70e9, 0.33);
+    assembler.assembleNumeric(mesh, aluminium, pattern, K);
+    ASSERT_EQ(K.valuePtr(), storage);
+
+    Eigen::SparseMatrix<double> K_ref = Assembler(1).assembleGlobalStiffness(mesh, aluminium);
+    ASSERT_LE((K - K_ref).norm(), 1e-12 * K_ref.norm());
+
+    // Colored scattering gives the same bits for any thread count
+    Eigen::SparseMatrix<double> K_serial;
+    Assembler(1).assembleNumeric(mesh, aluminium, pattern, K_serial);
+    for (Eigen::Index i = 0; i < K.nonZeros(); ++i) {
+        ASSERT_EQ(K.valuePtr()[i], K_serial.valuePtr()[i]);
+    }
+}
+
+TEST(AssemblerTest, NumericReassemblyRebuildsAnotherPatternOfTheSameSize) {
+    // Renumbering the nodes keeps the size and nonzero count but moves the entries
+    Mesh mesh = makeBoxMesh(3);
+    Mesh renumbered = mesh;
+    std::vector<int> shuffled(mesh.getNumNodes());
+    std::iota(shuffled.begin(), shuffled.end(), 0);
+    std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(5));
+    renumbered.permuteNodes(shuffled);
+    Material steel(210e9, 0.3);
+    steel.setDensity(7850.0);
+
+    Assembler assembler;
+    AssemblyPattern pattern = assembler.buildPattern(mesh);
+    AssemblyPattern other = assembler.buildPattern(renumbered);
+    ASSERT_EQ(other.structure.nonZeros(), pattern.structure.nonZeros());
+
+    Eigen::SparseMatrix<double> K, M;
+    assembler.assembleNumeric(mesh, steel, pattern, K);
+    assembler.assembleMassNumeric(mesh, steel, pattern, MassMatrixType::Consistent, M);
+    assembler.assembleNumeric(renumbered, steel, other, K);
+    assembler.assembleMassNumeric(renumbered, steel, other, MassMatrixType::Consistent, M);
+
+    Eigen::SparseMatrix<double> K_ref = assembler.assembleGlobalStiffness(renumbered, steel);
+    Eigen::SparseMatrix<double> M_ref = assembler.assembleGlobalMass(renumbered, steel);
+    EXPECT_LE((K - K_ref).norm(), 1e-12 * K_ref.norm());
+    EXPECT_LE((M - M_ref).norm(), 1e-12 * M_ref.norm());
+}
+
+TEST(AssemblerTest, BlockAssemblyMatchesScalarAssembly) {
+    Mesh mesh = makeBoxMesh(4);
+    Material material(210e9, 0.3);
+    Assembler assembler(0);
+    AssemblyPattern pattern = assembler.buildPattern(mesh);
+    Eigen::SparseMatrix<double> K = assembler.assembleGlobalStiffness(mesh, material, pattern);
+
+    // Same pattern and values once expanded, the same bits for any thread count
+    SymmetricBlockMatrix K_blocks = assembler.assembleBlockStiffness(mesh, material, pattern);
+    Eigen::SparseMatrix<double> K_expanded = K_blocks.toEigen();
+    ASSERT_EQ(K_expanded.nonZeros(), K.nonZeros());
+    for (Eigen::Index k = 0; k < K.nonZeros(); ++k) {
+        ASSERT_EQ(K_expanded.innerIndexPtr()[k], K.innerIndexPtr()[k]);
+    }
+    ASSERT_LE((K_expanded - K).norm(), 1e-12 * K.norm());
+
+    SymmetricBlockMatrix K_serial;
+    Assembler(1).assembleNumeric(mesh, material, pattern, K_serial);
+    ASSERT_EQ(K_serial.nonZeroBlocks(), K_blocks.nonZeroBlocks());
+    for (Eigen::Index k = 0; k < K_blocks.nonZeroBlocks(); ++k) {
+        for (int i = 0; i < 9; ++i) {
+            ASSERT_EQ(K_serial.blockValues(k)[i], K_blocks.blockValues(k)[i]);
+        }
+    }
+
+    // Reassembly keeps the storage
+    const double* storage = K_serial.blockValues(0);
+    Assembler(1).assembleNumeric(mesh, Material(70e9, 0.33), pattern, K_serial);
+    EXPECT_EQ(K_serial.blockValues(0), storage);
+}
+
+TEST(AssemblerTest, NonContiguousNodeIdsAssembleLikeContiguousOnes) {
+    // Same box, with node IDs scattered over a sparse range
+    Mesh contiguous = makeBoxMesh(3);
+    Mesh scattered;
+    for (size_t i = 0; i < contiguous.getNumNodes(); ++i) {
+        scattered.addNode(1000 + 7 * contiguous.getNodeIds()[i], contiguous.getX()[i], contiguous.getY()[i],
+                          contiguous.getZ()[i]);
+    }
+    for (size_t e = 0; e < contiguous.getNumElements(); ++e) {
+        std::vector<int> ids;
+        for (size_t i = 0; i < contiguous.getElementNumNodes(e); ++i) {
+            ids.push_back(scattered.getNodeIds()[contiguous.getElementNodes(e)[i]]);
+        }
+        scattered.addElement(ids);
+    }
+
+    Material material(210e9, 0.3);
+    Assembler assembler;
+    Eigen::SparseMatrix<double> K_ref = assembler.assembleGlobalStiffness(contiguous, material);
+    Eigen::SparseMatrix<double> K_triplet = assembler.assembleGlobalStiffness(scattered, material);
+    Eigen::SparseMatrix<double> K_pattern =
+        assembler.assembleGlobalStiffness(scattered, material, assembler.buildPattern(scattered));
+
+    ASSERT_EQ((K_triplet - K_ref).norm(), 0.0);
+    ASSERT_LE((K_pattern - K_ref).norm(), 1e-12 * K_ref.norm());
+}
+
+TEST(AssemblerTest, MassMatrixSharesThePatternAndCarriesTheTotalMass) {
+    Mesh mesh = makeBoxMesh(3);
+    Material steel(210e9, 0.3);
+    steel.setDensity(7850.0);
+    const double mass = 7850.0 * 27.0;
+
+    Assembler assembler(2);
+    AssemblyPattern pattern = assembler.buildPattern(mesh);
+    Eigen::SparseMatrix<double> M = assembler.assembleGlobalMass(mesh, steel, pattern);
+    Eigen::SparseMatrix<double> M_lumped = assembler.assembleGlobalMass(mesh, steel, pattern, MassMatrixType::Lumped);
+    ASSERT_EQ(M.nonZeros(), pattern.structure.nonZeros());
+    ASSERT_EQ(M_lumped.nonZeros(), pattern.structure.nonZeros());
+    EXPECT_LE((Eigen::SparseMatrix<double>(M.transpose()) - M).norm(), 0.0);
+
+    // Rigid translations carry the whole mass; lumping keeps the row sums
+    Eigen::VectorXd row_sums = M * Eigen::VectorXd::Ones(M.cols());
+    for (int c = 0; c < 3; ++c) {
+        Eigen::VectorXd u = Eigen::VectorXd::Zero(M.rows());
+        for (Eigen::Index n = 0; n < u.size() / 3; ++n) {
+            u(3 * n + c) = 1.0;
+        }
+        EXPECT_NEAR(u.dot(M * u), mass, 1e-10 * mass);
+        EXPECT_NEAR(u.dot(M_lumped * u), mass, 1e-10 * mass);
+    }
+    EXPECT_LE((row_sums - M_lumped.diagonal()).norm(), 1e-10 * mass);
+    EXPECT_NEAR(M_lumped.diagonal().sum(), 3.0 * mass, 1e-10 * mass);
+
+    // Same result on one thread, and without density there is no mass
+    Eigen::SparseMatrix<double> serial = Assembler().assembleGlobalMass(mesh, steel);
+    EXPECT_LE((serial - M).norm(), 1e-12 * M.norm());
+    EXPECT_EQ(Assembler().assembleGlobalMass(mesh, Material(210e9, 0.3)).norm(), 0.0);
+}
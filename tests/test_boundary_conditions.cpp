@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include "BoundaryConditions.h"
+#include "Assembler.h"
+#include "LinearSolver.h"
+#include "Mesh.h"
+#include "Material.h"
+#include "TestMeshes.h"
+#include <Eigen/SparseLU>
+#include <vector>
+
+// IDs of the nodes satisfying a predicate
+template <typename Pred>
+static std::vector<int> selectNodes(const Mesh& mesh, Pred pred) {
+    std::vector<int> ids;
+    for (const auto& n : mesh.getNodes()) {
+        if (pred(n)) {
+            ids.push_back(n.id);
+        }
+    }
+    return ids;
+}
+
+TEST(BoundaryConditionsTest, ReducedNumberingSkipsConstrainedDofs) {
+    Mesh mesh = makeBoxMesh(1);
+    BoundaryConditions bcs(mesh);
+    bcs.fixNode(1);
+    bcs.prescribe(3, 2, 0.5);
+
+    ASSERT_EQ(bcs.getNumDofs(), 24u);
+    ASSERT_EQ(bcs.getNumConstrainedDofs(), 4u);
+    ASSERT_EQ(bcs.getNumFreeDofs(), 20u);
+    ASSERT_EQ(bcs.getReducedIndex(0), -1);
+    ASSERT_EQ(bcs.getReducedIndex(3), 0);
+    ASSERT_EQ(bcs.getReducedIndex(8), -1); // Node 3, z
+    ASSERT_EQ(bcs.getReducedIndex(9), 5);
+    ASSERT_THROW(bcs.prescribe(9, 0, 0.0), std::out_of_range);
+}
+
+TEST(BoundaryConditionsTest, EliminationMatchesPenaltyMethod) {
+    Mesh mesh = makeBoxMesh(3);
+    Eigen::SparseMatrix<double> K = Assembler().assembleGlobalStiffness(mesh, Material(210e9, 0.3));
+    Eigen::VectorXd F = Eigen::VectorXd::Zero(K.rows());
+    F(F.size() - 1) = -1e7;
+
+    BoundaryConditions bcs(mesh);
+    std::vector<int> bottom = selectNodes(mesh, [](const Node& n) { return n.z == 0.0; });
+    bcs.fixNodes(bottom);
+
+    Eigen::SparseMatrix<double> K_ff;
+    Eigen::VectorXd F_f;
+    bcs.reduce(K, F, K_ff, F_f);
+    ASSERT_EQ(K_ff.rows(), static_cast<Eigen::Index>(bcs.getNumFreeDofs()));
+
+    LinearSolver solver(SolverType::LLT);
+    Eigen::VectorXd U_f;
+    ASSERT_TRUE(solver.compute(K_ff));
+    ASSERT_TRUE(solver.solve(F_f, U_f));
+    Eigen::VectorXd U = bcs.expand(U_f);
+
+    // Reference: the penalty approach fem_app used before
+    Eigen::SparseMatrix<double> K_pen = K;
+    Eigen::VectorXd F_pen = F;
+    double penalty = 1e12 * K.diagonal().mean();
+    for (int id : bottom) {
+        for (int c = 0; c < 3; ++c) {
+            K_pen.coeffRef((id - 1) * 3 + c, (id - 1) * 3 + c) += penalty;
+            F_pen((id - 1) * 3 + c) = 0.0;
+        }
+    }
+    Eigen::SparseLU<Eigen::SparseMatrix<double>> lu(K_pen);
+    Eigen::VectorXd U_pen = lu.solve(F_pen);
+
+    ASSERT_LE((U - U_pen).norm(), 1e-6 * U_pen.norm());
+    for (int id : bottom) {
+        ASSERT_EQ(U((id - 1) * 3 + 2), 0.0);
+    }
+}
+
+TEST(BoundaryConditionsTest, PrescribedLinearFieldPassesPatchTest) {
+    // Prescribe u = (eps * x, 0, 0) on the whole boundary; linear tets must
+    // reproduce the same field exactly at the interior nodes.
+    Mesh mesh = makeBoxMesh(3);
+    const double eps = 1e-3;
+    Eigen::SparseMatrix<double> K = Assembler().assembleGlobalStiffness(mesh, Material(210e9, 0.3));
+    Eigen::VectorXd F = Eigen::VectorXd::Zero(K.rows());
+
+    BoundaryConditions bcs(mesh);
+    auto on_boundary = [](const Node& n) {
+        return n.x == 0.0 || n.x == 3.0 || n.y == 0.0 || n.y == 3.0 || n.z == 0.0 || n.z == 3.0;
+    };
+    for (const auto& n : mesh.getNodes()) {
+        if (on_boundary(n)) {
+            bcs.prescribe(n.id, 0, eps * n.x);
+            bcs.prescribe(n.id, 1, 0.0);
+            bcs.prescribe(n.id, 2, 0.0);
+        }
+    }
+    ASSERT_EQ(bcs.getNumFreeDofs(), 8u * 3u); // 2x2x2 interior nodes
+
+    Eigen::SparseMatrix<double> K_ff;
+    Eigen::VectorXd F_f;
+    bcs.reduce(K, F, K_ff, F_f);
+    LinearSolver solver(SolverType::CGJacobi);
+    solver.setTolerance(1e-14);
+    Eigen::VectorXd U_f;
+    ASSERT_TRUE(solver.compute(K_ff));
+    ASSERT_TRUE(solver.solve(F_f, U_f));
+    Eigen::VectorXd U = bcs.expand(U_f);
+
+    for (const auto& n : mesh.getNodes()) {
+        ASSERT_NEAR(U((n.id - 1) * 3 + 0), eps * n.x, 1e-12);
+        ASSERT_NEAR(U((n.id - 1) * 3 + 1), 0.0, 1e-12);
+    }
+}
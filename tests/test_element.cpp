@@ -2,7 +2,11 @@
 #include "Tet4Element.h"
 #include "Node.h"
 #include "Material.h"
+#include "Tet4Kernel.h"
 #include <vector>
+#include <random>
+#include <chrono>
+#include <iostream>
 
 TEST(Tet4ElementTest, VolumeCalculation) {
     // Create nodes for a simple right-angled tetrahedron at the origin
@@ -73,4 +77,128 @@ TEST(Tet4ElementTest, StressCalculation) {
     ASSERT_NEAR(stress(0), expected_stress_x, 1e-9); // Check sigma_x
     ASSERT_NEAR(stress(1), expected_stress_y, 1e-9); // Check sigma_y
     ASSERT_NEAR(stress(3), 0.0, 1e-9);               // Shear stress should be zero
-}
\ No newline at end of file
+}
+
+namespace {
+
+// Random, reasonably shaped tets: a jittered unit corner tet, scaled and shifted
+std::vector<Eigen::Matrix<double, 4, 3>> randomTets(size_t count, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> jitter(-0.2, 0.2), scale(0.01, 10.0), shift(-100.0, 100.0);
+    Eigen::Matrix<double, 4, 3> corner;
+    corner << 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1;
+    std::vector<Eigen::Matrix<double, 4, 3>> tets(count);
+    for (auto& tet : tets) {
+        double s = scale(rng);
+        Eigen::RowVector3d offset(shift(rng), shift(rng), shift(rng));
+        for (int i = 0; i < 4; ++i) {
+            for (int d = 0; d < 3; ++d) {
+                tet(i, d) = (corner(i, d) + jitter(rng)) * s + offset(d);
+            }
+        }
+    }
+    return tets;
+}
+
+} // namespace
+
+TEST(Tet4ElementTest, BatchedKernelMatchesElementStiffness) {
+    Material material(210e9, 0.3);
+    Eigen::Matrix<double, 6, 6> D = material.getDMatrix();
+    std::vector<Eigen::Matrix<double, 4, 3>> tets = randomTets(4 * kTet4BatchWidth, 42);
+    tets[3].row(3) = tets[3].row(0); // Degenerate: two coincident nodes
+
+    for (size_t first = 0; first < tets.size(); first += kTet4BatchWidth) {
+        Tet4Batch<kTet4BatchWidth> batch;
+        for (int l = 0; l < kTet4BatchWidth; ++l) {
+            for (int i = 0; i < 4; ++i) {
+                batch.x[i][l] = tets[first + l](i, 0);
+                batch.y[i][l] = tets[first + l](i, 1);
+                batch.z[i][l] = tets[first + l](i, 2);
+            }
+        }
+        computeTet4Stiffness(batch, D);
+
+        for (int l = 0; l < kTet4BatchWidth; ++l) {
+            if (first + l == 3) {
+                ASSERT_TRUE(batch.stiffness(l).isZero(0.0)); // Degenerate elements contribute nothing
+                ASSERT_TRUE(computeTet4Stiffness(tets[3], D).isZero(0.0));
+                continue;
+            }
+            Eigen::Matrix<double, 12, 12> reference = Tet4Element(tets[first + l]).calculateStiffnessMatrix(material);
+            Eigen::Matrix<double, 12, 12> scalar = computeTet4Stiffness(tets[first + l], D);
+            Eigen::Matrix<double, 12, 12> batched = batch.stiffness(l);
+            double tol = 1e-9 * std::max(reference.norm(), 1.0); // The 4x4 inverse loses digits far from the origin
+            ASSERT_LE((batched - reference).norm(), tol) << "element " << first + l;
+            ASSERT_LE((scalar - reference).norm(), tol) << "element " << first + l;
+            ASSERT_EQ(batched, batched.transpose());
+        }
+    }
+}
+
+TEST(Tet4ElementTest, BatchedKernelThroughput) {
+    Material material(210e9, 0.3);
+    Eigen::Matrix<double, 6, 6> D = material.getDMatrix();
+    std::vector<Eigen::Matrix<double, 4, 3>> tets = randomTets(20000, 7);
+
+    // Reference path: 4x4 inverse and dense B^T D B per element
+    double checksum_ref = 0.0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (const auto& tet : tets) {
+        checksum_ref += Tet4Element(tet).calculateStiffnessMatrix(material)(0, 0);
+    }
+    double ref_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    // Batched kernel
+    double checksum_batch = 0.0;
+    auto t1 = std::chrono::steady_clock::now();
+    Tet4Batch<kTet4BatchWidth> batch;
+    for (size_t first = 0; first < tets.size(); first += kTet4BatchWidth) {
+        for (int l = 0; l < kTet4BatchWidth; ++l) {
+            for (int i = 0; i < 4; ++i) {
+                batch.x[i][l] = tets[first + l](i, 0);
+                batch.y[i][l] = tets[first + l](i, 1);
+                batch.z[i][l] = tets[first + l](i, 2);
+            }
+        }
+        computeTet4Stiffness(batch, D);
+        for (int l = 0; l < kTet4BatchWidth; ++l) {
+            checksum_batch += batch.stiffness(l, 0, 0);
+        }
+    }
+    double batch_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count();
+
+    ASSERT_NEAR(checksum_batch, checksum_ref, 1e-9 * std::abs(checksum_ref));
+    std::cout << "Tet4 stiffness, " << tets.size() << " elements: reference " << ref_seconds << " s, batched ("
+              << kTet4BatchWidth << " lanes, " << tet4KernelInstructionSet() << ") " << batch_seconds
+              << " s, speedup " << ref_seconds / batch_seconds << "x" << std::endl;
+}
+
+TEST(Tet4ElementTest, MassMatricesCarryTheElementMass) {
+    std::vector<Node> nodes = {
+        {1, 0.2, 0.3, 0.1}, {2, 1.5, 0.5, 0.8},
+        {3, 0.9, 1.7, 0.6}, {4, 0.4, 0.6, 1.4}
+    };
+    Tet4Element element(nodes);
+    const double density = 7850.0;
+    double mass = density * element.getVolume();
+
+    Eigen::Matrix<double, 12, 12> consistent = element.calculateMassMatrix(density);
+    Eigen::Matrix<double, 12, 12> lumped = element.calculateLumpedMassMatrix(density);
+    ASSERT_LE((consistent - consistent.transpose()).norm(), 0.0);
+    EXPECT_EQ(consistent.llt().info(), Eigen::Success);
+
+    // A rigid translation in each direction sees the full mass, and the
+    // lumped matrix holds the consistent row sums
+    for (int c = 0; c < 3; ++c) {
+        Eigen::Matrix<double, 12, 1> u = Eigen::Matrix<double, 12, 1>::Zero();
+        for (int i = 0; i < 4; ++i) {
+            u(3 * i + c) = 1.0;
+        }
+        EXPECT_NEAR(u.dot(consistent * u), mass, 1e-12 * mass);
+        EXPECT_NEAR(u.dot(lumped * u), mass, 1e-12 * mass);
+    }
+    Eigen::Matrix<double, 12, 1> row_sums = consistent.rowwise().sum();
+    EXPECT_LE((row_sums - lumped.diagonal()).norm(), 1e-12 * mass);
+    EXPECT_EQ((lumped - Eigen::Matrix<double, 12, 12>(lumped.diagonal().asDiagonal())).norm(), 0.0);
+}
@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+#include "ElementGeometry.h"
+#include "Assembler.h"
+#include "MatrixFreeStiffness.h"
+#include "Tet4Element.h"
+#include "Material.h"
+#include "TestMeshes.h"
+#include <chrono>
+#include <iostream>
+
+TEST(ElementGeometryTest, MatchesTet4Element) {
+    Mesh mesh = makeBoxMesh(2);
+    mesh.addNode(1000, 0.3, 0.3, 0.3);
+    mesh.addElement({1, 2, 1000}); // Not a Tet4: stored as zero
+    ElementGeometry geometry(mesh, 0);
+    ASSERT_EQ(geometry.getNumElements(), mesh.getNumElements());
+    ASSERT_TRUE(geometry.matches(mesh));
+
+    for (size_t e = 0; e + 1 < mesh.getNumElements(); ++e) {
+        Eigen::Matrix<double, 4, 3> coords;
+        for (int i = 0; i < 4; ++i) {
+            int node = mesh.getElementNodes(e)[i];
+            coords.row(i) << mesh.getX()[node], mesh.getY()[node], mesh.getZ()[node];
+        }
+        Tet4Element tet(coords);
+        ASSERT_NEAR(geometry.getVolume(e), tet.getVolume(), 1e-14);
+        ASSERT_LE((geometry.getBMatrix(e) - tet.calculateBMatrix()).norm(), 1e-12);
+    }
+    size_t last = mesh.getNumElements() - 1;
+    ASSERT_EQ(geometry.getVolume(last), 0.0);
+    ASSERT_TRUE(geometry.getGradients(last).isZero(0.0));
+}
+
+TEST(ElementGeometryTest, CachedAssemblyMatchesAcrossMaterialSweep) {
+    Mesh mesh = makeBoxMesh(4);
+    ElementGeometry geometry(mesh);
+    Assembler plain;
+    Assembler cached;
+    cached.setGeometry(&geometry);
+    AssemblyPattern pattern = cached.buildPattern(mesh);
+
+    Eigen::SparseMatrix<double> K;
+    for (double E : {70e9, 110e9, 210e9}) {
+        Material mat(E, 0.3);
+        Eigen::SparseMatrix<double> K_ref = plain.assembleGlobalStiffness(mesh, mat);
+        cached.assembleNumeric(mesh, mat, pattern, K);
+        ASSERT_LE((K - K_ref).norm(), 1e-12 * K_ref.norm());
+        ASSERT_LE((cached.assembleGlobalStiffness(mesh, mat) - K_ref).norm(), 1e-12 * K_ref.norm());
+    }
+
+    // A store built for another mesh is ignored rather than misread
+    Mesh other = makeBoxMesh(3);
+    Material steel(210e9, 0.3);
+    Eigen::SparseMatrix<double> K_other = cached.assembleGlobalStiffness(other, steel);
+    ASSERT_EQ((K_other - plain.assembleGlobalStiffness(other, steel)).norm(), 0.0);
+}
+
+TEST(ElementGeometryTest, MatrixFreeProductUsesCache) {
+    Mesh mesh = makeBoxMesh(3);
+    Material material(210e9, 0.3);
+    ElementGeometry geometry(mesh);
+
+    MatrixFreeStiffness op(mesh, material);
+    MatrixFreeStiffness op_cached(mesh, material);
+    op_cached.setGeometry(&geometry);
+
+    Eigen::VectorXd u = Eigen::VectorXd::Random(op.rows());
+    Eigen::VectorXd y = op * u;
+    Eigen::VectorXd y_cached = op_cached * u;
+    ASSERT_LE((y_cached - y).norm(), 1e-12 * y.norm());
+    ASSERT_LE((op_cached.diagonal() - op.diagonal()).norm(), 1e-12 * op.diagonal().norm());
+}
+
+TEST(ElementGeometryTest, ReportsMemoryFootprint) {
+    Mesh mesh = makeBoxMesh(6);
+    size_t estimate = ElementGeometry::estimateMemoryBytes(mesh.getNumElements());
+
+    auto t0 = std::chrono::steady_clock::now();
+    ElementGeometry geometry(mesh);
+    double build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    ASSERT_EQ(geometry.memoryBytes(), estimate);
+    // 12 gradients and a volume per element, plus padding of the last block
+    ASSERT_GE(geometry.memoryBytes(), mesh.getNumElements() * 13 * sizeof(double));
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(geometry.blocks()) % 64, 0u);
+
+    geometry.clear();
+    ASSERT_TRUE(geometry.empty());
+    ASSERT_FALSE(geometry.matches(mesh));
+    std::cout << "[ INFO     ] " << mesh.getNumElements() << " elements: geometry store " << estimate
+              << " B, built in " << build_seconds << " s" << std::endl;
+}
+
+TEST(ElementGeometryTest, StaleAfterNodesMoveOrAreRenumbered) {
+    Mesh mesh = makeBoxMesh(3);
+    Material steel(210e9, 0.3);
+    ElementGeometry geometry(mesh);
+    Assembler plain;
+    Assembler cached;
+    cached.setGeometry(&geometry);
+
+    // An unmodified copy has the same geometry; changing materials keeps it valid
+    Mesh copy = mesh;
+    ASSERT_TRUE(geometry.matches(copy));
+    mesh.setElementMaterial(0, 0);
+    ASSERT_TRUE(geometry.matches(mesh));
+
+    // Moving a node, same element count
+    mesh.setNodeCoordinates(5, mesh.getX()[5] + 0.1, mesh.getY()[5], mesh.getZ()[5] - 0.05);
+    ASSERT_FALSE(geometry.matches(mesh));
+    ASSERT_TRUE(geometry.matches(copy));
+    Eigen::SparseMatrix<double> K_ref = plain.assembleGlobalStiffness(mesh, steel);
+    ASSERT_EQ((cached.assembleGlobalStiffness(mesh, steel) - K_ref).norm(), 0.0);
+
+    // Renumbering the nodes of the (rebuilt) store's mesh
+    geometry.build(mesh);
+    ASSERT_TRUE(geometry.matches(mesh));
+    std::vector<int> reverse(mesh.getNumNodes());
+    for (size_t i = 0; i < reverse.size(); ++i) {
+        reverse[i] = static_cast<int>(reverse.size() - 1 - i);
+    }
+    mesh.permuteNodes(reverse);
+    ASSERT_FALSE(geometry.matches(mesh));
+    K_ref = plain.assembleGlobalStiffness(mesh, steel);
+    ASSERT_EQ((cached.assembleGlobalStiffness(mesh, steel) - K_ref).norm(), 0.0);
+}
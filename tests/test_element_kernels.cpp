@@ -0,0 +1,307 @@
+#include <gtest/gtest.h>
+#include "ElementKernel.h"
+#include "Assembler.h"
+#include "MatrixFreeStiffness.h"
+#include "StressRecovery.h"
+#include "Tet4Kernel.h"
+#include "Material.h"
+#include <cmath>
+#include <stdexcept>
+
+// Reference coordinates of each type's nodes, with a deterministic distortion
+static Eigen::Matrix<double, 4, 3> tet4Coords() {
+    Eigen::Matrix<double, 4, 3> c;
+    c << 0.1, -0.2, 0.0, 1.3, 0.1, 0.2, 0.2, 1.1, -0.1, 0.3, 0.2, 0.9;
+    return c;
+}
+
+static Eigen::Matrix<double, 10, 3> tet10Coords() {
+    Eigen::Matrix<double, 10, 3> c;
+    c.topRows<4>() = tet4Coords();
+    const auto& edges = ElementTraits<ElementType::Tet10>::kEdges;
+    for (int k = 0; k < 6; ++k) {
+        c.row(4 + k) = 0.5 * (c.row(edges[k][0]) + c.row(edges[k][1]));
+    }
+    return c;
+}
+
+static Eigen::Matrix<double, 8, 3> hex8Coords() {
+    Eigen::Matrix<double, 8, 3> c;
+    c << 0.0, 0.0, 0.0, 1.2, 0.1, 0.0, 1.1, 0.9, 0.1, -0.1, 1.0, 0.0,
+         0.1, 0.0, 1.0, 1.0, -0.1, 1.1, 1.2, 1.1, 0.9, 0.0, 0.9, 1.0;
+    return c;
+}
+
+// Displacements u = A x + t with symmetric A give the constant strain eps
+static Eigen::Matrix3d strainGradient() {
+    Eigen::Matrix3d A;
+    A << 1e-3, 2e-4, -3e-4, 2e-4, -5e-4, 1e-4, -3e-4, 1e-4, 7e-4;
+    return A;
+}
+
+static Eigen::Matrix<double, 6, 1> voigtStrain(const Eigen::Matrix3d& A) {
+    Eigen::Matrix<double, 6, 1> eps;
+    eps << A(0, 0), A(1, 1), A(2, 2), 2 * A(0, 1), 2 * A(1, 2), 2 * A(0, 2);
+    return eps;
+}
+
+template <ElementType Type>
+static ElementVector<Type> linearField(const ElementCoords<Type>& coords, const Eigen::Matrix3d& A,
+                                       const Eigen::Vector3d& t) {
+    ElementVector<Type> u;
+    for (int i = 0; i < ElementTraits<Type>::kNodes; ++i) {
+        u.template segment<3>(3 * i) = A * coords.row(i).transpose() + t;
+    }
+    return u;
+}
+
+template <ElementType Type>
+static void checkShapeFunctions() {
+    typedef ElementTraits<Type> Traits;
+    const double points[3][3] = {{0.1, 0.2, 0.3}, {0.25, 0.25, 0.25}, {0.6, 0.05, 0.15}};
+    for (const auto& p : points) {
+        double N[Traits::kNodes];
+        double dN[Traits::kNodes][3];
+        Traits::shapeFunctions(p[0], p[1], p[2], N);
+        Traits::shapeDerivatives(p[0], p[1], p[2], dN);
+        double sum = 0.0, dsum[3] = {0.0, 0.0, 0.0};
+        for (int i = 0; i < Traits::kNodes; ++i) {
+            sum += N[i];
+            for (int k = 0; k < 3; ++k) {
+                dsum[k] += dN[i][k];
+            }
+        }
+        EXPECT_NEAR(sum, 1.0, 1e-14);
+        for (int k = 0; k < 3; ++k) {
+            EXPECT_NEAR(dsum[k], 0.0, 1e-14);
+        }
+    }
+}
+
+TEST(ElementKernelTest, ShapeFunctionsArePartitionOfUnity) {
+    checkShapeFunctions<ElementType::Tet4>();
+    checkShapeFunctions<ElementType::Tet10>();
+    checkShapeFunctions<ElementType::Hex8>();
+}
+
+template <ElementType Type>
+static void checkStiffness(const ElementCoords<Type>& coords, double volume) {
+    Material steel(210e9, 0.3);
+    ElementMatrix<Type> ke;
+    ASSERT_TRUE(computeElementStiffness<Type>(coords, steel.getDMatrix(), ke));
+    double scale = ke.cwiseAbs().maxCoeff();
+    EXPECT_LT((ke - ke.transpose()).cwiseAbs().maxCoeff(), 1e-12 * scale);
+
+    // Rigid translations and rotations store no energy
+    Eigen::Matrix3d W;
+    W << 0.0, -0.3, 0.2, 0.3, 0.0, -0.1, -0.2, 0.1, 0.0;
+    ElementVector<Type> rigid = linearField<Type>(coords, W, Eigen::Vector3d(1.0, -2.0, 0.5));
+    EXPECT_LT((ke * rigid).cwiseAbs().maxCoeff(), 1e-9 * scale);
+
+    // A linear field is reproduced exactly: u^T K u = V eps^T D eps
+    Eigen::Matrix3d A = strainGradient();
+    Eigen::Matrix<double, 6, 1> eps = voigtStrain(A);
+    ElementVector<Type> u = linearField<Type>(coords, A, Eigen::Vector3d::Zero());
+    double energy = eps.dot(steel.getDMatrix() * eps) * volume;
+    EXPECT_NEAR(u.dot(ke * u), energy, 1e-10 * energy);
+    EXPECT_NEAR(computeElementVolume<Type>(coords), volume, 1e-12);
+
+    ElementStrainOperator<Type> B;
+    ASSERT_TRUE(computeCentroidStrainOperator<Type>(coords, B));
+    EXPECT_LT((B * u - eps).cwiseAbs().maxCoeff(), 1e-15);
+
+    // Positive semi-definite with exactly the six rigid modes in the null space
+    Eigen::SelfAdjointEigenSolver<ElementMatrix<Type>> eig(ke);
+    EXPECT_GT(eig.eigenvalues().minCoeff(), -1e-9 * scale);
+    EXPECT_GT(eig.eigenvalues()(6), 1e-6 * scale);
+}
+
+static double tetVolume(const Eigen::Matrix<double, 4, 3>& c) {
+    Eigen::Matrix3d edges;
+    edges << c.row(1) - c.row(0), c.row(2) - c.row(0), c.row(3) - c.row(0);
+    return std::abs(edges.determinant()) / 6.0;
+}
+
+TEST(ElementKernelTest, Tet4StiffnessIsExact) {
+    checkStiffness<ElementType::Tet4>(tet4Coords(), tetVolume(tet4Coords()));
+}
+
+TEST(ElementKernelTest, Tet10StiffnessIsExact) {
+    checkStiffness<ElementType::Tet10>(tet10Coords(), tetVolume(tet4Coords()));
+}
+
+TEST(ElementKernelTest, Hex8StiffnessIsExact) {
+    // 2x2x2 Gauss integrates det J of a trilinear hex exactly; compare with a
+    // 4x4x4 sum of the same Jacobian
+    ElementCoords<ElementType::Hex8> coords = hex8Coords();
+    const double g[2] = {-0.8611363115940526, -0.3399810435848563};
+    const double w[2] = {0.3478548451374538, 0.6521451548625461};
+    double volume = 0.0;
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            for (int k = 0; k < 4; ++k) {
+                double xi = i < 2 ? g[i] : -g[3 - i], eta = j < 2 ? g[j] : -g[3 - j], zeta = k < 2 ? g[k] : -g[3 - k];
+                double weight = w[i < 2 ? i : 3 - i] * w[j < 2 ? j : 3 - j] * w[k < 2 ? k : 3 - k];
+                ElementGradients<ElementType::Hex8> grad;
+                volume += weight * computeShapeGradients<ElementType::Hex8>(coords, xi, eta, zeta, grad);
+            }
+        }
+    }
+    checkStiffness<ElementType::Hex8>(coords, volume);
+}
+
+TEST(ElementKernelTest, GenericTet4MatchesBatchedKernel) {
+    Material steel(210e9, 0.3);
+    ElementMatrix<ElementType::Tet4> ke;
+    ASSERT_TRUE(computeElementStiffness<ElementType::Tet4>(tet4Coords(), steel.getDMatrix(), ke));
+    Eigen::Matrix<double, 12, 12> reference = computeTet4Stiffness(tet4Coords(), steel.getDMatrix());
+    EXPECT_LT((ke - reference).cwiseAbs().maxCoeff(), 1e-12 * reference.cwiseAbs().maxCoeff());
+}
+
+TEST(ElementKernelTest, Tet4InternalForcesMatchStiffnessTimesDisplacement) {
+    // Every lane a scaled copy of the same tet, with its own displacements
+    const int W = kTet4BatchWidth;
+    Material steel(210e9, 0.3);
+    Tet4Batch<W> batch;
+    double u[12][W], f[12][W];
+    for (int l = 0; l < W; ++l) {
+        Eigen::Matrix<double, 4, 3> coords = (1.0 + 0.1 * l) * tet4Coords();
+        for (int i = 0; i < 4; ++i) {
+            batch.x[i][l] = coords(i, 0);
+            batch.y[i][l] = coords(i, 1);
+            batch.z[i][l] = coords(i, 2);
+        }
+        for (int k = 0; k < 12; ++k) {
+            u[k][l] = 1e-3 * std::sin(1.0 + k + 3.0 * l);
+        }
+    }
+    computeTet4Geometry(batch);
+    computeTet4InternalForces(batch.geometry, steel.getDMatrix(), u, f);
+
+    for (int l = 0; l < W; ++l) {
+        Eigen::Matrix<double, 12, 12> ke = computeTet4Stiffness((1.0 + 0.1 * l) * tet4Coords(), steel.getDMatrix());
+        Eigen::Matrix<double, 12, 1> u_l, f_l;
+        for (int k = 0; k < 12; ++k) {
+            u_l(k) = u[k][l];
+            f_l(k) = f[k][l];
+        }
+        Eigen::Matrix<double, 12, 1> expected = ke * u_l;
+        EXPECT_LT((f_l - expected).cwiseAbs().maxCoeff(), 1e-12 * expected.cwiseAbs().maxCoeff()) << "lane " << l;
+    }
+}
+
+TEST(ElementKernelTest, InvertedElementGetsZeroStiffness) {
+    // Pulling a top corner through the bottom face flips det J at some points
+    ElementCoords<ElementType::Hex8> coords = hex8Coords();
+    coords.row(6) << 0.2, 0.1, -1.5;
+    Material steel(210e9, 0.3);
+    ElementMatrix<ElementType::Hex8> ke;
+    EXPECT_FALSE(computeElementStiffness<ElementType::Hex8>(coords, steel.getDMatrix(), ke));
+    EXPECT_TRUE(ke.isZero(0.0));
+}
+
+// A distorted Hex8 with a Tet4 and a Tet10 on its top, the Tet10 in material 1
+static Mesh makeMixedMesh() {
+    Mesh mesh;
+    ElementCoords<ElementType::Hex8> hex = hex8Coords();
+    for (int i = 0; i < 8; ++i) {
+        mesh.addNode(i + 1, hex(i, 0), hex(i, 1), hex(i, 2));
+    }
+    mesh.addNode(9, 0.5, 0.4, 1.9);
+    mesh.addElement({1, 2, 3, 4, 5, 6, 7, 8});
+    mesh.addElement({5, 6, 8, 9});
+
+    const int corners[4] = {6, 7, 8, 9};
+    const auto& edges = ElementTraits<ElementType::Tet10>::kEdges;
+    std::vector<int> tet10(corners, corners + 4);
+    for (int k = 0; k < 6; ++k) {
+        int a = mesh.getNodeIndex(corners[edges[k][0]]), b = mesh.getNodeIndex(corners[edges[k][1]]);
+        // Slightly off the edge midpoints, so the element is curved
+        mesh.addNode(10 + k, 0.5 * (mesh.getX()[a] + mesh.getX()[b]) + 0.01 * k,
+                     0.5 * (mesh.getY()[a] + mesh.getY()[b]), 0.5 * (mesh.getZ()[a] + mesh.getZ()[b]));
+        tet10.push_back(10 + k);
+    }
+    mesh.addElement(tet10, 1);
+    return mesh;
+}
+
+static MaterialTable makeMixedMaterials() {
+    MaterialTable table(Material(210e9, 0.3));
+    table.set(1, Material(70e9, 0.33));
+    return table;
+}
+
+TEST(ElementKernelTest, MixedMeshAssemblyMatchesElementKernels) {
+    Mesh mesh = makeMixedMesh();
+    MaterialTable materials = makeMixedMaterials();
+    std::vector<int> slots = materials.elementSlots(mesh);
+
+    Eigen::MatrixXd reference = Eigen::MatrixXd::Zero(3 * mesh.getNumNodes(), 3 * mesh.getNumNodes());
+    for (size_t e = 0; e < mesh.getNumElements(); ++e) {
+        const Eigen::Matrix<double, 6, 6>& D = materials.getDMatrix(slots[e]);
+        ASSERT_TRUE(dispatchElementType(mesh.getElementTypes()[e], [&](auto tag) {
+            constexpr ElementType Type = decltype(tag)::value;
+            ElementMatrix<Type> ke;
+            ASSERT_TRUE(computeElementStiffness<Type>(gatherElementCoords<Type>(mesh, e), D, ke));
+            const int* nodes = mesh.getElementNodes(e);
+            for (int i = 0; i < ElementTraits<Type>::kNodes; ++i) {
+                for (int j = 0; j < ElementTraits<Type>::kNodes; ++j) {
+                    reference.block<3, 3>(3 * nodes[i], 3 * nodes[j]) += ke.template block<3, 3>(3 * i, 3 * j);
+                }
+            }
+        }));
+    }
+
+    Assembler assembler;
+    Eigen::MatrixXd K = Eigen::MatrixXd(assembler.assembleGlobalStiffness(mesh, materials));
+    double scale = reference.cwiseAbs().maxCoeff();
+    EXPECT_LT((K - reference).cwiseAbs().maxCoeff(), 1e-12 * scale);
+
+    AssemblyPattern pattern = assembler.buildPattern(mesh);
+    Eigen::MatrixXd K_pattern = Eigen::MatrixXd(assembler.assembleGlobalStiffness(mesh, materials, pattern));
+    EXPECT_LT((K_pattern - reference).cwiseAbs().maxCoeff(), 1e-12 * scale);
+
+    Eigen::MatrixXd K_blocks = Eigen::MatrixXd(assembler.assembleBlockStiffness(mesh, materials, pattern).toEigen());
+    EXPECT_LT((K_blocks - reference).cwiseAbs().maxCoeff(), 1e-12 * scale);
+}
+
+TEST(ElementKernelTest, StressRecoveryHandlesMixedMesh) {
+    Mesh mesh = makeMixedMesh();
+    MaterialTable materials = makeMixedMaterials();
+    Eigen::Matrix3d A = strainGradient();
+    Eigen::Matrix<double, 6, 1> eps = voigtStrain(A);
+    Eigen::VectorXd U(3 * mesh.getNumNodes());
+    for (size_t n = 0; n < mesh.getNumNodes(); ++n) {
+        U.segment<3>(3 * n) = A * Eigen::Vector3d(mesh.getX()[n], mesh.getY()[n], mesh.getZ()[n]);
+    }
+
+    StressResults results;
+    StressRecovery(mesh).compute(materials, U, results);
+    std::vector<int> slots = materials.elementSlots(mesh);
+    for (size_t e = 0; e < mesh.getNumElements(); ++e) {
+        EXPECT_LT((results.element_strain.col(e) - eps).cwiseAbs().maxCoeff(), 1e-15) << "element " << e;
+        Eigen::Matrix<double, 6, 1> sigma = materials.getDMatrix(slots[e]) * eps;
+        EXPECT_LT((results.element_stress.col(e) - sigma).cwiseAbs().maxCoeff(), 1e-9 * sigma.cwiseAbs().maxCoeff());
+        EXPECT_GT(results.element_volume(e), 0.0);
+    }
+}
+
+TEST(ElementKernelTest, MatrixFreeOperatorHandlesMixedMesh) {
+    Mesh mesh = makeMixedMesh();
+    MaterialTable materials = makeMixedMaterials();
+    Eigen::SparseMatrix<double> K = Assembler().assembleGlobalStiffness(mesh, materials);
+
+    // Every element contributes, so nodes of the Hex8 alone get a diagonal too
+    MatrixFreeStiffness op(mesh, materials);
+    Eigen::VectorXd u = Eigen::VectorXd::Random(K.rows());
+    Eigen::VectorXd y_assembled = K * u;
+    Eigen::VectorXd y_free = op * u;
+    EXPECT_LE((y_free - y_assembled).norm(), 1e-12 * y_assembled.norm());
+    Eigen::VectorXd diag_assembled = K.diagonal();
+    EXPECT_LE((op.diagonal() - diag_assembled).norm(), 1e-12 * diag_assembled.norm());
+    EXPECT_GT(op.diagonal().minCoeff(), 0.0);
+
+    // An element without a kernel is rejected rather than skipped
+    mesh.addElement({1, 2, 3});
+    EXPECT_THROW(MatrixFreeStiffness(mesh, materials), std::invalid_argument);
+}
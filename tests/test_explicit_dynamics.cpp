@@ -0,0 +1,267 @@
+#include <gtest/gtest.h>
+#include "ExplicitDynamics.h"
+#include "Assembler.h"
+#include "BoundaryConditions.h"
+#include "Material.h"
+#include "ModalSolver.h"
+#include "TestMeshes.h"
+#include <Eigen/Eigenvalues>
+#include <Eigen/SparseCholesky>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+Material steel() {
+    Material material(210e9, 0.3);
+    material.setDensity(7850.0);
+    return material;
+}
+
+// Fixes every node at x = 0
+void clampLeftEnd(const Mesh& mesh, BoundaryConditions& bcs) {
+    for (size_t i = 0; i < mesh.getNumNodes(); ++i) {
+        if (mesh.getX()[i] == 0.0) {
+            bcs.fixNode(mesh.getNodeIds()[i]);
+        }
+    }
+}
+
+// Deterministic, smooth-ish full-size field
+Eigen::VectorXd testField(Eigen::Index size, double scale) {
+    Eigen::VectorXd u(size);
+    for (Eigen::Index i = 0; i < size; ++i) {
+        u(i) = scale * std::sin(0.7 * i + 0.3);
+    }
+    return u;
+}
+
+double energy(const ExplicitDynamics& engine, const Eigen::SparseMatrix<double>& K) {
+    const Eigen::VectorXd& u = engine.getDisplacement();
+    Eigen::VectorXd v = engine.getVelocity();
+    return 0.5 * v.dot(engine.getLumpedMass().cwiseProduct(v)) + 0.5 * u.dot(K * u);
+}
+
+} // namespace
+
+TEST(ExplicitDynamicsTest, InternalForcesMatchAssembledStiffness) {
+    Mesh mesh = generateBoxMesh(4, 3, 2);
+    BoundaryConditions bcs(mesh);
+    Assembler assembler;
+    Eigen::SparseMatrix<double> K = assembler.assembleGlobalStiffness(mesh, steel());
+    Eigen::VectorXd u = testField(K.rows(), 1e-4);
+    Eigen::VectorXd expected = K * u;
+
+    for (unsigned threads : {1u, 3u}) {
+        ExplicitDynamics engine(mesh, steel(), bcs, threads);
+        Eigen::VectorXd f;
+        engine.internalForces(u, f);
+        EXPECT_LE((f - expected).norm(), 1e-12 * expected.norm()) << threads << " threads";
+    }
+}
+
+TEST(ExplicitDynamicsTest, LumpedMassMatchesAssembledMass) {
+    Mesh mesh = generateBoxMesh(3, 2, 2);
+    BoundaryConditions bcs(mesh);
+    Assembler assembler;
+    Eigen::VectorXd expected = assembler.assembleGlobalMass(mesh, steel(), MassMatrixType::Lumped).diagonal();
+    ExplicitDynamics engine(mesh, steel(), bcs);
+    EXPECT_LE((engine.getLumpedMass() - expected).norm(), 1e-12 * expected.norm());
+    EXPECT_NEAR(engine.getLumpedMass().sum(), 3 * 7850.0 * 3 * 2 * 2, 1e-9 * engine.getLumpedMass().sum());
+}
+
+TEST(ExplicitDynamicsTest, CriticalTimeStepIsBelowTheStabilityLimit) {
+    // Central differences are stable for dt <= 2 / omega_max
+    Mesh mesh = generateBoxMesh(4, 2, 1);
+    BoundaryConditions bcs(mesh);
+    clampLeftEnd(mesh, bcs);
+    Assembler assembler;
+    Eigen::SparseMatrix<double> K, M;
+    bcs.reduce(assembler.assembleGlobalStiffness(mesh, steel()), K);
+    bcs.reduce(assembler.assembleGlobalMass(mesh, steel(), MassMatrixType::Lumped), M);
+    Eigen::MatrixXd K_dense = K, M_dense = M;
+    Eigen::GeneralizedSelfAdjointEigenSolver<Eigen::MatrixXd> dense(K_dense, M_dense, Eigen::EigenvaluesOnly);
+    double limit = 2.0 / std::sqrt(dense.eigenvalues().maxCoeff());
+
+    ExplicitDynamics engine(mesh, steel(), bcs);
+    double dt = engine.criticalTimeStep();
+    EXPECT_GT(dt, 0.0);
+    EXPECT_LE(dt, limit);
+    EXPECT_GT(dt, 0.5 * limit); // Conservative, not useless
+    EXPECT_DOUBLE_EQ(engine.getTimeStep(), 0.9 * dt);
+    engine.setTimeStep(1e-7);
+    EXPECT_DOUBLE_EQ(engine.getTimeStep(), 1e-7);
+}
+
+TEST(ExplicitDynamicsTest, EnergyStaysBoundedAtTheDefaultStep) {
+    Mesh mesh = generateBoxMesh(6, 2, 1);
+    BoundaryConditions bcs(mesh);
+    clampLeftEnd(mesh, bcs);
+    Assembler assembler;
+    Eigen::SparseMatrix<double> K = assembler.assembleGlobalStiffness(mesh, steel());
+
+    ExplicitDynamics engine(mesh, steel(), bcs);
+    engine.setInitialConditions(Eigen::VectorXd::Zero(K.rows()), testField(K.rows(), 1.0));
+    double initial = energy(engine, K);
+    double highest = initial;
+    for (int i = 0; i < 20; ++i) {
+        engine.run(100);
+        highest = std::max(highest, energy(engine, K));
+    }
+    EXPECT_EQ(engine.getStep(), 2000);
+    EXPECT_NEAR(engine.getTime(), 2000 * engine.getTimeStep(), 1e-12 * engine.getTime());
+    // The full-step energy oscillates with (omega dt)^2 but does not grow
+    EXPECT_LT(highest, 2.0 * initial);
+    EXPECT_GT(engine.getStats().element_updates_per_second, 0.0);
+
+    // Well past the limit the same start blows up
+    ExplicitDynamics unstable(mesh, steel(), bcs);
+    unstable.setInitialConditions(Eigen::VectorXd::Zero(K.rows()), testField(K.rows(), 1.0));
+    unstable.setTimeStep(3.0 * unstable.criticalTimeStep());
+    unstable.run(200);
+    EXPECT_FALSE(energy(unstable, K) < 1e6 * initial);
+}
+
+TEST(ExplicitDynamicsTest, FreeVibrationFollowsTheLowestMode) {
+    // A mode of (K, lumped M) released from rest is -phi half a period later
+    Mesh mesh = generateBoxMesh(8, 2, 1);
+    BoundaryConditions bcs(mesh);
+    clampLeftEnd(mesh, bcs);
+    Assembler assembler;
+    Eigen::SparseMatrix<double> K, M;
+    bcs.reduce(assembler.assembleGlobalStiffness(mesh, steel()), K);
+    bcs.reduce(assembler.assembleGlobalMass(mesh, steel(), MassMatrixType::Lumped), M);
+    ModalSolver modal;
+    ModalResults results;
+    ASSERT_TRUE(modal.compute(K, M, 1, results));
+    Eigen::VectorXd phi = bcs.expandHomogeneous(results.modes.col(0));
+
+    ExplicitDynamics engine(mesh, steel(), bcs);
+    double half_period = M_PI / std::sqrt(results.eigenvalues(0));
+    long steps = static_cast<long>(std::ceil(half_period / engine.getTimeStep()));
+    steps = std::max(steps, 400L);
+    engine.setTimeStep(half_period / steps);
+    engine.setInitialConditions(phi, Eigen::VectorXd::Zero(phi.size()));
+    engine.run(steps);
+
+    EXPECT_NEAR(engine.getTime(), half_period, 1e-12 * half_period);
+    EXPECT_LE((engine.getDisplacement() + phi).norm(), 1e-3 * phi.norm());
+}
+
+TEST(ExplicitDynamicsTest, ConstantLoadOscillatesAboutTheStaticSolution) {
+    // Suddenly applied, undamped: u(t) swings between 0 and twice the static displacement
+    Mesh mesh = generateBoxMesh(6, 2, 1);
+    BoundaryConditions bcs(mesh);
+    clampLeftEnd(mesh, bcs);
+    Assembler assembler;
+    Eigen::SparseMatrix<double> K, M;
+    bcs.reduce(assembler.assembleGlobalStiffness(mesh, steel()), K);
+    bcs.reduce(assembler.assembleGlobalMass(mesh, steel(), MassMatrixType::Lumped), M);
+
+    Eigen::VectorXd F = Eigen::VectorXd::Zero(3 * mesh.getNumNodes());
+    for (size_t i = 0; i < mesh.getNumNodes(); ++i) {
+        if (mesh.getX()[i] == 6.0) {
+            F(3 * i + 2) = -1e6;
+        }
+    }
+    Eigen::VectorXd F_f = bcs.restrictRows(F);
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> ldlt(K);
+    Eigen::VectorXd u_static = bcs.expandHomogeneous(ldlt.solve(F_f));
+
+    ExplicitDynamics engine(mesh, steel(), bcs);
+    engine.setExternalForce(F);
+    ModalSolver modal;
+    ModalResults results;
+    ASSERT_TRUE(modal.compute(K, M, 1, results));
+    double period = 2.0 * M_PI / std::sqrt(results.eigenvalues(0));
+    long steps = static_cast<long>(std::ceil(2.0 * period / engine.getTimeStep()));
+
+    // The time average over whole periods of the dominant mode is close to the static solution
+    Eigen::VectorXd mean = Eigen::VectorXd::Zero(F.size());
+    for (long s = 0; s < steps; ++s) {
+        engine.run(1);
+        mean += engine.getDisplacement();
+    }
+    mean /= static_cast<double>(steps);
+    EXPECT_LE((mean - u_static).norm(), 0.1 * u_static.norm());
+    EXPECT_LE((engine.getDisplacement() - u_static).norm(), 1.5 * u_static.norm());
+}
+
+TEST(ExplicitDynamicsTest, SnapshotsArriveEveryNStepsAndAtTheEnd) {
+    Mesh mesh = generateBoxMesh(3, 2, 1);
+    BoundaryConditions bcs(mesh);
+    clampLeftEnd(mesh, bcs);
+    ExplicitDynamics engine(mesh, steel(), bcs, 2);
+    engine.setInitialConditions(Eigen::VectorXd::Zero(3 * mesh.getNumNodes()), testField(3 * mesh.getNumNodes(), 1.0));
+
+    std::vector<ExplicitSnapshot> snapshots; // Only the writer thread touches it until run() returns
+    engine.setOutput(3, [&](const ExplicitSnapshot& snapshot) { snapshots.push_back(snapshot); }, 1);
+    engine.run(10);
+
+    ASSERT_EQ(snapshots.size(), 4u);
+    const long expected[] = {3, 6, 9, 10};
+    for (size_t i = 0; i < snapshots.size(); ++i) {
+        EXPECT_EQ(snapshots[i].step, expected[i]);
+        EXPECT_DOUBLE_EQ(snapshots[i].time, expected[i] * engine.getTimeStep());
+    }
+    EXPECT_EQ(snapshots.back().displacement, engine.getDisplacement());
+    EXPECT_EQ(snapshots.back().velocity, engine.getVelocity());
+    EXPECT_EQ(engine.getStats().snapshots, 4);
+    EXPECT_EQ(engine.getStats().steps, 10);
+
+    // Constrained DOFs never move
+    for (Eigen::Index dof = 0; dof < engine.getDisplacement().size(); ++dof) {
+        if (bcs.isConstrained(dof)) {
+            EXPECT_EQ(engine.getDisplacement()(dof), 0.0);
+        }
+    }
+}
+
+TEST(ExplicitDynamicsTest, RestartingKeepsTheTrajectory) {
+    // Changing the step mid-run re-centers the staggered velocity, so two
+    // halves at the same step match one run
+    Mesh mesh = generateBoxMesh(3, 2, 1);
+    BoundaryConditions bcs(mesh);
+    clampLeftEnd(mesh, bcs);
+    Eigen::VectorXd v0 = testField(3 * mesh.getNumNodes(), 1.0);
+
+    ExplicitDynamics whole(mesh, steel(), bcs), halves(mesh, steel(), bcs);
+    double dt = 0.5 * whole.criticalTimeStep();
+    for (ExplicitDynamics* engine : {&whole, &halves}) {
+        engine->setInitialConditions(Eigen::VectorXd::Zero(v0.size()), v0);
+        engine->setTimeStep(dt);
+    }
+    whole.run(40);
+    halves.run(20);
+    halves.setTimeStep(dt);
+    halves.run(20);
+    EXPECT_LE((whole.getDisplacement() - halves.getDisplacement()).norm(), 1e-10 * whole.getDisplacement().norm());
+}
+
+TEST(ExplicitDynamicsTest, RejectsMasslessMaterial) {
+    Mesh mesh = generateBoxMesh(2, 1, 1);
+    BoundaryConditions bcs(mesh);
+    EXPECT_THROW(ExplicitDynamics(mesh, Material(210e9, 0.3), bcs), std::invalid_argument);
+
+    ExplicitDynamics engine(mesh, steel(), bcs);
+    EXPECT_THROW(engine.setExternalForce(Eigen::VectorXd::Zero(5)), std::invalid_argument);
+}
+
+TEST(ExplicitDynamicsTest, RejectsNonTet4Elements) {
+    Mesh mesh = generateBoxMesh(1, 1, 1);
+    int next_id = static_cast<int>(mesh.getNumNodes()) + 1;
+    std::vector<int> hex;
+    for (int k = 0; k < 2; ++k) {
+        for (int j = 0; j < 2; ++j) {
+            for (int i = 0; i < 2; ++i) {
+                int ii = j == 0 ? i : 1 - i;
+                mesh.addNode(next_id, 1.0 + ii, j, k);
+                hex.push_back(next_id++);
+            }
+        }
+    }
+    mesh.addElement(hex);
+    BoundaryConditions bcs(mesh);
+    EXPECT_THROW(ExplicitDynamics(mesh, steel(), bcs), std::invalid_argument);
+}
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include "IncrementalAssembly.h"
+#include "LoadCases.h"
+#include "Material.h"
+#include "SolverSession.h"
+#include "TestMeshes.h"
+#include <algorithm>
+#include <stdexcept>
+
+static double relativeDifference(const Eigen::SparseMatrix<double>& A, const Eigen::SparseMatrix<double>& B) {
+    return (A - B).norm() / B.norm();
+}
+
+TEST(IncrementalAssemblyTest, ScaleUpdatesMatchFullReassembly) {
+    Mesh mesh = makeBoxMesh(3);
+    Material steel(210e9, 0.3);
+    IncrementalAssembler incremental(mesh, steel);
+    ASSERT_LE(relativeDifference(incremental.matrix(), Assembler().assembleGlobalStiffness(mesh, steel)), 1e-14);
+
+    const MeshArray<int>& ids = mesh.getElementIds();
+    incremental.setScales({{ids[0], 0.5}, {ids[17], 1e-3}, {ids[40], 2.0}});
+    incremental.setScales({{ids[17], 0.25}, {ids[100], 0.0}});
+
+    std::vector<double> scales(mesh.getNumElements(), 1.0);
+    scales[0] = 0.5;
+    scales[17] = 0.25;
+    scales[40] = 2.0;
+    scales[100] = 0.0;
+    ASSERT_EQ(incremental.getScales(), scales);
+
+    Assembler assembler;
+    assembler.setElementScales(&scales);
+    Eigen::SparseMatrix<double> expected = assembler.assembleGlobalStiffness(mesh, steel);
+    EXPECT_LE(relativeDifference(incremental.matrix(), expected), 1e-13);
+
+    // A full reassembly starts over with the same scales
+    incremental.assemble();
+    EXPECT_LE(relativeDifference(incremental.matrix(), expected), 1e-14);
+    EXPECT_TRUE(incremental.getChangedElements().empty());
+}
+
+TEST(IncrementalAssemblyTest, MovedNodesMatchFreshAssembly) {
+    Mesh mesh = makeBoxMesh(3);
+    Material steel(210e9, 0.3);
+    IncrementalAssembler incremental(mesh, steel);
+
+    // Two interior nodes: (1,1,1) and (2,1,1)
+    int a = mesh.getNodeIds()[1 + 4 + 16];
+    int b = mesh.getNodeIds()[2 + 4 + 16];
+    incremental.moveNodes({{a, 1.1, 0.95, 1.05}, {b, 2.0, 1.1, 0.9}});
+    EXPECT_DOUBLE_EQ(mesh.getX()[1 + 4 + 16], 1.1);
+    EXPECT_DOUBLE_EQ(mesh.getZ()[2 + 4 + 16], 0.9);
+
+    // Only the elements around the two nodes were touched
+    const std::vector<size_t>& changed = incremental.getChangedElements();
+    EXPECT_LT(changed.size(), mesh.getNumElements() / 2);
+    for (size_t e = 0; e < mesh.getNumElements(); ++e) {
+        bool touches = false;
+        for (size_t i = 0; i < mesh.getElementNumNodes(e); ++i) {
+            int node = mesh.getElementNodes(e)[i];
+            touches = touches || node == 1 + 4 + 16 || node == 2 + 4 + 16;
+        }
+        EXPECT_EQ(touches, std::binary_search(changed.begin(), changed.end(), e)) << "element " << e;
+    }
+
+    Eigen::SparseMatrix<double> expected = Assembler().assembleGlobalStiffness(mesh, steel);
+    EXPECT_LE(relativeDifference(incremental.matrix(), expected), 1e-13);
+}
+
+TEST(IncrementalAssemblyTest, UnknownIdsThrowWithoutChanges) {
+    Mesh mesh = makeBoxMesh(2);
+    IncrementalAssembler incremental(mesh, Material(210e9, 0.3));
+    Eigen::SparseMatrix<double> before = incremental.matrix();
+    double x = mesh.getX()[0];
+
+    EXPECT_EQ(incremental.getElementIndex(-7), -1);
+    EXPECT_THROW(incremental.setScales({{mesh.getElementIds()[0], 0.5}, {-7, 0.5}}), std::out_of_range);
+    EXPECT_THROW(incremental.moveNodes({{mesh.getNodeIds()[0], 5.0, 5.0, 5.0}, {-7, 0.0, 0.0, 0.0}}),
+                 std::out_of_range);
+    EXPECT_DOUBLE_EQ(incremental.getScale(0), 1.0);
+    EXPECT_DOUBLE_EQ(mesh.getX()[0], x);
+    EXPECT_EQ(relativeDifference(incremental.matrix(), before), 0.0);
+}
+
+TEST(IncrementalAssemblyTest, WarmStartWithKeptPreconditionerConvergesFaster) {
+    const int n = 3;
+    Mesh mesh = makeBoxMesh(n);
+    IncrementalAssembler incremental(mesh, Material(210e9, 0.3));
+    BoundaryConditions bcs(mesh);
+    for (int k = 0; k < (n + 1) * (n + 1); ++k) {
+        bcs.fixNode(1 + k);
+    }
+    Eigen::MatrixXd F = buildLoadMatrix(mesh, {{"down", {{64, 0.0, 0.0, -1e6}}}});
+
+    SolverSession session(bcs, SolverType::CGJacobi);
+    session.solver().setTolerance(1e-10);
+    ASSERT_TRUE(session.setup(incremental.matrix()));
+    Eigen::MatrixXd U0;
+    ASSERT_TRUE(session.solve(F, U0));
+
+    // Damage a few elements near the top
+    const MeshArray<int>& ids = mesh.getElementIds();
+    size_t last = mesh.getNumElements() - 1;
+    incremental.setScales({{ids[last], 0.5}, {ids[last - 1], 0.5}, {ids[last - 2], 0.5}});
+    ASSERT_TRUE(session.update(incremental.matrix(), true));
+    EXPECT_EQ(session.getStats().factorize_seconds, 0.0);
+
+    Eigen::MatrixXd U_cold, U_warm;
+    ASSERT_TRUE(session.solve(F, U_cold));
+    int cold_iterations = session.getStats().iterations;
+    ASSERT_TRUE(session.solveWithGuess(F, U0, U_warm));
+    EXPECT_LT(session.getStats().iterations, cold_iterations);
+
+    SolverSession direct(bcs, SolverType::LDLT);
+    ASSERT_TRUE(direct.setup(incremental.matrix()));
+    Eigen::MatrixXd expected;
+    ASSERT_TRUE(direct.solve(F, expected));
+    EXPECT_LE((U_warm - expected).norm(), 1e-8 * expected.norm());
+    EXPECT_LE((U_cold - expected).norm(), 1e-8 * expected.norm());
+}
+
+TEST(IncrementalAssemblyTest, MixedPrecisionKeepsSingleFactor) {
+    const int n = 2;
+    Mesh mesh = makeBoxMesh(n);
+    IncrementalAssembler incremental(mesh, Material(210e9, 0.3));
+    BoundaryConditions bcs(mesh);
+    for (int k = 0; k < (n + 1) * (n + 1); ++k) {
+        bcs.fixNode(1 + k);
+    }
+    Eigen::MatrixXd F = buildLoadMatrix(mesh, {{"pull", {{27, 0.0, 0.0, 1e6}}}});
+
+    SolverSession session(bcs, SolverType::LDLT);
+    session.solver().setPrecision(SolverPrecision::Mixed);
+    ASSERT_TRUE(session.setup(incremental.matrix()));
+    incremental.setScales({{mesh.getElementIds()[3], 0.8}});
+    ASSERT_TRUE(session.update(incremental.matrix(), true));
+    EXPECT_EQ(session.getStats().factorize_seconds, 0.0);
+    Eigen::MatrixXd U;
+    ASSERT_TRUE(session.solve(F, U));
+
+    SolverSession direct(bcs, SolverType::LDLT);
+    ASSERT_TRUE(direct.setup(incremental.matrix()));
+    Eigen::MatrixXd expected;
+    ASSERT_TRUE(direct.solve(F, expected));
+    EXPECT_LE((U - expected).norm(), 1e-8 * expected.norm());
+}
@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 #include "Material.h"
 #include <Eigen/Dense>
+#include <stdexcept>
 
 // Test that we can create a material and retrieve its properties.
 TEST(MaterialTest, PropertiesAreSetCorrectly) {
@@ -34,4 +35,56 @@ TEST(MaterialTest, DMatrixCalculation) {
 
     // D(3,3) (a shear term) should be prefactor * (1 - 2*nu) / 2
     ASSERT_NEAR(D(3, 3), prefactor * (1.0 - 2.0 * nu) / 2.0, 1e3);
-}
\ No newline at end of file
+}
+
+TEST(MaterialTest, OrthotropicWithIsotropicConstantsMatchesIsotropic) {
+    double E = 210e9, nu = 0.3, G = E / (2.0 * (1.0 + nu));
+    Material iso(E, nu);
+    Material ortho = Material::orthotropic({E, E, E, nu, nu, nu, G, G, G});
+
+    EXPECT_EQ(ortho.getKind(), Material::Kind::Orthotropic);
+    EXPECT_LT((ortho.getDMatrix() - iso.getDMatrix()).norm(), 1e-9 * iso.getDMatrix().norm());
+    EXPECT_NEAR(ortho.getE(), E, 1e-6 * E);
+    EXPECT_NEAR(ortho.getNu(), nu, 1e-12);
+}
+
+TEST(MaterialTest, OrthotropicComplianceIsInverseOfD) {
+    // A unidirectional carbon/epoxy ply, fibres along x
+    OrthotropicConstants ply = {135e9, 10e9, 10e9, 0.3, 0.45, 0.3, 5e9, 3.4e9, 5e9};
+    Material material = Material::orthotropic(ply);
+    Eigen::Matrix<double, 6, 6> S = material.getDMatrix().inverse();
+
+    EXPECT_NEAR(1.0 / S(0, 0), ply.Ex, 1e-6 * ply.Ex);
+    EXPECT_NEAR(1.0 / S(1, 1), ply.Ey, 1e-6 * ply.Ey);
+    EXPECT_NEAR(-S(0, 1) * ply.Ex, ply.nu_xy, 1e-9);
+    EXPECT_NEAR(-S(1, 2) * ply.Ey, ply.nu_yz, 1e-9);
+    EXPECT_NEAR(1.0 / S(3, 3), ply.Gxy, 1e-6 * ply.Gxy);
+    EXPECT_NEAR(1.0 / S(4, 4), ply.Gyz, 1e-6 * ply.Gyz);
+    EXPECT_NEAR(material.getE(), ply.Ex, 1e-6 * ply.Ex);
+}
+
+TEST(MaterialTest, AnisotropicKeepsDAndRejectsIndefinite) {
+    Eigen::Matrix<double, 6, 6> D = Material(70e9, 0.33).getDMatrix();
+    D(0, 3) = D(3, 0) = 1e9; // Shear-extension coupling
+    Material material = Material::anisotropic(D);
+    EXPECT_EQ(material.getKind(), Material::Kind::Anisotropic);
+    EXPECT_EQ(material.getDMatrix(), D);
+
+    Eigen::Matrix<double, 6, 6> unsymmetric = D;
+    unsymmetric(0, 3) = 2e9;
+    EXPECT_THROW(Material::anisotropic(unsymmetric), std::invalid_argument);
+    Eigen::Matrix<double, 6, 6> indefinite = D;
+    indefinite(5, 5) = -1.0;
+    EXPECT_THROW(Material::anisotropic(indefinite), std::invalid_argument);
+    // nu_xy = 0.9 with Ex = Ey makes the compliance indefinite
+    EXPECT_THROW(Material::orthotropic({1e9, 1e9, 1e9, 0.9, 0.3, 0.3, 1e8, 1e8, 1e8}), std::invalid_argument);
+}
+
+TEST(MaterialTest, DensityDefaultsToZeroAndRejectsNegative) {
+    Material steel(210e9, 0.3);
+    EXPECT_EQ(steel.getDensity(), 0.0);
+    steel.setDensity(7850.0);
+    EXPECT_EQ(steel.getDensity(), 7850.0);
+    EXPECT_THROW(steel.setDensity(-1.0), std::invalid_argument);
+    EXPECT_EQ(steel.getDensity(), 7850.0);
+}
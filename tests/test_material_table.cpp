@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include "MaterialTable.h"
+#include "Assembler.h"
+#include "MatrixFreeStiffness.h"
+#include "StressRecovery.h"
+#include "Tet4Element.h"
+#include "TestMeshes.h"
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+// A box whose lower half is steel (ID 1) and upper half an orthotropic ply (ID 2),
+// with the IDs interleaved in element order the way a mesher might emit them
+static Mesh makeTwoMaterialBox(int n) {
+    Mesh mesh = makeBoxMesh(n);
+    for (size_t e = 0; e < mesh.getNumElements(); ++e) {
+        double z = 0.0;
+        for (int i = 0; i < 4; ++i) {
+            z += mesh.getZ()[mesh.getElementNodes(e)[i]] / 4.0;
+        }
+        mesh.setElementMaterial(e, z < n / 2.0 ? 1 : 2);
+    }
+    return mesh;
+}
+
+static MaterialTable makeTwoMaterialTable() {
+    MaterialTable table;
+    table.set(1, Material(210e9, 0.3));
+    table.set(2, Material::orthotropic({135e9, 10e9, 10e9, 0.3, 0.45, 0.3, 5e9, 3.4e9, 5e9}));
+    return table;
+}
+
+// Element by element with Tet4Element, each with the D of its own material
+static Eigen::MatrixXd referenceStiffness(const Mesh& mesh, const MaterialTable& table) {
+    Eigen::MatrixXd K = Eigen::MatrixXd::Zero(3 * mesh.getNumNodes(), 3 * mesh.getNumNodes());
+    for (size_t e = 0; e < mesh.getNumElements(); ++e) {
+        const int* nodes = mesh.getElementNodes(e);
+        Eigen::Matrix<double, 4, 3> coords;
+        for (int i = 0; i < 4; ++i) {
+            coords.row(i) << mesh.getX()[nodes[i]], mesh.getY()[nodes[i]], mesh.getZ()[nodes[i]];
+        }
+        Eigen::Matrix<double, 12, 12> ke = Tet4Element(coords).calculateStiffnessMatrix(table[mesh.getElementMaterial(e)]);
+        for (int i = 0; i < 12; ++i) {
+            for (int j = 0; j < 12; ++j) {
+                K(3 * nodes[i / 3] + i % 3, 3 * nodes[j / 3] + j % 3) += ke(i, j);
+            }
+        }
+    }
+    return K;
+}
+
+TEST(MaterialTableTest, SlotsDefaultAndMissingIds) {
+    MaterialTable table;
+    table.set(7, Material(210e9, 0.3));
+    table.set(3, Material(70e9, 0.33));
+    table.set(7, Material(200e9, 0.29)); // Replaces, keeps the slot
+    EXPECT_EQ(table.size(), 2u);
+    EXPECT_EQ(table.slotOf(7), 0);
+    EXPECT_EQ(table[7].getE(), 200e9);
+    EXPECT_FALSE(table.contains(5));
+    EXPECT_THROW(table.slotOf(5), std::out_of_range);
+
+    Mesh mesh = makeBoxMesh(1);
+    mesh.setElementMaterial(2, 3);
+    mesh.setElementMaterial(4, 5);
+    EXPECT_THROW(table.elementSlots(mesh), std::out_of_range);
+
+    table.setDefault(Material(1e9, 0.2));
+    EXPECT_TRUE(table.contains(5));
+    std::vector<int> slots = table.elementSlots(mesh);
+    EXPECT_EQ(slots, (std::vector<int>{2, 2, 1, 2, 2, 2})); // Material 0 falls back to the default too
+
+    // A single material covers every ID
+    MaterialTable single(Material(210e9, 0.3));
+    EXPECT_EQ(single.elementSlots(mesh), std::vector<int>(6, 0));
+}
+
+TEST(MaterialTableTest, AssemblyUsesEachElementsMaterial) {
+    Mesh mesh = makeTwoMaterialBox(2);
+    MaterialTable table = makeTwoMaterialTable();
+    Eigen::MatrixXd reference = referenceStiffness(mesh, table);
+
+    Eigen::SparseMatrix<double> K = Assembler(1).assembleGlobalStiffness(mesh, table);
+    EXPECT_LE((Eigen::MatrixXd(K) - reference).norm(), 1e-12 * reference.norm());
+
+    // Thread count and the pattern path give the same matrix
+    Eigen::SparseMatrix<double> K_threads = Assembler(3).assembleGlobalStiffness(mesh, table);
+    EXPECT_EQ((K_threads - K).norm(), 0.0);
+    Assembler assembler(3);
+    AssemblyPattern pattern = assembler.buildPattern(mesh);
+    Eigen::SparseMatrix<double> K_pattern = assembler.assembleGlobalStiffness(mesh, table, pattern);
+    EXPECT_LE((K_pattern - K).norm(), 1e-12 * K.norm());
+
+    // The pattern keeps each color grouped by material
+    const ElementColoring& coloring = pattern.coloring;
+    for (size_t c = 0; c < coloring.numColors(); ++c) {
+        for (size_t k = coloring.offsets[c] + 1; k < coloring.offsets[c + 1]; ++k) {
+            EXPECT_LE(mesh.getElementMaterial(coloring.elements[k - 1]), mesh.getElementMaterial(coloring.elements[k]));
+        }
+    }
+
+    mesh.setElementMaterial(0, 4);
+    EXPECT_THROW(Assembler().assembleGlobalStiffness(mesh, table), std::out_of_range);
+}
+
+TEST(MaterialTableTest, StressRecoveryAndMatrixFreeUseEachElementsMaterial) {
+    Mesh mesh = makeTwoMaterialBox(2);
+    MaterialTable table = makeTwoMaterialTable();
+    Eigen::SparseMatrix<double> K = Assembler().assembleGlobalStiffness(mesh, table);
+
+    MatrixFreeStiffness op(mesh, table);
+    Eigen::VectorXd u = Eigen::VectorXd::Random(K.rows());
+    Eigen::VectorXd y_assembled = K * u;
+    Eigen::VectorXd y_free = op * u;
+    EXPECT_LE((y_free - y_assembled).norm(), 1e-12 * y_assembled.norm());
+
+    StressResults results;
+    StressRecovery(mesh, 2).compute(table, u, results);
+    for (size_t e = 0; e < mesh.getNumElements(); ++e) {
+        Eigen::Matrix<double, 6, 1> expected = table[mesh.getElementMaterial(e)].getDMatrix() * results.element_strain.col(e);
+        EXPECT_LE((results.element_stress.col(e) - expected).norm(), 1e-12 * expected.norm()) << e;
+    }
+}
+
+TEST(MaterialTableTest, LoadsAllThreeKinds) {
+    std::ofstream("materials.txt") << "# id kind constants\n"
+                                      "1 isotropic 210e9 0.3 7850\n"
+                                      "\n"
+                                      "2 orthotropic 135e9 10e9 10e9 0.3 0.45 0.3 5e9 3.4e9 5e9\n"
+                                      "3 anisotropic 10 1 1 0 0 0  10 1 0 0 0  10 0 0 0  4 0 0  4 0  4\n"
+                                      "default isotropic 70e9 0.33\n";
+    MaterialTable table;
+    ASSERT_TRUE(loadMaterialTable("materials.txt", table));
+    EXPECT_EQ(table.size(), 4u);
+    EXPECT_EQ(table[1].getKind(), Material::Kind::Isotropic);
+    EXPECT_EQ(table[2].getKind(), Material::Kind::Orthotropic);
+    EXPECT_EQ(table[3].getKind(), Material::Kind::Anisotropic);
+    EXPECT_EQ(table[3].getDMatrix()(0, 1), 1.0);
+    EXPECT_EQ(table[3].getDMatrix()(5, 5), 4.0);
+    EXPECT_EQ(table[99].getE(), 70e9);
+    EXPECT_EQ(table[1].getDensity(), 7850.0);
+    EXPECT_EQ(table[2].getDensity(), 0.0);
+
+    const char* bad[] = {
+        "1 isotropic 210e9\n",
+        "1 plastic 210e9 0.3\n",
+        "x isotropic 210e9 0.3\n",
+        "1 isotropic 210e9 0.7\n",
+        "1 isotropic 210e9 0.3 7850 1\n",
+        "1 isotropic 210e9 0.3 -7850\n",
+        "1 anisotropic 1 0 0 0 0 0 1 0 0 0 0 1 0 0 0 1 0 0 1 0 -1\n",
+    };
+    for (const char* text : bad) {
+        std::ofstream("materials.txt") << text;
+        EXPECT_FALSE(loadMaterialTable("materials.txt", table)) << text;
+        EXPECT_EQ(table.size(), 0u);
+    }
+    std::remove("materials.txt");
+}
@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+#include "MatrixFreeStiffness.h"
+#include "Assembler.h"
+#include "BoundaryConditions.h"
+#include "Mesh.h"
+#include "Material.h"
+#include "TestMeshes.h"
+#include <Eigen/IterativeLinearSolvers>
+#include <Eigen/SparseLU>
+#include <Eigen/SparseCholesky>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+// DOFs of every node on the z = 0 face
+static std::vector<int> bottomFaceDofs(const Mesh& mesh) {
+    std::vector<int> dofs;
+    for (size_t i = 0; i < mesh.getNodes().size(); ++i) {
+        if (mesh.getNodes()[i].z == 0.0) {
+            for (int d = 0; d < 3; ++d) {
+                dofs.push_back(static_cast<int>(i) * 3 + d);
+            }
+        }
+    }
+    return dofs;
+}
+
+TEST(MatrixFreeTest, ProductMatchesAssembledMatrix) {
+    Mesh mesh = makeBoxMesh(3);
+    Material material(210e9, 0.3);
+
+    Eigen::SparseMatrix<double> K = Assembler().assembleGlobalStiffness(mesh, material);
+    MatrixFreeStiffness op(mesh, material, 0);
+
+    Eigen::VectorXd u = Eigen::VectorXd::Random(K.rows());
+    Eigen::VectorXd y_assembled = K * u;
+    Eigen::VectorXd y_free = op * u;
+    ASSERT_LE((y_free - y_assembled).norm(), 1e-12 * y_assembled.norm());
+
+    Eigen::VectorXd diag_assembled = K.diagonal();
+    ASSERT_LE((op.diagonal() - diag_assembled).norm(), 1e-12 * diag_assembled.norm());
+}
+
+TEST(MatrixFreeTest, GeometryGoesStaleWhenNodesMove) {
+    Mesh mesh = makeBoxMesh(3);
+    Material material(210e9, 0.3);
+    ElementGeometry geometry(mesh);
+    MatrixFreeStiffness op(mesh, material);
+    op.setGeometry(&geometry);
+
+    mesh.setNodeCoordinates(mesh.getNodeIndex(22), 1.3, 1.2, 1.4);
+    Eigen::SparseMatrix<double> K = Assembler().assembleGlobalStiffness(mesh, material);
+    Eigen::VectorXd u = Eigen::VectorXd::Random(K.rows());
+    Eigen::VectorXd y_assembled = K * u;
+    Eigen::VectorXd y_free = op * u;
+    EXPECT_LE((y_free - y_assembled).norm(), 1e-12 * y_assembled.norm());
+    EXPECT_LE((op.diagonal() - K.diagonal()).norm(), 1e-12 * K.diagonal().norm());
+}
+
+TEST(MatrixFreeTest, ConjugateGradientMatchesDirectSolve) {
+    Mesh mesh = makeBoxMesh(3);
+    Material material(210e9, 0.3);
+    std::vector<int> fixed_dofs = bottomFaceDofs(mesh);
+
+    // Reference: eliminate the fixed DOFs from the assembled K and solve directly
+    Eigen::SparseMatrix<double> K = Assembler().assembleGlobalStiffness(mesh, material);
+    std::vector<char> fixed(K.rows(), 0);
+    for (int dof : fixed_dofs) {
+        fixed[dof] = 1;
+    }
+    K.prune([&](Eigen::Index row, Eigen::Index col, double) { return !fixed[row] && !fixed[col]; });
+    for (int dof : fixed_dofs) {
+        K.coeffRef(dof, dof) = 1.0;
+    }
+
+    Eigen::VectorXd F = Eigen::VectorXd::Zero(K.rows());
+    F(F.size() - 1) = -1e7; // Pull down the top corner
+
+    Eigen::SparseLU<Eigen::SparseMatrix<double>> lu(K);
+    Eigen::VectorXd U_ref = lu.solve(F);
+
+    MatrixFreeStiffness op(mesh, material);
+    op.setConstrainedDofs(fixed_dofs);
+    Eigen::ConjugateGradient<MatrixFreeStiffness, Eigen::Lower | Eigen::Upper, MatrixFreeJacobi> cg;
+    cg.setTolerance(1e-12);
+    cg.compute(op);
+    Eigen::VectorXd U = cg.solve(F);
+
+    ASSERT_EQ(cg.info(), Eigen::Success);
+    ASSERT_LE((U - U_ref).norm(), 1e-8 * U_ref.norm());
+    for (int dof : fixed_dofs) {
+        ASSERT_EQ(U(dof), 0.0);
+    }
+}
+
+TEST(MatrixFreeTest, NonzeroPrescribedValuesMatchReducedSolve) {
+    Mesh mesh = makeBoxMesh(3);
+    Material material(210e9, 0.3);
+
+    // Bottom clamped, top pressed down by a prescribed displacement
+    double top = *std::max_element(mesh.getZ().begin(), mesh.getZ().end());
+    BoundaryConditions bcs(mesh);
+    for (size_t i = 0; i < mesh.getNumNodes(); ++i) {
+        if (mesh.getZ()[i] == 0.0) {
+            bcs.fixNode(mesh.getNodeIds()[i]);
+        } else if (mesh.getZ()[i] == top) {
+            bcs.prescribe(mesh.getNodeIds()[i], 2, -1e-3);
+        }
+    }
+    Eigen::SparseMatrix<double> K = Assembler().assembleGlobalStiffness(mesh, material);
+    Eigen::VectorXd F = Eigen::VectorXd::Zero(K.rows());
+    F(F.size() - 2) = 1e5; // A side load on the top corner as well
+    Eigen::SparseMatrix<double> K_ff;
+    Eigen::VectorXd F_f;
+    bcs.reduce(K, F, K_ff, F_f);
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> ldlt(K_ff);
+    ASSERT_EQ(ldlt.info(), Eigen::Success);
+    Eigen::VectorXd U_ref = bcs.expand(ldlt.solve(F_f));
+
+    std::vector<int> constrained_dofs;
+    for (size_t dof = 0; dof < bcs.getNumDofs(); ++dof) {
+        if (bcs.isConstrained(dof)) {
+            constrained_dofs.push_back(static_cast<int>(dof));
+        }
+    }
+    MatrixFreeStiffness op(mesh, material);
+    op.setConstrainedDofs(constrained_dofs);
+    Eigen::VectorXd rhs = F;
+    op.liftPrescribedValues(U_ref, rhs); // Only the constrained entries are read
+    Eigen::ConjugateGradient<MatrixFreeStiffness, Eigen::Lower | Eigen::Upper, MatrixFreeJacobi> cg;
+    cg.setTolerance(1e-12);
+    cg.compute(op);
+    Eigen::VectorXd U = cg.solve(rhs);
+
+    ASSERT_EQ(cg.info(), Eigen::Success);
+    EXPECT_LE((U - U_ref).norm(), 1e-8 * U_ref.norm());
+    for (int dof : constrained_dofs) {
+        EXPECT_NEAR(U(dof), U_ref(dof), 1e-12);
+    }
+    EXPECT_THROW(op.liftPrescribedValues(Eigen::VectorXd::Zero(3), rhs), std::invalid_argument);
+}
+
+TEST(MatrixFreeTest, MatvecBenchmarkAgainstAssembledCsr) {
+    Mesh mesh = makeBoxMesh(10);
+    Material material(210e9, 0.3);
+
+    Eigen::SparseMatrix<double> K = Assembler().assembleGlobalStiffness(mesh, material);
+    MatrixFreeStiffness op(mesh, material);
+    Eigen::VectorXd u = Eigen::VectorXd::Random(K.rows());
+    Eigen::VectorXd y(K.rows());
+
+    const int repeats = 5;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        y.noalias() = K * u;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        y.noalias() = op * u;
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    size_t csr_bytes = K.nonZeros() * (sizeof(double) + sizeof(int)) + (K.outerSize() + 1) * sizeof(int);
+    std::cout << "[ INFO     ] " << K.rows() << " DOFs: CSR " << csr_bytes << " B, "
+              << std::chrono::duration<double>(t1 - t0).count() / repeats * 1e3 << " ms/matvec; matrix-free "
+              << op.memoryBytes() << " B, " << std::chrono::duration<double>(t2 - t1).count() / repeats * 1e3
+              << " ms/matvec" << std::endl;
+
+    ASSERT_LT(op.memoryBytes(), csr_bytes);
+}
@@ -1,6 +1,16 @@
 #include <gtest/gtest.h>
 #include "Mesh.h" // Include the class we want to test
+#include "MeshGenerator.h"
+#include "BinaryMeshFormat.h"
 #include <fstream> // Needed to write our test file
+#include <sstream>
+#include <string>
+#include <iterator>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <stdexcept>
 
 // Test #1: Checks that a newly created Mesh object is empty.
 TEST(MeshTest, IsEmptyInitially) {
@@ -30,4 +40,322 @@ TEST(MeshTest, LoadFromFile) {
     ASSERT_TRUE(loadSuccess);
     ASSERT_EQ(myMesh.getNumNodes(), 4);
     ASSERT_EQ(myMesh.getNumElements(), 2);
-}
\ No newline at end of file
+}
+// Test #3: A larger file parses identically with one thread and many, and
+// matches what operator>> reads for every number.
+TEST(MeshTest, ParallelLoadMatchesStreamParsing) {
+    std::ostringstream text;
+    text << "# generated\r\n";
+    text << "NODES 500\n";
+    for (int i = 1; i <= 500; ++i) {
+        text << i << " " << i * 0.1 << " -" << 1.0 / i << " +" << i << "e-3\n";
+        if (i % 97 == 0) {
+            text << "\n# comment inside a block\n";
+        }
+    }
+    text << "ELEMENTS 300\r\n";
+    for (int i = 1; i <= 300; ++i) {
+        text << i << " 4 " << i << " " << i + 1 << " " << i + 2 << " " << i + 3 << "\r\n";
+    }
+    std::ofstream("parallel.mesh") << text.str();
+
+    Mesh serial, parallel;
+    ASSERT_TRUE(serial.loadFromFile("parallel.mesh", 1));
+    ASSERT_TRUE(parallel.loadFromFile("parallel.mesh", 7));
+    ASSERT_EQ(serial.getNumNodes(), 500);
+    ASSERT_EQ(serial.getNumElements(), 300);
+
+    std::istringstream stream(text.str());
+    std::string skip;
+    std::getline(stream, skip); // Comment
+    std::getline(stream, skip); // NODES header
+    for (int i = 0; i < 500; ++i) {
+        Node ref;
+        stream >> ref.id >> ref.x >> ref.y >> ref.z;
+        if ((i + 1) % 97 == 0) {
+            std::getline(stream, skip);
+            std::getline(stream, skip);
+            std::getline(stream, skip);
+        }
+        const Node& a = serial.getNodes()[i];
+        const Node& b = parallel.getNodes()[i];
+        ASSERT_EQ(a.id, ref.id);
+        ASSERT_EQ(a.x, ref.x);
+        ASSERT_EQ(a.y, ref.y);
+        ASSERT_EQ(a.z, ref.z);
+        ASSERT_EQ(b.id, a.id);
+        ASSERT_EQ(b.x, a.x);
+        ASSERT_EQ(b.y, a.y);
+        ASSERT_EQ(b.z, a.z);
+    }
+    for (int i = 0; i < 300; ++i) {
+        ASSERT_EQ(serial.getElements()[i].id, i + 1);
+        ASSERT_EQ(serial.getElements()[i].connectivity, (std::vector<int>{i + 1, i + 2, i + 3, i + 4}));
+        ASSERT_EQ(parallel.getElements()[i].connectivity, serial.getElements()[i].connectivity);
+    }
+}
+
+// Test #4: Malformed input is rejected with the offending line number.
+TEST(MeshTest, MalformedInputReportsLineNumbers) {
+    struct Case {
+        const char* text;
+        const char* expected; // Substring of the error
+    };
+    const Case cases[] = {
+        {"NODES 2\n1 0 0 0\n2 0 zero 0\n", "bad.mesh:3:"},
+        {"NODES 1\n1 0 0 0 7\n", "bad.mesh:2: unexpected trailing data"},
+        {"NODES 3\n1 0 0 0\n2 1 0 0\n", "found 2 before end of file"},
+        {"NODES 3\n1 0 0 0\n2 1 0 0\n3 0 1 0\n\nELEMENTS 1\n1 4 1 2 3\n", "bad.mesh:7: element 1 lists fewer than 4"},
+        {"NODES 1\n1 0 0 0\nELEMENTS 1\n1 4 1 1 7 1\n", "bad.mesh:4: element 1 references unknown node ID 7"},
+        {"NODES 2\n5 0 0 0\n5 1 0 0\n", "duplicate node ID 5"},
+        {"NODES 1\n1 0 0 0\nFACES 2\n", "bad.mesh:3: unknown keyword 'FACES'"},
+        {"NODES many\n", "bad.mesh:1: expected a record count"},
+        {"NODES 1\n1 0 0 0\nELEMENTS 1\n1 4 1 1 1 1 2 3\n", "bad.mesh:4: unexpected trailing data"},
+    };
+    for (const Case& c : cases) {
+        std::ofstream("bad.mesh") << c.text;
+        Mesh mesh;
+        ASSERT_FALSE(mesh.loadFromFile("bad.mesh")) << c.text;
+        EXPECT_NE(mesh.getLastError().find(c.expected), std::string::npos) << mesh.getLastError();
+        EXPECT_EQ(mesh.getNumNodes(), 0u);
+    }
+
+    Mesh missing;
+    ASSERT_FALSE(missing.loadFromFile("does_not_exist.mesh"));
+}
+
+// Test #5: Binary format round trip, including loadFromFile's magic detection.
+TEST(MeshTest, BinaryRoundTrip) {
+    Mesh original;
+    original.addNode(10, 0.1, 0.2, 0.3);
+    original.addNode(20, 1.0 / 3.0, -2.5, 1e-300);
+    original.addNode(30, 4.0, 5.0, 6.0);
+    original.addElement({10, 20, 30});
+    original.addElement({30, 20, 10, 10});
+    // A 3-node element has no type the binary format can record
+    ASSERT_FALSE(original.saveBinary("roundtrip.femb"));
+    original = Mesh();
+    original.addNode(10, 0.1, 0.2, 0.3);
+    original.addNode(20, 1.0 / 3.0, -2.5, 1e-300);
+    original.addNode(30, 4.0, 5.0, 6.0);
+    original.addElement({10, 20, 30, 30});
+    original.addElement({30, 20, 10, 10});
+    ASSERT_TRUE(original.saveBinary("roundtrip.femb"));
+
+    Mesh loaded;
+    ASSERT_TRUE(loaded.loadFromFile("roundtrip.femb"));
+    ASSERT_EQ(loaded.getNumNodes(), 3);
+    ASSERT_EQ(loaded.getNumElements(), 2);
+    for (size_t i = 0; i < 3; ++i) {
+        ASSERT_EQ(loaded.getNodes()[i].id, original.getNodes()[i].id);
+        ASSERT_EQ(loaded.getNodes()[i].x, original.getNodes()[i].x);
+        ASSERT_EQ(loaded.getNodes()[i].y, original.getNodes()[i].y);
+        ASSERT_EQ(loaded.getNodes()[i].z, original.getNodes()[i].z);
+    }
+    ASSERT_EQ(loaded.getElements()[1].id, 2);
+    ASSERT_EQ(loaded.getElements()[1].connectivity, (std::vector<int>{30, 20, 10, 10}));
+
+    // A truncated file is rejected instead of being misread
+    std::ifstream in("roundtrip.femb", std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::ofstream("truncated.femb", std::ios::binary) << bytes.substr(0, bytes.size() - 4);
+    Mesh truncated;
+    ASSERT_FALSE(truncated.loadFromFile("truncated.femb"));
+    EXPECT_NE(truncated.getLastError().find("truncated"), std::string::npos) << truncated.getLastError();
+}
+
+TEST(MeshTest, BinaryLoadRejectsATypeThatDisagreesWithTheNodeCount) {
+    Mesh original = generateBoxMesh(2, 1, 1);
+    ASSERT_TRUE(original.saveBinary("mistyped.femb"));
+    std::string bytes;
+    {
+        std::ifstream in("mistyped.femb", std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    BinaryMeshHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+
+    // A 4-node record tagged as a Hex8 or Tet10 would make the kernels read
+    // past its connectivity; Unknown is rejected as well
+    for (ElementType type : {ElementType::Hex8, ElementType::Tet10, ElementType::Unknown}) {
+        std::string corrupt = bytes;
+        corrupt[header.element_types_offset + 3] = static_cast<char>(type);
+        std::ofstream("mistyped.femb", std::ios::binary | std::ios::trunc) << corrupt;
+        Mesh loaded;
+        EXPECT_FALSE(loaded.loadBinary("mistyped.femb")) << static_cast<int>(type);
+        EXPECT_NE(loaded.getLastError().find("corrupt"), std::string::npos) << loaded.getLastError();
+    }
+}
+
+TEST(MeshTest, BinaryLoadViewsTheMappedFile) {
+    Mesh original = generateBoxMesh(3, 2, 2);
+    ASSERT_TRUE(original.saveBinary("mapped.femb"));
+    Mesh loaded;
+    ASSERT_TRUE(loaded.loadBinary("mapped.femb"));
+    ASSERT_TRUE(loaded.isMapped());
+    EXPECT_EQ(loaded.getX(), original.getX());
+    EXPECT_EQ(loaded.getConnectivity(), original.getConnectivity());
+    EXPECT_EQ(loaded.getElementOffsets(), original.getElementOffsets());
+
+    // A copy shares the mapping and outlives the mesh it was copied from
+    Mesh copy = loaded;
+    loaded = Mesh();
+    EXPECT_FALSE(loaded.isMapped());
+    ASSERT_TRUE(copy.isMapped());
+    EXPECT_EQ(copy.getZ(), original.getZ());
+
+    // Writes copy the touched arrays out of the mapping; the file is untouched
+    copy.setNodeCoordinates(0, -1.0, -2.0, -3.0);
+    std::vector<int> reverse(copy.getNumNodes());
+    for (size_t i = 0; i < reverse.size(); ++i) {
+        reverse[i] = static_cast<int>(reverse.size() - 1 - i);
+    }
+    copy.permuteNodes(reverse);
+    EXPECT_EQ(copy.getX().back(), -1.0);
+    EXPECT_TRUE(copy.isMapped()); // Element IDs, types, materials and offsets still are
+    Mesh reloaded;
+    ASSERT_TRUE(reloaded.loadBinary("mapped.femb"));
+    EXPECT_EQ(reloaded.getX(), original.getX());
+    EXPECT_EQ(reloaded.getConnectivity(), original.getConnectivity());
+    std::remove("mapped.femb");
+}
+
+// Test #6: A sidecar cache is used while fresh and rewritten when the text changes.
+TEST(MeshTest, SidecarCacheIsUsedAndRefreshed) {
+    std::remove("cached.mesh.femb");
+    std::ofstream("cached.mesh") << "NODES 1\n1 0 0 0\nELEMENTS 0\n";
+
+    // Without a sidecar the text is parsed and no cache appears
+    Mesh plain;
+    ASSERT_TRUE(plain.loadFromFile("cached.mesh"));
+    ASSERT_FALSE(std::ifstream("cached.mesh.femb").good());
+
+    // A sidecar stamped with the current text is loaded instead of the text
+    Mesh marker;
+    marker.addNode(1, 0, 0, 0);
+    marker.addNode(2, 7, 7, 7);
+    ASSERT_TRUE(marker.saveBinary("cached.mesh.femb", "cached.mesh"));
+    Mesh from_cache;
+    ASSERT_TRUE(from_cache.loadFromFile("cached.mesh"));
+    ASSERT_EQ(from_cache.getNumNodes(), 2);
+
+    // Editing the text invalidates the sidecar, which is then refreshed
+    std::ofstream("cached.mesh") << "NODES 4\n1 0 0 0\n2 1 0 0\n3 0 1 0\n4 0 0 1\nELEMENTS 1\n1 4 1 2 3 4\n";
+    Mesh from_text;
+    ASSERT_TRUE(from_text.loadFromFile("cached.mesh"));
+    ASSERT_EQ(from_text.getNumNodes(), 4);
+
+    Mesh refreshed;
+    ASSERT_TRUE(refreshed.loadBinary("cached.mesh.femb"));
+    ASSERT_EQ(refreshed.getNumNodes(), 4);
+    ASSERT_EQ(refreshed.getNumElements(), 1);
+}
+
+// Test #7: Node IDs need not be contiguous; elements store 0-based node indices.
+TEST(MeshTest, NodeIdsMapToStorageIndices) {
+    std::ofstream("sparse_ids.mesh") << "NODES 4\n"
+                                        "40 0 0 0\n"
+                                        "10 1 0 0\n"
+                                        "30 0 1 0\n"
+                                        "20 0 0 1\n"
+                                        "ELEMENTS 2\n"
+                                        "5 4 40 10 30 20\n"
+                                        "6 4 20 30 10 40\n";
+    Mesh mesh;
+    ASSERT_TRUE(mesh.loadFromFile("sparse_ids.mesh"));
+    ASSERT_EQ(mesh.getNodeIndex(40), 0);
+    ASSERT_EQ(mesh.getNodeIndex(20), 3);
+    ASSERT_EQ(mesh.getNodeIndex(1), -1);
+    ASSERT_EQ(mesh.getY()[mesh.getNodeIndex(30)], 1.0);
+
+    ASSERT_EQ(mesh.getElementOffsets().size(), 3u);
+    ASSERT_EQ(mesh.getElementTypes()[1], ElementType::Tet4);
+    ASSERT_EQ(mesh.getElementNodes(1)[0], 3);
+    ASSERT_EQ(mesh.getElementNodes(1)[3], 0);
+
+    // The AoS compatibility views still speak in node IDs
+    ASSERT_EQ(mesh.getNodes()[1].id, 10);
+    ASSERT_EQ(mesh.getElements()[0].connectivity, (std::vector<int>{40, 10, 30, 20}));
+
+    Mesh built;
+    built.addNode(7, 0, 0, 0);
+    ASSERT_THROW(built.addNode(7, 1, 1, 1), std::invalid_argument);
+    ASSERT_THROW(built.addElement({7, 8}), std::invalid_argument);
+    ASSERT_EQ(built.getNumElements(), 0u);
+    ASSERT_TRUE(built.getConnectivity().empty());
+}
+
+TEST(MeshTest, GeneratedBoxHasExpectedSizeAndVolume) {
+    Mesh mesh = generateBoxMesh(3, 2, 4, 0.5);
+    ASSERT_EQ(mesh.getNumNodes(), 4u * 3u * 5u);
+    ASSERT_EQ(mesh.getNumElements(), 6u * 3u * 2u * 4u);
+    ASSERT_EQ(mesh.getNodeIndex(1 + 3 + 4 * (2 + 3 * 4)), static_cast<int>(mesh.getNumNodes()) - 1);
+    ASSERT_EQ(mesh.getX().back(), 1.5);
+    ASSERT_EQ(mesh.getZ().back(), 2.0);
+
+    // Tets tile the box with positive orientation
+    double volume = 0.0;
+    for (size_t e = 0; e < mesh.getNumElements(); ++e) {
+        const int* n = mesh.getElementNodes(e);
+        double a[3], b[3], c[3];
+        for (int d = 0; d < 3; ++d) {
+            const MeshArray<double>& x = d == 0 ? mesh.getX() : (d == 1 ? mesh.getY() : mesh.getZ());
+            a[d] = x[n[1]] - x[n[0]];
+            b[d] = x[n[2]] - x[n[0]];
+            c[d] = x[n[3]] - x[n[0]];
+        }
+        double det = a[0] * (b[1] * c[2] - b[2] * c[1]) - a[1] * (b[0] * c[2] - b[2] * c[0]) +
+                     a[2] * (b[0] * c[1] - b[1] * c[0]);
+        ASSERT_GT(det, 0.0) << "element " << e;
+        volume += det / 6.0;
+    }
+    ASSERT_NEAR(volume, 1.5 * 1.0 * 2.0, 1e-12);
+    ASSERT_THROW(generateBoxMesh(0, 1, 1), std::invalid_argument);
+}
+
+TEST(MeshTest, SaveTextRoundTrips) {
+    Mesh mesh = generateBoxMesh(2, 3, 1, 0.1); // 0.1 multiples are not exact in binary
+    ASSERT_TRUE(mesh.saveText("saved.mesh"));
+    Mesh loaded;
+    ASSERT_TRUE(loaded.loadFromFile("saved.mesh"));
+    ASSERT_EQ(loaded.getNodeIds(), mesh.getNodeIds());
+    ASSERT_EQ(loaded.getX(), mesh.getX());
+    ASSERT_EQ(loaded.getY(), mesh.getY());
+    ASSERT_EQ(loaded.getZ(), mesh.getZ());
+    ASSERT_EQ(loaded.getElementIds(), mesh.getElementIds());
+    ASSERT_EQ(loaded.getElementOffsets(), mesh.getElementOffsets());
+    ASSERT_EQ(loaded.getConnectivity(), mesh.getConnectivity());
+    std::remove("saved.mesh");
+}
+
+TEST(MeshTest, ElementMaterialIdsSurviveTextAndBinary) {
+    std::ofstream("regions.mesh") << "NODES 5\n"
+                                     "1 0 0 0\n2 1 0 0\n3 0 1 0\n4 0 0 1\n5 1 1 1\n"
+                                     "ELEMENTS 3\n"
+                                     "1 4 1 2 3 4\n"
+                                     "2 4 2 3 4 5 7\n"
+                                     "3 4 1 2 3 5 -2\n";
+    Mesh mesh;
+    ASSERT_TRUE(mesh.loadFromFile("regions.mesh"));
+    ASSERT_EQ(mesh.getElementMaterials(), (std::vector<int>{0, 7, -2}));
+
+    mesh.setElementMaterial(0, 3);
+    EXPECT_THROW(mesh.setElementMaterial(3, 1), std::out_of_range);
+    mesh.addElement({1, 3, 4, 5}, 9);
+    std::vector<int> expected = {3, 7, -2, 9};
+    ASSERT_EQ(mesh.getElementMaterials(), expected);
+
+    ASSERT_TRUE(mesh.saveText("regions_saved.mesh"));
+    Mesh from_text;
+    ASSERT_TRUE(from_text.loadFromFile("regions_saved.mesh"));
+    EXPECT_EQ(from_text.getElementMaterials(), expected);
+
+    ASSERT_TRUE(mesh.saveBinary("regions.femb"));
+    Mesh from_binary;
+    ASSERT_TRUE(from_binary.loadFromFile("regions.femb"));
+    EXPECT_EQ(from_binary.getElementMaterials(), expected);
+
+    std::remove("regions.mesh");
+    std::remove("regions_saved.mesh");
+    std::remove("regions.femb");
+}
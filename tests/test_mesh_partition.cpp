@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+#include "MeshPartition.h"
+#include "TestMeshes.h"
+#include <algorithm>
+#include <stdexcept>
+
+TEST(MeshPartitionTest, BisectionIsBalancedAndCoversEveryNode) {
+    Mesh mesh = generateBoxMesh(6, 4, 3);
+    for (int parts : {1, 2, 3, 7, 8}) {
+        MeshPartition partition = partitionMeshRCB(mesh, parts);
+        ASSERT_EQ(partition.num_parts, parts);
+        ASSERT_EQ(partition.node_part.size(), mesh.getNumNodes());
+        std::vector<size_t> sizes = partition.partSizes();
+        // Each split rounds down, so a part can lose one node per level
+        size_t smallest = *std::min_element(sizes.begin(), sizes.end());
+        size_t largest = *std::max_element(sizes.begin(), sizes.end());
+        EXPECT_GT(smallest, 0u) << parts << " parts";
+        EXPECT_LE(largest - smallest, 3u) << parts << " parts";
+        for (int part : partition.element_part) {
+            ASSERT_GE(part, 0);
+            ASSERT_LT(part, parts);
+        }
+    }
+}
+
+TEST(MeshPartitionTest, FirstCutIsAcrossTheLongestSide) {
+    // 6 x 4 x 3 box: two parts must split along x
+    Mesh mesh = generateBoxMesh(6, 4, 3);
+    MeshPartition partition = partitionMeshRCB(mesh, 2);
+    double max_left = -1e300, min_right = 1e300;
+    for (size_t n = 0; n < mesh.getNumNodes(); ++n) {
+        if (partition.node_part[n] == 0) {
+            max_left = std::max(max_left, mesh.getX()[n]);
+        } else {
+            min_right = std::min(min_right, mesh.getX()[n]);
+        }
+    }
+    EXPECT_LE(max_left, min_right);
+
+    // Elements go to the part holding most of their nodes
+    for (size_t e = 0; e < mesh.getNumElements(); ++e) {
+        int votes = 0;
+        for (size_t i = 0; i < mesh.getElementNumNodes(e); ++i) {
+            votes += partition.node_part[mesh.getElementNodes(e)[i]] == partition.element_part[e];
+        }
+        EXPECT_GE(2 * votes, static_cast<int>(mesh.getElementNumNodes(e)));
+    }
+}
+
+TEST(MeshPartitionTest, FreeDofsFollowTheirNodes) {
+    Mesh mesh = makeBoxMesh(3);
+    MeshPartition partition = partitionMeshRCB(mesh, 4);
+    BoundaryConditions bcs(mesh);
+    bcs.fixNode(mesh.getNodeIds()[0]);
+    bcs.prescribe(mesh.getNodeIds()[5], 1, 0.0);
+
+    std::vector<int> dof_part = partitionFreeDofs(partition, bcs);
+    ASSERT_EQ(dof_part.size(), bcs.getNumFreeDofs());
+    for (size_t dof = 0; dof < bcs.getNumDofs(); ++dof) {
+        int reduced = bcs.getReducedIndex(dof);
+        if (reduced >= 0) {
+            EXPECT_EQ(dof_part[reduced], partition.node_part[dof / 3]);
+        }
+    }
+    EXPECT_THROW(partitionMeshRCB(mesh, 0), std::invalid_argument);
+}
@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include "ModalSolver.h"
+#include "Assembler.h"
+#include "BoundaryConditions.h"
+#include "Material.h"
+#include "TestMeshes.h"
+#include <Eigen/Eigenvalues>
+#include <stdexcept>
+
+namespace {
+
+Material steel() {
+    Material material(210e9, 0.3);
+    material.setDensity(7850.0);
+    return material;
+}
+
+// Reduced K and M of an n x 2 x 1 bar clamped at x = 0
+void clampedBar(int n, MassMatrixType mass, Eigen::SparseMatrix<double>& K_ff, Eigen::SparseMatrix<double>& M_ff) {
+    Mesh mesh = generateBoxMesh(n, 2, 1);
+    Assembler assembler;
+    BoundaryConditions bcs(mesh);
+    for (size_t i = 0; i < mesh.getNumNodes(); ++i) {
+        if (mesh.getX()[i] == 0.0) {
+            bcs.fixNode(mesh.getNodeIds()[i]);
+        }
+    }
+    bcs.reduce(assembler.assembleGlobalStiffness(mesh, steel()), K_ff);
+    bcs.reduce(assembler.assembleGlobalMass(mesh, steel(), mass), M_ff);
+}
+
+Eigen::VectorXd denseEigenvalues(const Eigen::SparseMatrix<double>& K, const Eigen::SparseMatrix<double>& M) {
+    Eigen::MatrixXd K_dense = K, M_dense = M;
+    Eigen::GeneralizedSelfAdjointEigenSolver<Eigen::MatrixXd> dense(K_dense, M_dense);
+    return dense.eigenvalues();
+}
+
+} // namespace
+
+TEST(ModalSolverTest, LowestModesMatchDenseEigensolve) {
+    Eigen::SparseMatrix<double> K, M;
+    clampedBar(10, MassMatrixType::Consistent, K, M);
+    Eigen::VectorXd expected = denseEigenvalues(K, M);
+
+    ModalSolver modal;
+    ModalResults results;
+    const int num_modes = 8;
+    ASSERT_TRUE(modal.compute(K, M, num_modes, results));
+    ASSERT_EQ(results.eigenvalues.size(), num_modes);
+    for (int i = 0; i < num_modes; ++i) {
+        EXPECT_NEAR(results.eigenvalues(i), expected(i), 1e-8 * expected(i)) << "mode " << i;
+        EXPECT_NEAR(results.frequencies(i), std::sqrt(expected(i)) / (2.0 * M_PI), 1e-8 * results.frequencies(i));
+    }
+    // Mass-normalized, M-orthogonal and far fewer steps than unknowns
+    Eigen::MatrixXd gram = results.modes.transpose() * (M * results.modes);
+    EXPECT_LE((gram - Eigen::MatrixXd::Identity(num_modes, num_modes)).norm(), 1e-10);
+    EXPECT_LE(modal.getStats().residual, 1e-6);
+    EXPECT_LT(modal.getStats().basis_size, K.rows() / 3);
+}
+
+TEST(ModalSolverTest, LumpedMassLowersTheFrequencies) {
+    Eigen::SparseMatrix<double> K, M_consistent, M_lumped;
+    clampedBar(4, MassMatrixType::Consistent, K, M_consistent);
+    clampedBar(4, MassMatrixType::Lumped, K, M_lumped);
+
+    ModalSolver modal;
+    ModalResults consistent, lumped;
+    ASSERT_TRUE(modal.compute(K, M_consistent, 3, consistent));
+    ASSERT_TRUE(modal.compute(K, M_lumped, 3, lumped));
+    Eigen::VectorXd expected = denseEigenvalues(K, M_lumped);
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_NEAR(lumped.eigenvalues(i), expected(i), 1e-8 * expected(i));
+        EXPECT_LT(lumped.frequencies(i), consistent.frequencies(i));
+    }
+}
+
+TEST(ModalSolverTest, FreeBodyNeedsANegativeShift) {
+    Mesh mesh = generateBoxMesh(3, 2, 1);
+    Assembler assembler;
+    Eigen::SparseMatrix<double> K = assembler.assembleGlobalStiffness(mesh, steel());
+    Eigen::SparseMatrix<double> M = assembler.assembleGlobalMass(mesh, steel());
+    Eigen::VectorXd expected = denseEigenvalues(K, M);
+
+    // Six rigid-body modes at zero, then the first elastic mode; the block
+    // covers the six-fold zero eigenvalue
+    ModalSolver modal;
+    modal.setShift(-0.01 * expected(6));
+    modal.setBlockSize(6);
+    ModalResults results;
+    ASSERT_TRUE(modal.compute(K, M, 7, results));
+    for (int i = 0; i < 6; ++i) {
+        EXPECT_NEAR(results.eigenvalues(i), 0.0, 1e-6 * expected(6)) << "mode " << i;
+    }
+    EXPECT_NEAR(results.eigenvalues(6), expected(6), 1e-8 * expected(6));
+}
+
+TEST(ModalSolverTest, LastBlockShrinksToTheBasisLimit) {
+    // 18 free DOFs, not a multiple of the block size, so the basis only
+    // reaches the full space through a narrower last block
+    Eigen::SparseMatrix<double> K, M;
+    clampedBar(1, MassMatrixType::Consistent, K, M);
+    ASSERT_EQ(K.rows(), 18);
+    Eigen::VectorXd expected = denseEigenvalues(K, M);
+
+    ModalSolver modal;
+    modal.setBlockSize(4);
+    ModalResults results;
+    ASSERT_TRUE(modal.compute(K, M, 18, results));
+    EXPECT_EQ(modal.getStats().basis_size, 18);
+    for (int i = 0; i < 18; ++i) {
+        EXPECT_NEAR(results.eigenvalues(i), expected(i), 1e-8 * expected(i)) << "mode " << i;
+    }
+}
+
+TEST(ModalSolverTest, RejectsBadInput) {
+    Eigen::SparseMatrix<double> K, M;
+    clampedBar(2, MassMatrixType::Consistent, K, M);
+    ModalSolver modal;
+    ModalResults results;
+    EXPECT_THROW(modal.compute(K, M, 0, results), std::invalid_argument);
+    EXPECT_THROW(modal.compute(K, M, static_cast<int>(K.rows()) + 1, results), std::invalid_argument);
+    EXPECT_THROW(modal.setBlockSize(0), std::invalid_argument);
+
+    // Massless model
+    Eigen::SparseMatrix<double> zero(K.rows(), K.cols());
+    EXPECT_FALSE(modal.compute(K, zero, 2, results));
+
+    // A basis too small for the requested modes
+    modal.setMaxBasisSize(6);
+    EXPECT_FALSE(modal.compute(K, M, 4, results));
+}
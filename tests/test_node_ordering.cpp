@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include "NodeOrdering.h"
+#include "Assembler.h"
+#include "BoundaryConditions.h"
+#include "Material.h"
+#include "TestMeshes.h"
+#include <Eigen/SparseCholesky>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+
+// A box mesh whose nodes were emitted in random order, as a poor mesher might
+static Mesh makeShuffledBoxMesh(int n) {
+    Mesh mesh = makeBoxMesh(n);
+    std::vector<int> shuffle(mesh.getNumNodes());
+    std::iota(shuffle.begin(), shuffle.end(), 0);
+    std::shuffle(shuffle.begin(), shuffle.end(), std::mt19937(42));
+    mesh.permuteNodes(shuffle);
+    return mesh;
+}
+
+static NodeAdjacency adjacencyOf(const Mesh& mesh) {
+    return buildNodeAdjacency(mesh, buildNodeElementIncidence(mesh));
+}
+
+TEST(NodeOrderingTest, PermuteNodesKeepsIdsAndGeometry) {
+    Mesh original = makeBoxMesh(2);
+    Mesh mesh = original;
+    std::vector<int> reverse(mesh.getNumNodes());
+    for (size_t i = 0; i < reverse.size(); ++i) {
+        reverse[i] = static_cast<int>(reverse.size() - 1 - i);
+    }
+    mesh.permuteNodes(reverse);
+
+    for (size_t i = 0; i < original.getNumNodes(); ++i) {
+        int id = original.getNodeIds()[i];
+        int index = mesh.getNodeIndex(id);
+        ASSERT_EQ(index, reverse[i]);
+        EXPECT_EQ(mesh.getX()[index], original.getX()[i]);
+        EXPECT_EQ(mesh.getY()[index], original.getY()[i]);
+        EXPECT_EQ(mesh.getZ()[index], original.getZ()[i]);
+    }
+    for (size_t k = 0; k < original.getConnectivity().size(); ++k) {
+        EXPECT_EQ(mesh.getConnectivity()[k], reverse[original.getConnectivity()[k]]);
+    }
+    // Element views report node IDs, which must be unchanged
+    EXPECT_EQ(mesh.getElements()[5].connectivity, original.getElements()[5].connectivity);
+
+    EXPECT_THROW(mesh.permuteNodes({0, 1, 2}), std::invalid_argument);
+    std::vector<int> repeated(mesh.getNumNodes(), 0);
+    EXPECT_THROW(mesh.permuteNodes(repeated), std::invalid_argument);
+}
+
+TEST(NodeOrderingTest, OrderingsArePermutationsWithUnusedNodesLast) {
+    Mesh mesh = makeShuffledBoxMesh(3);
+    mesh.addNode(1000, 9.0, 9.0, 9.0); // Used by no element
+    NodeAdjacency adjacency = adjacencyOf(mesh);
+    for (NodeOrdering ordering : {NodeOrdering::Natural, NodeOrdering::RCM, NodeOrdering::AMD}) {
+        std::vector<int> permutation = computeNodeOrdering(adjacency, ordering);
+        ASSERT_EQ(permutation.size(), mesh.getNumNodes());
+        std::vector<int> sorted = permutation;
+        std::sort(sorted.begin(), sorted.end());
+        for (size_t i = 0; i < sorted.size(); ++i) {
+            ASSERT_EQ(sorted[i], static_cast<int>(i)) << nodeOrderingName(ordering);
+        }
+        EXPECT_EQ(permutation[mesh.getNodeIndex(1000)], static_cast<int>(mesh.getNumNodes()) - 1);
+    }
+}
+
+TEST(NodeOrderingTest, FactorCountMatchesCholesky) {
+    // An SPD matrix with a dense 3x3 block for every pair of adjacent nodes,
+    // the structure the count assumes (assembled K can drop exact zeros)
+    Mesh mesh = makeShuffledBoxMesh(3);
+    NodeAdjacency adjacency = adjacencyOf(mesh);
+    std::vector<Eigen::Triplet<double>> entries;
+    for (size_t n = 0; n < mesh.getNumNodes(); ++n) {
+        for (size_t a = adjacency.offsets[n]; a < adjacency.offsets[n + 1]; ++a) {
+            int m = adjacency.neighbours[a];
+            for (int i = 0; i < 3; ++i) {
+                for (int j = 0; j < 3; ++j) {
+                    bool diagonal = static_cast<int>(n) == m && i == j;
+                    entries.emplace_back(3 * n + i, 3 * m + j, diagonal ? 1000.0 : 1.0);
+                }
+            }
+        }
+    }
+    Eigen::SparseMatrix<double> A(3 * mesh.getNumNodes(), 3 * mesh.getNumNodes());
+    A.setFromTriplets(entries.begin(), entries.end());
+
+    Eigen::SimplicialLLT<Eigen::SparseMatrix<double>, Eigen::Lower, Eigen::NaturalOrdering<int>> llt(A);
+    ASSERT_EQ(llt.info(), Eigen::Success);
+    OrderingQuality quality = measureNodeOrdering(adjacency);
+    EXPECT_EQ(quality.factor_nonzeros, static_cast<size_t>(Eigen::SparseMatrix<double>(llt.matrixL()).nonZeros()));
+
+    Eigen::Index bandwidth = 0;
+    for (Eigen::Index c = 0; c < A.outerSize(); ++c) {
+        for (Eigen::SparseMatrix<double>::InnerIterator it(A, c); it; ++it) {
+            bandwidth = std::max(bandwidth, std::abs(it.row() - it.col()));
+        }
+    }
+    EXPECT_EQ(quality.bandwidth, static_cast<size_t>(bandwidth));
+}
+
+TEST(NodeOrderingTest, RenumberingReducesBandwidthAndFill) {
+    Mesh mesh = makeShuffledBoxMesh(6);
+    NodeAdjacency adjacency = adjacencyOf(mesh);
+    OrderingQuality shuffled = measureNodeOrdering(adjacency);
+    OrderingQuality rcm = measureNodeOrdering(adjacency, computeNodeOrdering(adjacency, NodeOrdering::RCM));
+    OrderingQuality amd = measureNodeOrdering(adjacency, computeNodeOrdering(adjacency, NodeOrdering::AMD));
+
+    EXPECT_LT(rcm.bandwidth * 4, shuffled.bandwidth);
+    EXPECT_LT(rcm.factor_nonzeros * 2, shuffled.factor_nonzeros);
+    EXPECT_LT(amd.factor_nonzeros * 2, shuffled.factor_nonzeros);
+    EXPECT_LT(amd.factor_nonzeros, rcm.factor_nonzeros);
+}
+
+TEST(NodeOrderingTest, SolutionMapsBackToOriginalOrder) {
+    Mesh mesh = makeShuffledBoxMesh(3);
+    Material material(210e9, 0.3);
+    auto solve = [&](const Mesh& m) {
+        BoundaryConditions bcs(m);
+        bcs.fixNodes({1, 2, 5, 6, 17, 18, 21, 22}); // Nodes on the z = 0 face
+        Eigen::SparseMatrix<double> K = Assembler().assembleGlobalStiffness(m, material);
+        Eigen::VectorXd F = Eigen::VectorXd::Zero(m.getNumNodes() * 3);
+        F(3 * m.getNodeIndex(64) + 2) = -1e6;
+        Eigen::SparseMatrix<double> K_ff;
+        Eigen::VectorXd F_f;
+        bcs.reduce(K, F, K_ff, F_f);
+        Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> ldlt(K_ff);
+        return bcs.expand(ldlt.solve(F_f));
+    };
+    Eigen::VectorXd reference = solve(mesh);
+
+    Mesh renumbered = mesh;
+    std::vector<int> permutation = computeNodeOrdering(adjacencyOf(mesh), NodeOrdering::RCM);
+    renumbered.permuteNodes(permutation);
+    Eigen::VectorXd U = permuteNodeDofs(solve(renumbered), invertPermutation(permutation));
+
+    EXPECT_LE((U - reference).norm(), 1e-10 * reference.norm());
+}
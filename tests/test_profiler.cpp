@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+#include "Profiler.h"
+#include "Assembler.h"
+#include "BoundaryConditions.h"
+#include "LinearSolver.h"
+#include "Material.h"
+#include "TestMeshes.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <thread>
+
+// The profiler is a process-wide singleton; each test starts from a clean,
+// enabled state and leaves it disabled for the next one
+class ProfilerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        Profiler::instance().reset();
+        Profiler::instance().setEnabled(true);
+    }
+    void TearDown() override {
+        Profiler::instance().setEnabled(false);
+        Profiler::instance().reset();
+    }
+
+    static const Profiler::Phase* findPhase(const std::vector<Profiler::Phase>& phases, const std::string& path) {
+        auto it = std::find_if(phases.begin(), phases.end(), [&](const Profiler::Phase& p) { return p.path == path; });
+        return it == phases.end() ? nullptr : &*it;
+    }
+};
+
+TEST_F(ProfilerTest, ScopesNestAndAccumulate) {
+    for (int i = 0; i < 3; ++i) {
+        Profiler::Scope outer("outer");
+        Profiler::Scope inner("inner");
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::vector<Profiler::Phase> phases = Profiler::instance().getPhases();
+    ASSERT_EQ(phases.size(), 2u);
+    // Inner scopes close first, so they are recorded first
+    EXPECT_EQ(phases[0].path, "outer/inner");
+    EXPECT_EQ(phases[1].path, "outer");
+    EXPECT_EQ(phases[0].calls, 3u);
+    EXPECT_EQ(phases[1].calls, 3u);
+    EXPECT_GE(phases[0].seconds, 0.003);
+    EXPECT_GE(phases[1].seconds, phases[0].seconds);
+}
+
+TEST_F(ProfilerTest, DisabledProfilerRecordsNothing) {
+    Profiler::instance().setEnabled(false);
+    {
+        Profiler::Scope scope("ignored");
+    }
+    EXPECT_TRUE(Profiler::instance().getPhases().empty());
+}
+
+TEST_F(ProfilerTest, CountersSetAndAdd) {
+    Profiler::instance().setCounter("a", 5);
+    Profiler::instance().setCounter("a", 7);
+    Profiler::instance().addCounter("b", 2);
+    Profiler::instance().addCounter("b", 3);
+    std::map<std::string, double> counters = Profiler::instance().getCounters();
+    EXPECT_EQ(counters["a"], 7.0);
+    EXPECT_EQ(counters["b"], 5.0);
+}
+
+TEST_F(ProfilerTest, SamplesResidentMemory) {
+#if defined(__linux__)
+    EXPECT_GT(Profiler::currentRssBytes(), 0u);
+    EXPECT_GE(Profiler::peakRssBytes(), Profiler::currentRssBytes());
+#endif
+}
+
+TEST_F(ProfilerTest, OnlyTopLevelScopesSampleMemory) {
+    {
+        Profiler::Scope outer("outer");
+        Profiler::Scope inner("inner");
+    }
+    std::vector<Profiler::Phase> phases = Profiler::instance().getPhases();
+    const Profiler::Phase* outer = findPhase(phases, "outer");
+    const Profiler::Phase* inner = findPhase(phases, "outer/inner");
+    ASSERT_NE(outer, nullptr);
+    ASSERT_NE(inner, nullptr);
+    EXPECT_EQ(inner->rss_start_bytes, 0u);
+    EXPECT_EQ(inner->rss_end_bytes, 0u);
+    EXPECT_EQ(inner->peak_rss_bytes, 0u);
+#if defined(__linux__)
+    EXPECT_GT(outer->rss_start_bytes, 0u);
+    EXPECT_GE(outer->peak_rss_bytes, outer->rss_end_bytes);
+#endif
+}
+
+TEST_F(ProfilerTest, PipelineStagesReportPhasesAndCounters) {
+#if !defined(FEM_ENABLE_PROFILING) || !FEM_ENABLE_PROFILING
+    GTEST_SKIP() << "instrumentation compiled out";
+#endif
+    Mesh mesh = makeBoxMesh(3);
+    Eigen::SparseMatrix<double> K = Assembler().assembleGlobalStiffness(mesh, Material(210e9, 0.3));
+    BoundaryConditions bcs(mesh);
+    bcs.fixNodes({1, 2, 3, 4});
+    Eigen::VectorXd F = Eigen::VectorXd::Ones(K.rows());
+    Eigen::SparseMatrix<double> K_ff;
+    Eigen::VectorXd F_f, U_f;
+    bcs.reduce(K, F, K_ff, F_f);
+    LinearSolver solver(SolverType::LDLT);
+    ASSERT_TRUE(solver.compute(K_ff));
+    ASSERT_TRUE(solver.solve(F_f, U_f));
+
+    std::vector<Profiler::Phase> phases = Profiler::instance().getPhases();
+    for (const char* path : {"assembly", "boundary_conditions.reduce", "solver.analyze", "solver.factorize",
+                             "solver.solve"}) {
+        const Profiler::Phase* phase = findPhase(phases, path);
+        ASSERT_NE(phase, nullptr) << path;
+        EXPECT_EQ(phase->calls, 1u) << path;
+    }
+    std::map<std::string, double> counters = Profiler::instance().getCounters();
+    EXPECT_EQ(counters["assembly.nonzeros"], static_cast<double>(K.nonZeros()));
+    EXPECT_EQ(counters["dofs.free"], static_cast<double>(K_ff.rows()));
+    EXPECT_GE(counters["solver.factor_nonzeros"], static_cast<double>(K_ff.nonZeros()) / 2);
+}
+
+TEST_F(ProfilerTest, JsonReportHasPhasesAndCounters) {
+    {
+        Profiler::Scope scope("quoted \"phase\"");
+    }
+    Profiler::instance().setCounter("mesh.nodes", 64);
+    std::ostringstream json;
+    Profiler::instance().writeJson(json);
+    std::string text = json.str();
+    EXPECT_NE(text.find("\"format\": \"fem-profile\""), std::string::npos);
+    EXPECT_NE(text.find("\"path\": \"quoted \\\"phase\\\"\""), std::string::npos);
+    EXPECT_NE(text.find("\"calls\": 1"), std::string::npos);
+    EXPECT_NE(text.find("\"mesh.nodes\": 64"), std::string::npos);
+    EXPECT_NE(text.find("\"peak_rss_bytes\""), std::string::npos);
+    EXPECT_EQ(std::count(text.begin(), text.end(), '{'), std::count(text.begin(), text.end(), '}'));
+}
+
+TEST_F(ProfilerTest, JsonCountersKeepEveryDigitAndStayValid) {
+    Profiler::instance().setCounter("bytes", 12345678901.0);
+    Profiler::instance().setCounter("ratio", 0.1);
+    Profiler::instance().setCounter("nan", std::nan(""));
+    Profiler::instance().setCounter("inf", -std::numeric_limits<double>::infinity());
+    std::ostringstream json;
+    Profiler::instance().writeJson(json);
+    std::string text = json.str();
+    EXPECT_NE(text.find("\"bytes\": 12345678901,"), std::string::npos) << text;
+    EXPECT_NE(text.find("\"ratio\": 0.10000000000000001"), std::string::npos) << text;
+    EXPECT_NE(text.find("\"nan\": null"), std::string::npos) << text;
+    EXPECT_NE(text.find("\"inf\": null"), std::string::npos) << text;
+    EXPECT_EQ(text.find("e+"), std::string::npos) << text;
+}
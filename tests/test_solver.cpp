@@ -0,0 +1,380 @@
+#include <gtest/gtest.h>
+#include "LinearSolver.h"
+#include "AmgPreconditioner.h"
+#include "SchwarzPreconditioner.h"
+#include "SymmetricSparseOperator.h"
+#include "Assembler.h"
+#include "Mesh.h"
+#include "Material.h"
+#include "TestMeshes.h"
+#include <Eigen/SparseLU>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+#include <vector>
+
+// Assembled K of a box clamped on z = 0 (fixed rows/columns replaced by the
+// identity) and a load pulling the top face down.
+static void buildClampedBox(const Mesh& mesh, Eigen::SparseMatrix<double>& K, Eigen::VectorXd& F) {
+    K = Assembler().assembleGlobalStiffness(mesh, Material(210e9, 0.3));
+    std::vector<char> fixed(K.rows(), 0);
+    double top = 0.0;
+    for (const auto& n : mesh.getNodes()) {
+        top = std::max(top, n.z);
+    }
+    F = Eigen::VectorXd::Zero(K.rows());
+    for (size_t i = 0; i < mesh.getNodes().size(); ++i) {
+        const Node& n = mesh.getNodes()[i];
+        if (n.z == 0.0) {
+            fixed[i * 3 + 0] = fixed[i * 3 + 1] = fixed[i * 3 + 2] = 1;
+        } else if (n.z == top) {
+            F(i * 3 + 2) = -1e6;
+        }
+    }
+    K.prune([&](Eigen::Index row, Eigen::Index col, double) { return !fixed[row] && !fixed[col]; });
+    for (Eigen::Index dof = 0; dof < K.rows(); ++dof) {
+        if (fixed[dof]) {
+            K.coeffRef(dof, dof) = 1.0;
+        }
+    }
+    K.makeCompressed();
+}
+
+TEST(SolverTest, ParseSolverNames) {
+    SolverType type;
+    ASSERT_TRUE(parseSolverType("cg-amg", type));
+    ASSERT_EQ(type, SolverType::CGAMG);
+    ASSERT_STREQ(solverTypeName(SolverType::LDLT), "ldlt");
+    ASSERT_FALSE(parseSolverType("cholmod", type));
+
+    SolverPrecision precision;
+    ASSERT_TRUE(parseSolverPrecision("mixed", precision));
+    ASSERT_EQ(precision, SolverPrecision::Mixed);
+    ASSERT_STREQ(solverPrecisionName(SolverPrecision::Double), "double");
+    ASSERT_FALSE(parseSolverPrecision("half", precision));
+}
+
+TEST(SolverTest, AllBackendsAgreeWithSparseLU) {
+    Mesh mesh = makeBoxMesh(4);
+    Eigen::SparseMatrix<double> K;
+    Eigen::VectorXd F;
+    buildClampedBox(mesh, K, F);
+
+    Eigen::SparseLU<Eigen::SparseMatrix<double>> lu(K);
+    Eigen::VectorXd U_ref = lu.solve(F);
+
+    const SolverType types[] = {SolverType::SparseLU, SolverType::LDLT, SolverType::LLT,
+                                SolverType::CGJacobi, SolverType::CGIncompleteCholesky, SolverType::CGAMG,
+                                SolverType::CGSchwarz};
+    for (SolverType type : types) {
+        LinearSolver solver(type);
+        solver.setMesh(mesh);
+        solver.setTolerance(1e-12);
+        ASSERT_TRUE(solver.compute(K)) << solverTypeName(type);
+
+        Eigen::VectorXd U;
+        ASSERT_TRUE(solver.solve(F, U)) << solverTypeName(type);
+        EXPECT_LE((U - U_ref).norm(), 1e-8 * U_ref.norm()) << solverTypeName(type);
+        EXPECT_LE(solver.getStats().residual, 1e-10) << solverTypeName(type);
+    }
+}
+
+TEST(SolverTest, AmgCutsJacobiIterations) {
+    Mesh mesh = makeBoxMesh(8);
+    Eigen::SparseMatrix<double> K;
+    Eigen::VectorXd F;
+    buildClampedBox(mesh, K, F);
+
+    LinearSolver jacobi(SolverType::CGJacobi);
+    LinearSolver amg(SolverType::CGAMG);
+    amg.setMesh(mesh);
+    Eigen::VectorXd U_jacobi, U_amg;
+    ASSERT_TRUE(jacobi.compute(K));
+    ASSERT_TRUE(jacobi.solve(F, U_jacobi));
+    ASSERT_TRUE(amg.compute(K));
+    ASSERT_TRUE(amg.solve(F, U_amg));
+
+    ASSERT_LT(amg.getStats().iterations, jacobi.getStats().iterations / 2);
+}
+
+TEST(SolverTest, AmgBuildsSeveralLevels) {
+    Mesh mesh = makeBoxMesh(8);
+    Eigen::SparseMatrix<double> K;
+    Eigen::VectorXd F;
+    buildClampedBox(mesh, K, F);
+
+    AmgPreconditioner amg;
+    amg.setNearNullspace(AmgPreconditioner::rigidBodyModes(mesh));
+    amg.setMaxCoarseSize(100);
+    amg.compute(K);
+    ASSERT_EQ(amg.info(), Eigen::Success);
+    ASSERT_GE(amg.numLevels(), 3u);
+
+    // Every level is smaller than the one above it; the first aggregation
+    // alone shrinks the fine operator several times over
+    EXPECT_EQ(amg.levelSize(0), K.rows());
+    for (size_t level = 1; level < amg.numLevels(); ++level) {
+        EXPECT_LT(amg.levelSize(level), amg.levelSize(level - 1)) << "level " << level;
+    }
+    EXPECT_LE(4 * amg.levelSize(1), amg.levelSize(0));
+
+    // Nothing to coarsen once the whole matrix fits the direct solve
+    AmgPreconditioner direct;
+    direct.setMaxCoarseSize(K.rows());
+    direct.compute(K);
+    ASSERT_EQ(direct.info(), Eigen::Success);
+    EXPECT_EQ(direct.numLevels(), 1u);
+    EXPECT_EQ(direct.levelSize(0), K.rows());
+
+    // Rigid-body modes are reproduced exactly by the tentative prolongator,
+    // so a pure rotation field should be (near) invariant under K
+    Eigen::MatrixXd modes = AmgPreconditioner::rigidBodyModes(mesh);
+    Eigen::SparseMatrix<double> K_free = Assembler().assembleGlobalStiffness(mesh, Material(210e9, 0.3));
+    ASSERT_LE((K_free * modes.col(5)).norm(), 1e-6 * K_free.norm());
+}
+
+TEST(SolverTest, SchwarzCoarseSpaceBoundsIterations) {
+    Mesh mesh = makeBoxMesh(8);
+    Eigen::SparseMatrix<double> K;
+    Eigen::VectorXd F;
+    buildClampedBox(mesh, K, F);
+
+    // One-level Schwarz degrades as the subdomains shrink; the coarse space
+    // of rigid-body modes per subdomain holds the count down
+    int one_level[2], two_level[2];
+    const int parts[2] = {2, 16};
+    for (int k = 0; k < 2; ++k) {
+        for (bool coarse : {false, true}) {
+            LinearSolver solver(SolverType::CGSchwarz);
+            solver.setNumSubdomains(parts[k]);
+            solver.setNumThreads(1);
+            if (coarse) {
+                solver.setMesh(mesh);
+            }
+            ASSERT_TRUE(solver.compute(K));
+            Eigen::VectorXd U;
+            ASSERT_TRUE(solver.solve(F, U));
+            (coarse ? two_level : one_level)[k] = solver.getStats().iterations;
+        }
+    }
+    std::cout << "Schwarz iterations, 2 / 16 subdomains: one-level " << one_level[0] << " / " << one_level[1]
+              << ", two-level " << two_level[0] << " / " << two_level[1] << std::endl;
+    EXPECT_LT(two_level[1], one_level[1]);
+    EXPECT_LE(two_level[1], 2 * two_level[0]);
+}
+
+TEST(SolverTest, SchwarzThreadsGiveTheSerialResult) {
+    Mesh mesh = makeBoxMesh(5);
+    Eigen::SparseMatrix<double> K;
+    Eigen::VectorXd F;
+    buildClampedBox(mesh, K, F);
+
+    Eigen::VectorXd U[2];
+    const unsigned threads[2] = {1, 4};
+    for (int k = 0; k < 2; ++k) {
+        SchwarzPreconditioner schwarz;
+        schwarz.setNumSubdomains(6);
+        schwarz.setOverlap(2);
+        schwarz.setNumThreads(threads[k]);
+        schwarz.compute(K);
+        ASSERT_EQ(schwarz.info(), Eigen::Success);
+        ASSERT_EQ(schwarz.numSubdomains(), 6);
+        EXPECT_GT(schwarz.maxSubdomainSize(), K.rows() / 6); // Grown by the overlap
+        U[k] = schwarz.solve(F);
+    }
+    EXPECT_EQ(U[0], U[1]); // Same local solves, same summation order
+
+    // A single subdomain covers the matrix, so the preconditioner is the exact inverse
+    SchwarzPreconditioner exact;
+    exact.setNumSubdomains(1);
+    exact.compute(K);
+    EXPECT_LE((K * exact.solve(F) - F).norm(), 1e-10 * F.norm());
+}
+
+TEST(SolverTest, ThreadedSymmetricProductMatchesEigen) {
+    Mesh mesh = makeBoxMesh(4);
+    Eigen::SparseMatrix<double> K;
+    Eigen::VectorXd F;
+    buildClampedBox(mesh, K, F);
+    Eigen::VectorXd x = Eigen::VectorXd::Random(K.rows());
+    Eigen::VectorXd expected = K * x;
+
+    for (unsigned threads : {1u, 3u}) {
+        SymmetricSparseOperator op(K, threads);
+        Eigen::VectorXd y = op * x;
+        EXPECT_LE((y - expected).norm(), 1e-14 * expected.norm()) << threads << " threads";
+    }
+    // Each entry is one column's dot product, whatever the thread count
+    EXPECT_EQ(Eigen::VectorXd(SymmetricSparseOperator(K, 1) * x), Eigen::VectorXd(SymmetricSparseOperator(K, 4) * x));
+
+    // cg-schwarz runs its product on the operator: same iterates for any thread count
+    Eigen::VectorXd U[2];
+    int iterations[2];
+    const unsigned threads[2] = {1, 4};
+    for (int k = 0; k < 2; ++k) {
+        LinearSolver solver(SolverType::CGSchwarz);
+        solver.setNumSubdomains(4);
+        solver.setNumThreads(threads[k]);
+        solver.setTolerance(1e-10);
+        ASSERT_TRUE(solver.compute(K));
+        ASSERT_TRUE(solver.solve(F, U[k]));
+        iterations[k] = solver.getStats().iterations;
+    }
+    EXPECT_EQ(iterations[0], iterations[1]);
+    EXPECT_EQ(U[0], U[1]);
+}
+
+TEST(SolverTest, BlockSolveMatchesColumnSolves) {
+    Mesh mesh = makeBoxMesh(4);
+    Eigen::SparseMatrix<double> K;
+    Eigen::VectorXd F0;
+    buildClampedBox(mesh, K, F0);
+    Eigen::MatrixXd F(K.rows(), 5);
+    F.col(0) = F0;
+    F.rightCols(4) = Eigen::MatrixXd::Random(K.rows(), 4) * 1e6;
+
+    const SolverType types[] = {SolverType::SparseLU, SolverType::LDLT, SolverType::LLT,
+                                SolverType::CGJacobi, SolverType::CGIncompleteCholesky, SolverType::CGAMG,
+                                SolverType::CGSchwarz};
+    for (SolverType type : types) {
+        LinearSolver solver(type);
+        solver.setMesh(mesh);
+        solver.setTolerance(1e-12);
+        ASSERT_TRUE(solver.compute(K)) << solverTypeName(type);
+        Eigen::MatrixXd U;
+        ASSERT_TRUE(solver.solve(F, U)) << solverTypeName(type);
+        ASSERT_EQ(solver.getStats().right_hand_sides, 5);
+        for (Eigen::Index c = 0; c < F.cols(); ++c) {
+            Eigen::VectorXd u;
+            ASSERT_TRUE(solver.solve(Eigen::VectorXd(F.col(c)), u));
+            ASSERT_LE((U.col(c) - u).norm(), 1e-8 * u.norm()) << solverTypeName(type) << " column " << c;
+        }
+    }
+}
+
+TEST(SolverTest, RefactorizeKeepsTheAnalysis) {
+    Mesh mesh = makeBoxMesh(3);
+    Eigen::SparseMatrix<double> K;
+    Eigen::VectorXd F;
+    buildClampedBox(mesh, K, F);
+
+    for (SolverType type : {SolverType::LDLT, SolverType::CGAMG}) {
+        LinearSolver solver(type);
+        solver.setMesh(mesh);
+        solver.setTolerance(1e-12);
+        ASSERT_FALSE(solver.refactorize(K));
+        ASSERT_TRUE(solver.compute(K));
+        Eigen::VectorXd U;
+        ASSERT_TRUE(solver.solve(F, U));
+
+        // A stiffer material on the same pattern halves the displacements
+        Eigen::SparseMatrix<double> K2 = 2.0 * K;
+        ASSERT_TRUE(solver.refactorize(K2)) << solverTypeName(type);
+        Eigen::VectorXd U2;
+        ASSERT_TRUE(solver.solve(F, U2));
+        ASSERT_LE((2.0 * U2 - U).norm(), 1e-8 * U.norm()) << solverTypeName(type);
+
+        Eigen::SparseMatrix<double> smaller = K.topLeftCorner(K.rows() - 3, K.cols() - 3);
+        ASSERT_FALSE(solver.refactorize(smaller));
+
+        // Same size and nonzero count, entries elsewhere
+        Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> P(K.rows());
+        P.setIdentity();
+        std::reverse(P.indices().data(), P.indices().data() + P.size() / 2);
+        Eigen::SparseMatrix<double> permuted;
+        permuted = K.twistedBy(P);
+        ASSERT_EQ(permuted.nonZeros(), K.nonZeros());
+        EXPECT_FALSE(solver.refactorize(permuted)) << solverTypeName(type);
+        EXPECT_FALSE(solver.updateValues(permuted)) << solverTypeName(type);
+    }
+}
+
+TEST(SolverTest, MixedPrecisionMatchesSparseLU) {
+    Mesh mesh = makeBoxMesh(4);
+    Eigen::SparseMatrix<double> K;
+    Eigen::VectorXd F0;
+    buildClampedBox(mesh, K, F0);
+    Eigen::MatrixXd F(K.rows(), 3);
+    F.col(0) = F0;
+    F.rightCols(2) = Eigen::MatrixXd::Random(K.rows(), 2) * 1e6;
+
+    Eigen::SparseLU<Eigen::SparseMatrix<double>> lu(K);
+    Eigen::MatrixXd U_ref = lu.solve(F);
+
+    const SolverType types[] = {SolverType::SparseLU, SolverType::LDLT, SolverType::LLT, SolverType::CGJacobi,
+                                SolverType::CGIncompleteCholesky};
+    for (SolverType type : types) {
+        LinearSolver solver(type);
+        solver.setPrecision(SolverPrecision::Mixed);
+        solver.setTolerance(1e-12);
+        ASSERT_TRUE(solver.compute(K)) << solverTypeName(type);
+        Eigen::MatrixXd U;
+        ASSERT_TRUE(solver.solve(F, U)) << solverTypeName(type);
+        const SolverStats& stats = solver.getStats();
+        EXPECT_LE(stats.residual, 1e-12) << solverTypeName(type);
+        EXPECT_GE(stats.refinements, 2) << solverTypeName(type); // A float solve alone cannot reach 1e-12
+        for (Eigen::Index c = 0; c < F.cols(); ++c) {
+            EXPECT_LE((U.col(c) - U_ref.col(c)).norm(), 1e-9 * U_ref.col(c).norm())
+                << solverTypeName(type) << " column " << c;
+        }
+
+        Eigen::VectorXd u;
+        ASSERT_TRUE(solver.solve(F0, u)) << solverTypeName(type);
+        EXPECT_LE((u - U_ref.col(0)).norm(), 1e-9 * U_ref.col(0).norm()) << solverTypeName(type);
+    }
+}
+
+TEST(SolverTest, MixedPrecisionRefactorizes) {
+    Mesh mesh = makeBoxMesh(3);
+    Eigen::SparseMatrix<double> K;
+    Eigen::VectorXd F;
+    buildClampedBox(mesh, K, F);
+
+    LinearSolver solver(SolverType::LDLT);
+    solver.setPrecision(SolverPrecision::Mixed);
+    ASSERT_TRUE(solver.compute(K));
+    Eigen::VectorXd U;
+    ASSERT_TRUE(solver.solve(F, U));
+
+    Eigen::SparseMatrix<double> K2 = 2.0 * K;
+    ASSERT_TRUE(solver.refactorize(K2));
+    Eigen::VectorXd U2;
+    ASSERT_TRUE(solver.solve(F, U2));
+    EXPECT_LE((2.0 * U2 - U).norm(), 1e-8 * U.norm());
+
+    // No refinement budget leaves the single-precision accuracy, which misses the tolerance
+    solver.setMaxRefinements(1);
+    ASSERT_FALSE(solver.solve(F, U2));
+
+    LinearSolver amg(SolverType::CGAMG);
+    amg.setMesh(mesh);
+    amg.setPrecision(SolverPrecision::Mixed);
+    ASSERT_FALSE(amg.compute(K));
+}
+
+TEST(SolverTest, BlockSolveThroughput) {
+    Mesh mesh = makeBoxMesh(12);
+    Eigen::SparseMatrix<double> K;
+    Eigen::VectorXd F0;
+    buildClampedBox(mesh, K, F0);
+    const int cases = 32;
+    Eigen::MatrixXd F = Eigen::MatrixXd::Random(K.rows(), cases);
+
+    LinearSolver solver(SolverType::LDLT);
+    ASSERT_TRUE(solver.compute(K));
+    auto t0 = std::chrono::steady_clock::now();
+    Eigen::VectorXd u;
+    for (int c = 0; c < cases; ++c) {
+        ASSERT_TRUE(solver.solve(Eigen::VectorXd(F.col(c)), u));
+    }
+    double one_by_one = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    auto t1 = std::chrono::steady_clock::now();
+    Eigen::MatrixXd U;
+    ASSERT_TRUE(solver.solve(F, U));
+    double block = std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count();
+
+    // Both timings include the residual check, which is the same work either way
+    std::cout << "[          ] " << cases << " LDLT solves one at a time: " << one_by_one << " s, as a block: " << block
+              << " s (" << one_by_one / block << "x)" << std::endl;
+    EXPECT_LT(block, one_by_one);
+}
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include "SolverSession.h"
+#include "LoadCases.h"
+#include "AmgPreconditioner.h"
+#include "Assembler.h"
+#include "Material.h"
+#include "TestMeshes.h"
+#include <Eigen/SparseCholesky>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+// Clamps the z = 0 face of an n-box and lifts one corner of it by a prescribed z displacement
+static void constrainBox(int n, BoundaryConditions& bcs) {
+    for (int k = 0; k < (n + 1) * (n + 1); ++k) {
+        bcs.fixNode(1 + k);
+    }
+    bcs.prescribe(1, 2, 1e-4);
+}
+
+TEST(SolverSessionTest, BlockOfLoadCasesMatchesSeparateReducedSolves) {
+    const int n = 3;
+    Mesh mesh = makeBoxMesh(n);
+    Eigen::SparseMatrix<double> K = Assembler().assembleGlobalStiffness(mesh, Material(210e9, 0.3));
+    BoundaryConditions bcs(mesh);
+    constrainBox(n, bcs);
+
+    std::vector<LoadCase> cases = {
+        {"down", {{64, 0.0, 0.0, -1e6}}},
+        {"twist", {{61, 1e5, 0.0, 0.0}, {64, -1e5, 0.0, 0.0}}},
+        {"none", {}},
+    };
+    Eigen::MatrixXd F = buildLoadMatrix(mesh, cases);
+
+    for (SolverType type : {SolverType::LDLT, SolverType::SparseLU, SolverType::CGAMG}) {
+        SolverSession session(bcs, type);
+        session.solver().setTolerance(1e-12);
+        session.solver().setNearNullspace(bcs.restrictRows(AmgPreconditioner::rigidBodyModes(mesh)));
+        ASSERT_TRUE(session.setup(K)) << solverTypeName(type);
+        Eigen::MatrixXd U;
+        ASSERT_TRUE(session.solve(F, U));
+        ASSERT_EQ(U.rows(), F.rows());
+        ASSERT_EQ(U.cols(), 3);
+
+        for (Eigen::Index c = 0; c < F.cols(); ++c) {
+            Eigen::SparseMatrix<double> K_ff;
+            Eigen::VectorXd F_f;
+            bcs.reduce(K, F.col(c), K_ff, F_f);
+            Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> ldlt(K_ff);
+            Eigen::VectorXd expected = bcs.expand(ldlt.solve(F_f));
+            ASSERT_LE((U.col(c) - expected).norm(), 1e-8 * expected.norm()) << solverTypeName(type) << " case " << c;
+        }
+        // The prescribed value holds in every case, including the unloaded one
+        ASSERT_EQ(U(2, 2), 1e-4);
+    }
+}
+
+TEST(SolverSessionTest, UpdateRefactorizesWithoutNewAnalysis) {
+    const int n = 2;
+    Mesh mesh = makeBoxMesh(n);
+    Assembler assembler;
+    Eigen::SparseMatrix<double> K = assembler.assembleGlobalStiffness(mesh, Material(210e9, 0.3));
+    BoundaryConditions bcs(mesh);
+    constrainBox(n, bcs);
+    Eigen::MatrixXd F = buildLoadMatrix(mesh, {{"pull", {{27, 0.0, 0.0, 1e6}}}});
+
+    SolverSession session(bcs, SolverType::LDLT);
+    Eigen::MatrixXd U;
+    ASSERT_FALSE(session.solve(F, U));
+    ASSERT_TRUE(session.setup(K));
+    ASSERT_TRUE(session.isReady());
+
+    Eigen::SparseMatrix<double> K_soft = assembler.assembleGlobalStiffness(mesh, Material(70e9, 0.3));
+    ASSERT_TRUE(session.update(K_soft));
+    ASSERT_TRUE(session.solve(F, U));
+
+    SolverSession fresh(bcs, SolverType::LDLT);
+    ASSERT_TRUE(fresh.setup(K_soft));
+    Eigen::MatrixXd expected;
+    ASSERT_TRUE(fresh.solve(F, expected));
+    ASSERT_LE((U - expected).norm(), 1e-12 * expected.norm());
+
+    // The values were gathered in place and the lift of the prescribed
+    // displacement follows the new stiffness
+    Eigen::SparseMatrix<double> K_ff;
+    Eigen::VectorXd F_f;
+    bcs.reduce(K_soft, F.col(0), K_ff, F_f);
+    ASSERT_EQ(session.getReducedMatrix().nonZeros(), K_ff.nonZeros());
+    for (Eigen::Index k = 0; k < K_ff.nonZeros(); ++k) {
+        ASSERT_EQ(session.getReducedMatrix().innerIndexPtr()[k], K_ff.innerIndexPtr()[k]);
+        ASSERT_EQ(session.getReducedMatrix().valuePtr()[k], K_ff.valuePtr()[k]);
+    }
+
+    // A different pattern of the same size is reduced afresh and rejected by the solver
+    Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> P(K.rows());
+    P.setIdentity();
+    std::reverse(P.indices().data(), P.indices().data() + P.size() / 2);
+    Eigen::SparseMatrix<double> permuted;
+    permuted = K.twistedBy(P);
+    EXPECT_FALSE(session.update(permuted));
+}
+
+TEST(LoadCasesTest, ParsesCasesAndRejectsMalformedFiles) {
+    std::ofstream("cases.txt") << "# Two cases\n"
+                                  "LOADCASE gravity\n"
+                                  "1 0 0 -9.81\n"
+                                  "2 0 0 -9.81\n"
+                                  "\n"
+                                  "LOADCASE wind\n"
+                                  "2 100 0 0\n";
+    std::vector<LoadCase> cases;
+    ASSERT_TRUE(loadLoadCases("cases.txt", cases));
+    ASSERT_EQ(cases.size(), 2u);
+    ASSERT_EQ(cases[0].name, "gravity");
+    ASSERT_EQ(cases[0].loads.size(), 2u);
+    ASSERT_EQ(cases[1].loads[0].node_id, 2);
+    ASSERT_EQ(cases[1].loads[0].fx, 100.0);
+
+    const char* bad[] = {
+        "1 0 0 0\n",                               // Load before any case
+        "LOADCASE a\n1 0 0\n",                     // Missing component
+        "LOADCASE a\nLOADCASE a\n",                // Duplicate name
+        "LOADCASE\n",                              // Missing name
+        "# nothing\n",                             // No cases
+    };
+    for (const char* text : bad) {
+        std::ofstream("bad_cases.txt") << text;
+        ASSERT_FALSE(loadLoadCases("bad_cases.txt", cases)) << text;
+    }
+    ASSERT_FALSE(loadLoadCases("no_such_cases.txt", cases));
+}
+
+TEST(LoadCasesTest, LoadMatrixSumsLoadsPerNode) {
+    Mesh mesh = makeBoxMesh(1);
+    std::vector<LoadCase> cases = {{"a", {{2, 1.0, 2.0, 3.0}, {2, 1.0, 0.0, 0.0}}}, {"b", {{8, 0.0, 0.0, -5.0}}}};
+    Eigen::MatrixXd F = buildLoadMatrix(mesh, cases);
+    ASSERT_EQ(F.rows(), 24);
+    ASSERT_EQ(F.cols(), 2);
+    ASSERT_EQ(F(3 * mesh.getNodeIndex(2) + 0, 0), 2.0);
+    ASSERT_EQ(F(3 * mesh.getNodeIndex(2) + 2, 0), 3.0);
+    ASSERT_EQ(F(3 * mesh.getNodeIndex(8) + 2, 1), -5.0);
+    ASSERT_EQ(F.sum(), 2.0 + 2.0 + 3.0 - 5.0);
+
+    cases[1].loads.push_back({99, 1.0, 0.0, 0.0});
+    ASSERT_THROW(buildLoadMatrix(mesh, cases), std::out_of_range);
+}
@@ -0,0 +1,214 @@
+#include <gtest/gtest.h>
+#include "StreamingAssembly.h"
+#include "Assembler.h"
+#include "BinaryMeshFormat.h"
+#include "Mesh.h"
+#include "MeshGenerator.h"
+#include "Material.h"
+#include "MaterialTable.h"
+#include "TestMeshes.h"
+#include <Eigen/IterativeLinearSolvers>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Two materials in layers, so the chunks mix material IDs
+MaterialTable layeredMaterials(Mesh& mesh) {
+    for (size_t e = 0; e < mesh.getNumElements(); ++e) {
+        mesh.setElementMaterial(e, e % 7 < 3 ? 1 : 2);
+    }
+    MaterialTable materials;
+    materials.set(1, Material(210e9, 0.3));
+    materials.set(2, Material(70e9, 0.33));
+    return materials;
+}
+
+// Same structure and values up to the summation order
+void expectSameMatrix(const Eigen::SparseMatrix<double>& A, const Eigen::SparseMatrix<double>& B) {
+    ASSERT_EQ(A.rows(), B.rows());
+    ASSERT_EQ(A.cols(), B.cols());
+    ASSERT_EQ(A.nonZeros(), B.nonZeros());
+    for (Eigen::Index c = 0; c <= A.outerSize(); ++c) {
+        ASSERT_EQ(A.outerIndexPtr()[c], B.outerIndexPtr()[c]) << "column " << c;
+    }
+    double scale = B.coeffs().cwiseAbs().maxCoeff();
+    for (Eigen::Index k = 0; k < A.nonZeros(); ++k) {
+        ASSERT_EQ(A.innerIndexPtr()[k], B.innerIndexPtr()[k]) << "entry " << k;
+        ASSERT_NEAR(A.valuePtr()[k], B.valuePtr()[k], 1e-13 * scale) << "entry " << k;
+    }
+}
+
+std::vector<std::filesystem::path> scratchFiles(const std::filesystem::path& directory) {
+    std::vector<std::filesystem::path> files;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        files.push_back(entry.path());
+    }
+    return files;
+}
+
+} // namespace
+
+// Files and scratch directory are named after the test, so the cases can
+// run concurrently (ctest -j)
+class StreamingAssemblyTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::string name = ::testing::UnitTest::GetInstance()->current_test_info()->name();
+        scratch_ = std::filesystem::temp_directory_path() / ("fem_streaming_" + name);
+        mesh_file_ = "streaming_" + name + ".femb";
+        matrix_file_ = "streaming_" + name + ".femcsc";
+        std::filesystem::remove_all(scratch_);
+        std::filesystem::create_directories(scratch_);
+    }
+    void TearDown() override {
+        std::filesystem::remove_all(scratch_);
+        std::remove(mesh_file_.c_str());
+        std::remove(matrix_file_.c_str());
+    }
+
+    std::filesystem::path scratch_;
+    std::string mesh_file_;
+    std::string matrix_file_;
+};
+
+TEST_F(StreamingAssemblyTest, MatchesInMemoryAssembly) {
+    Mesh mesh = generateBoxMesh(6, 5, 4);
+    MaterialTable materials = layeredMaterials(mesh);
+    ASSERT_TRUE(mesh.saveBinary(mesh_file_));
+    Eigen::SparseMatrix<double> K_ref = Assembler().assembleGlobalStiffness(mesh, materials);
+
+    // The smallest budget spills many runs and needs intermediate merge passes
+    StreamingAssembler streaming(StreamingAssembler::kMinMemoryBudget);
+    streaming.setScratchDirectory(scratch_.string());
+    Eigen::SparseMatrix<double> K;
+    ASSERT_TRUE(streaming.assemble(mesh_file_, materials, K));
+    expectSameMatrix(K, K_ref);
+
+    const StreamingAssemblyStats& stats = streaming.getStats();
+    EXPECT_GT(stats.chunks, 8u);
+    EXPECT_EQ(stats.runs, stats.chunks);
+    EXPECT_GT(stats.merge_passes, 1u);
+    EXPECT_LE(stats.peak_working_bytes, StreamingAssembler::kMinMemoryBudget);
+    EXPECT_TRUE(scratchFiles(scratch_).empty());
+
+    // A budget holding the whole mesh is one chunk and one pass
+    streaming.setMemoryBudget(size_t(64) << 20);
+    streaming.setNumThreads(3);
+    ASSERT_TRUE(streaming.assemble(mesh_file_, materials, K));
+    expectSameMatrix(K, K_ref);
+    EXPECT_EQ(streaming.getStats().chunks, 1u);
+    EXPECT_EQ(streaming.getStats().merge_passes, 1u);
+}
+
+TEST_F(StreamingAssemblyTest, DiskMatrixSolvesLikeInMemory) {
+    Mesh mesh = makeBoxMesh(4);
+    MaterialTable materials(Material(210e9, 0.3));
+    ASSERT_TRUE(mesh.saveBinary(mesh_file_));
+    Eigen::SparseMatrix<double> K_ref = Assembler().assembleGlobalStiffness(mesh, materials);
+
+    StreamingAssembler streaming(size_t(128) << 10);
+    streaming.setScratchDirectory(scratch_.string());
+    ASSERT_TRUE(streaming.assembleToFile(mesh_file_, materials, matrix_file_));
+    EXPECT_TRUE(scratchFiles(scratch_).empty());
+
+    MappedSparseMatrix disk;
+    ASSERT_TRUE(disk.open(matrix_file_));
+    EXPECT_EQ(disk.rows(), K_ref.rows());
+    EXPECT_EQ(disk.nonZeros(), K_ref.nonZeros());
+    Eigen::SparseMatrix<double> K = disk.matrix();
+    expectSameMatrix(K, K_ref);
+
+    // A shifted (hence definite) system solved straight off the mapping
+    Eigen::VectorXd x = Eigen::VectorXd::Random(K_ref.rows());
+    Eigen::VectorXd expected = K_ref * x;
+    EXPECT_LE((disk.matrix() * x - expected).norm(), 1e-13 * expected.norm());
+
+    Eigen::SparseMatrix<double> I(K_ref.rows(), K_ref.cols());
+    I.setIdentity();
+    double shift = K_ref.diagonal().mean();
+    Eigen::SparseMatrix<double> A = disk.matrix() + shift * I;
+    Eigen::ConjugateGradient<Eigen::SparseMatrix<double>, Eigen::Lower | Eigen::Upper> cg;
+    cg.setTolerance(1e-12);
+    cg.compute(A);
+    Eigen::VectorXd y = cg.solve(expected + shift * x);
+    ASSERT_EQ(cg.info(), Eigen::Success);
+    EXPECT_LE((y - x).norm(), 1e-8 * x.norm());
+}
+
+TEST_F(StreamingAssemblyTest, RejectsBadInput) {
+    EXPECT_THROW(StreamingAssembler(StreamingAssembler::kMinMemoryBudget - 1), std::invalid_argument);
+
+    StreamingAssembler streaming;
+    streaming.setScratchDirectory(scratch_.string());
+    MaterialTable materials(Material(210e9, 0.3));
+    Eigen::SparseMatrix<double> K;
+    EXPECT_FALSE(streaming.assemble("does_not_exist.femb", materials, K));
+
+    // A text file is not a binary mesh
+    {
+        std::ofstream out(mesh_file_);
+        out << "NODES 1\n1 0 0 0\n";
+    }
+    EXPECT_FALSE(streaming.assemble(mesh_file_, materials, K));
+
+    // Neither a mesh nor a truncated matrix opens as a disk matrix
+    MappedSparseMatrix disk;
+    EXPECT_FALSE(disk.open(mesh_file_));
+    ASSERT_TRUE(makeBoxMesh(2).saveBinary(mesh_file_));
+    ASSERT_TRUE(streaming.assembleToFile(mesh_file_, materials, matrix_file_));
+    ASSERT_TRUE(disk.open(matrix_file_));
+    disk.close();
+    std::filesystem::resize_file(matrix_file_, std::filesystem::file_size(matrix_file_) - 8);
+    EXPECT_FALSE(disk.open(matrix_file_));
+    EXPECT_FALSE(disk.isOpen());
+
+    // An element type that disagrees with the node count would send the
+    // kernels past the element's connectivity
+    {
+        std::string corrupt_file = "streaming_mistyped.femb";
+        std::ifstream in(mesh_file_, std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        BinaryMeshHeader header;
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        bytes[header.element_types_offset + 5] = static_cast<char>(ElementType::Hex8);
+        std::ofstream(corrupt_file, std::ios::binary | std::ios::trunc) << bytes;
+        EXPECT_FALSE(streaming.assemble(corrupt_file, materials, K));
+        std::remove(corrupt_file.c_str());
+    }
+
+    // An uncovered material ID is the same error as for in-memory assembly
+    MaterialTable partial;
+    partial.set(5, Material(210e9, 0.3));
+    EXPECT_THROW(streaming.assemble(mesh_file_, partial, K), std::out_of_range);
+    EXPECT_TRUE(scratchFiles(scratch_).empty());
+}
+
+TEST_F(StreamingAssemblyTest, MissingMaterialInALaterChunkLeavesNoScratchFiles) {
+    // Only the last elements use material 2, so runs are already spilled
+    // when the lookup throws
+    Mesh mesh = makeBoxMesh(4);
+    for (size_t e = mesh.getNumElements() - 10; e < mesh.getNumElements(); ++e) {
+        mesh.setElementMaterial(e, 2);
+    }
+    ASSERT_TRUE(mesh.saveBinary(mesh_file_));
+    MaterialTable materials;
+    materials.set(0, Material(210e9, 0.3));
+
+    StreamingAssembler streaming(StreamingAssembler::kMinMemoryBudget);
+    streaming.setScratchDirectory(scratch_.string());
+    Eigen::SparseMatrix<double> K;
+    EXPECT_THROW(streaming.assemble(mesh_file_, materials, K), std::out_of_range);
+    EXPECT_GT(streaming.getStats().runs, 1u);
+    EXPECT_TRUE(scratchFiles(scratch_).empty());
+
+    EXPECT_THROW(streaming.assembleToFile(mesh_file_, materials, matrix_file_), std::out_of_range);
+    EXPECT_TRUE(scratchFiles(scratch_).empty());
+    EXPECT_FALSE(std::filesystem::exists(matrix_file_));
+}
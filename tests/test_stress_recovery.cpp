@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+#include "StressRecovery.h"
+#include "ElementGeometry.h"
+#include "Tet4Element.h"
+#include "Material.h"
+#include "TestMeshes.h"
+#include <chrono>
+#include <iostream>
+
+// Displacement field u = A x evaluated at every node
+static Eigen::VectorXd linearField(const Mesh& mesh, const Eigen::Matrix3d& A) {
+    Eigen::VectorXd U(mesh.getNumNodes() * 3);
+    for (size_t i = 0; i < mesh.getNumNodes(); ++i) {
+        U.segment<3>(3 * i) = A * Eigen::Vector3d(mesh.getX()[i], mesh.getY()[i], mesh.getZ()[i]);
+    }
+    return U;
+}
+
+TEST(StressRecoveryTest, LinearFieldGivesUniformStress) {
+    Mesh mesh = makeBoxMesh(3);
+    Material material(210e9, 0.3);
+    Eigen::Matrix3d A;
+    A << 1e-3, 2e-4, 0.0,
+         0.0, -3e-4, 5e-4,
+         1e-4, 0.0, 2e-3;
+    Eigen::Matrix<double, 6, 1> eps;
+    eps << A(0, 0), A(1, 1), A(2, 2), A(0, 1) + A(1, 0), A(1, 2) + A(2, 1), A(0, 2) + A(2, 0);
+    Eigen::Matrix<double, 6, 1> sigma = material.getDMatrix() * eps;
+
+    StressResults results;
+    StressRecovery(mesh, 0).compute(material, linearField(mesh, A), results);
+
+    ASSERT_EQ(results.element_stress.cols(), static_cast<Eigen::Index>(mesh.getNumElements()));
+    ASSERT_EQ(results.nodal_stress.cols(), static_cast<Eigen::Index>(mesh.getNumNodes()));
+    for (Eigen::Index e = 0; e < results.element_stress.cols(); ++e) {
+        ASSERT_LE((results.element_strain.col(e) - eps).norm(), 1e-12);
+        ASSERT_LE((results.element_stress.col(e) - sigma).norm(), 1e-9 * sigma.norm());
+        ASSERT_NEAR(results.element_von_mises(e), StressRecovery::vonMises(sigma), 1e-9 * sigma.norm());
+    }
+    for (Eigen::Index n = 0; n < results.nodal_stress.cols(); ++n) {
+        ASSERT_LE((results.nodal_stress.col(n) - sigma).norm(), 1e-9 * sigma.norm());
+    }
+}
+
+TEST(StressRecoveryTest, MatchesTet4ElementAndIsThreadInvariant) {
+    Mesh mesh = makeBoxMesh(4);
+    Material material(70e9, 0.33);
+    Eigen::VectorXd U = Eigen::VectorXd::Random(mesh.getNumNodes() * 3) * 1e-3;
+
+    StressResults serial;
+    StressRecovery(mesh, 1).compute(material, U, serial);
+
+    for (size_t e = 0; e < mesh.getNumElements(); e += 37) {
+        Eigen::Matrix<double, 4, 3> coords;
+        Eigen::Matrix<double, 12, 1> u_e;
+        for (int i = 0; i < 4; ++i) {
+            int node = mesh.getElementNodes(e)[i];
+            coords.row(i) << mesh.getX()[node], mesh.getY()[node], mesh.getZ()[node];
+            u_e.segment<3>(3 * i) = U.segment<3>(3 * node);
+        }
+        Eigen::Matrix<double, 6, 1> expected = Tet4Element(coords).calculateStress(u_e, material);
+        ASSERT_LE((serial.element_stress.col(e) - expected).norm(), 1e-9 * expected.norm());
+    }
+
+    // Threads and the geometry cache change nothing, and reuse keeps the storage
+    ElementGeometry geometry(mesh);
+    StressRecovery parallel(mesh, 8);
+    parallel.setGeometry(&geometry);
+    StressResults results;
+    parallel.compute(material, U, results);
+    const double* storage = results.element_stress.data();
+    parallel.compute(material, U, results);
+    ASSERT_EQ(results.element_stress.data(), storage);
+    ASSERT_LE((results.element_stress - serial.element_stress).norm(), 1e-12 * serial.element_stress.norm());
+    ASSERT_LE((results.nodal_stress - serial.nodal_stress).norm(), 1e-12 * serial.nodal_stress.norm());
+}
+
+TEST(StressRecoveryTest, MeshChangesAfterConstructionAreSeen) {
+    Mesh mesh = makeBoxMesh(3);
+    Material material(210e9, 0.3);
+    ElementGeometry geometry(mesh);
+    StressRecovery recovery(mesh, 2);
+    recovery.setGeometry(&geometry);
+
+    // A moved node makes the cached gradients stale
+    mesh.setNodeCoordinates(mesh.getNodeIndex(22), 1.3, 1.2, 1.4);
+    Eigen::VectorXd U = Eigen::VectorXd::Random(mesh.getNumNodes() * 3) * 1e-3;
+    StressResults expected, results;
+    StressRecovery(mesh).compute(material, U, expected);
+    recovery.compute(material, U, results);
+    ASSERT_LE((results.element_stress - expected.element_stress).norm(), 1e-12 * expected.element_stress.norm());
+    ASSERT_LE((results.nodal_stress - expected.nodal_stress).norm(), 1e-12 * expected.nodal_stress.norm());
+
+    // Renumbered nodes make the node-to-element incidence stale
+    std::vector<int> reverse(mesh.getNumNodes());
+    Eigen::VectorXd U_reversed(U.size());
+    for (size_t i = 0; i < reverse.size(); ++i) {
+        reverse[i] = static_cast<int>(reverse.size() - 1 - i);
+        U_reversed.segment<3>(3 * reverse[i]) = U.segment<3>(3 * i);
+    }
+    mesh.permuteNodes(reverse);
+    StressRecovery(mesh).compute(material, U_reversed, expected);
+    recovery.compute(material, U_reversed, results);
+    ASSERT_LE((results.nodal_stress - expected.nodal_stress).norm(), 1e-12 * expected.nodal_stress.norm());
+}
+
+TEST(StressRecoveryTest, VonMisesOfSimpleStates) {
+    Eigen::Matrix<double, 6, 1> uniaxial;
+    uniaxial << 100.0, 0, 0, 0, 0, 0;
+    ASSERT_NEAR(StressRecovery::vonMises(uniaxial), 100.0, 1e-12);
+
+    Eigen::Matrix<double, 6, 1> hydrostatic;
+    hydrostatic << -5.0, -5.0, -5.0, 0, 0, 0;
+    ASSERT_NEAR(StressRecovery::vonMises(hydrostatic), 0.0, 1e-12);
+
+    Eigen::Matrix<double, 6, 1> shear;
+    shear << 0, 0, 0, 10.0, 0, 0;
+    ASSERT_NEAR(StressRecovery::vonMises(shear), 10.0 * std::sqrt(3.0), 1e-12);
+}
+
+TEST(StressRecoveryTest, Throughput) {
+    Mesh mesh = makeBoxMesh(16);
+    Material material(210e9, 0.3);
+    Eigen::VectorXd U = Eigen::VectorXd::Random(mesh.getNumNodes() * 3) * 1e-3;
+    StressRecovery recovery(mesh, 0);
+    StressResults results;
+
+    auto t0 = std::chrono::steady_clock::now();
+    recovery.compute(material, U, results);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    ASSERT_TRUE(results.nodal_von_mises.allFinite());
+    std::cout << "[ INFO     ] " << mesh.getNumElements() << " elements: stress recovery " << seconds << " s ("
+              << mesh.getNumElements() / seconds / 1e6 << " M elements/s)" << std::endl;
+}
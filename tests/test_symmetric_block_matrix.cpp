@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include "SymmetricBlockMatrix.h"
+#include "Assembler.h"
+#include "BoundaryConditions.h"
+#include "Mesh.h"
+#include "Material.h"
+#include "NodeOrdering.h"
+#include "TestMeshes.h"
+#include <Eigen/IterativeLinearSolvers>
+#include <Eigen/SparseCholesky>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+SymmetricBlockMatrix blockStiffness(const Mesh& mesh) {
+    Assembler assembler;
+    return assembler.assembleBlockStiffness(mesh, Material(210e9, 0.3), assembler.buildPattern(mesh));
+}
+
+// DOFs of every node on the z = 0 face
+std::vector<int> bottomFaceDofs(const Mesh& mesh) {
+    std::vector<int> dofs;
+    for (size_t i = 0; i < mesh.getNumNodes(); ++i) {
+        if (mesh.getZ()[i] == 0.0) {
+            for (int d = 0; d < 3; ++d) {
+                dofs.push_back(static_cast<int>(i) * 3 + d);
+            }
+        }
+    }
+    return dofs;
+}
+
+} // namespace
+
+TEST(SymmetricBlockMatrixTest, ProductMatchesExpandedMatrix) {
+    Mesh mesh = makeBoxMesh(4);
+    SymmetricBlockMatrix K_blocks = blockStiffness(mesh);
+    Eigen::SparseMatrix<double> K = K_blocks.toEigen();
+    Eigen::VectorXd x = Eigen::VectorXd::Random(K.rows());
+    Eigen::VectorXd expected = K * x;
+
+    // Serial and threaded; transposed blocks cross thread boundaries
+    for (unsigned threads : {1u, 2u, 5u}) {
+        K_blocks.setNumThreads(threads);
+        Eigen::VectorXd y = K_blocks * x;
+        EXPECT_LE((y - expected).norm(), 1e-14 * expected.norm()) << threads << " threads";
+
+        // y += alpha A x keeps what y held
+        Eigen::VectorXd z = Eigen::VectorXd::Ones(K.rows());
+        K_blocks.multiplyAdd(x, z, -0.5);
+        EXPECT_LE((z - (Eigen::VectorXd::Ones(K.rows()) - 0.5 * expected)).norm(), 1e-14 * expected.norm());
+    }
+    EXPECT_LE((K_blocks.diagonal() - K.diagonal()).norm(), 1e-15 * K.diagonal().norm());
+}
+
+TEST(SymmetricBlockMatrixTest, StoresOneIndexPerUpperBlock) {
+    Mesh mesh = makeBoxMesh(6);
+    SymmetricBlockMatrix K_blocks = blockStiffness(mesh);
+    Eigen::SparseMatrix<double> K = K_blocks.toEigen();
+
+    EXPECT_EQ(K_blocks.nonZeros(), K.nonZeros());
+    EXPECT_EQ(K_blocks.blockRows(), static_cast<Eigen::Index>(mesh.getNumNodes()));
+    for (Eigen::Index i = 0; i < K_blocks.blockRows(); ++i) {
+        EXPECT_EQ(K_blocks.columns()[K_blocks.rowOffsets()[i]], i);
+        EXPECT_EQ(K_blocks.findBlock(static_cast<int>(i), static_cast<int>(i)), K_blocks.rowOffsets()[i]);
+    }
+    EXPECT_EQ(K_blocks.findBlock(0, static_cast<int>(K_blocks.blockRows()) - 1), -1);
+
+    size_t csc_bytes = K.nonZeros() * (sizeof(double) + sizeof(int)) + (K.outerSize() + 1) * sizeof(int);
+    std::cout << "[ INFO     ] " << K.rows() << " DOFs: CSC " << csc_bytes << " B, blocks " << K_blocks.memoryBytes()
+              << " B" << std::endl;
+    EXPECT_LT(K_blocks.memoryBytes(), csc_bytes / 2);
+}
+
+TEST(SymmetricBlockMatrixTest, ConjugateGradientMatchesDirectSolve) {
+    Mesh mesh = makeBoxMesh(4);
+    std::vector<int> fixed_dofs = bottomFaceDofs(mesh);
+    SymmetricBlockMatrix K_blocks = blockStiffness(mesh);
+    K_blocks.eliminateDofs(fixed_dofs);
+    Eigen::SparseMatrix<double> K = K_blocks.toEigen();
+
+    Eigen::VectorXd F = Eigen::VectorXd::Zero(K.rows());
+    F(F.size() - 1) = -1e7; // Pull down the top corner
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> ldlt(K);
+    ASSERT_EQ(ldlt.info(), Eigen::Success);
+    Eigen::VectorXd U_ref = ldlt.solve(F);
+
+    Eigen::ConjugateGradient<SymmetricBlockMatrix, Eigen::Lower | Eigen::Upper, BlockJacobiPreconditioner> cg;
+    cg.setTolerance(1e-12);
+    cg.compute(K_blocks);
+    Eigen::VectorXd U = cg.solve(F);
+    ASSERT_EQ(cg.info(), Eigen::Success);
+    EXPECT_LE((U - U_ref).norm(), 1e-8 * U_ref.norm());
+    for (int dof : fixed_dofs) {
+        EXPECT_EQ(U(dof), 0.0);
+    }
+}
+
+TEST(SymmetricBlockMatrixTest, EliminationLiftsNonzeroPrescribedValues) {
+    Mesh mesh = makeBoxMesh(4);
+    double top = *std::max_element(mesh.getZ().begin(), mesh.getZ().end());
+    BoundaryConditions bcs(mesh);
+    std::vector<int> constrained_dofs;
+    for (size_t i = 0; i < mesh.getNumNodes(); ++i) {
+        int node = static_cast<int>(i);
+        if (mesh.getZ()[i] == 0.0) {
+            bcs.fixNode(mesh.getNodeIds()[i]);
+            constrained_dofs.insert(constrained_dofs.end(), {3 * node, 3 * node + 1, 3 * node + 2});
+        } else if (mesh.getZ()[i] == top) {
+            bcs.prescribe(mesh.getNodeIds()[i], 2, -1e-3);
+            constrained_dofs.push_back(3 * node + 2);
+        }
+    }
+    SymmetricBlockMatrix K_blocks = blockStiffness(mesh);
+    Eigen::VectorXd F = Eigen::VectorXd::Zero(K_blocks.rows());
+    F(F.size() - 3) = 1e5; // A side load on the top corner as well
+
+    Eigen::SparseMatrix<double> K_ff;
+    Eigen::VectorXd F_f;
+    bcs.reduce(K_blocks.toEigen(), F, K_ff, F_f);
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> ldlt(K_ff);
+    ASSERT_EQ(ldlt.info(), Eigen::Success);
+    Eigen::VectorXd U_ref = bcs.expand(ldlt.solve(F_f));
+
+    Eigen::VectorXd rhs = F;
+    K_blocks.eliminateDofs(constrained_dofs, U_ref, rhs); // Only the constrained entries are read
+    Eigen::ConjugateGradient<SymmetricBlockMatrix, Eigen::Lower | Eigen::Upper, BlockJacobiPreconditioner> cg;
+    cg.setTolerance(1e-12);
+    cg.compute(K_blocks);
+    Eigen::VectorXd U = cg.solve(rhs);
+    ASSERT_EQ(cg.info(), Eigen::Success);
+    EXPECT_LE((U - U_ref).norm(), 1e-8 * U_ref.norm());
+    for (int dof : constrained_dofs) {
+        EXPECT_NEAR(U(dof), U_ref(dof), 1e-12);
+    }
+
+    Eigen::VectorXd short_rhs = Eigen::VectorXd::Zero(3);
+    EXPECT_THROW(K_blocks.eliminateDofs(constrained_dofs, U_ref, short_rhs), std::invalid_argument);
+}
+
+TEST(SymmetricBlockMatrixTest, ThreadedProductMatchesAfterReordering) {
+    // With a small bandwidth the transposed blocks mostly stay inside a thread's rows
+    Mesh mesh = makeBoxMesh(5);
+    NodeAdjacency adjacency = buildNodeAdjacency(mesh, buildNodeElementIncidence(mesh));
+    mesh.permuteNodes(computeNodeOrdering(adjacency, NodeOrdering::RCM));
+    SymmetricBlockMatrix K_blocks = blockStiffness(mesh);
+    Eigen::SparseMatrix<double> K = K_blocks.toEigen();
+    Eigen::VectorXd x = Eigen::VectorXd::Random(K.rows());
+    Eigen::VectorXd expected = K * x;
+    K_blocks.setNumThreads(4);
+    EXPECT_LE((K_blocks * x - expected).norm(), 1e-14 * expected.norm());
+}
+
+TEST(SymmetricBlockMatrixTest, RejectsMalformedStructure) {
+    // Row 0 must start with its own diagonal block
+    EXPECT_THROW(SymmetricBlockMatrix(2, {0, 1, 2}, {1, 1}), std::invalid_argument);
+    // Columns above the diagonal must ascend
+    EXPECT_THROW(SymmetricBlockMatrix(3, {0, 3, 4, 5}, {0, 2, 1, 1, 2}), std::invalid_argument);
+    // Offsets must cover the columns
+    EXPECT_THROW(SymmetricBlockMatrix(2, {0, 1}, {0}), std::invalid_argument);
+
+    SymmetricBlockMatrix A(2, {0, 2, 3}, {0, 1, 1});
+    EXPECT_EQ(A.nonZeroBlocks(), 3);
+    EXPECT_EQ(A.nonZeros(), 36);
+    EXPECT_EQ(A.toEigen().nonZeros(), 36);
+}
@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include "VtuWriter.h"
+#include "TestMeshes.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#ifdef FEM_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+// Reads back the appended arrays of a VTU written by VtuWriter, in header order
+static std::vector<std::vector<char>> readAppendedArrays(const std::string& filename, bool compressed) {
+    std::ifstream in(filename, std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    std::string file = ss.str();
+
+    std::vector<uint64_t> offsets;
+    for (size_t pos = file.find("offset=\""); pos != std::string::npos; pos = file.find("offset=\"", pos + 1)) {
+        offsets.push_back(std::stoull(file.substr(pos + 8, 20)));
+    }
+    size_t start = file.find("<AppendedData encoding=\"raw\">");
+    EXPECT_NE(start, std::string::npos);
+    start = file.find('_', start) + 1;
+
+    std::vector<std::vector<char>> arrays;
+    for (uint64_t offset : offsets) {
+        const char* p = file.data() + start + offset;
+        uint64_t header[3];
+        std::memcpy(header, p, sizeof(header));
+        std::vector<char> data;
+        if (!compressed) {
+            data.assign(p + 8, p + 8 + header[0]);
+        } else {
+#ifdef FEM_HAVE_ZLIB
+            uint64_t num_blocks = header[0];
+            std::vector<uint64_t> sizes(num_blocks);
+            std::memcpy(sizes.data(), p + 24, num_blocks * 8);
+            const char* block = p + 24 + num_blocks * 8;
+            for (uint64_t b = 0; b < num_blocks; ++b) {
+                uLongf raw = b + 1 == num_blocks ? header[2] : header[1];
+                std::vector<char> out(raw);
+                EXPECT_EQ(uncompress(reinterpret_cast<Bytef*>(out.data()), &raw,
+                                     reinterpret_cast<const Bytef*>(block), sizes[b]),
+                          Z_OK);
+                data.insert(data.end(), out.begin(), out.begin() + raw);
+                block += sizes[b];
+            }
+#endif
+        }
+        arrays.push_back(data);
+    }
+    return arrays;
+}
+
+template <typename T>
+static std::vector<T> as(const std::vector<char>& bytes) {
+    std::vector<T> values(bytes.size() / sizeof(T));
+    std::memcpy(values.data(), bytes.data(), values.size() * sizeof(T));
+    return values;
+}
+
+static Mesh makeMixedMesh() {
+    Mesh mesh;
+    for (int i = 0; i < 12; ++i) {
+        mesh.addNode(100 + 3 * i, 0.5 * i, 0.25 * i * i, -1.0 * i);
+    }
+    mesh.addElement({100, 103, 106, 109});
+    mesh.addElement({100, 103, 106, 109, 112, 115, 118, 121});
+    mesh.addElement({100, 103, 106, 109, 112, 115, 118, 121, 124, 127});
+    return mesh;
+}
+
+static void checkRoundTrip(bool compressed) {
+    Mesh mesh = makeMixedMesh();
+    Eigen::VectorXd displacement = Eigen::VectorXd::Random(mesh.getNumNodes() * 3);
+    Eigen::VectorXd von_mises = Eigen::VectorXd::Random(mesh.getNumNodes());
+    Eigen::VectorXd element_stress = Eigen::VectorXd::Random(mesh.getNumElements() * 6);
+
+    VtuWriter writer(mesh);
+    writer.setCompression(compressed ? VtuWriter::Compression::Zlib : VtuWriter::Compression::None);
+    writer.addPointData("Displacement", displacement, 3);
+    writer.addPointData("VonMises", von_mises, 1);
+    writer.addCellData("ElementStress", element_stress, 6);
+    ASSERT_TRUE(writer.write("roundtrip.vtu"));
+
+    auto arrays = readAppendedArrays("roundtrip.vtu", compressed);
+    ASSERT_EQ(arrays.size(), 7u);
+
+    auto points = as<double>(arrays[0]);
+    ASSERT_EQ(points.size(), mesh.getNumNodes() * 3);
+    for (size_t i = 0; i < mesh.getNumNodes(); ++i) {
+        EXPECT_EQ(points[3 * i + 0], mesh.getX()[i]);
+        EXPECT_EQ(points[3 * i + 1], mesh.getY()[i]);
+        EXPECT_EQ(points[3 * i + 2], mesh.getZ()[i]);
+    }
+    EXPECT_EQ(as<int32_t>(arrays[1]), std::vector<int32_t>(mesh.getConnectivity().begin(), mesh.getConnectivity().end()));
+    EXPECT_EQ(as<int64_t>(arrays[2]), (std::vector<int64_t>{4, 12, 22}));
+    EXPECT_EQ(as<uint8_t>(arrays[3]), (std::vector<uint8_t>{10, 12, 24}));
+
+    auto same = [](const std::vector<char>& bytes, const Eigen::VectorXd& v) {
+        return as<double>(bytes) == std::vector<double>(v.data(), v.data() + v.size());
+    };
+    EXPECT_TRUE(same(arrays[4], displacement));
+    EXPECT_TRUE(same(arrays[5], von_mises));
+    EXPECT_TRUE(same(arrays[6], element_stress));
+}
+
+TEST(VtuWriterTest, RawAppendedDataRoundTrips) {
+    checkRoundTrip(false);
+}
+
+TEST(VtuWriterTest, CompressedAppendedDataRoundTrips) {
+    if (!VtuWriter::zlibAvailable()) {
+        GTEST_SKIP() << "built without zlib";
+    }
+    checkRoundTrip(true);
+}
+
+TEST(VtuWriterTest, HeaderDescribesGridAndFields) {
+    Mesh mesh = makeBoxMesh(2);
+    Eigen::VectorXd displacement = Eigen::VectorXd::Zero(mesh.getNumNodes() * 3);
+    VtuWriter writer(mesh);
+    writer.addPointData("Displacement", displacement, 3);
+    ASSERT_TRUE(writer.write("header.vtu"));
+
+    std::ifstream in("header.vtu", std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    std::string file = ss.str();
+    EXPECT_NE(file.find("type=\"UnstructuredGrid\""), std::string::npos);
+    EXPECT_NE(file.find("NumberOfPoints=\"27\" NumberOfCells=\"48\""), std::string::npos);
+    EXPECT_NE(file.find("Name=\"Displacement\" NumberOfComponents=\"3\""), std::string::npos);
+    EXPECT_EQ(file.find("compressor="), std::string::npos);
+    EXPECT_EQ(file.substr(file.size() - 11), "</VTKFile>\n");
+}
+
+TEST(VtuWriterTest, UnwritablePathFails) {
+    Mesh mesh = makeBoxMesh(1);
+    VtuWriter writer(mesh);
+    EXPECT_FALSE(writer.write("no_such_directory/out.vtu"));
+}